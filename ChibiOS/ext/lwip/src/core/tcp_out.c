@@ -874,7 +874,9 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
 #if CHECKSUM_GEN_TCP
   tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
         IP_PROTO_TCP, p->tot_len);
-#endif
+#else /* CHECKSUM_GEN_TCP */
+  (void)tcphdr;
+#endif /* CHECKSUM_GEN_TCP */
 #if LWIP_NETIF_HWADDRHINT
   ip_output_hinted(p, &(pcb->local_ip), &(pcb->remote_ip), pcb->ttl, pcb->tos,
       IP_PROTO_TCP, &(pcb->addr_hint));
@@ -1384,7 +1386,9 @@ tcp_keepalive(struct tcp_pcb *pcb)
 #if CHECKSUM_GEN_TCP
   tcphdr->chksum = inet_chksum_pseudo(p, &pcb->local_ip, &pcb->remote_ip,
                                       IP_PROTO_TCP, p->tot_len);
-#endif
+#else /* CHECKSUM_GEN_TCP */
+  (void)tcphdr;
+#endif /* CHECKSUM_GEN_TCP */
   TCP_STATS_INC(tcp.xmit);
 
   /* Send output to IP */
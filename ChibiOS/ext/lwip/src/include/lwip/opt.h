@@ -141,6 +141,14 @@
 #define MEMP_SEPARATE_POOLS             0
 #endif
 
+/**
+ * MEM_SECTION: storage attributes of the heap and of the pools memory,
+ * used to place them in a specific RAM section.
+ */
+#ifndef MEM_SECTION
+#define MEM_SECTION
+#endif
+
 /**
  * MEMP_OVERFLOW_CHECK: memp overflow protection reserves a configurable
  * amount of bytes before and after each memp element in every pool and fills
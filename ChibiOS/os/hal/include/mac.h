@@ -30,6 +30,27 @@
 /* Driver constants.                                                         */
 /*===========================================================================*/
 
+/**
+ * @name    Receive checksum status
+ * @brief   Values of the @p checksum field of a receive descriptor, the
+ *          checksums verified by the MAC for the frame. Frames failing a
+ *          verified checksum are dropped by the driver.
+ * @{
+ */
+/**
+ * @brief   Nothing verified, not an IPv4 frame or no offload.
+ */
+#define MAC_CHECKSUM_NONE           0U
+/**
+ * @brief   IPv4 header checksum verified, payload not, as for fragments.
+ */
+#define MAC_CHECKSUM_IP             1U
+/**
+ * @brief   IPv4 header and TCP, UDP or ICMP checksums verified.
+ */
+#define MAC_CHECKSUM_ALL            3U
+/** @} */
+
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -293,6 +293,12 @@ typedef struct {
  * @param[in] id        a vector name as defined in @p vectors.s
  */
 #define OSAL_IRQ_HANDLER(id) CH_IRQ_HANDLER(id)
+
+/**
+ * @brief   Marks a function to be executed from RAM.
+ * @details Meant for the hot IRQ and data paths of the drivers.
+ */
+#define OSAL_RAMFUNC CH_RAMFUNC
 /** @} */
 
 /**
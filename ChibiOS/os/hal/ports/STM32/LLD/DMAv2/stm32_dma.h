@@ -384,6 +384,22 @@ typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Checks if an address is in the core coupled memory.
+ * @details The CCM is only connected to the core D-bus, the DMA
+ *          controllers cannot reach it.
+ *
+ * @param[in] addr      address to be checked
+ * @return              The test result.
+ */
+#if defined(CCMDATARAM_BASE) || defined(__DOXYGEN__)
+#define STM32_DMA_IS_CCM(addr)                                              \
+  (((uint32_t)(addr) - CCMDATARAM_BASE) <=                                  \
+   (CCMDATARAM_END - CCMDATARAM_BASE))
+#else
+#define STM32_DMA_IS_CCM(addr)      false
+#endif
+
 #if STM32_DMA_CACHE_HANDLING || defined(__DOXYGEN__)
 /**
  * @brief   Invalidates the data cache lines overlapping a DMA buffer.
@@ -476,10 +492,12 @@ typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
  *
  * @param[in] dmastp    pointer to a stm32_dma_stream_t structure
  * @param[in] addr      value to be written in the M0AR register
+ *                      it must not be in CCM, checked by an assertion
  *
  * @special
  */
 #define dmaStreamSetMemory0(dmastp, addr) {                                 \
+  osalDbgAssert(!STM32_DMA_IS_CCM(addr), "CCM not reachable by DMA");       \
   (dmastp)->stream->M0AR  = (uint32_t)(addr);                               \
 }
 
@@ -489,10 +507,12 @@ typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
  *
  * @param[in] dmastp    pointer to a stm32_dma_stream_t structure
  * @param[in] addr      value to be written in the M1AR register
+ *                      it must not be in CCM, checked by an assertion
  *
  * @special
  */
 #define dmaStreamSetMemory1(dmastp, addr) {                                 \
+  osalDbgAssert(!STM32_DMA_IS_CCM(addr), "CCM not reachable by DMA");       \
   (dmastp)->stream->M1AR  = (uint32_t)(addr);                               \
 }
 
@@ -51,6 +51,19 @@
 #error "STM32_HCLK below minimum frequency for ETH operations (20MHz)"
 #endif
 
+/* Receive errors. With the checksum offload ES also sums up IPHCE and PCE,
+   which are a checksum status then, see rx_checksum_valid().*/
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD
+#define RDES0_ERRORS    (STM32_RDES0_DESERR | STM32_RDES0_OE |              \
+                         STM32_RDES0_LCO | STM32_RDES0_RWT |                \
+                         STM32_RDES0_RE | STM32_RDES0_CE)
+#else
+#define RDES0_ERRORS    STM32_RDES0_ES
+#endif
+
+/* Checksum status bits of RDES0 with the offload enabled.*/
+#define RDES0_CSUM_MASK (STM32_RDES0_FT | STM32_RDES0_IPHCE | STM32_RDES0_PCE)
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -169,11 +182,58 @@ static void mac_lld_set_address(const uint8_t *p) {
   ETH->MACHTLR   = 0;
 }
 
+/**
+ * @brief   Checks the checksum status of a received frame.
+ * @details With the offload the FT, IPHCE and PCE bits of RDES0 encode:
+ *          - FT=0 IPHCE=0 PCE=0 IEEE 802.3 frame, not checked.
+ *          - FT=1 IPHCE=0 PCE=0 IP frame, checksums good.
+ *          - FT=0 IPHCE=0 PCE=1 IP frame, header good, payload bypassed.
+ *          - FT=0 IPHCE=1 PCE=1 Type frame other than IP, not checked.
+ *          - FT=1 with IPHCE or PCE set, IP frame with a bad checksum.
+ *          .
+ *
+ * @param[in] rdes0     the RDES0 word of the last descriptor of the frame
+ * @return              @p false if the frame must be dropped.
+ */
+static inline bool rx_checksum_valid(uint32_t rdes0) {
+
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD
+  return !((rdes0 & STM32_RDES0_FT) &&
+           (rdes0 & (STM32_RDES0_IPHCE | STM32_RDES0_PCE)));
+#else
+  (void)rdes0;
+  return true;
+#endif
+}
+
+/**
+ * @brief   Checksums verified for a valid received frame.
+ *
+ * @param[in] rdes0     the RDES0 word of the last descriptor of the frame
+ * @return              One of the @p MAC_CHECKSUM_ values.
+ */
+static inline uint32_t rx_checksum_status(uint32_t rdes0) {
+
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD
+  switch (rdes0 & RDES0_CSUM_MASK) {
+  case STM32_RDES0_FT:
+    return MAC_CHECKSUM_ALL;
+  case STM32_RDES0_PCE:
+    return MAC_CHECKSUM_IP;
+  default:
+    return MAC_CHECKSUM_NONE;
+  }
+#else
+  (void)rdes0;
+  return MAC_CHECKSUM_NONE;
+#endif
+}
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
 
-OSAL_IRQ_HANDLER(STM32_ETH_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_ETH_HANDLER) {
   uint32_t dmasr;
 
   OSAL_IRQ_PROLOGUE();
@@ -399,6 +459,7 @@ void mac_lld_stop(MACDriver *macp) {
  *
  * @notapi
  */
+OSAL_RAMFUNC
 msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
                                       MACTransmitDescriptor *tdp) {
   stm32_eth_tx_descriptor_t *tdes;
@@ -442,6 +503,7 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
  *
  * @notapi
  */
+OSAL_RAMFUNC
 void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp) {
 
   osalDbgAssert(!(tdp->physdesc->tdes0 & STM32_TDES0_OWN),
@@ -475,6 +537,7 @@ void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp) {
  *
  * @notapi
  */
+OSAL_RAMFUNC
 msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
                                      MACReceiveDescriptor *rdp) {
   stm32_eth_rx_descriptor_t *rdes;
@@ -487,15 +550,13 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
   /* Iterates through received frames until a valid one is found, invalid
      frames are discarded.*/
   while (!(rdes->rdes0 & STM32_RDES0_OWN)) {
-    if (!(rdes->rdes0 & (STM32_RDES0_AFM | STM32_RDES0_ES))
-#if STM32_MAC_IP_CHECKSUM_OFFLOAD
-        && (rdes->rdes0 & STM32_RDES0_FT)
-        && !(rdes->rdes0 & (STM32_RDES0_IPHCE | STM32_RDES0_PCE))
-#endif
-        && (rdes->rdes0 & STM32_RDES0_FS) && (rdes->rdes0 & STM32_RDES0_LS)) {
+    if (!(rdes->rdes0 & (STM32_RDES0_AFM | RDES0_ERRORS))
+        && (rdes->rdes0 & STM32_RDES0_FS) && (rdes->rdes0 & STM32_RDES0_LS)
+        && rx_checksum_valid(rdes->rdes0)) {
       /* Found a valid one.*/
       rdp->offset   = 0;
       rdp->size     = ((rdes->rdes0 & STM32_RDES0_FL_MASK) >> 16) - 4;
+      rdp->checksum = rx_checksum_status(rdes->rdes0);
       rdp->physdesc = rdes;
       macp->rxptr   = (stm32_eth_rx_descriptor_t *)rdes->rdes3;
 
@@ -523,6 +584,7 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
  *
  * @notapi
  */
+OSAL_RAMFUNC
 void mac_lld_release_receive_descriptor(MACReceiveDescriptor *rdp) {
 
   osalDbgAssert(!(rdp->physdesc->rdes0 & STM32_RDES0_OWN),
@@ -625,6 +687,7 @@ bool mac_lld_poll_link_status(MACDriver *macp) {
  *
  * @notapi
  */
+OSAL_RAMFUNC
 size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
                                          uint8_t *buf,
                                          size_t size) {
@@ -655,6 +718,7 @@ size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
  *
  * @notapi
  */
+OSAL_RAMFUNC
 size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
                                        uint8_t *buf,
                                        size_t size) {
@@ -306,6 +306,11 @@ typedef struct {
    */
   size_t                size;
   /* End of the mandatory fields.*/
+  /**
+   * @brief Checksums verified by the MAC, @p MAC_CHECKSUM_NONE unless
+   *        @p STM32_MAC_IP_CHECKSUM_OFFLOAD is enabled.
+   */
+  uint32_t              checksum;
   /**
    * @brief Pointer to the physical descriptor.
    */
@@ -55,6 +55,12 @@ static union {
   uint32_t  alignment;
   uint8_t   buf[MMCSD_BLOCK_SIZE];
 } u;
+
+/**
+ * @brief   Buffers the DMA cannot transfer directly, unaligned or in CCM.
+ */
+#define SDC_NEEDS_BOUNCE(buf)                                               \
+  ((((unsigned)(buf) & 3U) != 0U) || STM32_DMA_IS_CCM(buf))
 #endif /* STM32_SDC_SDIO_UNALIGNED_SUPPORT */
 
 
@@ -317,7 +323,7 @@ static void sdc_lld_error_cleanup(SDCDriver *sdcp,
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_SDIO_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_SDIO_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -802,7 +808,7 @@ bool sdc_lld_read(SDCDriver *sdcp, uint32_t startblk,
                   uint8_t *buf, uint32_t blocks) {
 
 #if STM32_SDC_SDIO_UNALIGNED_SUPPORT
-  if (((unsigned)buf & 3) != 0) {
+  if (SDC_NEEDS_BOUNCE(buf)) {
     uint32_t i;
     for (i = 0; i < blocks; i++) {
       if (sdc_lld_read_aligned(sdcp, startblk, u.buf, 1))
@@ -835,7 +841,7 @@ bool sdc_lld_write(SDCDriver *sdcp, uint32_t startblk,
                    const uint8_t *buf, uint32_t blocks) {
 
 #if STM32_SDC_SDIO_UNALIGNED_SUPPORT
-  if (((unsigned)buf & 3) != 0) {
+  if (SDC_NEEDS_BOUNCE(buf)) {
     uint32_t i;
     for (i = 0; i < blocks; i++) {
       memcpy(u.buf, buf, MMCSD_BLOCK_SIZE);
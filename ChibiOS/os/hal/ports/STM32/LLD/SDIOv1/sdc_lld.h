@@ -95,6 +95,7 @@
 /**
  * @brief   Support for unaligned transfers.
  * @note    Unaligned transfers are much slower.
+ * @note    Buffers in CCM take the same path, the DMA cannot reach them.
  */
 #if !defined(STM32_SDC_SDIO_UNALIGNED_SUPPORT) || defined(__DOXYGEN__)
 #define STM32_SDC_SDIO_UNALIGNED_SUPPORT    TRUE
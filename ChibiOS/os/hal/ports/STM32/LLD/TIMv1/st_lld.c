@@ -217,7 +217,7 @@
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(SysTick_Handler) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(SysTick_Handler) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -236,7 +236,7 @@ OSAL_IRQ_HANDLER(SysTick_Handler) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(ST_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(ST_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -160,7 +160,7 @@ static void set_error(SerialDriver *sdp, uint16_t sr) {
  *
  * @param[in] sdp       communication channel associated to the USART
  */
-static void serve_interrupt(SerialDriver *sdp) {
+OSAL_RAMFUNC static void serve_interrupt(SerialDriver *sdp) {
   USART_TypeDef *u = sdp->usart;
   uint16_t cr1 = u->CR1;
   uint16_t sr = u->SR;
@@ -291,7 +291,7 @@ static void notify8(io_queue_t *qp) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_USART1_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_USART1_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -310,7 +310,7 @@ OSAL_IRQ_HANDLER(STM32_USART1_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_USART2_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_USART2_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -329,7 +329,7 @@ OSAL_IRQ_HANDLER(STM32_USART2_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_USART3_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_USART3_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -348,7 +348,7 @@ OSAL_IRQ_HANDLER(STM32_USART3_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_UART4_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_UART4_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -367,7 +367,7 @@ OSAL_IRQ_HANDLER(STM32_UART4_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_UART5_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_UART5_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -386,7 +386,7 @@ OSAL_IRQ_HANDLER(STM32_UART5_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_USART6_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_USART6_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -405,7 +405,7 @@ OSAL_IRQ_HANDLER(STM32_USART6_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_UART7_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_UART7_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -424,7 +424,7 @@ OSAL_IRQ_HANDLER(STM32_UART7_HANDLER) {
  *
  * @isr
  */
-OSAL_IRQ_HANDLER(STM32_UART8_HANDLER) {
+OSAL_RAMFUNC OSAL_IRQ_HANDLER(STM32_UART8_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
@@ -0,0 +1,214 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_lld.c
+ * @brief   POSIX simulator HAL subsystem low level driver code.
+ * @details All the simulated peripherals are polled by
+ *          @p _sim_check_for_interrupts(), when it is invoked by the idle
+ *          thread and nothing is pending the process sleeps in @p ppoll()
+ *          until a registered descriptor becomes readable or the POSIX
+ *          timer used as tick source expires.
+ *
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Maximum number of host descriptors the idle thread waits on.
+ */
+#define SIM_MAX_WAIT_FDS                8
+
+/**
+ * @brief   Signal raised by the tick source timer.
+ */
+#define SIM_TIMER_SIGNAL                SIGALRM
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+static struct pollfd wait_fds[SIM_MAX_WAIT_FDS];
+static nfds_t nwait_fds;
+
+static timer_t sim_timer;
+
+/**
+ * @brief   Signal mask used while sleeping, the timer signal is blocked
+ *          at any other time so it can only interrupt @p ppoll().
+ */
+static sigset_t sim_wait_mask;
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static void sim_timer_handler(int sig) {
+
+  /* Nothing to do, the signal just wakes up ppoll().*/
+  (void)sig;
+}
+
+static void sim_reschedule(void) {
+
+  _dbg_check_lock();
+  if (chSchIsPreemptionRequired())
+    chSchDoReschedule();
+  _dbg_check_unlock();
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level HAL driver initialization.
+ */
+void hal_lld_init(void) {
+  struct sigaction sa;
+  struct sigevent sev;
+  sigset_t set;
+
+  printf("ChibiOS/RT simulator (POSIX)\n");
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sim_timer_handler;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIM_TIMER_SIGNAL, &sa, NULL);
+
+  sigemptyset(&set);
+  sigaddset(&set, SIM_TIMER_SIGNAL);
+  sigprocmask(SIG_BLOCK, &set, &sim_wait_mask);
+  sigdelset(&sim_wait_mask, SIM_TIMER_SIGNAL);
+
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_SIGNAL;
+  sev.sigev_signo = SIM_TIMER_SIGNAL;
+  if (timer_create(CLOCK_MONOTONIC, &sev, &sim_timer) != 0) {
+    printf("timer_create() error\n");
+    exit(1);
+  }
+
+  fflush(stdout);
+}
+
+/**
+ * @brief   Returns the host monotonic time in nanoseconds.
+ */
+uint64_t _sim_get_time_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief   Programs the tick source timer.
+ *
+ * @param[in] ns        absolute expiration time, zero disarms the timer
+ * @param[in] interval  reload interval, zero for a one shot expiration
+ */
+void _sim_timer_arm(uint64_t ns, uint64_t interval) {
+  struct itimerspec its;
+
+  its.it_value.tv_sec = (time_t)(ns / 1000000000ULL);
+  its.it_value.tv_nsec = (long)(ns % 1000000000ULL);
+  its.it_interval.tv_sec = (time_t)(interval / 1000000000ULL);
+  its.it_interval.tv_nsec = (long)(interval % 1000000000ULL);
+  timer_settime(sim_timer, TIMER_ABSTIME, &its, NULL);
+}
+
+/**
+ * @brief   Adds a host descriptor to the set the idle thread waits on.
+ *
+ * @param[in] fd        descriptor that becomes readable on new input
+ */
+void _sim_add_wait_fd(int fd) {
+
+  if (nwait_fds < SIM_MAX_WAIT_FDS) {
+    wait_fds[nwait_fds].fd = fd;
+    wait_fds[nwait_fds].events = POLLIN;
+    nwait_fds++;
+  }
+}
+
+/**
+ * @brief   Interrupt simulation.
+ */
+void _sim_check_for_interrupts(void) {
+
+#if HAL_USE_SERIAL
+  if (sd_lld_interrupt_pending()) {
+    sim_reschedule();
+    return;
+  }
+#endif
+
+#if HAL_USE_MAC
+  if (mac_lld_interrupt_pending()) {
+    sim_reschedule();
+    return;
+  }
+#endif
+
+  if (st_lld_interrupt_pending()) {
+    CH_IRQ_PROLOGUE();
+
+    chSysLockFromISR();
+    chSysTimerHandlerI();
+    chSysUnlockFromISR();
+
+    CH_IRQ_EPILOGUE();
+
+    sim_reschedule();
+    return;
+  }
+
+  /* Nothing pending, busy loops calling this function keep polling but
+     the idle thread sleeps until there is something to do.*/
+  if (chThdGetPriorityX() == IDLEPRIO) {
+    if ((ppoll(wait_fds, nwait_fds, NULL, &sim_wait_mask) < 0) &&
+        (errno != EINTR)) {
+      printf("ppoll() error\n");
+      exit(1);
+    }
+  }
+}
+
+/** @} */
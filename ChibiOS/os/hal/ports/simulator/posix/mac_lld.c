@@ -0,0 +1,770 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/mac_lld.c
+ * @brief   POSIX simulator MAC driver code.
+ * @details The link is always up. Frames are exchanged with a host TAP
+ *          interface or read from a pcap capture or, without either, the
+ *          transmitted frames are looped back; the transmitted frames can
+ *          also be captured into a pcap file that can be opened with the
+ *          usual network analysis tools. With
+ *          @p POSIX_MAC_IP_CHECKSUM_OFFLOAD the checksum offload of the
+ *          STM32 MAC is emulated on both paths.
+ *
+ * @addtogroup POSIX_MAC
+ * @{
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include "hal.h"
+
+#if HAL_USE_MAC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define PCAP_MAGIC                  0xA1B2C3D4U
+#define PCAP_LINKTYPE_ETHERNET      1U
+
+#define ETH_HEADER_SIZE             14U
+#define ETH_TYPE_IPV4               0x0800U
+#define IP_PROTO_ICMP               1U
+#define IP_PROTO_TCP                6U
+#define IP_PROTO_UDP                17U
+
+/* Receive checksum status of a frame to be dropped.*/
+#define RX_CHECKSUM_BAD             0xFFFFFFFFU
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Ethernet driver 1.
+ */
+MACDriver ETHD1;
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   pcap file header.
+ */
+typedef struct {
+  uint32_t              magic;
+  uint16_t              version_major;
+  uint16_t              version_minor;
+  int32_t               thiszone;
+  uint32_t              sigfigs;
+  uint32_t              snaplen;
+  uint32_t              network;
+} pcap_hdr_t;
+
+/**
+ * @brief   pcap record header.
+ */
+typedef struct {
+  uint32_t              ts_sec;
+  uint32_t              ts_usec;
+  uint32_t              incl_len;
+  uint32_t              orig_len;
+} pcap_rec_t;
+
+#if POSIX_MAC_IP_CHECKSUM_OFFLOAD || defined(__DOXYGEN__)
+/**
+ * @brief   IPv4 packet of a frame.
+ */
+typedef struct {
+  uint8_t               *header;
+  size_t                hlen;
+  uint8_t               *payload;
+  size_t                plen;
+  unsigned              proto;
+  bool                  fragment;
+} ipv4_packet_t;
+#endif
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Opens the input capture and checks its header.
+ */
+static FILE *pcap_open_in(const char *name) {
+  pcap_hdr_t hdr;
+  FILE *f;
+
+  f = fopen(name, "rb");
+  if (f == NULL)
+    return NULL;
+  if ((fread(&hdr, sizeof(hdr), 1, f) != 1) || (hdr.magic != PCAP_MAGIC) ||
+      (hdr.network != PCAP_LINKTYPE_ETHERNET)) {
+    printf("%s: not an Ethernet pcap file\n", name);
+    fclose(f);
+    return NULL;
+  }
+  return f;
+}
+
+/**
+ * @brief   Attaches to an existing or new host TAP interface.
+ * @note    Creating an interface needs @p CAP_NET_ADMIN, e.g.
+ *          "ip tuntap add dev tap0 mode tap user $USER" beforehand.
+ *
+ * @return              The non blocking descriptor, -1 on failure.
+ */
+static int tap_open(const char *name) {
+  struct ifreq ifr;
+  int fd;
+
+  fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+  if (fd < 0) {
+    printf("/dev/net/tun: %s\n", strerror(errno));
+    return -1;
+  }
+  memset(&ifr, 0, sizeof(ifr));
+  ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+  strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+  if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+    printf("%s: %s\n", name, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief   Creates the output capture.
+ */
+static FILE *pcap_open_out(const char *name) {
+  pcap_hdr_t hdr = {PCAP_MAGIC, 2, 4, 0, 0, POSIX_MAC_BUFFERS_SIZE,
+                    PCAP_LINKTYPE_ETHERNET};
+  FILE *f;
+
+  f = fopen(name, "wb");
+  if (f != NULL)
+    fwrite(&hdr, sizeof(hdr), 1, f);
+  return f;
+}
+
+/**
+ * @brief   Appends a frame to the output capture.
+ */
+static void pcap_write(FILE *f, const uint8_t *data, size_t length) {
+  struct timeval tv;
+  pcap_rec_t rec;
+
+  gettimeofday(&tv, NULL);
+  rec.ts_sec = (uint32_t)tv.tv_sec;
+  rec.ts_usec = (uint32_t)tv.tv_usec;
+  rec.incl_len = (uint32_t)length;
+  rec.orig_len = (uint32_t)length;
+  fwrite(&rec, sizeof(rec), 1, f);
+  fwrite(data, 1, length, f);
+  fflush(f);
+}
+
+#if POSIX_MAC_IP_CHECKSUM_OFFLOAD || defined(__DOXYGEN__)
+static uint16_t get16(const uint8_t *p) {
+
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+/**
+ * @brief   Adds big endian halfwords to a one's complement sum.
+ */
+static uint32_t csum_add(uint32_t sum, const uint8_t *p, size_t n) {
+
+  for (; n > 1; n -= 2, p += 2)
+    sum += get16(p);
+  if (n > 0)
+    sum += (uint32_t)p[0] << 8;
+  return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum) {
+
+  while (sum >> 16)
+    sum = (sum & 0xFFFFU) + (sum >> 16);
+  return (uint16_t)sum;
+}
+
+/**
+ * @brief   Offset of the checksum field in the payload, zero if the
+ *          protocol has none the MAC knows of.
+ */
+static size_t csum_field(unsigned proto) {
+
+  switch (proto) {
+  case IP_PROTO_TCP:
+    return 16;
+  case IP_PROTO_UDP:
+    return 6;
+  case IP_PROTO_ICMP:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief   Sum of the payload, with the pseudo header for TCP and UDP.
+ */
+static uint16_t csum_payload(const ipv4_packet_t *ipp, bool pseudo) {
+  uint32_t sum;
+
+  sum = csum_add(0, ipp->payload, ipp->plen);
+  if (pseudo && (ipp->proto != IP_PROTO_ICMP)) {
+    sum = csum_add(sum, ipp->header + 12, 8);
+    sum += ipp->proto + (uint32_t)ipp->plen;
+  }
+  return csum_fold(sum);
+}
+
+static bool is_ipv4(const uint8_t *data, size_t length) {
+
+  return (length >= ETH_HEADER_SIZE) &&
+         (get16(data + 12) == ETH_TYPE_IPV4);
+}
+
+/**
+ * @brief   Locates the IPv4 packet of a frame.
+ *
+ * @return              @p false if the IPv4 header is malformed.
+ */
+static bool ipv4_parse(uint8_t *data, size_t length, ipv4_packet_t *ipp) {
+  uint8_t *ip = data + ETH_HEADER_SIZE;
+  size_t avail = length - ETH_HEADER_SIZE, total;
+
+  if ((avail < 20) || ((ip[0] >> 4) != 4))
+    return false;
+  ipp->hlen = (size_t)(ip[0] & 0x0F) * 4;
+  total = get16(ip + 2);
+  if ((ipp->hlen < 20) || (total < ipp->hlen) || (total > avail))
+    return false;
+  ipp->header = ip;
+  ipp->payload = ip + ipp->hlen;
+  ipp->plen = total - ipp->hlen;
+  ipp->proto = ip[9];
+  ipp->fragment = (get16(ip + 6) & 0x3FFFU) != 0;
+  return true;
+}
+
+/**
+ * @brief   Inserts the checksums of a transmitted frame.
+ * @details As the STM32 MAC: the IP header checksum from mode 1, the
+ *          payload checksum of TCP, UDP and ICMP from mode 2, over the
+ *          payload and the field as left by the stack, and from mode 3
+ *          with the pseudo header and regardless of the field. Fragments
+ *          only get the header checksum.
+ */
+static void tx_insert_checksums(uint8_t *data, size_t length) {
+  ipv4_packet_t ip;
+  size_t at;
+  uint16_t sum;
+
+  if (!is_ipv4(data, length) || !ipv4_parse(data, length, &ip))
+    return;
+  put16(ip.header + 10, 0);
+  put16(ip.header + 10, (uint16_t)~csum_fold(csum_add(0, ip.header, ip.hlen)));
+  at = csum_field(ip.proto);
+  if ((POSIX_MAC_IP_CHECKSUM_OFFLOAD < 2) || ip.fragment || (at == 0) ||
+      (at + 2 > ip.plen))
+    return;
+  if (POSIX_MAC_IP_CHECKSUM_OFFLOAD == 3)
+    put16(ip.payload + at, 0);
+  sum = (uint16_t)~csum_payload(&ip, POSIX_MAC_IP_CHECKSUM_OFFLOAD == 3);
+  if ((ip.proto == IP_PROTO_UDP) && (sum == 0))
+    sum = 0xFFFFU;
+  put16(ip.payload + at, sum);
+}
+#endif /* POSIX_MAC_IP_CHECKSUM_OFFLOAD */
+
+/**
+ * @brief   Verifies the checksums of a received frame.
+ *
+ * @return              The @p MAC_CHECKSUM_ status of the frame or
+ *                      @p RX_CHECKSUM_BAD if it must be dropped.
+ */
+static uint32_t rx_checksum(uint8_t *data, size_t length) {
+#if POSIX_MAC_IP_CHECKSUM_OFFLOAD
+  ipv4_packet_t ip;
+  size_t at;
+
+  if (!is_ipv4(data, length))
+    return MAC_CHECKSUM_NONE;
+  if (!ipv4_parse(data, length, &ip) ||
+      (csum_fold(csum_add(0, ip.header, ip.hlen)) != 0xFFFFU))
+    return RX_CHECKSUM_BAD;
+  at = csum_field(ip.proto);
+  if (ip.fragment || (at == 0) || (at + 2 > ip.plen))
+    return MAC_CHECKSUM_IP;
+  /* A zero UDP checksum is not computed by the sender.*/
+  if ((ip.proto == IP_PROTO_UDP) && (get16(ip.payload + at) == 0))
+    return MAC_CHECKSUM_ALL;
+  return csum_payload(&ip, true) == 0xFFFFU ? MAC_CHECKSUM_ALL
+                                            : RX_CHECKSUM_BAD;
+#else
+  (void)data;
+  (void)length;
+  return MAC_CHECKSUM_NONE;
+#endif
+}
+
+/**
+ * @brief   Returns @p true if the receive ring has no free buffers.
+ */
+static bool rx_full(MACDriver *macp) {
+
+  return (macp->rxwr - macp->rxrd) >= POSIX_MAC_RECEIVE_BUFFERS;
+}
+
+/**
+ * @brief   Queues a frame into the receive ring.
+ * @note    Frames are dropped when the ring is full, as a real MAC would.
+ */
+static void rx_queue(MACDriver *macp, const uint8_t *data, size_t length) {
+  posix_mac_buffer_t *bp;
+
+  if (rx_full(macp) || (length > POSIX_MAC_BUFFERS_SIZE))
+    return;
+  bp = &macp->rxbuf[macp->rxwr % POSIX_MAC_RECEIVE_BUFFERS];
+  memcpy(bp->data, data, length);
+  bp->length = length;
+  macp->rxwr++;
+  macp->rxsignal = true;
+}
+
+/**
+ * @brief   Moves frames from the input capture into the receive ring.
+ */
+static void rx_replay(MACDriver *macp) {
+  posix_mac_buffer_t *bp;
+  pcap_rec_t rec;
+
+  while ((macp->pcap_in != NULL) && !rx_full(macp)) {
+    if (fread(&rec, sizeof(rec), 1, macp->pcap_in) != 1) {
+      fclose(macp->pcap_in);
+      macp->pcap_in = NULL;
+      break;
+    }
+    if (rec.incl_len > POSIX_MAC_BUFFERS_SIZE) {
+      fseek(macp->pcap_in, (long)rec.incl_len, SEEK_CUR);
+      continue;
+    }
+    bp = &macp->rxbuf[macp->rxwr % POSIX_MAC_RECEIVE_BUFFERS];
+    if (fread(bp->data, 1, rec.incl_len, macp->pcap_in) != rec.incl_len)
+      continue;
+    bp->length = rec.incl_len;
+    macp->rxwr++;
+    macp->rxsignal = true;
+  }
+}
+
+/**
+ * @brief   Moves frames from the TAP interface into the receive ring.
+ */
+static void rx_tap(MACDriver *macp) {
+  posix_mac_buffer_t *bp;
+  ssize_t n;
+
+  while ((macp->tap_fd >= 0) && !rx_full(macp)) {
+    bp = &macp->rxbuf[macp->rxwr % POSIX_MAC_RECEIVE_BUFFERS];
+    n = read(macp->tap_fd, bp->data, POSIX_MAC_BUFFERS_SIZE);
+    if (n <= 0)
+      break;
+    bp->length = (size_t)n;
+    macp->rxwr++;
+    macp->rxsignal = true;
+  }
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   MAC interrupt simulation.
+ *
+ * @return              @p true if an interrupt was served.
+ *
+ * @notapi
+ */
+bool mac_lld_interrupt_pending(void) {
+  MACDriver *macp = &ETHD1;
+
+  if (macp->state != MAC_ACTIVE)
+    return false;
+
+  rx_replay(macp);
+  rx_tap(macp);
+  if (!macp->rxsignal)
+    return false;
+
+  CH_IRQ_PROLOGUE();
+
+  osalSysLockFromISR();
+  macp->rxsignal = false;
+  osalThreadDequeueAllI(&macp->rdqueue, MSG_RESET);
+#if MAC_USE_EVENTS
+  osalEventBroadcastFlagsI(&macp->rdevent, 0);
+#endif
+  osalSysUnlockFromISR();
+
+  CH_IRQ_EPILOGUE();
+
+  return true;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level MAC initialization.
+ *
+ * @notapi
+ */
+void mac_lld_init(void) {
+
+  macObjectInit(&ETHD1);
+  ETHD1.link_up = false;
+  ETHD1.pcap_in = NULL;
+  ETHD1.pcap_out = NULL;
+  ETHD1.tap_fd = -1;
+}
+
+/**
+ * @brief   Configures and activates the MAC peripheral.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+void mac_lld_start(MACDriver *macp) {
+  const char *name;
+  unsigned i;
+
+  macp->rxrd = 0;
+  macp->rxwr = 0;
+  macp->rxsignal = false;
+  for (i = 0; i < POSIX_MAC_TRANSMIT_BUFFERS; i++)
+    macp->txbuf[i].length = 0;
+
+  macp->loopback = true;
+  name = getenv("SIM_MAC_TAP");
+  if ((name != NULL) && (macp->tap_fd < 0)) {
+    macp->tap_fd = tap_open(name);
+    if (macp->tap_fd >= 0)
+      _sim_add_wait_fd(macp->tap_fd);
+  }
+  if (macp->tap_fd >= 0)
+    macp->loopback = false;
+  name = getenv("SIM_MAC_PCAP_IN");
+  if (name != NULL) {
+    macp->pcap_in = pcap_open_in(name);
+    macp->loopback = false;
+  }
+  name = getenv("SIM_MAC_PCAP_OUT");
+  if (name != NULL)
+    macp->pcap_out = pcap_open_out(name);
+  macp->link_up = true;
+}
+
+/**
+ * @brief   Deactivates the MAC peripheral.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+void mac_lld_stop(MACDriver *macp) {
+
+  if (macp->pcap_in != NULL) {
+    fclose(macp->pcap_in);
+    macp->pcap_in = NULL;
+  }
+  if (macp->pcap_out != NULL) {
+    fclose(macp->pcap_out);
+    macp->pcap_out = NULL;
+  }
+  macp->link_up = false;
+}
+
+/**
+ * @brief   Returns a transmission descriptor.
+ * @details One of the available transmission descriptors is locked and
+ *          returned.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] tdp      pointer to a @p MACTransmitDescriptor structure
+ * @return              The operation status.
+ * @retval MSG_OK       the descriptor has been obtained.
+ * @retval MSG_TIMEOUT  descriptor not available.
+ *
+ * @notapi
+ */
+msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
+                                      MACTransmitDescriptor *tdp) {
+  unsigned i;
+
+  if (!macp->link_up)
+    return MSG_TIMEOUT;
+
+  osalSysLock();
+  for (i = 0; i < POSIX_MAC_TRANSMIT_BUFFERS; i++) {
+    if (macp->txbuf[i].length == 0) {
+      /* Marked as in use until released.*/
+      macp->txbuf[i].length = POSIX_MAC_BUFFERS_SIZE;
+      osalSysUnlock();
+      tdp->offset = 0;
+      tdp->size = POSIX_MAC_BUFFERS_SIZE;
+      tdp->macp = macp;
+      tdp->buf = &macp->txbuf[i];
+      return MSG_OK;
+    }
+  }
+  osalSysUnlock();
+  return MSG_TIMEOUT;
+}
+
+/**
+ * @brief   Releases a transmit descriptor and starts the transmission of
+ *          the enqueued data as a single frame.
+ *
+ * @param[in] tdp       the pointer to the @p MACTransmitDescriptor structure
+ *
+ * @notapi
+ */
+void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp) {
+  MACDriver *macp = tdp->macp;
+
+#if POSIX_MAC_IP_CHECKSUM_OFFLOAD
+  tx_insert_checksums(tdp->buf->data, tdp->offset);
+#endif
+  if (macp->pcap_out != NULL)
+    pcap_write(macp->pcap_out, tdp->buf->data, tdp->offset);
+  /* A full host queue drops the frame, as a congested link would.*/
+  if (macp->tap_fd >= 0)
+    (void)write(macp->tap_fd, tdp->buf->data, tdp->offset);
+
+  osalSysLock();
+  if (macp->loopback)
+    rx_queue(macp, tdp->buf->data, tdp->offset);
+  tdp->buf->length = 0;
+  osalThreadDequeueAllI(&macp->tdqueue, MSG_RESET);
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Returns a receive descriptor.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] rdp      pointer to a @p MACReceiveDescriptor structure
+ * @return              The operation status.
+ * @retval MSG_OK       the descriptor has been obtained.
+ * @retval MSG_TIMEOUT  descriptor not available.
+ *
+ * @notapi
+ */
+msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
+                                     MACReceiveDescriptor *rdp) {
+  posix_mac_buffer_t *bp;
+  uint32_t checksum;
+  msg_t msg = MSG_TIMEOUT;
+
+  osalSysLock();
+  /* Frames with a bad checksum are discarded, as by the STM32 driver.*/
+  while (macp->rxrd != macp->rxwr) {
+    bp = &macp->rxbuf[macp->rxrd % POSIX_MAC_RECEIVE_BUFFERS];
+    checksum = rx_checksum(bp->data, bp->length);
+    if (checksum != RX_CHECKSUM_BAD) {
+      rdp->buf = bp;
+      rdp->offset = 0;
+      rdp->size = bp->length;
+      rdp->checksum = checksum;
+      rdp->macp = macp;
+      msg = MSG_OK;
+      break;
+    }
+    bp->length = 0;
+    macp->rxrd++;
+  }
+  osalSysUnlock();
+  return msg;
+}
+
+/**
+ * @brief   Releases a receive descriptor.
+ * @details The descriptor and its buffer are made available for more
+ *          incoming frames.
+ *
+ * @param[in] rdp       the pointer to the @p MACReceiveDescriptor structure
+ *
+ * @notapi
+ */
+void mac_lld_release_receive_descriptor(MACReceiveDescriptor *rdp) {
+
+  osalSysLock();
+  rdp->buf->length = 0;
+  rdp->macp->rxrd++;
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Updates and returns the link status.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @return              The link status.
+ * @retval true         if the link is active.
+ * @retval false        if the link is down.
+ *
+ * @notapi
+ */
+bool mac_lld_poll_link_status(MACDriver *macp) {
+
+  return macp->link_up;
+}
+
+/**
+ * @brief   Writes to a transmit descriptor's stream.
+ *
+ * @param[in] tdp       pointer to a @p MACTransmitDescriptor structure
+ * @param[in] buf       pointer to the buffer containing the data to be
+ *                      written
+ * @param[in] size      number of bytes to be written
+ * @return              The number of bytes written into the descriptor's
+ *                      stream, this value can be less than the amount
+ *                      specified in the parameter @p size if the maximum
+ *                      frame size is reached.
+ *
+ * @notapi
+ */
+size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
+                                         uint8_t *buf,
+                                         size_t size) {
+
+  if (size > tdp->size - tdp->offset)
+    size = tdp->size - tdp->offset;
+  memcpy(tdp->buf->data + tdp->offset, buf, size);
+  tdp->offset += size;
+  return size;
+}
+
+/**
+ * @brief   Reads from a receive descriptor's stream.
+ *
+ * @param[in] rdp       pointer to a @p MACReceiveDescriptor structure
+ * @param[in] buf       pointer to the buffer that will receive the read data
+ * @param[in] size      number of bytes to be read
+ * @return              The number of bytes read from the descriptor's
+ *                      stream, this value can be less than the amount
+ *                      specified in the parameter @p size if there are
+ *                      no more bytes to read.
+ *
+ * @notapi
+ */
+size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
+                                       uint8_t *buf,
+                                       size_t size) {
+
+  if (size > rdp->size - rdp->offset)
+    size = rdp->size - rdp->offset;
+  memcpy(buf, rdp->buf->data + rdp->offset, size);
+  rdp->offset += size;
+  return size;
+}
+
+#if MAC_USE_ZERO_COPY || defined(__DOXYGEN__)
+/**
+ * @brief   Returns a pointer to the next transmit buffer in the descriptor
+ *          chain.
+ * @note    The simulated frames are contiguous, the whole remaining space
+ *          is returned.
+ *
+ * @param[in] tdp       the pointer to the @p MACTransmitDescriptor structure
+ * @param[in] size      size of the requested buffer
+ * @param[out] sizep    pointer to variable receiving the buffer size
+ * @return              Pointer to the returned buffer.
+ * @retval NULL         if the buffer chain has been entirely scanned.
+ *
+ * @notapi
+ */
+uint8_t *mac_lld_get_next_transmit_buffer(MACTransmitDescriptor *tdp,
+                                          size_t size,
+                                          size_t *sizep) {
+  uint8_t *p;
+
+  (void)size;
+
+  if (tdp->offset >= tdp->size)
+    return NULL;
+  p = tdp->buf->data + tdp->offset;
+  *sizep = tdp->size - tdp->offset;
+  tdp->offset = tdp->size;
+  return p;
+}
+
+/**
+ * @brief   Returns a pointer to the next receive buffer in the descriptor
+ *          chain.
+ * @note    The simulated frames are contiguous, the whole remaining frame
+ *          is returned.
+ *
+ * @param[in] rdp       the pointer to the @p MACReceiveDescriptor structure
+ * @param[out] sizep    pointer to variable receiving the buffer size, it is
+ *                      zero when the last buffer has already been returned.
+ * @return              Pointer to the returned buffer.
+ * @retval NULL         if the buffer chain has been entirely scanned.
+ *
+ * @notapi
+ */
+const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
+                                               size_t *sizep) {
+  const uint8_t *p;
+
+  if (rdp->offset >= rdp->size) {
+    *sizep = 0;
+    return NULL;
+  }
+  p = rdp->buf->data + rdp->offset;
+  *sizep = rdp->size - rdp->offset;
+  rdp->offset = rdp->size;
+  return p;
+}
+#endif /* MAC_USE_ZERO_COPY */
+
+#endif /* HAL_USE_MAC */
+
+/** @} */
@@ -0,0 +1,279 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/mac_lld.h
+ * @brief   POSIX simulator MAC driver header.
+ *
+ * @addtogroup POSIX_MAC
+ * @{
+ */
+
+#ifndef _MAC_LLD_H_
+#define _MAC_LLD_H_
+
+#if HAL_USE_MAC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   This implementation supports the zero-copy mode API.
+ */
+#define MAC_SUPPORTS_ZERO_COPY      TRUE
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Configuration options
+ * @{
+ */
+/**
+ * @brief   Number of available transmit buffers.
+ */
+#if !defined(POSIX_MAC_TRANSMIT_BUFFERS) || defined(__DOXYGEN__)
+#define POSIX_MAC_TRANSMIT_BUFFERS          2
+#endif
+
+/**
+ * @brief   Number of available receive buffers.
+ */
+#if !defined(POSIX_MAC_RECEIVE_BUFFERS) || defined(__DOXYGEN__)
+#define POSIX_MAC_RECEIVE_BUFFERS           8
+#endif
+
+/**
+ * @brief   Maximum supported frame size.
+ */
+#if !defined(POSIX_MAC_BUFFERS_SIZE) || defined(__DOXYGEN__)
+#define POSIX_MAC_BUFFERS_SIZE              1536
+#endif
+
+/**
+ * @brief   IP checksum offload emulation.
+ * @details The modes of @p STM32_MAC_IP_CHECKSUM_OFFLOAD: the checksums
+ *          are inserted into the transmitted frames as the STM32 MAC
+ *          does, and the received frames are verified, dropped when bad,
+ *          and their receive descriptors report the checksum status.
+ */
+#if !defined(POSIX_MAC_IP_CHECKSUM_OFFLOAD) || defined(__DOXYGEN__)
+#define POSIX_MAC_IP_CHECKSUM_OFFLOAD       0
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief MAC address.
+   */
+  uint8_t               *mac_address;
+  /* End of the mandatory fields.*/
+} MACConfig;
+
+/**
+ * @brief   Type of a simulated frame buffer.
+ */
+typedef struct {
+  /**
+   * @brief Frame length, zero if the buffer is free.
+   */
+  size_t                length;
+  /**
+   * @brief Frame data.
+   */
+  uint8_t               data[POSIX_MAC_BUFFERS_SIZE];
+} posix_mac_buffer_t;
+
+/**
+ * @brief   Structure representing a MAC driver.
+ * @details Frames are exchanged with the host TAP interface named by the
+ *          @p SIM_MAC_TAP environment variable. Received frames can also
+ *          come from a pcap file named by @p SIM_MAC_PCAP_IN, without
+ *          either the transmitted frames are looped back. Transmitted
+ *          frames are also captured into the pcap file named by
+ *          @p SIM_MAC_PCAP_OUT.
+ */
+struct MACDriver {
+  /**
+   * @brief Driver state.
+   */
+  macstate_t            state;
+  /**
+   * @brief Current configuration data.
+   */
+  const MACConfig       *config;
+  /**
+   * @brief Transmit semaphore.
+   */
+  threads_queue_t       tdqueue;
+  /**
+   * @brief Receive semaphore.
+   */
+  threads_queue_t       rdqueue;
+#if MAC_USE_EVENTS || defined(__DOXYGEN__)
+  /**
+   * @brief Receive event.
+   */
+  event_source_t        rdevent;
+#endif
+  /* End of the mandatory fields.*/
+  /**
+   * @brief Link status flag.
+   */
+  bool                  link_up;
+  /**
+   * @brief Frames received since the last simulated interrupt.
+   */
+  bool                  rxsignal;
+  /**
+   * @brief Receive buffers ring, filled at @p rxwr and drained at
+   *        @p rxrd.
+   */
+  posix_mac_buffer_t    rxbuf[POSIX_MAC_RECEIVE_BUFFERS];
+  unsigned              rxrd;
+  unsigned              rxwr;
+  /**
+   * @brief Transmit buffers.
+   */
+  posix_mac_buffer_t    txbuf[POSIX_MAC_TRANSMIT_BUFFERS];
+  /**
+   * @brief Transmitted frames are looped back to the receive side.
+   */
+  bool                  loopback;
+  /**
+   * @brief Replayed input capture, @p NULL when exhausted or disabled.
+   */
+  FILE                  *pcap_in;
+  /**
+   * @brief Output capture, @p NULL if disabled.
+   */
+  FILE                  *pcap_out;
+  /**
+   * @brief Host TAP interface descriptor, -1 if disabled.
+   */
+  int                   tap_fd;
+};
+
+/**
+ * @brief   Structure representing a transmit descriptor.
+ */
+typedef struct {
+  /**
+   * @brief Current write offset.
+   */
+  size_t                    offset;
+  /**
+   * @brief Available space size.
+   */
+  size_t                    size;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief Pointer to the associated driver.
+   */
+  MACDriver                 *macp;
+  /**
+   * @brief Pointer to the frame buffer.
+   */
+  posix_mac_buffer_t        *buf;
+} MACTransmitDescriptor;
+
+/**
+ * @brief   Structure representing a receive descriptor.
+ */
+typedef struct {
+  /**
+   * @brief Current read offset.
+   */
+  size_t                offset;
+  /**
+   * @brief Available data size.
+   */
+  size_t                size;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief Checksums verified by the MAC, @p MAC_CHECKSUM_NONE unless
+   *        @p POSIX_MAC_IP_CHECKSUM_OFFLOAD is enabled.
+   */
+  uint32_t              checksum;
+  /**
+   * @brief Pointer to the associated driver.
+   */
+  MACDriver             *macp;
+  /**
+   * @brief Pointer to the frame buffer.
+   */
+  posix_mac_buffer_t    *buf;
+} MACReceiveDescriptor;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern MACDriver ETHD1;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void mac_lld_init(void);
+  void mac_lld_start(MACDriver *macp);
+  void mac_lld_stop(MACDriver *macp);
+  msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
+                                        MACTransmitDescriptor *tdp);
+  void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp);
+  msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
+                                       MACReceiveDescriptor *rdp);
+  void mac_lld_release_receive_descriptor(MACReceiveDescriptor *rdp);
+  bool mac_lld_poll_link_status(MACDriver *macp);
+  size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
+                                           uint8_t *buf,
+                                           size_t size);
+  size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
+                                         uint8_t *buf,
+                                         size_t size);
+#if MAC_USE_ZERO_COPY
+  uint8_t *mac_lld_get_next_transmit_buffer(MACTransmitDescriptor *tdp,
+                                            size_t size,
+                                            size_t *sizep);
+  const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
+                                                 size_t *sizep);
+#endif /* MAC_USE_ZERO_COPY */
+  bool mac_lld_interrupt_pending(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_MAC */
+
+#endif /* _MAC_LLD_H_ */
+
+/** @} */
@@ -0,0 +1,15 @@
+# List of all the POSIX platform files.
+PLATFORMSRC = ${CHIBIOS}/os/hal/ports/simulator/posix/hal_lld.c \
+              ${CHIBIOS}/os/hal/ports/simulator/posix/st_lld.c \
+              ${CHIBIOS}/os/hal/ports/simulator/posix/serial_lld.c \
+              ${CHIBIOS}/os/hal/ports/simulator/posix/sdc_lld.c \
+              ${CHIBIOS}/os/hal/ports/simulator/posix/mac_lld.c \
+              ${CHIBIOS}/os/hal/ports/simulator/pal_lld.c
+
+# Required include directories, the POSIX directory must come first
+# because it overrides the common st_lld.h.
+PLATFORMINC = ${CHIBIOS}/os/hal/ports/simulator/posix \
+              ${CHIBIOS}/os/hal/ports/simulator
+
+# Host libraries required by the platform.
+PLATFORMLIBS = -lrt
@@ -0,0 +1,426 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/sdc_lld.c
+ * @brief   POSIX simulator SDC subsystem low level driver source.
+ * @details Emulates an SDHC card backed by an image file, the commands
+ *          issued by the high level driver during the card identification
+ *          get the answers a real card would give.
+ *
+ * @addtogroup POSIX_SDC
+ * @{
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hal.h"
+
+#if HAL_USE_SDC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   R1 response of a card in transfer state.
+ */
+#define SIM_R1_TRAN             (MMCSD_STS_TRAN << 9U)
+
+/**
+ * @brief   Relative card address assigned by the emulated card.
+ */
+#define SIM_RCA                 0x00010000U
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/** @brief SDCD1 driver identifier.*/
+SDCDriver SDCD1;
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Default configuration.
+ */
+static const SDCConfig sdc_default_cfg = {
+  NULL,
+  SDC_MODE_4BIT
+};
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Sets a bit field into a words array, see @p _mmcsd_get_slice().
+ */
+static void set_slice(uint32_t *data, uint32_t end, uint32_t start,
+                      uint32_t value) {
+  uint32_t i;
+
+  for (i = start; i <= end; i++) {
+    if (value & (1U << (i - start)))
+      data[i / 32U] |= 1U << (i % 32U);
+    else
+      data[i / 32U] &= ~(1U << (i % 32U));
+  }
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the path of the card image file.
+ *
+ * @notapi
+ */
+const char *sdc_lld_image_path(void) {
+  const char *path = getenv("SIM_SDC_IMAGE");
+
+  return path != NULL ? path : POSIX_SDC_IMAGE;
+}
+
+/**
+ * @brief   Low level SDC driver initialization.
+ *
+ * @notapi
+ */
+void sdc_lld_init(void) {
+
+  sdcObjectInit(&SDCD1);
+  SDCD1.fd = -1;
+}
+
+/**
+ * @brief   Configures and activates the SDC peripheral.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ *
+ * @notapi
+ */
+void sdc_lld_start(SDCDriver *sdcp) {
+
+  if (sdcp->config == NULL) {
+    sdcp->config = &sdc_default_cfg;
+  }
+}
+
+/**
+ * @brief   Deactivates the SDC peripheral.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ *
+ * @notapi
+ */
+void sdc_lld_stop(SDCDriver *sdcp) {
+
+  sdc_lld_stop_clk(sdcp);
+}
+
+/**
+ * @brief   Starts the SDIO clock, the image file is opened here.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ *
+ * @notapi
+ */
+void sdc_lld_start_clk(SDCDriver *sdcp) {
+  struct stat st;
+
+  if (sdcp->fd >= 0)
+    return;
+  sdcp->fd = open(sdc_lld_image_path(), O_RDWR);
+  if ((sdcp->fd >= 0) && (fstat(sdcp->fd, &st) == 0))
+    sdcp->blocks = (uint32_t)(st.st_size / MMCSD_BLOCK_SIZE);
+  else
+    sdcp->blocks = 0;
+}
+
+/**
+ * @brief   Sets the SDIO clock to data mode.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] clk       the clock mode
+ *
+ * @notapi
+ */
+void sdc_lld_set_data_clk(SDCDriver *sdcp, sdcbusclk_t clk) {
+
+  (void)sdcp;
+  (void)clk;
+}
+
+/**
+ * @brief   Stops the SDIO clock, the image file is closed here.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ *
+ * @notapi
+ */
+void sdc_lld_stop_clk(SDCDriver *sdcp) {
+
+  if (sdcp->fd >= 0) {
+    close(sdcp->fd);
+    sdcp->fd = -1;
+  }
+}
+
+/**
+ * @brief   Switches the bus to 1 bit or 4 bits mode.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] mode      bus mode
+ *
+ * @notapi
+ */
+void sdc_lld_set_bus_mode(SDCDriver *sdcp, sdcbusmode_t mode) {
+
+  (void)sdcp;
+  (void)mode;
+}
+
+/**
+ * @brief   Sends an SDIO command with no response expected.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] cmd       card command
+ * @param[in] arg       command argument
+ *
+ * @notapi
+ */
+void sdc_lld_send_cmd_none(SDCDriver *sdcp, uint8_t cmd, uint32_t arg) {
+
+  (void)sdcp;
+  (void)cmd;
+  (void)arg;
+}
+
+/**
+ * @brief   Sends an SDIO command with a short response expected.
+ * @note    The CRC is not verified.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] cmd       card command
+ * @param[in] arg       command argument
+ * @param[out] resp     pointer to the response buffer (one word)
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_send_cmd_short(SDCDriver *sdcp, uint8_t cmd, uint32_t arg,
+                            uint32_t *resp) {
+
+  return sdc_lld_send_cmd_short_crc(sdcp, cmd, arg, resp);
+}
+
+/**
+ * @brief   Sends an SDIO command with a short response expected and CRC.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] cmd       card command
+ * @param[in] arg       command argument
+ * @param[out] resp     pointer to the response buffer (one word)
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_send_cmd_short_crc(SDCDriver *sdcp, uint8_t cmd, uint32_t arg,
+                                uint32_t *resp) {
+
+  if (sdcp->fd < 0)
+    return HAL_FAILED;
+
+  switch (cmd) {
+  case MMCSD_CMD_SEND_IF_COND:
+    /* Voltage accepted, check pattern echoed.*/
+    *resp = arg & 0xFFFU;
+    break;
+  case MMCSD_CMD_APP_OP_COND:
+    /* Powered up, high capacity.*/
+    *resp = 0xC0FF8000U;
+    break;
+  case MMCSD_CMD_SEND_RELATIVE_ADDR:
+    *resp = SIM_RCA;
+    break;
+  default:
+    *resp = SIM_R1_TRAN;
+    break;
+  }
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Sends an SDIO command with a long response expected and CRC.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] cmd       card command
+ * @param[in] arg       command argument
+ * @param[out] resp     pointer to the response buffer (four words)
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_send_cmd_long_crc(SDCDriver *sdcp, uint8_t cmd, uint32_t arg,
+                               uint32_t *resp) {
+
+  (void)arg;
+
+  if (sdcp->fd < 0)
+    return HAL_FAILED;
+
+  memset(resp, 0, 4 * sizeof(uint32_t));
+  if (cmd == MMCSD_CMD_SEND_CSD) {
+    /* CSD version 2.0, the capacity is (C_SIZE + 1) * 512kB.*/
+    if (sdcp->blocks < 1024U)
+      return HAL_FAILED;
+    set_slice(resp, MMCSD_CSD_20_CSD_STRUCTURE_SLICE, 1U);
+    set_slice(resp, MMCSD_CSD_20_READ_BL_LEN_SLICE, 9U);
+    set_slice(resp, MMCSD_CSD_20_C_SIZE_SLICE, sdcp->blocks / 1024U - 1U);
+  }
+  else {
+    /* CID, manufacturer and product name.*/
+    resp[3] = 0x00534953U;
+    resp[2] = 0x494D5344U;
+  }
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Reads special registers using data bus.
+ * @details The emulated card supports no switch function, all zeros are
+ *          returned.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] buf      pointer to the read buffer
+ * @param[in] bytes     number of bytes to read
+ * @param[in] cmd       card command
+ * @param[in] arg       argument for command
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_read_special(SDCDriver *sdcp, uint8_t *buf, size_t bytes,
+                          uint8_t cmd, uint32_t arg) {
+
+  (void)cmd;
+  (void)arg;
+
+  if (sdcp->fd < 0)
+    return HAL_FAILED;
+  memset(buf, 0, bytes);
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Reads one or more blocks.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] startblk  first block to read
+ * @param[out] buf      pointer to the read buffer
+ * @param[in] blocks    number of blocks to read
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_read(SDCDriver *sdcp, uint32_t startblk,
+                  uint8_t *buf, uint32_t blocks) {
+  size_t n = (size_t)blocks * MMCSD_BLOCK_SIZE;
+
+  if ((sdcp->fd < 0) || (startblk + blocks > sdcp->blocks))
+    return HAL_FAILED;
+  if (pread(sdcp->fd, buf, n, (off_t)startblk * MMCSD_BLOCK_SIZE) !=
+      (ssize_t)n)
+    return HAL_FAILED;
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Writes one or more blocks.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] startblk  first block to write
+ * @param[out] buf      pointer to the write buffer
+ * @param[in] blocks    number of blocks to write
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool sdc_lld_write(SDCDriver *sdcp, uint32_t startblk,
+                   const uint8_t *buf, uint32_t blocks) {
+  size_t n = (size_t)blocks * MMCSD_BLOCK_SIZE;
+
+  if ((sdcp->fd < 0) || (startblk + blocks > sdcp->blocks))
+    return HAL_FAILED;
+  if (pwrite(sdcp->fd, buf, n, (off_t)startblk * MMCSD_BLOCK_SIZE) !=
+      (ssize_t)n)
+    return HAL_FAILED;
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Waits for card idle condition.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  the operation succeeded.
+ * @retval HAL_FAILED   the operation failed.
+ *
+ * @api
+ */
+bool sdc_lld_sync(SDCDriver *sdcp) {
+
+  if ((sdcp->fd < 0) || (fdatasync(sdcp->fd) != 0))
+    return HAL_FAILED;
+  return HAL_SUCCESS;
+}
+
+#endif /* HAL_USE_SDC */
+
+/** @} */
@@ -0,0 +1,277 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/serial_lld.c
+ * @brief   POSIX simulator low level serial driver code.
+ * @details SD1 is connected to the process standard input and output, the
+ *          terminal is switched to non canonical mode while the process
+ *          runs. SD2 is connected to a pseudo terminal, attach to it with
+ *          any terminal program, e.g. "screen /dev/pts/N".
+ *
+ * @addtogroup POSIX_SERIAL
+ * @{
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "hal.h"
+
+#if HAL_USE_SERIAL || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/** @brief Serial driver 1 identifier.*/
+#if USE_POSIX_SERIAL1 || defined(__DOXYGEN__)
+SerialDriver SD1;
+#endif
+/** @brief Serial driver 2 identifier.*/
+#if USE_POSIX_SERIAL2 || defined(__DOXYGEN__)
+SerialDriver SD2;
+#endif
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/** @brief Driver default configuration.*/
+static const SerialConfig default_config = {
+  38400
+};
+
+#if USE_POSIX_SERIAL1 || defined(__DOXYGEN__)
+/** @brief Terminal settings restored at exit.*/
+static struct termios saved_tio;
+#endif
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+#if USE_POSIX_SERIAL1 || defined(__DOXYGEN__)
+static void restore_stdin(void) {
+
+  tcsetattr(STDIN_FILENO, TCSANOW, &saved_tio);
+}
+
+static void init_stdio(SerialDriver *sdp) {
+  struct termios tio;
+
+  /* Characters are delivered as typed, the shell does its own echo.*/
+  if (isatty(STDIN_FILENO) && (tcgetattr(STDIN_FILENO, &saved_tio) == 0)) {
+    tio = saved_tio;
+    tio.c_lflag &= ~(ICANON | ECHO);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &tio);
+    atexit(restore_stdin);
+  }
+  sdp->com_in = STDIN_FILENO;
+  sdp->com_out = STDOUT_FILENO;
+  _sim_add_wait_fd(sdp->com_in);
+}
+#endif
+
+#if USE_POSIX_SERIAL2 || defined(__DOXYGEN__)
+static void init_pty(SerialDriver *sdp) {
+  struct termios tio;
+  int master, slave;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) {
+    printf("%s: Error creating pseudo terminal\n", sdp->com_name);
+    exit(1);
+  }
+
+  /* The slave side is kept open so reads do not fail while no terminal
+     program is attached, it is also switched to raw mode.*/
+  slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if ((slave >= 0) && (tcgetattr(slave, &tio) == 0)) {
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+  }
+
+  sdp->com_in = master;
+  sdp->com_out = master;
+  _sim_add_wait_fd(master);
+  printf("Full Duplex Channel %s on %s\n", sdp->com_name, ptsname(master));
+  fflush(stdout);
+}
+#endif
+
+static bool inint(SerialDriver *sdp) {
+  struct pollfd pfd;
+  uint8_t data[32];
+  ssize_t i, n;
+  size_t room;
+
+  if (sdp->com_in < 0)
+    return false;
+
+  /* Only what fits in the input queue is read, the rest is left in the
+     descriptor until the application makes room.*/
+  chSysLockFromISR();
+  room = (size_t)iqGetEmptyI(&sdp->iqueue);
+  chSysUnlockFromISR();
+  if (room == 0)
+    return false;
+  if (room > sizeof(data))
+    room = sizeof(data);
+
+  pfd.fd = sdp->com_in;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, 0) <= 0)
+    return false;
+
+  n = read(sdp->com_in, data, room);
+  if (n <= 0) {
+    /* End of file or error, the port is no more usable.*/
+    sdp->com_in = -1;
+    chSysLockFromISR();
+    chnAddFlagsI(sdp, CHN_DISCONNECTED);
+    chSysUnlockFromISR();
+    return false;
+  }
+  chSysLockFromISR();
+  for (i = 0; i < n; i++)
+    sdIncomingDataI(sdp, data[i]);
+  chSysUnlockFromISR();
+  return true;
+}
+
+static bool outint(SerialDriver *sdp) {
+  uint8_t data[256];
+  size_t n = 0;
+  msg_t b;
+
+  if (sdp->com_out < 0)
+    return false;
+
+  chSysLockFromISR();
+  while ((n < sizeof(data)) && ((b = sdRequestDataI(sdp)) >= MSG_OK))
+    data[n++] = (uint8_t)b;
+  chSysUnlockFromISR();
+  if (n == 0)
+    return false;
+
+  if (write(sdp->com_out, data, n) < 0) {
+    sdp->com_out = -1;
+    return false;
+  }
+  return true;
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * Low level serial driver initialization.
+ */
+void sd_lld_init(void) {
+
+#if USE_POSIX_SERIAL1
+  sdObjectInit(&SD1, NULL, NULL);
+  SD1.com_in = -1;
+  SD1.com_out = -1;
+  SD1.com_name = "SD1";
+#endif
+
+#if USE_POSIX_SERIAL2
+  sdObjectInit(&SD2, NULL, NULL);
+  SD2.com_in = -1;
+  SD2.com_out = -1;
+  SD2.com_name = "SD2";
+#endif
+}
+
+/**
+ * @brief   Low level serial driver configuration and (re)start.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ * @param[in] config    the architecture-dependent serial driver configuration.
+ *                      If this parameter is set to @p NULL then a default
+ *                      configuration is used.
+ */
+void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
+
+  if (config == NULL)
+    config = &default_config;
+  (void)config;
+
+  if (sdp->state != SD_STOP)
+    return;
+
+#if USE_POSIX_SERIAL1
+  if (sdp == &SD1)
+    init_stdio(&SD1);
+#endif
+
+#if USE_POSIX_SERIAL2
+  if (sdp == &SD2)
+    init_pty(&SD2);
+#endif
+}
+
+/**
+ * @brief Low level serial driver stop.
+ *
+ * @param[in] sdp pointer to a @p SerialDriver object
+ */
+void sd_lld_stop(SerialDriver *sdp) {
+
+  (void)sdp;
+}
+
+/**
+ * @brief   Serial ports interrupts simulation.
+ *
+ * @return              @p true if some data has been moved.
+ */
+bool sd_lld_interrupt_pending(void) {
+  bool b = false;
+
+  CH_IRQ_PROLOGUE();
+
+#if USE_POSIX_SERIAL1
+  b |= inint(&SD1);
+  b |= outint(&SD1);
+#endif
+#if USE_POSIX_SERIAL2
+  b |= inint(&SD2);
+  b |= outint(&SD2);
+#endif
+
+  CH_IRQ_EPILOGUE();
+
+  return b;
+}
+
+#endif /* HAL_USE_SERIAL */
+
+/** @} */
@@ -0,0 +1,134 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/serial_lld.h
+ * @brief   POSIX simulator low level serial driver header.
+ *
+ * @addtogroup POSIX_SERIAL
+ * @{
+ */
+
+#ifndef _SERIAL_LLD_H_
+#define _SERIAL_LLD_H_
+
+#if HAL_USE_SERIAL || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Serial buffers size.
+ * @details Configuration parameter, you can change the depth of the queue
+ *          buffers depending on the requirements of your application.
+ */
+#if !defined(SERIAL_BUFFERS_SIZE) || defined(__DOXYGEN__)
+#define SERIAL_BUFFERS_SIZE                 1024
+#endif
+
+/**
+ * @brief   SD1 driver enable switch.
+ * @details If set to @p TRUE the support for SD1 is included, SD1 is
+ *          connected to the process standard input and output.
+ * @note    The default is @p TRUE.
+ */
+#if !defined(USE_POSIX_SERIAL1) || defined(__DOXYGEN__)
+#define USE_POSIX_SERIAL1                   TRUE
+#endif
+
+/**
+ * @brief   SD2 driver enable switch.
+ * @details If set to @p TRUE the support for SD2 is included, SD2 is
+ *          connected to a pseudo terminal whose name is printed when the
+ *          driver is started.
+ * @note    The default is @p TRUE.
+ */
+#if !defined(USE_POSIX_SERIAL2) || defined(__DOXYGEN__)
+#define USE_POSIX_SERIAL2                   TRUE
+#endif
+
+/*===========================================================================*/
+/* Unsupported event flags and custom events.                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Generic Serial Driver configuration structure.
+ * @details An instance of this structure must be passed to @p sdStart()
+ *          in order to configure and start a serial driver operations.
+ * @note    The speed is ignored by the simulator.
+ */
+typedef struct {
+  /**
+   * @brief Bit rate.
+   */
+  uint32_t                  speed;
+} SerialConfig;
+
+/**
+ * @brief   @p SerialDriver specific data.
+ */
+#define _serial_driver_data                                                 \
+  _base_asynchronous_channel_data                                           \
+  /* Driver state.*/                                                        \
+  sdstate_t                 state;                                          \
+  /* Input queue.*/                                                         \
+  input_queue_t             iqueue;                                         \
+  /* Output queue.*/                                                        \
+  output_queue_t            oqueue;                                         \
+  /* Input circular buffer.*/                                               \
+  uint8_t                   ib[SERIAL_BUFFERS_SIZE];                        \
+  /* Output circular buffer.*/                                              \
+  uint8_t                   ob[SERIAL_BUFFERS_SIZE];                        \
+  /* End of the mandatory fields.*/                                         \
+  /* Host input descriptor, -1 if not open.*/                               \
+  int                       com_in;                                         \
+  /* Host output descriptor, -1 if not open.*/                              \
+  int                       com_out;                                        \
+  /* Port readable name.*/                                                  \
+  const char                *com_name;
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#if USE_POSIX_SERIAL1 && !defined(__DOXYGEN__)
+extern SerialDriver SD1;
+#endif
+#if USE_POSIX_SERIAL2 && !defined(__DOXYGEN__)
+extern SerialDriver SD2;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void sd_lld_init(void);
+  void sd_lld_start(SerialDriver *sdp, const SerialConfig *config);
+  void sd_lld_stop(SerialDriver *sdp);
+  bool sd_lld_interrupt_pending(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_SERIAL */
+
+#endif /* _SERIAL_LLD_H_ */
+
+/** @} */
@@ -0,0 +1,214 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    posix/st_lld.c
+ * @brief   ST Driver subsystem low level driver code.
+ *
+ * @addtogroup ST
+ * @{
+ */
+
+#include "hal.h"
+
+#if (OSAL_ST_MODE != OSAL_ST_MODE_NONE) || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Duration of a system tick in nanoseconds.
+ */
+#define ST_TICK_NS      (1000000000ULL / (uint64_t)OSAL_ST_FREQUENCY)
+
+#if (1000000000 % OSAL_ST_FREQUENCY) != 0
+#error "OSAL_ST_FREQUENCY must be a divider of 1000000000"
+#endif
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Host time corresponding to the counter value zero.
+ */
+static uint64_t st_epoch;
+
+#if (OSAL_ST_MODE == OSAL_ST_MODE_PERIODIC) || defined(__DOXYGEN__)
+/**
+ * @brief   Host time of the next periodic tick.
+ */
+static uint64_t st_next;
+#endif
+
+#if (OSAL_ST_MODE == OSAL_ST_MODE_FREERUNNING) || defined(__DOXYGEN__)
+static systime_t st_alarm;
+static bool st_alarm_active;
+#endif
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+#if (OSAL_ST_MODE == OSAL_ST_MODE_FREERUNNING) || defined(__DOXYGEN__)
+/**
+ * @brief   Programs the host timer for the current alarm.
+ */
+static void st_arm(void) {
+  uint64_t now = _sim_get_time_ns();
+  systime_t delta = st_alarm - (systime_t)((now - st_epoch) / ST_TICK_NS);
+
+  /* An alarm already in the past expires immediately.*/
+  if (delta > (systime_t)(((systime_t)-1) >> 1))
+    delta = (systime_t)0;
+  _sim_timer_arm(now + (uint64_t)delta * ST_TICK_NS + 1ULL, 0);
+}
+#endif
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level ST driver initialization.
+ *
+ * @notapi
+ */
+void st_lld_init(void) {
+
+  st_epoch = _sim_get_time_ns();
+#if OSAL_ST_MODE == OSAL_ST_MODE_PERIODIC
+  st_next = st_epoch + ST_TICK_NS;
+  _sim_timer_arm(st_next, ST_TICK_NS);
+#endif
+}
+
+/**
+ * @brief   Checks for a system tick or alarm to be served.
+ *
+ * @return              The tick interrupt status.
+ * @retval true         if the tick handler must be invoked.
+ *
+ * @notapi
+ */
+bool st_lld_interrupt_pending(void) {
+
+#if OSAL_ST_MODE == OSAL_ST_MODE_PERIODIC
+  if (_sim_get_time_ns() >= st_next) {
+    st_next += ST_TICK_NS;
+    return true;
+  }
+  return false;
+#else
+  systime_t delta;
+
+  if (!st_alarm_active)
+    return false;
+  delta = st_lld_get_counter() - st_alarm;
+  return delta <= (systime_t)(((systime_t)-1) >> 1);
+#endif
+}
+
+#if (OSAL_ST_MODE == OSAL_ST_MODE_FREERUNNING) || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the time counter value.
+ *
+ * @return              The counter value.
+ *
+ * @notapi
+ */
+systime_t st_lld_get_counter(void) {
+
+  return (systime_t)((_sim_get_time_ns() - st_epoch) / ST_TICK_NS);
+}
+
+/**
+ * @brief   Starts the alarm.
+ *
+ * @param[in] time      the time to be set for the first alarm
+ *
+ * @notapi
+ */
+void st_lld_start_alarm(systime_t time) {
+
+  st_alarm = time;
+  st_alarm_active = true;
+  st_arm();
+}
+
+/**
+ * @brief   Stops the alarm interrupt.
+ *
+ * @notapi
+ */
+void st_lld_stop_alarm(void) {
+
+  st_alarm_active = false;
+  _sim_timer_arm(0, 0);
+}
+
+/**
+ * @brief   Sets the alarm time.
+ *
+ * @param[in] time      the time to be set for the next alarm
+ *
+ * @notapi
+ */
+void st_lld_set_alarm(systime_t time) {
+
+  st_alarm = time;
+  st_arm();
+}
+
+/**
+ * @brief   Returns the current alarm time.
+ *
+ * @return              The currently set alarm time.
+ *
+ * @notapi
+ */
+systime_t st_lld_get_alarm(void) {
+
+  return st_alarm;
+}
+
+/**
+ * @brief   Determines if the alarm is active.
+ *
+ * @return              The alarm status.
+ * @retval false        if the alarm is not active.
+ * @retval true         is the alarm is active
+ *
+ * @notapi
+ */
+bool st_lld_is_alarm_active(void) {
+
+  return st_alarm_active;
+}
+#endif /* OSAL_ST_MODE == OSAL_ST_MODE_FREERUNNING */
+
+#endif /* OSAL_ST_MODE != OSAL_ST_MODE_NONE */
+
+/** @} */
@@ -32,6 +32,27 @@
 /* Module constants.                                                         */
 /*===========================================================================*/
 
+/**
+ * @name    Kernel objects trace events
+ * @{
+ */
+#define CH_TRACE_SEM_WAIT                   1U
+#define CH_TRACE_SEM_SIGNAL                 2U
+#define CH_TRACE_MTX_LOCK                   3U
+#define CH_TRACE_MTX_UNLOCK                 4U
+#define CH_TRACE_MB_POST                    5U
+#define CH_TRACE_MB_FETCH                   6U
+#define CH_TRACE_VT_FIRE                    7U
+/** @} */
+
+/**
+ * @name    Memory allocators trace sources
+ * @{
+ */
+#define CH_TRACE_ALLOC_HEAP                 0U
+#define CH_TRACE_ALLOC_POOL                 1U
+/** @} */
+
 /*===========================================================================*/
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -149,6 +170,55 @@ typedef struct {
 #define _dbg_trace(otp)
 #endif
 
+/**
+ * @brief   Kernel objects trace hook.
+ * @details Invokes the optional @p CH_CFG_TRACE_OBJECT_HOOK, it is called
+ *          by the semaphores, mutexes, mailboxes and virtual timers code
+ *          from within the kernel critical zone.
+ *
+ * @param[in] ev        event identifier, one of the @p CH_TRACE_xxx values
+ * @param[in] objp      pointer to the kernel object
+ * @param[in] arg       event specific argument
+ */
+#if defined(CH_CFG_TRACE_OBJECT_HOOK) || defined(__DOXYGEN__)
+#define _trace_object(ev, objp, arg) CH_CFG_TRACE_OBJECT_HOOK(ev, objp, arg)
+#else
+#define _trace_object(ev, objp, arg)
+#endif
+
+/**
+ * @brief   Memory allocation trace hook.
+ * @details Invokes the optional @p CH_CFG_TRACE_ALLOC_HOOK, it is called
+ *          by the heap and memory pools thread API after a successful
+ *          allocation.
+ * @note    The hook is expanded inside the allocator function so
+ *          @p __builtin_return_address(0) is the allocator caller.
+ *
+ * @param[in] src       allocator, one of the @p CH_TRACE_ALLOC_xxx values
+ * @param[in] p         pointer to the allocated block
+ * @param[in] size      requested size
+ */
+#if defined(CH_CFG_TRACE_ALLOC_HOOK) || defined(__DOXYGEN__)
+#define _trace_alloc(src, p, size) CH_CFG_TRACE_ALLOC_HOOK(src, p, size)
+#else
+#define _trace_alloc(src, p, size)
+#endif
+
+/**
+ * @brief   Memory release trace hook.
+ * @details Invokes the optional @p CH_CFG_TRACE_FREE_HOOK, it is called
+ *          by the heap and memory pools thread API before a block is
+ *          released.
+ *
+ * @param[in] src       allocator, one of the @p CH_TRACE_ALLOC_xxx values
+ * @param[in] p         pointer to the released block
+ */
+#if defined(CH_CFG_TRACE_FREE_HOOK) || defined(__DOXYGEN__)
+#define _trace_free(src, p) CH_CFG_TRACE_FREE_HOOK(src, p)
+#else
+#define _trace_free(src, p)
+#endif
+
 /**
  * @name    Macro Functions
  * @{
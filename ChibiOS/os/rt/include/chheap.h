@@ -87,6 +87,14 @@ struct memory_heap {
 #endif
 };
 
+/**
+ * @brief   Free block descriptor returned by @p chHeapGetFragments().
+ */
+typedef struct {
+  void                  *hf_addr;   /**< @brief Block data area.            */
+  size_t                hf_size;    /**< @brief Block size.                 */
+} heap_fragment_t;
+
 /*===========================================================================*/
 /* Module macros.                                                            */
 /*===========================================================================*/
@@ -103,6 +111,8 @@ extern "C" {
   void *chHeapAlloc(memory_heap_t *heapp, size_t size);
   void chHeapFree(void *p);
   size_t chHeapStatus(memory_heap_t *heapp, size_t *sizep);
+  size_t chHeapGetFragments(memory_heap_t *heapp, heap_fragment_t *fp,
+                            size_t n);
 #ifdef __cplusplus
 }
 #endif
@@ -119,6 +119,14 @@ extern "C" {
   msg_t chMBFetch(mailbox_t *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchS(mailbox_t *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchI(mailbox_t *mbp, msg_t *msgp);
+  cnt_t chMBPostN(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                  systime_t timeout);
+  cnt_t chMBPostNS(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                   systime_t timeout);
+  cnt_t chMBPostNI(mailbox_t *mbp, const msg_t *msgs, cnt_t n);
+  cnt_t chMBFetchN(mailbox_t *mbp, msg_t *msgs, cnt_t n, systime_t timeout);
+  cnt_t chMBFetchNS(mailbox_t *mbp, msg_t *msgs, cnt_t n, systime_t timeout);
+  cnt_t chMBFetchNI(mailbox_t *mbp, msg_t *msgs, cnt_t n);
 #ifdef __cplusplus
 }
 #endif
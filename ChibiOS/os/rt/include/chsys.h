@@ -48,6 +48,22 @@
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   ISR enter hook.
+ * @details Optional, invoked in @p CH_IRQ_PROLOGUE() after the port code.
+ */
+#if !defined(CH_CFG_IRQ_PROLOGUE_HOOK) || defined(__DOXYGEN__)
+#define CH_CFG_IRQ_PROLOGUE_HOOK() {}
+#endif
+
+/**
+ * @brief   ISR exit hook.
+ * @details Optional, invoked in @p CH_IRQ_EPILOGUE() before the port code.
+ */
+#if !defined(CH_CFG_IRQ_EPILOGUE_HOOK) || defined(__DOXYGEN__)
+#define CH_CFG_IRQ_EPILOGUE_HOOK() {}
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -108,6 +124,7 @@
  */
 #define CH_IRQ_PROLOGUE()                                                   \
   PORT_IRQ_PROLOGUE();                                                      \
+  CH_CFG_IRQ_PROLOGUE_HOOK();                                               \
   _stats_increase_irq();                                                    \
   _dbg_check_enter_isr()
 
@@ -121,6 +138,7 @@
  */
 #define CH_IRQ_EPILOGUE()                                                   \
   _dbg_check_leave_isr();                                                   \
+  CH_CFG_IRQ_EPILOGUE_HOOK();                                               \
   PORT_IRQ_EPILOGUE()
 
 /**
@@ -147,6 +165,18 @@
 #define CH_FAST_IRQ_HANDLER(id) PORT_FAST_IRQ_HANDLER(id)
 /** @} */
 
+/**
+ * @brief   Marks a function to be executed from RAM.
+ * @note    Empty on the ports that do not support it.
+ *
+ * @special
+ */
+#if defined(PORT_RAMFUNC) || defined(__DOXYGEN__)
+#define CH_RAMFUNC PORT_RAMFUNC
+#else
+#define CH_RAMFUNC
+#endif
+
 /**
  * @name    Time conversion utilities for the realtime counter
  * @{
@@ -517,6 +517,7 @@ static inline void chVTDoTickI(void) {
       vtp->vt_func = NULL;
       vtp->vt_next->vt_prev = (virtual_timer_t *)&ch.vtlist;
       ch.vtlist.vt_next = vtp->vt_next;
+      _trace_object(CH_TRACE_VT_FIRE, vtp, 0U);
       chSysUnlockFromISR();
       fn(vtp->vt_par);
       chSysLockFromISR();
@@ -553,6 +554,7 @@ static inline void chVTDoTickI(void) {
     /* Leaving the system critical zone in order to execute the callback
        and in order to give a preemption chance to higher priority
        interrupts.*/
+    _trace_object(CH_TRACE_VT_FIRE, vtp, 0U);
     chSysUnlockFromISR();
 
     /* The callback is invoked outside the kernel critical zone.*/
@@ -59,7 +59,7 @@
  * @note    The PendSV vector is only used in advanced kernel mode.
  */
 /*lint -save -e9075 [8.4] All symbols are invoked from asm context.*/
-void SVC_Handler(void) {
+PORT_RAMFUNC void SVC_Handler(void) {
 /*lint -restore*/
   struct port_extctx *ctxp;
 
@@ -91,7 +91,7 @@ void SVC_Handler(void) {
  * @note    The PendSV vector is only used in compact kernel mode.
  */
 /*lint -save -e9075 [8.4] All symbols are invoked from asm context.*/
-void PendSV_Handler(void) {
+PORT_RAMFUNC void PendSV_Handler(void) {
 /*lint -restore*/
   struct port_extctx *ctxp;
 
@@ -119,7 +119,7 @@ void PendSV_Handler(void) {
 /**
  * @brief   Exception exit redirection to _port_switch_from_isr().
  */
-void _port_irq_epilogue(void) {
+PORT_RAMFUNC void _port_irq_epilogue(void) {
 
   port_lock_from_isr();
   if ((SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) != 0U) {
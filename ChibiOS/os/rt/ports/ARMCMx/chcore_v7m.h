@@ -101,6 +101,19 @@
 #define CORTEX_SIMPLIFIED_PRIORITY      FALSE
 #endif
 
+/**
+ * @brief   Executes the hot kernel, port and driver paths from RAM.
+ * @details The functions marked with @p PORT_RAMFUNC and the context
+ *          switch code are linked in the .ramtext section, the startup
+ *          code copies it to RAM together with the data segment. The flash
+ *          wait states and the accelerator misses are removed from those
+ *          paths.
+ * @note    The CCM is not executable, the code is placed in ram0.
+ */
+#if !defined(CORTEX_USE_RAMTEXT) || defined(__DOXYGEN__)
+#define CORTEX_USE_RAMTEXT              FALSE
+#endif
+
 /**
  * @brief   SVCALL handler priority.
  * @note    The default SVCALL handler priority is defaulted to
@@ -328,6 +341,17 @@ struct port_intctx {
  */
 #define PORT_IRQ_HANDLER(id) void id(void)
 
+/**
+ * @brief   Function placement in RAM.
+ * @note    Calls between flash and RAM are out of the branch range, the
+ *          linker inserts the long branch veneers.
+ */
+#if (CORTEX_USE_RAMTEXT == TRUE) || defined(__DOXYGEN__)
+#define PORT_RAMFUNC __attribute__((section(".ramtext")))
+#else
+#define PORT_RAMFUNC
+#endif
+
 /**
  * @brief   Fast IRQ handler function declaration.
  * @note    @p id can be a function name or a vector number depending on the
@@ -52,7 +52,11 @@
 #endif
 
                 .thumb
+#if CORTEX_USE_RAMTEXT
+                .section .ramtext, "ax", %progbits
+#else
                 .text
+#endif
 
 /*--------------------------------------------------------------------------*
  * Performs a context switch between two threads.
@@ -25,7 +25,13 @@
  * @{
  */
 
+#if defined(WIN32)
 #include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <stddef.h>
 
 #include "ch.h"
 
@@ -61,6 +67,52 @@ syssts_t port_irq_sts;
  * @param otp the thread to be switched out
  * @param ntp the thread to be switched in
  */
+#if defined(__x86_64__)
+__attribute__((used))
+static void __dummy(thread_t *ntp, thread_t *otp) {
+  (void)ntp; (void)otp;
+
+  /* System V ABI, ntp in rdi and otp in rsi.*/
+  asm volatile (
+#if defined(__APPLE__)
+                ".globl _port_switch                            \n\t"
+                "_port_switch:"
+#else
+                ".globl port_switch                             \n\t"
+                "port_switch:"
+#endif
+                "push    %%rbp                                  \n\t"
+                "push    %%rbx                                  \n\t"
+                "push    %%r12                                  \n\t"
+                "push    %%r13                                  \n\t"
+                "push    %%r14                                  \n\t"
+                "push    %%r15                                  \n\t"
+                "movq    %%rsp, %c0(%%rsi)                      \n\t"
+                "movq    %c0(%%rdi), %%rsp                      \n\t"
+                "pop     %%r15                                  \n\t"
+                "pop     %%r14                                  \n\t"
+                "pop     %%r13                                  \n\t"
+                "pop     %%r12                                  \n\t"
+                "pop     %%rbx                                  \n\t"
+                "pop     %%rbp                                  \n\t"
+                "ret                                            \n\t"
+#if defined(__APPLE__)
+                ".globl __port_thread_trampoline                \n\t"
+                "__port_thread_trampoline:"
+#else
+                ".globl _port_thread_trampoline                 \n\t"
+                "_port_thread_trampoline:"
+#endif
+                "movq    %%r12, %%rdi                           \n\t"
+                "movq    %%r13, %%rsi                           \n\t"
+#if defined(__APPLE__)
+                "call    __port_thread_start"
+#else
+                "call    _port_thread_start"
+#endif
+                : : "i" (offsetof(thread_t, p_ctx)));
+}
+#else
 __attribute__((used))
 static void __dummy(thread_t *ntp, thread_t *otp) {
   (void)ntp; (void)otp;
@@ -88,13 +140,18 @@ static void __dummy(thread_t *ntp, thread_t *otp) {
                 "pop     %ebp                                   \n\t"
                 "ret");
 }
+#endif
 
 /**
  * @brief   Start a thread by invoking its work function.
  * @details If the work function returns @p chThdExit() is automatically
  *          invoked.
  */
+#if defined(__x86_64__)
+__attribute__((noreturn))
+#else
 __attribute__((cdecl, noreturn))
+#endif
 void _port_thread_start(msg_t (*pf)(void *), void *p) {
 
   chSysUnlock();
@@ -110,11 +167,21 @@ void _port_thread_start(msg_t (*pf)(void *), void *p) {
  * @return              The realtime counter value.
  */
 rtcnt_t port_rt_get_counter_value(void) {
+#if defined(WIN32)
   LARGE_INTEGER n;
 
   QueryPerformanceCounter(&n);
 
   return (rtcnt_t)(n.QuadPart / 1000LL);
+#else
+  struct timespec ts;
+
+  /* Microseconds, the same unit assumed by the application code.*/
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (rtcnt_t)((uint64_t)ts.tv_sec * 1000000ULL +
+                   (uint64_t)ts.tv_nsec / 1000ULL);
+#endif
 }
 
 /** @} */
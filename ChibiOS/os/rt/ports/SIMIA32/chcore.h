@@ -45,7 +45,11 @@
 /**
  * @brief   Name of the architecture variant (optional).
  */
+#if defined(__x86_64__) || defined(__DOXYGEN__)
+#define PORT_CORE_VARIANT_NAME          "x86-64 (integer only)"
+#else
 #define PORT_CORE_VARIANT_NAME          "x86 (integer only)"
+#endif
 
 /**
  * @brief   Name of the compiler supported by this port.
@@ -132,6 +136,17 @@ struct port_extctx {
  * @details This structure represents the inner stack frame during a context
  *          switch.
  */
+#if defined(__x86_64__)
+struct port_intctx {
+  regx86  r15;
+  regx86  r14;
+  regx86  r13;
+  regx86  r12;
+  regx86  rbx;
+  regx86  rbp;
+  regx86  rip;
+};
+#else
 struct port_intctx {
   regx86  ebx;
   regx86  edi;
@@ -139,6 +154,7 @@ struct port_intctx {
   regx86  ebp;
   regx86  eip;
 };
+#endif
 
 /**
  * @brief   Platform dependent part of the @p thread_t structure.
@@ -164,13 +180,32 @@ struct context {
  * to save MMX registers). This aligns to 'mod' module 16, so that we'll end
  * up with the right alignment after pushing the args. */
 #define AALIGN(p, mask, mod)                                                \
-  p = (void *)((((uint32_t)(p) - (uint32_t)(mod)) & ~(uint32_t)(mask)) + (uint32_t)(mod)) \
+  p = (void *)((((uintptr_t)(p) - (uintptr_t)(mod)) & ~(uintptr_t)(mask)) + (uintptr_t)(mod)) \
 
 /**
  * @brief   Platform dependent part of the @p chThdCreateI() API.
  * @details This code usually setup the context switching frame represented
  *          by an @p port_intctx structure.
  */
+#if defined(__x86_64__)
+/* On x86-64 the arguments are passed in registers, the context switch
+   returns into _port_thread_trampoline which moves them from r12/r13.*/
+#define PORT_SETUP_CONTEXT(tp, workspace, wsize, pf, arg) {                 \
+  uint8_t *esp = (uint8_t *)workspace + wsize;                              \
+  APUSH(esp, 0);                                                            \
+  uint8_t *savebp = esp;                                                    \
+  AALIGN(esp, 15, 0);                                                       \
+  esp -= sizeof(struct port_intctx);                                        \
+  ((struct port_intctx *)esp)->rip = (void *)_port_thread_trampoline;       \
+  ((struct port_intctx *)esp)->rbx = NULL;                                  \
+  ((struct port_intctx *)esp)->r12 = (void *)(pf);                          \
+  ((struct port_intctx *)esp)->r13 = (void *)(arg);                         \
+  ((struct port_intctx *)esp)->r14 = NULL;                                  \
+  ((struct port_intctx *)esp)->r15 = NULL;                                  \
+  ((struct port_intctx *)esp)->rbp = (void *)savebp;                        \
+  (tp)->p_ctx.esp = (struct port_intctx *)esp;                              \
+}
+#else
 #define PORT_SETUP_CONTEXT(tp, workspace, wsize, pf, arg) {                 \
   /*lint -save -e611 -e9033 -e9074 -e9087 [10.8, 11.1, 11.3] Valid casts.*/ \
   uint8_t *esp = (uint8_t *)workspace + wsize;                              \
@@ -189,6 +224,7 @@ struct context {
   (tp)->p_ctx.esp = (struct port_intctx *)esp;                              \
   /*lint -restore*/                                                         \
 }
+#endif
 
  /**
  * @brief   Computes the thread working area global size.
@@ -243,9 +279,16 @@ extern syssts_t port_irq_sts;
 extern "C" {
 #endif
   /*lint -save -e950 [Dir-2.1] Non-ANSI keywords are fine in the port layer.*/
+#if defined(__x86_64__)
+  void port_switch(thread_t *ntp, thread_t *otp);
+  __attribute__((noreturn)) void _port_thread_start(msg_t (*pf)(void *p),
+                                                    void *p);
+  void _port_thread_trampoline(void);
+#else
   __attribute__((fastcall)) void port_switch(thread_t *ntp, thread_t *otp);
   __attribute__((cdecl, noreturn)) void _port_thread_start(msg_t (*pf)(void *p),
                                                            void *p);
+#endif
   /*lint -restore*/
   rtcnt_t port_rt_get_counter_value(void);
   void _sim_check_for_interrupts(void);
@@ -377,6 +420,14 @@ static inline void port_wait_for_interrupt(void) {
   _sim_check_for_interrupts();
 }
 
+#if CH_CFG_ST_TIMEDELTA > 0
+#if PORT_USE_ALT_TIMER == FALSE
+#include "chcore_timer.h"
+#else /* PORT_USE_ALT_TIMER != FALSE */
+#include "chcore_timer_alt.h"
+#endif /* PORT_USE_ALT_TIMER != FALSE */
+#endif /* CH_CFG_ST_TIMEDELTA > 0 */
+
 #endif /* _CHCORE_H_ */
 
 /** @} */
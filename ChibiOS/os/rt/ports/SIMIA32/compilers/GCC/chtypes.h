@@ -74,7 +74,12 @@ typedef uint8_t             tstate_t;       /**< Thread state.              */
 typedef uint8_t             trefs_t;        /**< Thread references counter. */
 typedef uint8_t             tslices_t;      /**< Thread time slices counter.*/
 typedef uint32_t            tprio_t;        /**< Thread priority.           */
+#if defined(__x86_64__)
+typedef intptr_t            msg_t;          /**< Inter-thread message, wide
+                                                 enough to carry a pointer. */
+#else
 typedef int32_t             msg_t;          /**< Inter-thread message.      */
+#endif
 typedef int32_t             eventid_t;      /**< Numeric event identifier.  */
 typedef uint32_t            eventmask_t;    /**< Mask of event identifiers. */
 typedef uint32_t            eventflags_t;   /**< Mask of event flags.       */
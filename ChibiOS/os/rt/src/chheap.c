@@ -176,6 +176,7 @@ void *chHeapAlloc(memory_heap_t *heapp, size_t size) {
       }
       hp->h.u.heap = heapp;
       H_UNLOCK(heapp);
+      _trace_alloc(CH_TRACE_ALLOC_HEAP, hp + 1, size);
 
       /*lint -save -e9087 [11.3] Safe cast.*/
       return (void *)(hp + 1);
@@ -193,6 +194,7 @@ void *chHeapAlloc(memory_heap_t *heapp, size_t size) {
       hp->h.u.heap = heapp;
       hp->h.size = size;
       hp++;
+      _trace_alloc(CH_TRACE_ALLOC_HEAP, hp, size);
 
       /*lint -save -e9087 [11.3] Safe cast.*/
       return (void *)hp;
@@ -215,6 +217,7 @@ void chHeapFree(void *p) {
   memory_heap_t *heapp;
 
   chDbgCheck(p != NULL);
+  _trace_free(CH_TRACE_ALLOC_HEAP, p);
 
   /*lint -save -e9087 [11.3] Safe cast.*/
   hp = (union heap_header *)p - 1;
@@ -289,6 +292,46 @@ size_t chHeapStatus(memory_heap_t *heapp, size_t *sizep) {
   return n;
 }
 
+/**
+ * @brief   Reports the free blocks of a heap.
+ * @details The free list is walked in address order and the first @p n
+ *          blocks are copied into @p fp, this is meant for fragmentation
+ *          diagnostics.
+ *
+ * @param[in] heapp     pointer to a heap descriptor or @p NULL in order to
+ *                      access the default heap.
+ * @param[out] fp       array receiving the free blocks
+ * @param[in] n         number of elements of @p fp
+ * @return              The number of fragments in the heap, it can be
+ *                      greater than @p n.
+ *
+ * @api
+ */
+size_t chHeapGetFragments(memory_heap_t *heapp, heap_fragment_t *fp,
+                          size_t n) {
+  union heap_header *qp;
+  size_t i;
+
+  if (heapp == NULL) {
+    heapp = &default_heap;
+  }
+
+  H_LOCK(heapp);
+  i = 0;
+  qp = heapp->h_free.h.u.next;
+  while (qp != NULL) {
+    if (i < n) {
+      fp[i].hf_addr = (void *)(qp + 1);
+      fp[i].hf_size = qp->h.size;
+    }
+    i++;
+    qp = qp->h.u.next;
+  }
+  H_UNLOCK(heapp);
+
+  return i;
+}
+
 #endif /* CH_CFG_USE_HEAP == TRUE */
 
 /** @} */
@@ -69,6 +69,70 @@
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Copies messages into the mailbox buffer.
+ * @note    The caller must have already reserved the slots on the
+ *          @p mb_emptysem semaphore.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be copied
+ * @param[in] n         number of messages to be copied
+ *
+ * @notapi
+ */
+static void mb_write(mailbox_t *mbp, const msg_t *msgs, cnt_t n) {
+
+  while (n > (cnt_t)0) {
+    *mbp->mb_wrptr++ = *msgs++;
+    if (mbp->mb_wrptr >= mbp->mb_top) {
+      mbp->mb_wrptr = mbp->mb_buffer;
+    }
+    n--;
+  }
+}
+
+/**
+ * @brief   Copies messages out of the mailbox buffer.
+ * @note    The caller must have already reserved the slots on the
+ *          @p mb_fullsem semaphore.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         number of messages to be copied
+ *
+ * @notapi
+ */
+static void mb_read(mailbox_t *mbp, msg_t *msgs, cnt_t n) {
+
+  while (n > (cnt_t)0) {
+    *msgs++ = *mbp->mb_rdptr++;
+    if (mbp->mb_rdptr >= mbp->mb_top) {
+      mbp->mb_rdptr = mbp->mb_buffer;
+    }
+    n--;
+  }
+}
+
+/**
+ * @brief   Reserves up to @p n slots already available on a semaphore.
+ * @details The semaphore counter is decreased without waiting.
+ *
+ * @param[in] sp        pointer to the @p semaphore_t to be decreased
+ * @param[in] n         maximum number of slots to be reserved
+ * @return              The number of reserved slots.
+ *
+ * @notapi
+ */
+static cnt_t mb_reserve(semaphore_t *sp, cnt_t n) {
+  cnt_t i;
+
+  for (i = (cnt_t)0; (i < n) && (chSemGetCounterI(sp) > (cnt_t)0); i++) {
+    chSemFastWaitI(sp);
+  }
+
+  return i;
+}
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -185,6 +249,7 @@ msg_t chMBPostS(mailbox_t *mbp, msg_t msg, systime_t timeout) {
 
   chDbgCheckClassS();
   chDbgCheck(mbp != NULL);
+  _trace_object(CH_TRACE_MB_POST, mbp, 1U);
 
   rdymsg = chSemWaitTimeoutS(&mbp->mb_emptysem, timeout);
   if (rdymsg == MSG_OK) {
@@ -217,6 +282,7 @@ msg_t chMBPostI(mailbox_t *mbp, msg_t msg) {
 
   chDbgCheckClassI();
   chDbgCheck(mbp != NULL);
+  _trace_object(CH_TRACE_MB_POST, mbp, 1U);
 
   if (chSemGetCounterI(&mbp->mb_emptysem) <= (cnt_t)0) {
     return MSG_TIMEOUT;
@@ -285,6 +351,7 @@ msg_t chMBPostAheadS(mailbox_t *mbp, msg_t msg, systime_t timeout) {
 
   chDbgCheckClassS();
   chDbgCheck(mbp != NULL);
+  _trace_object(CH_TRACE_MB_POST, mbp, 1U);
 
   rdymsg = chSemWaitTimeoutS(&mbp->mb_emptysem, timeout);
   if (rdymsg == MSG_OK) {
@@ -317,6 +384,7 @@ msg_t chMBPostAheadI(mailbox_t *mbp, msg_t msg) {
 
   chDbgCheckClassI();
   chDbgCheck(mbp != NULL);
+  _trace_object(CH_TRACE_MB_POST, mbp, 1U);
 
   if (chSemGetCounterI(&mbp->mb_emptysem) <= (cnt_t)0) {
     return MSG_TIMEOUT;
@@ -384,6 +452,7 @@ msg_t chMBFetchS(mailbox_t *mbp, msg_t *msgp, systime_t timeout) {
 
   chDbgCheckClassS();
   chDbgCheck((mbp != NULL) && (msgp != NULL));
+  _trace_object(CH_TRACE_MB_FETCH, mbp, 1U);
 
   rdymsg = chSemWaitTimeoutS(&mbp->mb_fullsem, timeout);
   if (rdymsg == MSG_OK) {
@@ -416,6 +485,7 @@ msg_t chMBFetchI(mailbox_t *mbp, msg_t *msgp) {
 
   chDbgCheckClassI();
   chDbgCheck((mbp != NULL) && (msgp != NULL));
+  _trace_object(CH_TRACE_MB_FETCH, mbp, 1U);
 
   if (chSemGetCounterI(&mbp->mb_fullsem) <= (cnt_t)0) {
     return MSG_TIMEOUT;
@@ -429,6 +499,210 @@ msg_t chMBFetchI(mailbox_t *mbp, msg_t *msgp) {
 
   return MSG_OK;
 }
+
+/**
+ * @brief   Posts multiple messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as there are free slots, up to @p n.
+ *          All the messages are posted within a single critical zone and
+ *          with a single reschedule operation.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of messages effectively posted, zero if
+ *                      the operation timed out or the mailbox has been
+ *                      reset while waiting.
+ *
+ * @api
+ */
+cnt_t chMBPostN(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                systime_t timeout) {
+  cnt_t posted;
+
+  chSysLock();
+  posted = chMBPostNS(mbp, msgs, n, timeout);
+  chSysUnlock();
+
+  return posted;
+}
+
+/**
+ * @brief   Posts multiple messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as there are free slots, up to @p n.
+ *          All the messages are posted within a single critical zone and
+ *          with a single reschedule operation.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of messages effectively posted, zero if
+ *                      the operation timed out or the mailbox has been
+ *                      reset while waiting.
+ *
+ * @sclass
+ */
+cnt_t chMBPostNS(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                 systime_t timeout) {
+  cnt_t posted;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+  _trace_object(CH_TRACE_MB_POST, mbp, (uint32_t)n);
+
+  if (chSemWaitTimeoutS(&mbp->mb_emptysem, timeout) != MSG_OK) {
+    return (cnt_t)0;
+  }
+  posted = (cnt_t)1 + mb_reserve(&mbp->mb_emptysem, n - (cnt_t)1);
+  mb_write(mbp, msgs, posted);
+  chSemAddCounterI(&mbp->mb_fullsem, posted);
+  chSchRescheduleS();
+
+  return posted;
+}
+
+/**
+ * @brief   Posts multiple messages into a mailbox.
+ * @details This variant is non-blocking, as many messages as there are free
+ *          slots are posted, up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @return              The number of messages effectively posted, zero if
+ *                      the mailbox is full.
+ *
+ * @iclass
+ */
+cnt_t chMBPostNI(mailbox_t *mbp, const msg_t *msgs, cnt_t n) {
+  cnt_t posted;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+  _trace_object(CH_TRACE_MB_POST, mbp, (uint32_t)n);
+
+  posted = mb_reserve(&mbp->mb_emptysem, n);
+  if (posted > (cnt_t)0) {
+    mb_write(mbp, msgs, posted);
+    chSemAddCounterI(&mbp->mb_fullsem, posted);
+  }
+
+  return posted;
+}
+
+/**
+ * @brief   Retrieves multiple messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted
+ *          in the mailbox or the specified time runs out, then fetches as
+ *          many queued messages as available, up to @p n.
+ *          All the messages are fetched within a single critical zone and
+ *          with a single reschedule operation.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of messages effectively fetched, zero if
+ *                      the operation timed out or the mailbox has been
+ *                      reset while waiting.
+ *
+ * @api
+ */
+cnt_t chMBFetchN(mailbox_t *mbp, msg_t *msgs, cnt_t n, systime_t timeout) {
+  cnt_t fetched;
+
+  chSysLock();
+  fetched = chMBFetchNS(mbp, msgs, n, timeout);
+  chSysUnlock();
+
+  return fetched;
+}
+
+/**
+ * @brief   Retrieves multiple messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted
+ *          in the mailbox or the specified time runs out, then fetches as
+ *          many queued messages as available, up to @p n.
+ *          All the messages are fetched within a single critical zone and
+ *          with a single reschedule operation.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of messages effectively fetched, zero if
+ *                      the operation timed out or the mailbox has been
+ *                      reset while waiting.
+ *
+ * @sclass
+ */
+cnt_t chMBFetchNS(mailbox_t *mbp, msg_t *msgs, cnt_t n, systime_t timeout) {
+  cnt_t fetched;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+  _trace_object(CH_TRACE_MB_FETCH, mbp, (uint32_t)n);
+
+  if (chSemWaitTimeoutS(&mbp->mb_fullsem, timeout) != MSG_OK) {
+    return (cnt_t)0;
+  }
+  fetched = (cnt_t)1 + mb_reserve(&mbp->mb_fullsem, n - (cnt_t)1);
+  mb_read(mbp, msgs, fetched);
+  chSemAddCounterI(&mbp->mb_emptysem, fetched);
+  chSchRescheduleS();
+
+  return fetched;
+}
+
+/**
+ * @brief   Retrieves multiple messages from a mailbox.
+ * @details This variant is non-blocking, as many queued messages as
+ *          available are fetched, up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @return              The number of messages effectively fetched, zero if
+ *                      the mailbox is empty.
+ *
+ * @iclass
+ */
+cnt_t chMBFetchNI(mailbox_t *mbp, msg_t *msgs, cnt_t n) {
+  cnt_t fetched;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+  _trace_object(CH_TRACE_MB_FETCH, mbp, (uint32_t)n);
+
+  fetched = mb_reserve(&mbp->mb_fullsem, n);
+  if (fetched > (cnt_t)0) {
+    mb_read(mbp, msgs, fetched);
+    chSemAddCounterI(&mbp->mb_emptysem, fetched);
+  }
+
+  return fetched;
+}
 #endif /* CH_CFG_USE_MAILBOXES == TRUE */
 
 /** @} */
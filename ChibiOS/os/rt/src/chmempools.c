@@ -152,6 +152,9 @@ void *chPoolAlloc(memory_pool_t *mp) {
   chSysLock();
   objp = chPoolAllocI(mp);
   chSysUnlock();
+  if (objp != NULL) {
+    _trace_alloc(CH_TRACE_ALLOC_POOL, objp, mp->mp_object_size);
+  }
 
   return objp;
 }
@@ -192,6 +195,7 @@ void chPoolFreeI(memory_pool_t *mp, void *objp) {
  */
 void chPoolFree(memory_pool_t *mp, void *objp) {
 
+  _trace_free(CH_TRACE_ALLOC_POOL, objp);
   chSysLock();
   chPoolFreeI(mp, objp);
   chSysUnlock();
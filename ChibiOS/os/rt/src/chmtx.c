@@ -141,6 +141,7 @@ void chMtxLockS(mutex_t *mp) {
 
   chDbgCheckClassS();
   chDbgCheck(mp != NULL);
+  _trace_object(CH_TRACE_MTX_LOCK, mp, 0U);
 
   /* Is the mutex already locked? */
   if (mp->m_owner != NULL) {
@@ -327,6 +328,7 @@ void chMtxUnlock(mutex_t *mp) {
   chDbgCheck(mp != NULL);
 
   chSysLock();
+  _trace_object(CH_TRACE_MTX_UNLOCK, mp, 0U);
 
   chDbgAssert(ctp->p_mtxlist != NULL, "owned mutexes list empty");
   chDbgAssert(ctp->p_mtxlist->m_owner == ctp, "ownership failure");
@@ -413,6 +415,7 @@ void chMtxUnlockS(mutex_t *mp) {
 
   chDbgCheckClassS();
   chDbgCheck(mp != NULL);
+  _trace_object(CH_TRACE_MTX_UNLOCK, mp, 0U);
 
   chDbgAssert(ctp->p_mtxlist != NULL, "owned mutexes list empty");
   chDbgAssert(ctp->p_mtxlist->m_owner == ctp, "ownership failure");
@@ -215,7 +215,7 @@ thread_t *list_remove(threads_list_t *tlp) {
  *
  * @iclass
  */
-thread_t *chSchReadyI(thread_t *tp) {
+CH_RAMFUNC thread_t *chSchReadyI(thread_t *tp) {
   thread_t *cp;
 
   chDbgCheckClassI();
@@ -247,7 +247,7 @@ thread_t *chSchReadyI(thread_t *tp) {
  *
  * @sclass
  */
-void chSchGoSleepS(tstate_t newstate) {
+CH_RAMFUNC void chSchGoSleepS(tstate_t newstate) {
   thread_t *otp;
 
   chDbgCheckClassS();
@@ -327,7 +327,7 @@ static void wakeup(void *p) {
  *
  * @sclass
  */
-msg_t chSchGoSleepTimeoutS(tstate_t newstate, systime_t time) {
+CH_RAMFUNC msg_t chSchGoSleepTimeoutS(tstate_t newstate, systime_t time) {
 
   chDbgCheckClassS();
 
@@ -364,7 +364,7 @@ msg_t chSchGoSleepTimeoutS(tstate_t newstate, systime_t time) {
  *
  * @sclass
  */
-void chSchWakeupS(thread_t *ntp, msg_t msg) {
+CH_RAMFUNC void chSchWakeupS(thread_t *ntp, msg_t msg) {
 
   chDbgCheckClassS();
 
@@ -403,7 +403,7 @@ void chSchWakeupS(thread_t *ntp, msg_t msg) {
  *
  * @sclass
  */
-void chSchRescheduleS(void) {
+CH_RAMFUNC void chSchRescheduleS(void) {
 
   chDbgCheckClassS();
 
@@ -425,7 +425,7 @@ void chSchRescheduleS(void) {
  *
  * @special
  */
-bool chSchIsPreemptionRequired(void) {
+CH_RAMFUNC bool chSchIsPreemptionRequired(void) {
   tprio_t p1 = firstprio(&ch.rlist.r_queue);
   tprio_t p2 = currp->p_prio;
 
@@ -452,7 +452,7 @@ bool chSchIsPreemptionRequired(void) {
  *
  * @special
  */
-void chSchDoRescheduleBehind(void) {
+CH_RAMFUNC void chSchDoRescheduleBehind(void) {
   thread_t *otp;
 
   otp = currp;
@@ -480,7 +480,7 @@ void chSchDoRescheduleBehind(void) {
  *
  * @special
  */
-void chSchDoRescheduleAhead(void) {
+CH_RAMFUNC void chSchDoRescheduleAhead(void) {
   thread_t *otp, *cp;
 
   otp = currp;
@@ -517,7 +517,7 @@ void chSchDoRescheduleAhead(void) {
  *
  * @special
  */
-void chSchDoReschedule(void) {
+CH_RAMFUNC void chSchDoReschedule(void) {
 
 #if CH_CFG_TIME_QUANTUM > 0
   /* If CH_CFG_TIME_QUANTUM is enabled then there are two different scenarios
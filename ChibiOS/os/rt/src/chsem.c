@@ -201,6 +201,7 @@ msg_t chSemWaitS(semaphore_t *sp) {
   chDbgAssert(((sp->s_cnt >= (cnt_t)0) && queue_isempty(&sp->s_queue)) ||
               ((sp->s_cnt < (cnt_t)0) && queue_notempty(&sp->s_queue)),
               "inconsistent semaphore");
+  _trace_object(CH_TRACE_SEM_WAIT, sp, (uint32_t)sp->s_cnt);
 
   if (--sp->s_cnt < (cnt_t)0) {
     currp->p_u.wtsemp = sp;
@@ -268,6 +269,7 @@ msg_t chSemWaitTimeoutS(semaphore_t *sp, systime_t time) {
   chDbgAssert(((sp->s_cnt >= (cnt_t)0) && queue_isempty(&sp->s_queue)) ||
               ((sp->s_cnt < (cnt_t)0) && queue_notempty(&sp->s_queue)),
               "inconsistent semaphore");
+  _trace_object(CH_TRACE_SEM_WAIT, sp, (uint32_t)sp->s_cnt);
 
   if (--sp->s_cnt < (cnt_t)0) {
     if (TIME_IMMEDIATE == time) {
@@ -299,6 +301,7 @@ void chSemSignal(semaphore_t *sp) {
               "inconsistent semaphore");
 
   chSysLock();
+  _trace_object(CH_TRACE_SEM_SIGNAL, sp, (uint32_t)sp->s_cnt);
   if (++sp->s_cnt <= (cnt_t)0) {
     chSchWakeupS(queue_fifo_remove(&sp->s_queue), MSG_OK);
   }
@@ -323,6 +326,7 @@ void chSemSignalI(semaphore_t *sp) {
   chDbgAssert(((sp->s_cnt >= (cnt_t)0) && queue_isempty(&sp->s_queue)) ||
               ((sp->s_cnt < (cnt_t)0) && queue_notempty(&sp->s_queue)),
               "inconsistent semaphore");
+  _trace_object(CH_TRACE_SEM_SIGNAL, sp, (uint32_t)sp->s_cnt);
 
   if (++sp->s_cnt <= (cnt_t)0) {
     /* Note, it is done this way in order to allow a tail call on
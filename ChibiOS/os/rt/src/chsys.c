@@ -310,7 +310,7 @@ bool chSysIntegrityCheckI(unsigned testmask) {
  *
  * @iclass
  */
-void chSysTimerHandlerI(void) {
+CH_RAMFUNC void chSysTimerHandlerI(void) {
 
   chDbgCheckClassI();
 
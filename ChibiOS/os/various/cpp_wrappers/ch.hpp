@@ -2194,6 +2194,138 @@ namespace chibios_rt {
       return chMBFetchI(&mb, reinterpret_cast<msg_t*>(msgp));
     }
 
+    /**
+     * @brief   Posts multiple messages into a mailbox.
+     * @details The invoking thread waits until at least one empty slot in
+     *          the mailbox becomes available or the specified time runs out,
+     *          then posts as many messages as there are free slots, up to
+     *          @p n.
+     *
+     * @param[in] msgs      pointer to the array of messages to be posted
+     * @param[in] n         number of messages in the array
+     * @param[in] time      the number of ticks before the operation timeouts,
+     *                      the following special values are allowed:
+     *                      - @a TIME_IMMEDIATE immediate timeout.
+     *                      - @a TIME_INFINITE no timeout.
+     *                      .
+     * @return              The number of messages effectively posted, zero
+     *                      if the operation timed out or the mailbox has
+     *                      been reset while waiting.
+     *
+     * @api
+     */
+    cnt_t postN(const T *msgs, cnt_t n, systime_t time) {
+
+      return chMBPostN(&mb, reinterpret_cast<const msg_t*>(msgs), n, time);
+    }
+
+    /**
+     * @brief   Posts multiple messages into a mailbox.
+     * @details The invoking thread waits until at least one empty slot in
+     *          the mailbox becomes available or the specified time runs out,
+     *          then posts as many messages as there are free slots, up to
+     *          @p n.
+     *
+     * @param[in] msgs      pointer to the array of messages to be posted
+     * @param[in] n         number of messages in the array
+     * @param[in] time      the number of ticks before the operation timeouts,
+     *                      the following special values are allowed:
+     *                      - @a TIME_IMMEDIATE immediate timeout.
+     *                      - @a TIME_INFINITE no timeout.
+     *                      .
+     * @return              The number of messages effectively posted, zero
+     *                      if the operation timed out or the mailbox has
+     *                      been reset while waiting.
+     *
+     * @sclass
+     */
+    cnt_t postNS(const T *msgs, cnt_t n, systime_t time) {
+
+      return chMBPostNS(&mb, reinterpret_cast<const msg_t*>(msgs), n, time);
+    }
+
+    /**
+     * @brief   Posts multiple messages into a mailbox.
+     * @details This variant is non-blocking, as many messages as there are
+     *          free slots are posted, up to @p n.
+     *
+     * @param[in] msgs      pointer to the array of messages to be posted
+     * @param[in] n         number of messages in the array
+     * @return              The number of messages effectively posted, zero
+     *                      if the mailbox is full.
+     *
+     * @iclass
+     */
+    cnt_t postNI(const T *msgs, cnt_t n) {
+
+      return chMBPostNI(&mb, reinterpret_cast<const msg_t*>(msgs), n);
+    }
+
+    /**
+     * @brief   Retrieves multiple messages from a mailbox.
+     * @details The invoking thread waits until at least one message is
+     *          posted in the mailbox or the specified time runs out, then
+     *          fetches as many queued messages as available, up to @p n.
+     *
+     * @param[out] msgs     pointer to the array receiving the messages
+     * @param[in] n         size of the array
+     * @param[in] time      the number of ticks before the operation timeouts,
+     *                      the following special values are allowed:
+     *                      - @a TIME_IMMEDIATE immediate timeout.
+     *                      - @a TIME_INFINITE no timeout.
+     *                      .
+     * @return              The number of messages effectively fetched, zero
+     *                      if the operation timed out or the mailbox has
+     *                      been reset while waiting.
+     *
+     * @api
+     */
+    cnt_t fetchN(T *msgs, cnt_t n, systime_t time) {
+
+      return chMBFetchN(&mb, reinterpret_cast<msg_t*>(msgs), n, time);
+    }
+
+    /**
+     * @brief   Retrieves multiple messages from a mailbox.
+     * @details The invoking thread waits until at least one message is
+     *          posted in the mailbox or the specified time runs out, then
+     *          fetches as many queued messages as available, up to @p n.
+     *
+     * @param[out] msgs     pointer to the array receiving the messages
+     * @param[in] n         size of the array
+     * @param[in] time      the number of ticks before the operation timeouts,
+     *                      the following special values are allowed:
+     *                      - @a TIME_IMMEDIATE immediate timeout.
+     *                      - @a TIME_INFINITE no timeout.
+     *                      .
+     * @return              The number of messages effectively fetched, zero
+     *                      if the operation timed out or the mailbox has
+     *                      been reset while waiting.
+     *
+     * @sclass
+     */
+    cnt_t fetchNS(T *msgs, cnt_t n, systime_t time) {
+
+      return chMBFetchNS(&mb, reinterpret_cast<msg_t*>(msgs), n, time);
+    }
+
+    /**
+     * @brief   Retrieves multiple messages from a mailbox.
+     * @details This variant is non-blocking, as many queued messages as
+     *          available are fetched, up to @p n.
+     *
+     * @param[out] msgs     pointer to the array receiving the messages
+     * @param[in] n         size of the array
+     * @return              The number of messages effectively fetched, zero
+     *                      if the mailbox is empty.
+     *
+     * @iclass
+     */
+    cnt_t fetchNI(T *msgs, cnt_t n) {
+
+      return chMBFetchNI(&mb, reinterpret_cast<msg_t*>(msgs), n);
+    }
+
     /**
      * @brief   Returns the number of free message slots into a mailbox.
      * @note    Can be invoked in any system state but if invoked out of a
@@ -0,0 +1,152 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    tmscope.hpp
+ * @brief   C++ wrapper of the scoped time measurements.
+ *
+ * @addtogroup cpp_library
+ * @{
+ */
+
+#include <ch.h>
+#include "tmscope.h"
+
+#ifndef _TMSCOPE_HPP_
+#define _TMSCOPE_HPP_
+
+namespace chibios_rt {
+
+  /*------------------------------------------------------------------------*
+   * chibios_rt::MeasurementPoint                                           *
+   *------------------------------------------------------------------------*/
+  /**
+   * @brief   Named measurement point.
+   * @details Objects of this class are meant to have static storage, they
+   *          join the registry listed by the shell on their first
+   *          measurement.
+   */
+  class MeasurementPoint {
+  public:
+    /**
+     * @brief   Embedded @p tm_point_t structure.
+     */
+    ::tm_point_t point;
+
+    /**
+     * @brief   MeasurementPoint constructor.
+     *
+     * @param[in] name      the point name
+     *
+     * @init
+     */
+    MeasurementPoint(const char *name) {
+      ::tm_point_t init = _TM_POINT_DATA(name);
+
+      point = init;
+    }
+
+    /**
+     * @brief   Records a measurement.
+     *
+     * @param[in] start     realtime counter value at the start
+     * @param[in] stop      realtime counter value at the end
+     *
+     * @xclass
+     */
+    void recordX(rtcnt_t start, rtcnt_t stop) {
+
+      tmpRecordX(&point, start, stop);
+    }
+
+    /**
+     * @brief   Resets the statistics.
+     *
+     * @api
+     */
+    void reset(void) {
+
+      tmpReset(&point);
+    }
+  };
+
+  /*------------------------------------------------------------------------*
+   * chibios_rt::ScopedTimer                                                *
+   *------------------------------------------------------------------------*/
+  /**
+   * @brief   RAII timer, measures its own lifetime.
+   */
+  class ScopedTimer {
+    ::tm_point_t *point;
+    rtcnt_t start;
+
+    /* Not copyable.*/
+    ScopedTimer(const ScopedTimer &);
+    ScopedTimer &operator=(const ScopedTimer &);
+
+  public:
+    /**
+     * @brief   Starts the measurement.
+     *
+     * @param[in] mp        the measurement point to be updated
+     *
+     * @xclass
+     */
+    ScopedTimer(MeasurementPoint &mp) :
+      point(&mp.point), start(chSysGetRealtimeCounterX()) {
+    }
+
+    /**
+     * @brief   Starts the measurement.
+     *
+     * @param[in] tpp       pointer to the @p tm_point_t to be updated
+     *
+     * @xclass
+     */
+    ScopedTimer(::tm_point_t *tpp) :
+      point(tpp), start(chSysGetRealtimeCounterX()) {
+    }
+
+    /**
+     * @brief   Stops the measurement and records it.
+     */
+    ~ScopedTimer() {
+
+      tmpRecordX(point, start, chSysGetRealtimeCounterX());
+    }
+  };
+}
+
+/**
+ * @brief   Measures the rest of the enclosing block.
+ * @note    The point is a constant initialized @p tm_point_t, a local
+ *          static object would need a guarded constructor call.
+ *
+ * @param[in] name      the point name
+ */
+#if TM_SCOPE_ENABLED || defined(__DOXYGEN__)
+#define TM_SCOPE(name)                                                      \
+  static ::tm_point_t _TM_CONCAT(_tm_point_, __LINE__) =                    \
+      _TM_POINT_DATA(name);                                                 \
+  chibios_rt::ScopedTimer _TM_CONCAT(_tm_scope_, __LINE__)(                 \
+      &_TM_CONCAT(_tm_point_, __LINE__))
+#else
+#define TM_SCOPE(name)
+#endif
+
+#endif /* _TMSCOPE_HPP_ */
+
+/** @} */
@@ -0,0 +1,329 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    deftimer.c
+ * @brief   Deferred Timers code.
+ * @details Virtual timer callbacks run in the system tick ISR with the
+ *          kernel locked, heavy callbacks stretch the interrupt latency of
+ *          the whole system. A deferred timer only queues itself from the
+ *          ISR, the callback is executed by a service thread at
+ *          @p DEFTIMER_THREAD_PRIORITY with the kernel unlocked, so it can
+ *          use the normal (non I-class) APIs.
+ *
+ * @addtogroup deferred_timer
+ * @{
+ */
+
+#include "ch.h"
+#include "deftimer.h"
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local types.                                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables.                                                   */
+/*===========================================================================*/
+
+static THD_WORKING_AREA(wa_deftimer, DEFTIMER_THREAD_STACK_SIZE);
+
+/**
+ * @brief   Service thread reference, not NULL while it is waiting.
+ */
+static thread_reference_t dt_thread;
+
+/**
+ * @brief   Queue of the expired timers waiting for execution.
+ */
+static deferred_timer_t *dt_head, *dt_tail;
+
+/**
+ * @brief   List of all the initialized timers.
+ */
+static deferred_timer_t *dt_registry;
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Removes a timer from the pending queue.
+ *
+ * @param[in] dtp       pointer to the @p deferred_timer_t
+ *
+ * @notapi
+ */
+static void dt_dequeue(deferred_timer_t *dtp) {
+  deferred_timer_t *prev = NULL, *cur = dt_head;
+
+  while (cur != NULL) {
+    if (cur == dtp) {
+      if (prev == NULL)
+        dt_head = cur->dt_next;
+      else
+        prev->dt_next = cur->dt_next;
+      if (dt_tail == cur)
+        dt_tail = prev;
+      break;
+    }
+    prev = cur;
+    cur = cur->dt_next;
+  }
+  dtp->dt_next = NULL;
+  dtp->dt_pending = false;
+}
+
+/**
+ * @brief   Virtual timer callback, runs in the timer ISR.
+ * @details Periodic timers are re-armed here in order to keep the period
+ *          independent from the service thread latency.
+ *
+ * @param[in] p         pointer to the @p deferred_timer_t
+ *
+ * @notapi
+ */
+static void dt_vtcb(void *p) {
+  deferred_timer_t *dtp = (deferred_timer_t *)p;
+
+  chSysLockFromISR();
+  if (dtp->dt_interval != (systime_t)0)
+    chVTDoSetI(&dtp->dt_vt, dtp->dt_interval, dt_vtcb, dtp);
+  if (dtp->dt_pending) {
+    dtp->dt_overruns++;
+  }
+  else {
+    dtp->dt_pending = true;
+    dtp->dt_fired = chSysGetRealtimeCounterX();
+    dtp->dt_next = NULL;
+    if (dt_tail == NULL)
+      dt_head = dtp;
+    else
+      dt_tail->dt_next = dtp;
+    dt_tail = dtp;
+    chThdResumeI(&dt_thread, MSG_OK);
+  }
+  chSysUnlockFromISR();
+}
+
+/**
+ * @brief   Deferred timers service thread.
+ */
+static THD_FUNCTION(dt_service, p) {
+  deferred_timer_t *dtp;
+  dtfunc_t func;
+  void *par;
+  rtcnt_t latency;
+
+  (void)p;
+  chRegSetThreadName("deftimer");
+
+  while (true) {
+    chSysLock();
+    while (dt_head == NULL)
+      (void) chThdSuspendS(&dt_thread);
+    dtp = dt_head;
+    dt_head = dtp->dt_next;
+    if (dt_head == NULL)
+      dt_tail = NULL;
+    dtp->dt_next = NULL;
+    dtp->dt_pending = false;
+    func = dtp->dt_func;
+    par = dtp->dt_par;
+    latency = chSysGetRealtimeCounterX() - dtp->dt_fired;
+    if (latency > dtp->dt_latency)
+      dtp->dt_latency = latency;
+    chSysUnlock();
+
+    chTMStartMeasurementX(&dtp->dt_tm);
+    func(par);
+    chTMStopMeasurementX(&dtp->dt_tm);
+  }
+}
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Starts the deferred timers service thread.
+ * @note    Must be invoked once after the kernel initialization and before
+ *          arming any deferred timer.
+ *
+ * @api
+ */
+void dtInit(void) {
+
+  chThdCreateStatic(wa_deftimer, sizeof(wa_deftimer),
+                    DEFTIMER_THREAD_PRIORITY, dt_service, NULL);
+}
+
+/**
+ * @brief   Initializes a @p deferred_timer_t structure.
+ * @details The timer is also added to the list of the timers reported by
+ *          @p dtGetFirst() and @p dtGetNext().
+ *
+ * @param[out] dtp      the @p deferred_timer_t structure to be initialized
+ * @param[in] name      timer name used in the statistics
+ *
+ * @init
+ */
+void dtObjectInit(deferred_timer_t *dtp, const char *name) {
+
+  chVTObjectInit(&dtp->dt_vt);
+  dtp->dt_next = NULL;
+  dtp->dt_name = name;
+  dtp->dt_func = NULL;
+  dtp->dt_par = NULL;
+  dtp->dt_interval = (systime_t)0;
+  dtp->dt_pending = false;
+  dtResetStats(dtp);
+  chSysLock();
+  dtp->dt_link = dt_registry;
+  dt_registry = dtp;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Arms a one shot deferred timer.
+ * @details If the timer was already armed or pending then it is reset
+ *          before being armed again.
+ *
+ * @param[in] dtp       pointer to an initialized @p deferred_timer_t
+ * @param[in] delay     the number of ticks before the callback is queued,
+ *                      @p TIME_INFINITE and @p TIME_IMMEDIATE are not
+ *                      allowed
+ * @param[in] func      the callback, invoked from the service thread
+ * @param[in] par       parameter passed to the callback
+ *
+ * @api
+ */
+void dtSet(deferred_timer_t *dtp, systime_t delay,
+           dtfunc_t func, void *par) {
+
+  chSysLock();
+  if (chVTIsArmedI(&dtp->dt_vt))
+    chVTResetI(&dtp->dt_vt);
+  if (dtp->dt_pending)
+    dt_dequeue(dtp);
+  dtp->dt_func = func;
+  dtp->dt_par = par;
+  dtp->dt_interval = (systime_t)0;
+  chVTDoSetI(&dtp->dt_vt, delay, dt_vtcb, dtp);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Arms a periodic deferred timer.
+ * @details The period is kept by the timer ISR, if the callback of the
+ *          previous period has not been executed yet when the timer fires
+ *          again then the expiration is counted as an overrun and dropped.
+ *
+ * @param[in] dtp       pointer to an initialized @p deferred_timer_t
+ * @param[in] interval  the period in ticks, @p TIME_INFINITE and
+ *                      @p TIME_IMMEDIATE are not allowed
+ * @param[in] func      the callback, invoked from the service thread
+ * @param[in] par       parameter passed to the callback
+ *
+ * @api
+ */
+void dtSetPeriodic(deferred_timer_t *dtp, systime_t interval,
+                   dtfunc_t func, void *par) {
+
+  chSysLock();
+  if (chVTIsArmedI(&dtp->dt_vt))
+    chVTResetI(&dtp->dt_vt);
+  if (dtp->dt_pending)
+    dt_dequeue(dtp);
+  dtp->dt_func = func;
+  dtp->dt_par = par;
+  dtp->dt_interval = interval;
+  chVTDoSetI(&dtp->dt_vt, interval, dt_vtcb, dtp);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Disables a deferred timer.
+ * @details A pending callback that has not been executed yet is discarded.
+ *
+ * @param[in] dtp       pointer to an initialized @p deferred_timer_t
+ *
+ * @api
+ */
+void dtReset(deferred_timer_t *dtp) {
+
+  chSysLock();
+  dtp->dt_interval = (systime_t)0;
+  if (chVTIsArmedI(&dtp->dt_vt))
+    chVTResetI(&dtp->dt_vt);
+  if (dtp->dt_pending)
+    dt_dequeue(dtp);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Clears the statistics of a deferred timer.
+ * @details The counters are cleared with the kernel locked, the timer ISR
+ *          and the service thread update them meanwhile.
+ *
+ * @param[in] dtp       pointer to an initialized @p deferred_timer_t
+ *
+ * @api
+ */
+void dtResetStats(deferred_timer_t *dtp) {
+
+  chSysLock();
+  chTMObjectInit(&dtp->dt_tm);
+  dtp->dt_fired = (rtcnt_t)0;
+  dtp->dt_latency = (rtcnt_t)0;
+  dtp->dt_overruns = (ucnt_t)0;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Returns the first registered deferred timer.
+ *
+ * @return              The most recently initialized timer or @p NULL.
+ *
+ * @api
+ */
+deferred_timer_t *dtGetFirst(void) {
+
+  return dt_registry;
+}
+
+/**
+ * @brief   Returns the registered timer after @p dtp.
+ *
+ * @param[in] dtp       pointer to a registered @p deferred_timer_t
+ * @return              The next timer or @p NULL.
+ *
+ * @api
+ */
+deferred_timer_t *dtGetNext(deferred_timer_t *dtp) {
+
+  return dtp->dt_link;
+}
+
+/** @} */
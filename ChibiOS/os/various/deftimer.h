@@ -0,0 +1,141 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    deftimer.h
+ * @brief   Deferred Timers structures and macros.
+ *
+ * @addtogroup deferred_timer
+ * @{
+ */
+
+#ifndef _DEFTIMER_H_
+#define _DEFTIMER_H_
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Priority of the deferred timers service thread.
+ * @note    Callbacks are executed in the order their timers fired, at this
+ *          priority and with the kernel unlocked.
+ */
+#if !defined(DEFTIMER_THREAD_PRIORITY) || defined(__DOXYGEN__)
+#define DEFTIMER_THREAD_PRIORITY            (HIGHPRIO - 1)
+#endif
+
+/**
+ * @brief   Stack size of the deferred timers service thread.
+ * @note    All the deferred callbacks share this stack.
+ */
+#if !defined(DEFTIMER_THREAD_STACK_SIZE) || defined(__DOXYGEN__)
+#define DEFTIMER_THREAD_STACK_SIZE          512
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*
+ * Module dependencies check.
+ */
+#if !CH_CFG_USE_TM
+#error "Deferred Timers require CH_CFG_USE_TM"
+#endif
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Type of a deferred timer callback function.
+ */
+typedef void (*dtfunc_t)(void *par);
+
+/**
+ * @brief   Type of a deferred timer structure.
+ * @details The embedded virtual timer only queues the object from the
+ *          timer ISR, the callback is invoked later by the service thread.
+ */
+typedef struct deferred_timer {
+  virtual_timer_t           dt_vt;      /**< @brief Embedded virtual timer. */
+  struct deferred_timer     *dt_next;   /**< @brief Next pending timer.     */
+  struct deferred_timer     *dt_link;   /**< @brief Next registered timer.  */
+  const char                *dt_name;   /**< @brief Timer name.             */
+  dtfunc_t                  dt_func;    /**< @brief Callback function.      */
+  void                      *dt_par;    /**< @brief Callback parameter.     */
+  systime_t                 dt_interval;/**< @brief Period, zero if one
+                                                    shot.                   */
+  bool                      dt_pending; /**< @brief Queued for execution.   */
+  rtcnt_t                   dt_fired;   /**< @brief Realtime counter value
+                                                    when last queued.       */
+  rtcnt_t                   dt_latency; /**< @brief Worst ISR to callback
+                                                    dispatch latency.       */
+  ucnt_t                    dt_overruns;/**< @brief Number of expirations
+                                                    lost because the timer
+                                                    was still pending.      */
+  time_measurement_t        dt_tm;      /**< @brief Callback execution
+                                                    time statistics.        */
+} deferred_timer_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void dtInit(void);
+  void dtObjectInit(deferred_timer_t *dtp, const char *name);
+  void dtSet(deferred_timer_t *dtp, systime_t delay,
+             dtfunc_t func, void *par);
+  void dtSetPeriodic(deferred_timer_t *dtp, systime_t interval,
+                     dtfunc_t func, void *par);
+  void dtReset(deferred_timer_t *dtp);
+  void dtResetStats(deferred_timer_t *dtp);
+  deferred_timer_t *dtGetFirst(void);
+  deferred_timer_t *dtGetNext(deferred_timer_t *dtp);
+#ifdef __cplusplus
+}
+#endif
+
+/*===========================================================================*/
+/* Module inline functions.                                                  */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the name of a deferred timer.
+ *
+ * @param[in] dtp       pointer to an initialized @p deferred_timer_t
+ * @return              The name given to @p dtObjectInit().
+ */
+static inline const char *dtGetName(deferred_timer_t *dtp) {
+
+  return dtp->dt_name;
+}
+
+#endif /* _DEFTIMER_H_ */
+
+/** @} */
@@ -8,6 +8,7 @@
 #include "hal.h"
 #include "ffconf.h"
 #include "diskio.h"
+#include "tmscope.h"
 
 #if HAL_USE_MMC_SPI && HAL_USE_SDC
 #error "cannot specify both MMC_SPI and SDC drivers"
@@ -25,6 +26,15 @@ extern SDCDriver SDCD1;
 extern RTCDriver RTCD1;
 #endif
 
+/*
+ * I/O accounting hook, invoked after each SDC transfer with the direction
+ * (0 read, 1 write), the number of sectors, the duration in realtime
+ * counter cycles and the result. It can be defined in ffconf.h.
+ */
+#if !defined(FATFS_DISKIO_HOOK)
+#define FATFS_DISKIO_HOOK(wr, count, cycles, res) (void)(cycles)
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Correspondence between physical drive number and physical drive.      */
 
@@ -113,6 +123,8 @@ DRESULT disk_read (
     UINT count        /* Number of sectors to read (1..255) */
 )
 {
+  TM_SCOPE("disk_read");
+
   switch (pdrv) {
 #if HAL_USE_MMC_SPI
   case MMC:
@@ -130,12 +142,17 @@ DRESULT disk_read (
         return RES_ERROR;
     return RES_OK;
 #else
-  case SDC:
+  case SDC: {
+    rtcnt_t start;
+    DRESULT res;
+
     if (blkGetDriverState(&SDCD1) != BLK_READY)
       return RES_NOTRDY;
-    if (sdcRead(&SDCD1, sector, buff, count))
-      return RES_ERROR;
-    return RES_OK;
+    start = chSysGetRealtimeCounterX();
+    res = sdcRead(&SDCD1, sector, buff, count) ? RES_ERROR : RES_OK;
+    FATFS_DISKIO_HOOK(0, count, chSysGetRealtimeCounterX() - start, res);
+    return res;
+  }
 #endif
   }
   return RES_PARERR;
@@ -154,6 +171,8 @@ DRESULT disk_write (
     UINT count            /* Number of sectors to write (1..255) */
 )
 {
+  TM_SCOPE("disk_write");
+
   switch (pdrv) {
 #if HAL_USE_MMC_SPI
   case MMC:
@@ -173,12 +192,17 @@ DRESULT disk_write (
         return RES_ERROR;
     return RES_OK;
 #else
-  case SDC:
+  case SDC: {
+    rtcnt_t start;
+    DRESULT res;
+
     if (blkGetDriverState(&SDCD1) != BLK_READY)
       return RES_NOTRDY;
-    if (sdcWrite(&SDCD1, sector, buff, count))
-      return RES_ERROR;
-    return RES_OK;
+    start = chSysGetRealtimeCounterX();
+    res = sdcWrite(&SDCD1, sector, buff, count) ? RES_ERROR : RES_OK;
+    FATFS_DISKIO_HOOK(1, count, chSysGetRealtimeCounterX() - start, res);
+    return res;
+  }
 #endif
   }
   return RES_PARERR;
@@ -59,7 +59,7 @@ typedef uint16_t        u16_t;
 typedef int16_t         s16_t;
 typedef uint32_t        u32_t;
 typedef int32_t         s32_t;
-typedef uint32_t        mem_ptr_t;
+typedef uintptr_t       mem_ptr_t;
 
 #define PACK_STRUCT_STRUCT __attribute__((packed))
 
@@ -68,7 +68,16 @@ typedef uint32_t        mem_ptr_t;
   osalSysHalt(x);                                                          \
 }
 
+#ifndef BYTE_ORDER
 #define BYTE_ORDER LITTLE_ENDIAN
+#endif
+
+#if defined(SIMULATOR)
+/* The host C library already provides these.*/
+#define LWIP_TIMEVAL_PRIVATE 0
+#include <errno.h>
+#else
 #define LWIP_PROVIDE_ERRNO
+#endif
 
 #endif /* __CC_H__ */
@@ -60,6 +60,14 @@
 #include "arch/cc.h"
 #include "arch/sys_arch.h"
 
+/*
+ * Allocator of the working areas of the threads created by
+ * sys_thread_new(), it can be defined in lwipopts.h.
+ */
+#if !defined(LWIP_THREAD_ALLOC)
+#define LWIP_THREAD_ALLOC(size) chCoreAlloc(size)
+#endif
+
 void sys_init(void) {
 
 }
@@ -211,7 +219,7 @@ sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread,
 
   (void)name;
   wsz = THD_WORKING_AREA_SIZE(stacksize);
-  wsp = chCoreAlloc(wsz);
+  wsp = LWIP_THREAD_ALLOC(wsz);
   if (wsp == NULL)
     return NULL;
 
@@ -57,6 +57,7 @@
 
 #include "hal.h"
 #include "evtimer.h"
+#include "tmscope.h"
 
 #include "lwipthread.h"
 
@@ -72,6 +73,12 @@
 #include "netif/etharp.h"
 #include "netif/ppp_oe.h"
 
+#if LWIP_MAC_CHECKSUM_OFFLOAD
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+#include "lwip/udp.h"
+#endif
+
 #if LWIP_DHCP
 #include <lwip/dhcp.h>
 #endif
@@ -87,7 +94,8 @@ thread_reference_t lwip_trp = NULL;
 /*
  * Stack area for the LWIP-MAC thread.
  */
-static THD_WORKING_AREA(wa_lwip_thread, LWIP_THREAD_STACK_SIZE);
+static LWIP_THREAD_WA_SECTION THD_WORKING_AREA(wa_lwip_thread,
+                                                LWIP_THREAD_STACK_SIZE);
 
 /*
  * Initialization.
@@ -112,6 +120,7 @@ static void low_level_init(struct netif *netif) {
 static err_t low_level_output(struct netif *netif, struct pbuf *p) {
   struct pbuf *q;
   MACTransmitDescriptor td;
+  TM_SCOPE("eth_output");
 
   (void)netif;
   if (macWaitTransmitDescriptor(&ETHD1, &td, MS2ST(LWIP_SEND_TIMEOUT)) != MSG_OK)
@@ -135,6 +144,55 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p) {
   return ERR_OK;
 }
 
+#if LWIP_MAC_CHECKSUM_OFFLOAD
+/*
+ * Checks in software what the MAC did not verify in an IPv4 frame, lwIP
+ * leaves the checksums to the MAC. The MAC bypasses the payload of the
+ * fragments, these are not verified, nor is the reassembled datagram.
+ * ICMP is always checked by lwIP.
+ */
+static bool input_checksum_valid(struct pbuf *p, uint32_t checksum) {
+  struct eth_hdr *ethhdr = (struct eth_hdr *)p->payload;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  ip_addr_t src, dest;
+  u16_t hlen, len;
+  bool valid;
+
+  if ((checksum == MAC_CHECKSUM_ALL) || (p->len < SIZEOF_ETH_HDR + IP_HLEN) ||
+      (ethhdr->type != PP_HTONS(ETHTYPE_IP)))
+    return true;
+
+  /* Malformed headers are left to ip_input().*/
+  iphdr = (struct ip_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
+  hlen = IPH_HL(iphdr) * 4;
+  len = ntohs(IPH_LEN(iphdr));
+  if ((IPH_V(iphdr) != 4) || (hlen < IP_HLEN) ||
+      (p->len < SIZEOF_ETH_HDR + hlen) || (len < hlen) ||
+      (len > p->tot_len - SIZEOF_ETH_HDR))
+    return true;
+  if ((checksum == MAC_CHECKSUM_NONE) && (inet_chksum(iphdr, hlen) != 0))
+    return false;
+  if ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) ||
+      ((IPH_PROTO(iphdr) != IP_PROTO_TCP) &&
+       (IPH_PROTO(iphdr) != IP_PROTO_UDP)))
+    return true;
+
+  ip_addr_copy(src, iphdr->src);
+  ip_addr_copy(dest, iphdr->dest);
+  pbuf_header(p, -(s16_t)(SIZEOF_ETH_HDR + hlen));
+  udphdr = (struct udp_hdr *)p->payload;
+  if ((IPH_PROTO(iphdr) == IP_PROTO_UDP) &&
+      ((len - hlen < UDP_HLEN) || (p->len < UDP_HLEN) || (udphdr->chksum == 0)))
+    valid = true;
+  else
+    valid = inet_chksum_pseudo_partial(p, &src, &dest, IPH_PROTO(iphdr),
+                                       len - hlen, len - hlen) == 0;
+  pbuf_header(p, (s16_t)(SIZEOF_ETH_HDR + hlen));
+  return valid;
+}
+#endif
+
 /*
  * Receives a frame.
  */
@@ -144,7 +202,9 @@ static struct pbuf *low_level_input(struct netif *netif) {
   u16_t len;
 
   (void)netif;
-  if (macWaitReceiveDescriptor(&ETHD1, &rd, TIME_IMMEDIATE) == MSG_OK) {
+  while (macWaitReceiveDescriptor(&ETHD1, &rd, TIME_IMMEDIATE) == MSG_OK) {
+    TM_SCOPE("eth_input");
+
     len = (u16_t)rd.size;
 
 #if ETH_PAD_SIZE
@@ -165,6 +225,15 @@ static struct pbuf *low_level_input(struct netif *netif) {
         macReadReceiveDescriptor(&rd, (uint8_t *)q->payload, (size_t)q->len);
       macReleaseReceiveDescriptor(&rd);
 
+#if LWIP_MAC_CHECKSUM_OFFLOAD
+      if (!input_checksum_valid(p, rd.checksum)) {
+        pbuf_free(p);
+        LINK_STATS_INC(link.chkerr);
+        LINK_STATS_INC(link.drop);
+        continue;
+      }
+#endif
+
 #if ETH_PAD_SIZE
       pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
 #endif
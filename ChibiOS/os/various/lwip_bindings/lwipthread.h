@@ -40,6 +40,13 @@
 #define LWIP_THREAD_STACK_SIZE              576
 #endif
 
+/**
+ * @brief   lwIP thread working area storage attributes.
+ */
+#if !defined(LWIP_THREAD_WA_SECTION) || defined(__DOXYGEN__)
+#define LWIP_THREAD_WA_SECTION
+#endif
+
 /**
  * @brief   Link poll interval.
  */
@@ -28,6 +28,7 @@
 #include "hal.h"
 #include "shell.h"
 #include "chprintf.h"
+#include "tmscope.h"
 
 /**
  * @brief   Shell termination event source.
@@ -120,6 +121,8 @@ static bool cmdexec(const ShellCommand *scp, BaseSequentialStream *chp,
 
   while (scp->sc_name != NULL) {
     if (strcmp(scp->sc_name, name) == 0) {
+      TM_SCOPE("shell_cmd");
+
       scp->sc_function(chp, argc, argv);
       return false;
     }
@@ -0,0 +1,208 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    tmscope.c
+ * @brief   Named scoped time measurements code.
+ * @details A layer over the realtime counter used by the Time Measurement
+ *          module: each named point aggregates its measurements (count,
+ *          last, best, worst, running mean and variance, log2 histogram)
+ *          and links itself into a registry on first use, so a block is
+ *          instrumented with a single @p TM_SCOPE() line. The registry is
+ *          listed and reset from the shell.
+ *
+ * @addtogroup tm_scope
+ * @{
+ */
+
+#include "ch.h"
+#include "tmscope.h"
+
+#include <string.h>
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local types.                                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   List of the points that recorded at least one measurement.
+ */
+static tm_point_t *tp_registry;
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Clears the statistics of a point.
+ *
+ * @param[out] tpp      pointer to the @p tm_point_t
+ *
+ * @notapi
+ */
+static void tp_clear(tm_point_t *tpp) {
+
+  tpp->tp_n     = (ucnt_t)0;
+  tpp->tp_last  = (rtcnt_t)0;
+  tpp->tp_best  = (rtcnt_t)-1;
+  tpp->tp_worst = (rtcnt_t)0;
+  tpp->tp_mean  = 0.0f;
+  tpp->tp_m2    = 0.0f;
+  memset(tpp->tp_hist, 0, sizeof(tpp->tp_hist));
+}
+
+/**
+ * @brief   Returns the histogram bucket of a duration.
+ *
+ * @param[in] t         the duration
+ * @return              The number of significant bits of @p t, clamped
+ *                      to the last bucket.
+ *
+ * @notapi
+ */
+static inline unsigned tp_bucket(rtcnt_t t) {
+  unsigned k;
+
+  if (t == (rtcnt_t)0)
+    return 0U;
+  k = 32U - (unsigned)__builtin_clz((uint32_t)t);
+  return k < TM_POINT_BUCKETS ? k : TM_POINT_BUCKETS - 1U;
+}
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Records a measurement.
+ * @details The Time Measurement calibration offset is subtracted from the
+ *          difference of the two time stamps.
+ *
+ * @param[in,out] tpp   pointer to the @p tm_point_t
+ * @param[in] start     realtime counter value at the start
+ * @param[in] stop      realtime counter value at the end
+ *
+ * @xclass
+ */
+void tmpRecordX(tm_point_t *tpp, rtcnt_t start, rtcnt_t stop) {
+  rtcnt_t t = stop - start;
+  syssts_t sts;
+  float delta;
+
+  t = t > ch.tm.offset ? t - ch.tm.offset : (rtcnt_t)0;
+
+  sts = chSysGetStatusAndLockX();
+  if (!tpp->tp_linked) {
+    tpp->tp_linked = true;
+    tpp->tp_link = tp_registry;
+    tp_registry = tpp;
+  }
+  tpp->tp_n++;
+  tpp->tp_last = t;
+  if (t < tpp->tp_best)
+    tpp->tp_best = t;
+  if (t > tpp->tp_worst)
+    tpp->tp_worst = t;
+  delta = (float)t - tpp->tp_mean;
+  tpp->tp_mean += delta / (float)tpp->tp_n;
+  tpp->tp_m2 += delta * ((float)t - tpp->tp_mean);
+  tpp->tp_hist[tp_bucket(t)]++;
+  chSysRestoreStatusX(sts);
+}
+
+/**
+ * @brief   Resets the statistics of a point.
+ *
+ * @param[in,out] tpp   pointer to the @p tm_point_t
+ *
+ * @api
+ */
+void tmpReset(tm_point_t *tpp) {
+
+  chSysLock();
+  tp_clear(tpp);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Resets the statistics of all the registered points.
+ *
+ * @api
+ */
+void tmpResetAll(void) {
+  tm_point_t *tpp;
+
+  for (tpp = tmpGetFirst(); tpp != NULL; tpp = tmpGetNext(tpp))
+    tmpReset(tpp);
+}
+
+/**
+ * @brief   Copies a consistent snapshot of a point.
+ *
+ * @param[in] tpp       pointer to the @p tm_point_t
+ * @param[out] dst      pointer to the copy
+ *
+ * @api
+ */
+void tmpGetSnapshot(tm_point_t *tpp, tm_point_t *dst) {
+
+  chSysLock();
+  *dst = *tpp;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Returns the first registered point.
+ *
+ * @return              The most recently registered point or @p NULL.
+ *
+ * @api
+ */
+tm_point_t *tmpGetFirst(void) {
+  tm_point_t *tpp;
+
+  chSysLock();
+  tpp = tp_registry;
+  chSysUnlock();
+  return tpp;
+}
+
+/**
+ * @brief   Returns the next registered point.
+ *
+ * @param[in] tpp       pointer to a registered @p tm_point_t
+ * @return              The next point or @p NULL.
+ *
+ * @api
+ */
+tm_point_t *tmpGetNext(tm_point_t *tpp) {
+
+  return tpp->tp_link;
+}
+
+/** @} */
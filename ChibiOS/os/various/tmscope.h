@@ -0,0 +1,186 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    tmscope.h
+ * @brief   Named scoped time measurements structures and macros.
+ *
+ * @addtogroup tm_scope
+ * @{
+ */
+
+#ifndef _TMSCOPE_H_
+#define _TMSCOPE_H_
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Number of log2 histogram buckets.
+ * @details Bucket @p k counts the durations of @p k significant bits, the
+ *          last bucket also collects the longer ones.
+ */
+#define TM_POINT_BUCKETS                    32
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Enables the measurement points.
+ * @note    When @p FALSE the @p TM_SCOPE() macros expand to nothing.
+ */
+#if !defined(TM_SCOPE_ENABLED) || defined(__DOXYGEN__)
+#define TM_SCOPE_ENABLED                    TRUE
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*
+ * Module dependencies check.
+ */
+#if !CH_CFG_USE_TM
+#error "Scoped time measurements require CH_CFG_USE_TM"
+#endif
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Type of a named measurement point.
+ * @details Durations are in realtime counter cycles, the mean and the
+ *          variance are maintained with Welford's running algorithm.
+ * @note    Points are statically allocated and linked into the registry
+ *          when they record their first measurement.
+ */
+typedef struct tm_point {
+  const char                *tp_name;   /**< @brief Point name.             */
+  struct tm_point           *tp_link;   /**< @brief Next registered point.  */
+  bool                      tp_linked;  /**< @brief In the registry.        */
+  ucnt_t                    tp_n;       /**< @brief Number of measurements. */
+  rtcnt_t                   tp_last;    /**< @brief Last measurement.       */
+  rtcnt_t                   tp_best;    /**< @brief Best measurement.       */
+  rtcnt_t                   tp_worst;   /**< @brief Worst measurement.      */
+  float                     tp_mean;    /**< @brief Running mean.           */
+  float                     tp_m2;      /**< @brief Sum of the squared
+                                                    differences from the
+                                                    mean.                   */
+  ucnt_t                    tp_hist[TM_POINT_BUCKETS];
+                                        /**< @brief Log2 histogram.         */
+} tm_point_t;
+
+/**
+ * @brief   Type of an active scope.
+ */
+typedef struct {
+  tm_point_t                *ts_point;  /**< @brief Measurement point.      */
+  rtcnt_t                   ts_start;   /**< @brief Start time stamp.       */
+} tm_scope_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Static initializer of a @p tm_point_t.
+ *
+ * @param[in] name      the point name
+ */
+#define _TM_POINT_DATA(name) {(name), NULL, false, 0, 0, (rtcnt_t)-1, 0,   \
+                              0.0f, 0.0f, {0}}
+
+/**
+ * @brief   Declares and initializes a measurement point.
+ *
+ * @param[in] var       the variable name
+ * @param[in] name      the point name
+ */
+#define TM_POINT_DECL(var, name) tm_point_t var = _TM_POINT_DATA(name)
+
+/** @cond */
+#define _TM_CONCAT2(a, b)       a##b
+#define _TM_CONCAT(a, b)        _TM_CONCAT2(a, b)
+/** @endcond */
+
+/**
+ * @brief   Measures the rest of the enclosing block.
+ * @details Declares a static point and a scope whose cleanup records the
+ *          elapsed time on every exit path, including @p return.
+ * @note    In C++ the macro is provided by @p tmscope.hpp.
+ *
+ * @param[in] name      the point name
+ */
+#if (TM_SCOPE_ENABLED && !defined(__cplusplus)) || defined(__DOXYGEN__)
+#define TM_SCOPE(name)                                                      \
+  static tm_point_t _TM_CONCAT(_tm_point_, __LINE__) = _TM_POINT_DATA(name);\
+  tm_scope_t _TM_CONCAT(_tm_scope_, __LINE__)                               \
+      __attribute__((cleanup(_tm_scope_leave))) =                           \
+      {&_TM_CONCAT(_tm_point_, __LINE__), chSysGetRealtimeCounterX()}
+#elif !defined(__cplusplus)
+#define TM_SCOPE(name)
+#endif
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void tmpRecordX(tm_point_t *tpp, rtcnt_t start, rtcnt_t stop);
+  void tmpReset(tm_point_t *tpp);
+  void tmpResetAll(void);
+  void tmpGetSnapshot(tm_point_t *tpp, tm_point_t *dst);
+  tm_point_t *tmpGetFirst(void);
+  tm_point_t *tmpGetNext(tm_point_t *tpp);
+#ifdef __cplusplus
+}
+#endif
+
+/*===========================================================================*/
+/* Module inline functions.                                                  */
+/*===========================================================================*/
+
+/**
+ * @brief   Cleanup function of the @p TM_SCOPE() variable.
+ *
+ * @param[in] tsp       pointer to the @p tm_scope_t going out of scope
+ *
+ * @notapi
+ */
+static inline void _tm_scope_leave(tm_scope_t *tsp) {
+
+  tmpRecordX(tsp->ts_point, tsp->ts_start, chSysGetRealtimeCounterX());
+}
+
+/**
+ * @brief   Returns the name of a measurement point.
+ *
+ * @param[in] tpp       pointer to a @p tm_point_t
+ * @return              The point name.
+ */
+static inline const char *tmpGetName(tm_point_t *tpp) {
+
+  return tpp->tp_name;
+}
+
+#endif /* _TMSCOPE_H_ */
+
+/** @} */
@@ -38,6 +38,7 @@
 #include "testdyn.h"
 #include "testqueues.h"
 #include "testbmk.h"
+#include "testlat.h"
 
 /*
  * Array of all the test patterns.
@@ -55,6 +56,7 @@ static ROMCONST struct testcase * ROMCONST *patterns[] = {
   patterndyn,
   patternqueues,
   patternbmk,
+  patternlat,
   NULL
 };
 
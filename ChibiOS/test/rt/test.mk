@@ -11,7 +11,8 @@ TESTSRC = ${CHIBIOS}/test/rt/test.c \
           ${CHIBIOS}/test/rt/testdyn.c \
           ${CHIBIOS}/test/rt/testqueues.c \
           ${CHIBIOS}/test/rt/testsys.c \
-          ${CHIBIOS}/test/rt/testbmk.c
+          ${CHIBIOS}/test/rt/testbmk.c \
+          ${CHIBIOS}/test/rt/testlat.c
 
 # Required include directories
 TESTINC = ${CHIBIOS}/test/rt
@@ -49,6 +49,7 @@
  * - @subpage test_benchmarks_011
  * - @subpage test_benchmarks_012
  * - @subpage test_benchmarks_013
+ * - @subpage test_benchmarks_014
  * .
  * @file testbmk.c Kernel Benchmarks
  * @brief Kernel Benchmarks source file
@@ -690,6 +691,77 @@ ROMCONST struct testcase testbmk13 = {
   bmk13_execute
 };
 
+#if CH_CFG_USE_MAILBOXES || defined(__DOXYGEN__)
+/**
+ * @page test_benchmarks_014 Mailboxes batch throughput
+ *
+ * <h2>Description</h2>
+ * A thread posts messages into a mailbox while a lower priority thread
+ * fetches them, both sides transfer the messages in batches of 1, 4 and 16
+ * messages using @p chMBPostN() and @p chMBFetchN().<br>
+ * The performance is calculated by measuring the number of messages
+ * transferred after a second of continuous operations, for each batch size.
+ */
+
+#define BMK_MB_SIZE 16
+
+static msg_t mbbuf[BMK_MB_SIZE];
+static mailbox_t mb1;
+
+static THD_FUNCTION(thread14, p) {
+  msg_t msgs[BMK_MB_SIZE];
+
+  while (!chThdShouldTerminateX()) {
+    (void)chMBFetchN(&mb1, msgs, (cnt_t)(intptr_t)p, TIME_INFINITE);
+  }
+}
+
+static uint32_t mbox_batch_test(cnt_t batch) {
+  static const msg_t msgs[BMK_MB_SIZE];
+  uint32_t n;
+
+  chMBObjectInit(&mb1, mbbuf, BMK_MB_SIZE);
+  threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX()-1,
+                                 thread14, (void *)(intptr_t)batch);
+  n = 0;
+  test_wait_tick();
+  test_start_timer(1000);
+  do {
+    n += (uint32_t)chMBPostN(&mb1, msgs, batch, TIME_INFINITE);
+#if defined(SIMULATOR)
+    _sim_check_for_interrupts();
+#endif
+  } while (!test_timer_done);
+  test_terminate_threads();
+  /* The consumer may be waiting for messages or still holding a full
+     mailbox, the reset wakes it in both cases.*/
+  chMBReset(&mb1);
+  test_wait_threads();
+
+  return n;
+}
+
+static void bmk14_execute(void) {
+
+  test_print("--- Batch1: ");
+  test_printn(mbox_batch_test(1));
+  test_println(" msgs/S");
+  test_print("--- Batch4: ");
+  test_printn(mbox_batch_test(4));
+  test_println(" msgs/S");
+  test_print("--- Batch16: ");
+  test_printn(mbox_batch_test(16));
+  test_println(" msgs/S");
+}
+
+ROMCONST struct testcase testbmk14 = {
+  "Benchmark, mailboxes batch post/fetch",
+  NULL,
+  NULL,
+  bmk14_execute
+};
+#endif
+
 /**
  * @brief   Test sequence for benchmarks.
  */
@@ -718,6 +790,9 @@ ROMCONST struct testcase * ROMCONST patternbmk[] = {
   &testbmk12,
 #endif
   &testbmk13,
+#if CH_CFG_USE_MAILBOXES || defined(__DOXYGEN__)
+  &testbmk14,
+#endif
 #endif
   NULL
 };
@@ -0,0 +1,458 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "ch.h"
+#include "hal.h"
+#include "test.h"
+
+/**
+ * @page test_latency Kernel Latency Benchmarks
+ *
+ * File: @ref testlat.c
+ *
+ * <h2>Description</h2>
+ * This module measures the distribution of some critical kernel latencies
+ * using the realtime counter. Each test case collects @p LAT_SAMPLES
+ * samples and prints the minimum, average, 99th percentile and maximum
+ * in nanoseconds, followed by the same figures as a CSV line and as a
+ * JSON line with a power of two histogram. The machine readable lines
+ * start with "--- CSV : " and "--- JSON: " and can be compared between
+ * builds using tools/latcompare.py.
+ *
+ * <h2>Objective</h2>
+ * Objective of the test module is to detect latency regressions that the
+ * throughput benchmarks averages cannot show.
+ *
+ * <h2>Preconditions</h2>
+ * None.
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_latency_001
+ * - @subpage test_latency_002
+ * - @subpage test_latency_003
+ * - @subpage test_latency_004
+ * - @subpage test_latency_005
+ * .
+ * @file testlat.c Kernel Latency Benchmarks
+ * @brief Kernel Latency Benchmarks source file
+ * @file testlat.h
+ * @brief Kernel Latency Benchmarks header file
+ */
+
+/**
+ * @brief   Samples collected by each test case.
+ */
+#define LAT_SAMPLES             256
+
+/**
+ * @brief   Histogram buckets, bucket 0 counts the samples below 256ns and
+ *          each next bucket doubles the limit, the last one is open.
+ */
+#define LAT_BUCKETS             16
+
+/**
+ * @brief   Period of the timer jitter test.
+ */
+#define LAT_PERIOD              MS2ST(1)
+
+/**
+ * @brief   Realtime counter frequency.
+ * @note    The STM32 ports use the DWT cycle counter clocked by HCLK, the
+ *          simulator counts microseconds.
+ */
+#if !defined(TEST_RT_COUNTER_HZ) || defined(__DOXYGEN__)
+#if defined(STM32_HCLK)
+#define TEST_RT_COUNTER_HZ      STM32_HCLK
+#else
+#define TEST_RT_COUNTER_HZ      1000000U
+#endif
+#endif
+
+static uint32_t lat_buf[LAT_SAMPLES];
+static unsigned lat_n;
+static volatile rtcnt_t lat_stamp;
+static virtual_timer_t lat_vt;
+static thread_reference_t lat_tr;
+
+static void lat_reset(void) {
+
+  lat_n = 0;
+}
+
+static void lat_add(rtcnt_t delta) {
+
+  if (lat_n < LAT_SAMPLES)
+    lat_buf[lat_n++] = (uint32_t)delta;
+}
+
+/*
+ * Converts the samples to nanoseconds, sorts them and prints the
+ * statistics in the human readable, CSV and JSON forms.
+ */
+static void lat_report(const char *name) {
+  uint32_t hist[LAT_BUCKETS];
+  uint64_t sum = 0;
+  uint32_t ns, lim;
+  unsigned i, j;
+
+  for (i = 0; i < LAT_BUCKETS; i++)
+    hist[i] = 0;
+  for (i = 0; i < lat_n; i++) {
+    ns = (uint32_t)(((uint64_t)lat_buf[i] * 1000000000ULL) /
+                    TEST_RT_COUNTER_HZ);
+    sum += ns;
+    for (j = 0, lim = 256; (j < LAT_BUCKETS - 1) && (ns >= lim); j++)
+      lim <<= 1;
+    hist[j]++;
+
+    /* Insertion sort, the samples before i are already sorted.*/
+    for (j = i; (j > 0) && (lat_buf[j - 1] > ns); j--)
+      lat_buf[j] = lat_buf[j - 1];
+    lat_buf[j] = ns;
+  }
+  if (lat_n == 0)
+    return;
+
+  test_print("--- Min/Avg/P99/Max: ");
+  test_printn(lat_buf[0]);
+  test_print("/");
+  test_printn((uint32_t)(sum / lat_n));
+  test_print("/");
+  test_printn(lat_buf[(lat_n * 99 + 99) / 100 - 1]);
+  test_print("/");
+  test_printn(lat_buf[lat_n - 1]);
+  test_println(" nS");
+
+  test_print("--- CSV : latency,");
+  test_print(name);
+  test_print(",");
+  test_printn(lat_n);
+  test_print(",");
+  test_printn(lat_buf[0]);
+  test_print(",");
+  test_printn((uint32_t)(sum / lat_n));
+  test_print(",");
+  test_printn(lat_buf[(lat_n * 99 + 99) / 100 - 1]);
+  test_print(",");
+  test_printn(lat_buf[lat_n - 1]);
+  test_println("");
+
+  test_print("--- JSON: {\"bench\":\"");
+  test_print(name);
+  test_print("\",\"arch\":\"");
+  test_print(PORT_ARCHITECTURE_NAME);
+#ifdef BOARD_NAME
+  test_print("\",\"board\":\"");
+  test_print(BOARD_NAME);
+#endif
+  test_print("\",\"unit\":\"ns\",\"n\":");
+  test_printn(lat_n);
+  test_print(",\"min\":");
+  test_printn(lat_buf[0]);
+  test_print(",\"avg\":");
+  test_printn((uint32_t)(sum / lat_n));
+  test_print(",\"p99\":");
+  test_printn(lat_buf[(lat_n * 99 + 99) / 100 - 1]);
+  test_print(",\"max\":");
+  test_printn(lat_buf[lat_n - 1]);
+  test_print(",\"hist\":[");
+  for (i = 0; i < LAT_BUCKETS; i++) {
+    if (i > 0)
+      test_print(",");
+    test_printn(hist[i]);
+  }
+  test_println("]}");
+}
+
+/**
+ * @page test_latency_001 Interrupt to thread wakeup
+ *
+ * <h2>Description</h2>
+ * A one shot virtual timer callback, executed in the system timer
+ * interrupt, takes a timestamp and resumes the suspended test thread, the
+ * time until the thread runs again is measured.
+ */
+
+static void lat1_cb(void *p) {
+
+  (void)p;
+  chSysLockFromISR();
+  lat_stamp = chSysGetRealtimeCounterX();
+  chThdResumeI(&lat_tr, MSG_OK);
+  chSysUnlockFromISR();
+}
+
+static void lat1_execute(void) {
+  rtcnt_t now;
+  unsigned i;
+
+  lat_reset();
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    chSysLock();
+    chVTSetI(&lat_vt, (systime_t)1, lat1_cb, NULL);
+    chThdSuspendS(&lat_tr);
+    now = chSysGetRealtimeCounterX();
+    chSysUnlock();
+    lat_add(now - lat_stamp);
+  }
+  test_assert(1, lat_n == LAT_SAMPLES, "missing samples");
+  lat_report("irq_wakeup");
+}
+
+ROMCONST struct testcase testlat1 = {
+  "Latency, interrupt to thread wakeup",
+  NULL,
+  NULL,
+  lat1_execute
+};
+
+#if CH_CFG_USE_SEMAPHORES || defined(__DOXYGEN__)
+/**
+ * @page test_latency_002 Semaphore handoff
+ *
+ * <h2>Description</h2>
+ * A thread with higher priority waits on a semaphore, the test thread
+ * takes a timestamp and signals the semaphore, the time until the waiting
+ * thread runs is measured.
+ */
+
+static semaphore_t lat_sem1;
+
+static THD_FUNCTION(lat2_thread, p) {
+
+  (void)p;
+  while (chSemWait(&lat_sem1) == MSG_OK)
+    lat_add(chSysGetRealtimeCounterX() - lat_stamp);
+}
+
+static void lat2_setup(void) {
+
+  chSemObjectInit(&lat_sem1, 0);
+}
+
+static void lat2_execute(void) {
+  unsigned i;
+
+  lat_reset();
+  threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX()+1,
+                                 lat2_thread, NULL);
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    lat_stamp = chSysGetRealtimeCounterX();
+    chSemSignal(&lat_sem1);
+  }
+  chSemReset(&lat_sem1, 0);
+  test_wait_threads();
+  test_assert(1, lat_n == LAT_SAMPLES, "missing samples");
+  lat_report("sem_handoff");
+}
+
+ROMCONST struct testcase testlat2 = {
+  "Latency, semaphore handoff",
+  lat2_setup,
+  NULL,
+  lat2_execute
+};
+#endif /* CH_CFG_USE_SEMAPHORES */
+
+#if (CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
+/**
+ * @page test_latency_003 Mutex priority inheritance
+ *
+ * <h2>Description</h2>
+ * A lower priority thread owns a mutex and is ready but not running when
+ * the test thread tries to lock it. The owner inherits the test thread
+ * priority, runs and releases the mutex, the time from the lock request
+ * to the ownership is measured. The priority seen by the owner while
+ * releasing is checked.
+ */
+
+static mutex_t lat_mtx1;
+static semaphore_t lat_sem2;
+static tprio_t lat_prio;
+
+static THD_FUNCTION(lat3_thread, p) {
+
+  (void)p;
+  while (true) {
+    chSemWait(&lat_sem1);
+    if (chThdShouldTerminateX())
+      break;
+    chMtxLock(&lat_mtx1);
+    chSemSignal(&lat_sem2);
+    lat_prio = chThdGetPriorityX();
+    chMtxUnlock(&lat_mtx1);
+  }
+}
+
+static void lat3_setup(void) {
+
+  chMtxObjectInit(&lat_mtx1);
+  chSemObjectInit(&lat_sem1, 0);
+  chSemObjectInit(&lat_sem2, 0);
+}
+
+static void lat3_execute(void) {
+  tprio_t prio = chThdGetPriorityX();
+  rtcnt_t start;
+  unsigned i;
+
+  lat_reset();
+  threads[0] = chThdCreateStatic(wa[0], WA_SIZE, prio-1,
+                                 lat3_thread, NULL);
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    /* The owner locks the mutex and is preempted while signaling.*/
+    chSemSignal(&lat_sem1);
+    chSemWait(&lat_sem2);
+    start = chSysGetRealtimeCounterX();
+    chMtxLock(&lat_mtx1);
+    lat_add(chSysGetRealtimeCounterX() - start);
+    chMtxUnlock(&lat_mtx1);
+    if (lat_prio != prio)
+      break;
+  }
+  /* The owner is not waiting yet, it is preempted while unlocking.*/
+  test_terminate_threads();
+  chSemSignal(&lat_sem1);
+  test_wait_threads();
+  test_assert(1, lat_prio == prio, "priority not inherited");
+  test_assert(2, lat_n == LAT_SAMPLES, "missing samples");
+  lat_report("mtx_inherit");
+}
+
+ROMCONST struct testcase testlat3 = {
+  "Latency, mutex priority inheritance",
+  lat3_setup,
+  NULL,
+  lat3_execute
+};
+#endif /* CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES */
+
+/**
+ * @page test_latency_004 Virtual timer jitter
+ *
+ * <h2>Description</h2>
+ * A virtual timer re-arms itself from its callback with a fixed period,
+ * the absolute deviation of the measured interval between two callbacks
+ * from the nominal period is measured.
+ */
+
+static void lat4_cb(void *p) {
+  rtcnt_t now = chSysGetRealtimeCounterX();
+  rtcnt_t period = (rtcnt_t)(((uint64_t)LAT_PERIOD * TEST_RT_COUNTER_HZ) /
+                             CH_CFG_ST_FREQUENCY);
+  rtcnt_t delta;
+
+  chSysLockFromISR();
+  if (p != NULL) {
+    delta = now - lat_stamp;
+    lat_add(delta > period ? delta - period : period - delta);
+  }
+  lat_stamp = now;
+  if (lat_n < LAT_SAMPLES)
+    chVTSetI(&lat_vt, LAT_PERIOD, lat4_cb, &lat_vt);
+  else
+    chThdResumeI(&lat_tr, MSG_OK);
+  chSysUnlockFromISR();
+}
+
+static void lat4_execute(void) {
+
+  lat_reset();
+  test_wait_tick();
+  chSysLock();
+  chVTSetI(&lat_vt, LAT_PERIOD, lat4_cb, NULL);
+  chThdSuspendS(&lat_tr);
+  chSysUnlock();
+  test_assert(1, lat_n == LAT_SAMPLES, "missing samples");
+  lat_report("vt_jitter");
+}
+
+ROMCONST struct testcase testlat4 = {
+  "Latency, virtual timer jitter",
+  NULL,
+  NULL,
+  lat4_execute
+};
+
+/**
+ * @page test_latency_005 Context switch round trip
+ *
+ * <h2>Description</h2>
+ * A thread with higher priority is awakened and goes back to sleep, the
+ * round trip of two context switches is measured with the kernel locked.
+ * The interrupts are served outside of the measurement, the spread comes
+ * from the memory wait states, compare builds with and without the hot
+ * paths in RAM (CORTEX_USE_RAMTEXT).
+ */
+
+static THD_FUNCTION(lat5_thread, p) {
+  thread_t *self = chThdGetSelfX();
+
+  (void)p;
+  chSysLock();
+  do {
+    chSchGoSleepS(CH_STATE_SUSPENDED);
+  } while (self->p_u.rdymsg == MSG_OK);
+  chSysUnlock();
+}
+
+static void lat5_execute(void) {
+  thread_t *tp;
+  rtcnt_t start;
+  unsigned i;
+
+  lat_reset();
+  tp = threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX()+1,
+                                      lat5_thread, NULL);
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    chSysLock();
+    start = chSysGetRealtimeCounterX();
+    chSchWakeupS(tp, MSG_OK);
+    lat_add(chSysGetRealtimeCounterX() - start);
+    chSysUnlock();
+  }
+  chSysLock();
+  chSchWakeupS(tp, MSG_TIMEOUT);
+  chSysUnlock();
+  test_wait_threads();
+  test_assert(1, lat_n == LAT_SAMPLES, "missing samples");
+  lat_report("ctx_switch");
+}
+
+ROMCONST struct testcase testlat5 = {
+  "Latency, context switch round trip",
+  NULL,
+  NULL,
+  lat5_execute
+};
+
+/**
+ * @brief   Test sequence for latency benchmarks.
+ */
+ROMCONST struct testcase * ROMCONST patternlat[] = {
+#if !TEST_NO_BENCHMARKS
+  &testlat1,
+#if CH_CFG_USE_SEMAPHORES || defined(__DOXYGEN__)
+  &testlat2,
+#endif
+#if (CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
+  &testlat3,
+#endif
+  &testlat4,
+  &testlat5,
+#endif
+  NULL
+};
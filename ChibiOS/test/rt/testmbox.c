@@ -40,6 +40,7 @@
  *
  * <h2>Test Cases</h2>
  * - @subpage test_mbox_001
+ * - @subpage test_mbox_002
  * .
  * @file testmbox.c
  * @brief Mailboxes test source file
@@ -226,6 +227,102 @@ ROMCONST struct testcase testmbox1 = {
   mbox1_execute
 };
 
+/**
+ * @page test_mbox_002 Batch posting and fetching
+ *
+ * <h2>Description</h2>
+ * Messages are posted/fetched from a mailbox in batches, partial batches
+ * are tested against a nearly full or nearly empty mailbox and the
+ * circularity of the buffer is verified across batch boundaries.<br>
+ * The test expects to find a consistent mailbox status after each operation.
+ */
+
+static void mbox2_setup(void) {
+
+  chMBObjectInit(&mb1, (msg_t *)test.wa.T0, MB_SIZE);
+}
+
+static void mbox2_execute(void) {
+  static const msg_t out[MB_SIZE + 2] = {'A', 'B', 'C', 'D', 'E', 'F', 'G'};
+  msg_t in[MB_SIZE + 2];
+  cnt_t n;
+  unsigned i;
+
+  /*
+   * Testing a partial batch, only the free slots are filled.
+   */
+  n = chMBPostN(&mb1, out, 3, TIME_INFINITE);
+  test_assert(1, n == 3, "wrong posted count");
+  n = chMBPostN(&mb1, &out[3], 4, TIME_INFINITE);
+  test_assert(2, n == MB_SIZE - 3, "wrong posted count");
+  test_assert_lock(3, chMBGetFreeCountI(&mb1) == 0, "still empty");
+  test_assert_lock(4, chMBGetUsedCountI(&mb1) == MB_SIZE, "not full");
+
+  /*
+   * Testing batch post timeout.
+   */
+  n = chMBPostN(&mb1, out, 2, 1);
+  test_assert(5, n == 0, "posted into a full mailbox");
+  chSysLock();
+  n = chMBPostNI(&mb1, out, 2);
+  chSysUnlock();
+  test_assert(6, n == 0, "posted into a full mailbox");
+
+  /*
+   * Testing batch fetch across the buffer boundary.
+   */
+  n = chMBFetchN(&mb1, in, 2, TIME_INFINITE);
+  test_assert(7, n == 2, "wrong fetched count");
+  n = chMBPostN(&mb1, &out[5], 2, TIME_INFINITE);
+  test_assert(8, n == 2, "wrong posted count");
+  n = chMBFetchN(&mb1, &in[2], MB_SIZE + 2, TIME_INFINITE);
+  test_assert(9, n == MB_SIZE, "wrong fetched count");
+  for (i = 0; i < MB_SIZE + 2; i++) {
+    test_emit_token(in[i]);
+  }
+  test_assert_sequence(10, "ABCDEFG");
+
+  /*
+   * Testing batch fetch timeout.
+   */
+  n = chMBFetchN(&mb1, in, 2, 1);
+  test_assert(11, n == 0, "fetched from an empty mailbox");
+  chSysLock();
+  n = chMBFetchNI(&mb1, in, 2);
+  chSysUnlock();
+  test_assert(12, n == 0, "fetched from an empty mailbox");
+
+  /*
+   * Testing I-Class.
+   */
+  chSysLock();
+  n = chMBPostNI(&mb1, out, MB_SIZE + 2);
+  chSysUnlock();
+  test_assert(13, n == MB_SIZE, "wrong posted count");
+  chSysLock();
+  n = chMBFetchNI(&mb1, in, MB_SIZE + 2);
+  chSysUnlock();
+  test_assert(14, n == MB_SIZE, "wrong fetched count");
+  for (i = 0; i < MB_SIZE; i++) {
+    test_emit_token(in[i]);
+  }
+  test_assert_sequence(15, "ABCDE");
+
+  /*
+   * Testing final conditions.
+   */
+  test_assert_lock(16, chMBGetFreeCountI(&mb1) == MB_SIZE, "not empty");
+  test_assert_lock(17, chMBGetUsedCountI(&mb1) == 0, "still full");
+  test_assert_lock(18, mb1.mb_rdptr == mb1.mb_wrptr, "pointers not aligned");
+}
+
+ROMCONST struct testcase testmbox2 = {
+  "Mailboxes, batch post and fetch",
+  mbox2_setup,
+  NULL,
+  mbox2_execute
+};
+
 #endif /* CH_CFG_USE_MAILBOXES */
 
 /**
@@ -234,6 +331,7 @@ ROMCONST struct testcase testmbox1 = {
 ROMCONST struct testcase * ROMCONST patternmbox[] = {
 #if CH_CFG_USE_MAILBOXES || defined(__DOXYGEN__)
   &testmbox1,
+  &testmbox2,
 #endif
   NULL
 };
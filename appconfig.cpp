@@ -0,0 +1,22 @@
+#include "appconfig.h"
+
+/*
+ * Loaded from APPCONFIG_FILE when the card is mounted and by "config
+ * load", see globalconfig.h. The network defaults are those of
+ * lwipthread.h. The telemetry rate is in kB/s, 0 for no limit, and the
+ * period in ms, see telemetry.h.
+ */
+const cfgdef_t appconfig[] = {
+    {"network", "address", CFG_IP, "192.168.0.10", false},
+    {"network", "netmask", CFG_IP, "255.255.255.0", false},
+    {"network", "gateway", CFG_IP, "192.168.0.1", false},
+    {"network", "dhcp", CFG_BOOL, "no", false},
+    {"web", "port", CFG_INT, "80", false},
+    {"telemetry", "enable", CFG_BOOL, "no", false},
+    {"telemetry", "dest", CFG_STR, "192.168.0.2:5005", false},
+    {"telemetry", "rate", CFG_INT, "0", false},
+    {"telemetry", "period", CFG_INT, "10", false},
+    {"system", "hostname", CFG_STR, "stm32f4", false},
+};
+
+const size_t appconfig_count = sizeof(appconfig) / sizeof(appconfig[0]);
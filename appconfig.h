@@ -0,0 +1,16 @@
+#ifndef __APPCONFIG_H__
+#define __APPCONFIG_H__
+
+/**
+ * Configuration keys of the application, shared with the host tool
+ * tools/cfgsnap.cpp so that both build the same image.
+ **/
+
+#include "globalconfig.h"
+
+#define APPCONFIG_FILE  "/config.ini"
+
+extern const cfgdef_t appconfig[];
+extern const size_t appconfig_count;
+
+#endif
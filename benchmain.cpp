@@ -0,0 +1,65 @@
+/*
+    ChibiOS - Copyright (C) 2006..2015 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host benchmark runner, the simulator build of the "bench" shell
+ * command: the cases selected on the command line are run once and the
+ * process exits, with status 1 when a case had to be skipped.
+ */
+
+#include "ch.hpp"
+#include "hal.h"
+
+#include "deftimer.h"
+#include "fs.h"
+#include "appbench.h"
+
+#include <stdlib.h>
+
+using namespace chibios_rt;
+
+#if !defined(SIMULATOR)
+#error "benchmain.cpp is only built by Makefile.sim"
+#endif
+
+int main(int argc, char *argv[]) {
+  BaseSequentialStream *chp = (BaseSequentialStream *)&BOARD_SHELL_SD;
+  int skipped;
+
+  halInit();
+  System::init();
+  dtInit();
+
+  sdStart(&BOARD_SHELL_SD, NULL);
+
+  /*
+   * The card is mounted directly, there is no insertion monitor.
+   */
+  sdcStart(&SDCD1, NULL);
+  InsertHandler(0);
+
+  skipped = benchRunAll(chp, appbench_cases, argc - 1, argv + 1);
+
+  /*
+   * Waits for the serial driver to flush its output queue.
+   */
+  while (!oqIsEmptyI(&BOARD_SHELL_SD.oqueue))
+    chThdSleepMilliseconds(10);
+  chThdSleepMilliseconds(10);
+
+  exit(skipped ? 1 : 0);
+  return 0;
+}
@@ -27,6 +27,11 @@
 #define BOARD_EMBEST_DMSTF4BB
 #define BOARD_NAME                  "STMicroelectronics STM32F4-Discovery with Embest add-on"
 
+/*
+ * Serial port used by the shell, USART6 on PC6(TX) and PC7(RX).
+ */
+#define BOARD_SHELL_SD              SD6
+
 /*
  * Board oscillators-related settings.
  * NOTE: LSE not fitted.
@@ -0,0 +1,5 @@
+# List of all the board related files.
+BOARDSRC = ${BOARD}/SIMULATOR/board.c
+
+# Required include directories
+BOARDINC = ${BOARD}/SIMULATOR
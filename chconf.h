@@ -91,8 +91,14 @@
  * @note    In order to let the OS manage the whole RAM the linker script must
  *          provide the @p __heap_base__ and @p __heap_end__ symbols.
  * @note    Requires @p CH_CFG_USE_MEMCORE.
+ * @note    The host simulator has no such symbols, a static area of about
+ *          the size of the target heap is used instead.
  */
+#if defined(SIMULATOR)
+#define CH_CFG_MEMCORE_SIZE                 0x20000
+#else
 #define CH_CFG_MEMCORE_SIZE                 0
+#endif
 
 /**
  * @brief   Idle thread automatic spawn suppression.
@@ -384,7 +390,7 @@
  *
  * @note    The default is @p FALSE.
  */
-#define CH_DBG_FILL_THREADS                 FALSE
+#define CH_DBG_FILL_THREADS                 TRUE
 
 /**
  * @brief   Debug option, threads profiling.
@@ -411,7 +417,9 @@
  * @details User fields added to the end of the @p thread_t structure.
  */
 #define CH_CFG_THREAD_EXTRA_FIELDS                                          \
-  /* Add threads custom fields here.*/
+  /* Add threads custom fields here.*/                                      \
+  CPULOAD_THREAD_FIELDS                                                     \
+  STACKWM_THREAD_FIELDS
 
 /**
  * @brief   Threads initialization hook.
@@ -422,6 +430,8 @@
  */
 #define CH_CFG_THREAD_INIT_HOOK(tp) {                                       \
   /* Add threads initialization code here.*/                                \
+  CPULOAD_THREAD_INIT(tp);                                                  \
+  STACKWM_THREAD_INIT(tp);                                                  \
 }
 
 /**
@@ -442,6 +452,56 @@
  */
 #define CH_CFG_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   /* Context switch code here.*/                                            \
+  CPULOAD_SWITCH(ntp, otp);                                                 \
+  EVTRACE_SWITCH_HOOK(ntp, otp);                                            \
+  STACKWM_SWITCH(ntp, otp);                                                 \
+}
+
+/**
+ * @brief   ISR enter hook.
+ * @details This hook is invoked in the IRQ prologue, after the port
+ *          specific code.
+ */
+#define CH_CFG_IRQ_PROLOGUE_HOOK() {                                        \
+  CPULOAD_IRQ_ENTER();                                                      \
+  EVTRACE_IRQ_ENTER_HOOK();                                                 \
+}
+
+/**
+ * @brief   ISR exit hook.
+ * @details This hook is invoked in the IRQ epilogue, before the port
+ *          specific code.
+ */
+#define CH_CFG_IRQ_EPILOGUE_HOOK() {                                        \
+  EVTRACE_IRQ_LEAVE_HOOK();                                                 \
+  CPULOAD_IRQ_LEAVE();                                                      \
+}
+
+/**
+ * @brief   Kernel objects trace hook.
+ * @details This hook is invoked with the kernel locked by the semaphores,
+ *          mutexes, mailboxes and virtual timers code.
+ */
+#define CH_CFG_TRACE_OBJECT_HOOK(ev, objp, arg) {                           \
+  EVTRACE_OBJECT_HOOK(ev, objp, arg);                                       \
+}
+
+/**
+ * @brief   Memory allocation hook.
+ * @details This hook is invoked by the heap and memory pools thread API
+ *          after a successful allocation, the kernel may be locked.
+ */
+#define CH_CFG_TRACE_ALLOC_HOOK(src, p, size) {                             \
+  ALLOCPROF_ALLOC_HOOK(src, p, size);                                       \
+}
+
+/**
+ * @brief   Memory release hook.
+ * @details This hook is invoked by the heap and memory pools thread API
+ *          before a block is released.
+ */
+#define CH_CFG_TRACE_FREE_HOOK(src, p) {                                    \
+  ALLOCPROF_FREE_HOOK(src, p);                                              \
 }
 
 /**
@@ -494,6 +554,15 @@
 /* Port-specific settings (override port settings defaulted in chcore.h).    */
 /*===========================================================================*/
 
+/*===========================================================================*/
+/* Application hooks implementation.                                         */
+/*===========================================================================*/
+
+#include "cpuload.h"
+#include "evtrace.h"
+#include "allocprof.h"
+#include "stackwm.h"
+
 #endif  /* _CHCONF_H_ */
 
 /** @} */
@@ -36,7 +36,7 @@
 /   3: f_lseek() function is removed in addition to 2. */
 
 
-#define _USE_STRFUNC    0   /* 0:Disable or 1-2:Enable */
+#define _USE_STRFUNC    1   /* 0:Disable or 1-2:Enable */
 /* To enable string functions, set _USE_STRFUNC to 1 or 2. */
 
 
@@ -191,7 +191,7 @@
 /  with file lock control. This feature uses bss _FS_LOCK * 12 bytes. */
 
 
-#define _FS_REENTRANT   0               /* 0:Disable or 1:Enable */
+#define _FS_REENTRANT   1               /* 0:Disable or 1:Enable */
 #define _FS_TIMEOUT     MS2ST(1000)     /* Timeout period in unit of time tick */
 #define _SYNC_t         semaphore_t*    /* O/S dependent sync object type. e.g. HANDLE, OS_EVENT*, ID, SemaphoreHandle_t and etc.. */
 /* The _FS_REENTRANT option switches the re-entrancy (thread safe) of the FatFs module.
@@ -227,4 +227,10 @@
 */
 
 
+/* Disk I/O accounting, see utils/metrics.h. */
+#include "metrics.h"
+#define FATFS_DISKIO_HOOK(wr, count, cycles, res) \
+    METRICS_DISKIO_HOOK(wr, count, cycles, res)
+
+
 #endif /* _FFCONF */
@@ -38,6 +38,10 @@
 #ifndef __LWIPOPT_H__
 #define __LWIPOPT_H__
 
+#include "ccm.h"
+#include "chksum.h"
+#include "mcuconf.h"
+
 
 /*
    -----------------------------------------------
@@ -121,9 +125,11 @@
 /**
  * MEM_SIZE: the size of the heap memory. If the application will send
  * a lot of data that needs to be copied, this should be set high.
+ * The frames sent to the WebSocket clients are copied here, up to a send
+ * buffer each (WS_MAX_CLIENTS in web/websocket.h).
  */
 #ifndef MEM_SIZE
-#define MEM_SIZE                        1600
+#define MEM_SIZE                        (1600 + 3 * TCP_SND_BUF)
 #endif
 
 /**
@@ -135,6 +141,15 @@
 #define MEMP_SEPARATE_POOLS             0
 #endif
 
+/**
+ * MEM_SECTION: storage attributes of the heap and of the pools memory.
+ * The MAC driver copies the frames to and from its own buffers so
+ * neither is touched by DMA, both go to the core coupled memory.
+ */
+#ifndef MEM_SECTION
+#define MEM_SECTION                     CCM_BSS
+#endif
+
 /**
  * MEMP_OVERFLOW_CHECK: memp overflow protection reserves a configurable
  * amount of bytes before and after each memp element in every pool and fills
@@ -242,7 +257,7 @@
  * (requires the LWIP_TCP option)
  */
 #ifndef MEMP_NUM_TCP_PCB
-#define MEMP_NUM_TCP_PCB                5
+#define MEMP_NUM_TCP_PCB                8
 #endif
 
 /**
@@ -258,7 +273,7 @@
  * (requires the LWIP_TCP option)
  */
 #ifndef MEMP_NUM_TCP_SEG
-#define MEMP_NUM_TCP_SEG                16
+#define MEMP_NUM_TCP_SEG                32
 #endif
 
 /**
@@ -321,9 +336,11 @@
 /**
  * MEMP_NUM_NETCONN: the number of struct netconns.
  * (only needed if you use the sequential API, like api_lib.c)
+ * The HTTP server listens on one, serves a request on another and keeps
+ * one per WebSocket client.
  */
 #ifndef MEMP_NUM_NETCONN
-#define MEMP_NUM_NETCONN                4
+#define MEMP_NUM_NETCONN                6
 #endif
 
 /**
@@ -1244,6 +1261,19 @@
 #define TCPIP_THREAD_STACKSIZE          1024
 #endif
 
+/**
+ * LWIP_THREAD_WA_SECTION, LWIP_THREAD_ALLOC: placement of the working
+ * area of the MAC thread and allocator of the working areas of the
+ * threads created by sys_thread_new(), both in the core coupled memory.
+ */
+#ifndef LWIP_THREAD_WA_SECTION
+#define LWIP_THREAD_WA_SECTION          CCM_NOINIT
+#endif
+
+#ifndef LWIP_THREAD_ALLOC
+#define LWIP_THREAD_ALLOC(size)         ccmAlloc(size)
+#endif
+
 /**
  * TCPIP_THREAD_PRIO: The priority assigned to the main tcpip thread.
  * The priority value itself is platform-dependent, but is passed to
@@ -1506,6 +1536,14 @@
 
 #if LWIP_STATS
 
+/**
+ * LWIP_STATS_LARGE==1: Use 32 bits counters, they are exported as metrics
+ * (utils/sysmetrics.cpp) and the 16 bits ones wrap too quickly.
+ */
+#ifndef LWIP_STATS_LARGE
+#define LWIP_STATS_LARGE                1
+#endif
+
 /**
  * LWIP_STATS_DISPLAY==1: Compile in the statistics output functions.
  */
@@ -1778,53 +1816,74 @@
    ---------- Checksum options ----------
    --------------------------------------
 */
+/**
+ * LWIP_MAC_CHECKSUM_OFFLOAD: checksum offload mode of the MAC, from
+ * mcuconf.h. From mode 1 the MAC inserts the IP header checksum and
+ * verifies all the received checksums, dropping the bad frames, in mode 3
+ * it also inserts the TCP, UDP and ICMP checksums. Received frames the
+ * MAC did not verify are checked in software by low_level_input() of
+ * lwipthread.c. Mode 2 leaves the pseudo header sum to the stack, which
+ * lwIP cannot do.
+ */
+#ifndef LWIP_MAC_CHECKSUM_OFFLOAD
+#if defined(SIMULATOR)
+#define LWIP_MAC_CHECKSUM_OFFLOAD       POSIX_MAC_IP_CHECKSUM_OFFLOAD
+#else
+#define LWIP_MAC_CHECKSUM_OFFLOAD       STM32_MAC_IP_CHECKSUM_OFFLOAD
+#endif
+#endif
+
+#if LWIP_MAC_CHECKSUM_OFFLOAD == 2
+#error "checksum offload mode 2 is not supported by lwIP, use 1 or 3"
+#endif
+
 /**
  * CHECKSUM_GEN_IP==1: Generate checksums in software for outgoing IP packets.
  */
 #ifndef CHECKSUM_GEN_IP
-#define CHECKSUM_GEN_IP                 1
+#define CHECKSUM_GEN_IP                 (LWIP_MAC_CHECKSUM_OFFLOAD == 0)
 #endif
  
 /**
  * CHECKSUM_GEN_UDP==1: Generate checksums in software for outgoing UDP packets.
  */
 #ifndef CHECKSUM_GEN_UDP
-#define CHECKSUM_GEN_UDP                1
+#define CHECKSUM_GEN_UDP                (LWIP_MAC_CHECKSUM_OFFLOAD != 3)
 #endif
  
 /**
  * CHECKSUM_GEN_TCP==1: Generate checksums in software for outgoing TCP packets.
  */
 #ifndef CHECKSUM_GEN_TCP
-#define CHECKSUM_GEN_TCP                1
+#define CHECKSUM_GEN_TCP                (LWIP_MAC_CHECKSUM_OFFLOAD != 3)
 #endif
 
 /**
  * CHECKSUM_GEN_ICMP==1: Generate checksums in software for outgoing ICMP packets.
  */
 #ifndef CHECKSUM_GEN_ICMP
-#define CHECKSUM_GEN_ICMP               1
+#define CHECKSUM_GEN_ICMP               (LWIP_MAC_CHECKSUM_OFFLOAD != 3)
 #endif
  
 /**
  * CHECKSUM_CHECK_IP==1: Check checksums in software for incoming IP packets.
  */
 #ifndef CHECKSUM_CHECK_IP
-#define CHECKSUM_CHECK_IP               1
+#define CHECKSUM_CHECK_IP               (LWIP_MAC_CHECKSUM_OFFLOAD == 0)
 #endif
  
 /**
  * CHECKSUM_CHECK_UDP==1: Check checksums in software for incoming UDP packets.
  */
 #ifndef CHECKSUM_CHECK_UDP
-#define CHECKSUM_CHECK_UDP              1
+#define CHECKSUM_CHECK_UDP              (LWIP_MAC_CHECKSUM_OFFLOAD == 0)
 #endif
 
 /**
  * CHECKSUM_CHECK_TCP==1: Check checksums in software for incoming TCP packets.
  */
 #ifndef CHECKSUM_CHECK_TCP
-#define CHECKSUM_CHECK_TCP              1
+#define CHECKSUM_CHECK_TCP              (LWIP_MAC_CHECKSUM_OFFLOAD == 0)
 #endif
 
 /**
@@ -1832,7 +1891,20 @@
  * application buffers to pbufs.
  */
 #ifndef LWIP_CHECKSUM_ON_COPY
-#define LWIP_CHECKSUM_ON_COPY           0
+#define LWIP_CHECKSUM_ON_COPY           CHECKSUM_GEN_TCP
+#endif
+
+/**
+ * LWIP_CHKSUM: Internet checksum of a buffer, and LWIP_CHKSUM_COPY the
+ * same fused with the copy, see utils/chksum.h.
+ */
+#ifndef LWIP_CHKSUM
+#define LWIP_CHKSUM(dataptr, len)       chksumData(dataptr, len)
+#endif
+
+#ifndef LWIP_CHKSUM_COPY
+#define LWIP_CHKSUM_COPY(dst, src, len) chksumCopy(dst, src, len)
+#define LWIP_CHKSUM_COPY_ALGORITHM      0
 #endif
 
 /*
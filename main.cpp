@@ -25,6 +25,14 @@
 #include "lwipthread.h"
 #include "web/web.h"
 
+#include "deftimer.h"
+#include "metrics.h"
+#include "allocprof.h"
+#include "stackwm.h"
+#include "ccm.h"
+#include "appconfig.h"
+#include "telemetry.h"
+
 #include "ff.h"
 #include "fs.h"
 #include "i2c.h"
@@ -36,13 +44,16 @@ using namespace chibios_rt;
 /*===========================================================================*/
 /* Configuration Parameters                                                  */
 /*===========================================================================*/
+#if !defined(SIMULATOR)
 static const SerialConfig serialcfg = {
     115200, // baud rate
     0,
     0,
     0,
 };
+#endif
 
+#if HAL_USE_I2C
 /* I2C interface #2 */
 static const I2CConfig i2c1cfg = {
     OPMODE_I2C,
@@ -58,7 +69,7 @@ static const I2CConfig i2c1cfg = {
 #endif
 
 #define I2C_CNT_ADDR 0x20
-static THD_WORKING_AREA(wa_sevensegment, SEVENSEGMENT_THREAD_STACK_SIZE);
+static CCM_THD_WORKING_AREA(wa_sevensegment, SEVENSEGMENT_THREAD_STACK_SIZE);
 
 static uint8_t rxbuf[2];
 static uint8_t txbuf[2];
@@ -91,6 +102,31 @@ static THD_FUNCTION(sevensegment, p)
         chThdSleepMilliseconds(100);
     }
 }
+#endif /* HAL_USE_I2C */
+
+
+/*===========================================================================*/
+/* Card Events                                                               */
+/*===========================================================================*/
+
+/*
+ * Card insertion, mounts the file system and loads the configuration,
+ * from its snapshot when the INI file did not change. The problems are
+ * listed by "config load".
+ */
+static void CardInsertHandler(eventid_t id) {
+    int err;
+
+    InsertHandler(id);
+    if (!fs_ready)
+        return;
+    err = parseconfig(APPCONFIG_FILE, NULL, NULL);
+    if (err > 0)
+        chprintf((BaseSequentialStream *) &BOARD_SHELL_SD,
+                 "%s: %d error(s), using the defaults\r\n", APPCONFIG_FILE, err);
+    else if (err == 0)
+        telemConfigure();
+}
 
 
 /*===========================================================================*/
@@ -100,7 +136,7 @@ int main(void) {
 
     static thread_t *shelltp = NULL;
     static const evhandler_t evhndl[] = {
-        InsertHandler,
+        CardInsertHandler,
         RemoveHandler
     };
     event_listener_t el0, el1;
@@ -115,24 +151,64 @@ int main(void) {
   halInit();
   System::init();
 
+  /**
+   * Starts recording the heap, pool and malloc allocations, see the
+   * "alloc" command and /alloc.bin.
+   */
+  allocprofInit();
+
+  /**
+   * Arms the MPU stack guards when STACKWM_MPU_GUARD is set, the stack
+   * usage is reported by the "stacks" command.
+   */
+  stackwmInit();
+
+  /**
+   * Starts the deferred timers service thread, timer callbacks flagged
+   * as deferred are executed there instead of the system tick ISR.
+   */
+  dtInit();
+
+  /**
+   * Registers the built-in metrics, see the "stats" command and /metrics.
+   */
+  sysmetricsInit();
+
+  /**
+   * Installs the configuration keys with their default values.
+   */
+  configInit(appconfig, appconfig_count);
+
   /**
    * Initialize LwIP Subsystem.
    */
   lwipInit(NULL); // Use static ip, modify IP address in lwpthread.h
 
+  /**
+   * Starts the UDP telemetry sender, streaming when telemetry.enable is
+   * set, see the "telem" command.
+   */
+  telemInit();
+
   /**
    * Activates the serial driver 2 using the driver default configuration.
    * PA2(TX) and PA3(RX) are routed to USART2.
    **/
+#if !defined(SIMULATOR)
   palSetPadMode(GPIOC, 6, PAL_MODE_ALTERNATE(8));
   palSetPadMode(GPIOC, 7, PAL_MODE_ALTERNATE(8));
-  sdStart(&SD6, &serialcfg);
+  sdStart(&BOARD_SHELL_SD, &serialcfg);
+#else
+  sdStart(&BOARD_SHELL_SD, NULL);
+#endif
 
+#if HAL_USE_I2C
   /**
    * Initialize I2C1
    **/
-  chprintf((BaseSequentialStream *) &SD6, "Initializing I2C...\r\n");
+  chprintf((BaseSequentialStream *) &BOARD_SHELL_SD, "Initializing I2C...\r\n");
   i2cStart(&I2CD1, &i2c1cfg);
+#endif
 
   /**
    * Shell manager initialization.
@@ -142,7 +218,7 @@ int main(void) {
   /*
    * Start the SDC/MMC Card Driver
    */
-  chprintf((BaseSequentialStream *) &SD6, "Initializing Shell...\r\n");
+  chprintf((BaseSequentialStream *) &BOARD_SHELL_SD, "Initializing Shell...\r\n");
   sdcStart(&SDCD1, NULL);
 
   /*
@@ -153,16 +229,18 @@ int main(void) {
   /*
    * Creates the HTTP thread (it changes priority internally).
    */
-  chprintf((BaseSequentialStream *) &SD6, "Starting web server...\r\n");
+  chprintf((BaseSequentialStream *) &BOARD_SHELL_SD, "Starting web server...\r\n");
   chThdCreateStatic(wa_http_server, sizeof(wa_http_server), NORMALPRIO + 1,
           http_server, NULL);
 
+#if HAL_USE_I2C
   /*
    * Creates the blinker thread.
    */
-  chprintf((BaseSequentialStream *) &SD6, "Starting counter thread...\r\n");
+  chprintf((BaseSequentialStream *) &BOARD_SHELL_SD, "Starting counter thread...\r\n");
   chThdCreateStatic(wa_sevensegment, sizeof(wa_sevensegment), NORMALPRIO + 1,
 		  sevensegment, NULL);
+#endif
   /*
    * Normal main() thread activity, in this demo it does nothing except
    * sleeping in a loop and listen for events.
@@ -130,7 +130,7 @@
 #define STM32_GPT_USE_TIM4                  FALSE
 #define STM32_GPT_USE_TIM5                  FALSE
 #define STM32_GPT_USE_TIM6                  FALSE
-#define STM32_GPT_USE_TIM7                  FALSE
+#define STM32_GPT_USE_TIM7                  TRUE
 #define STM32_GPT_USE_TIM8                  FALSE
 #define STM32_GPT_USE_TIM9                  FALSE
 #define STM32_GPT_USE_TIM11                 FALSE
@@ -142,7 +142,7 @@
 #define STM32_GPT_TIM4_IRQ_PRIORITY         7
 #define STM32_GPT_TIM5_IRQ_PRIORITY         7
 #define STM32_GPT_TIM6_IRQ_PRIORITY         7
-#define STM32_GPT_TIM7_IRQ_PRIORITY         7
+#define STM32_GPT_TIM7_IRQ_PRIORITY         2
 #define STM32_GPT_TIM8_IRQ_PRIORITY         7
 #define STM32_GPT_TIM9_IRQ_PRIORITY         7
 #define STM32_GPT_TIM11_IRQ_PRIORITY        7
@@ -212,7 +212,16 @@
 #define STM32_MAC_PHY_TIMEOUT               100
 #define STM32_MAC_ETH1_CHANGE_PHY_STATE     TRUE
 #define STM32_MAC_ETH1_IRQ_PRIORITY         13
-#define STM32_MAC_IP_CHECKSUM_OFFLOAD       0
+#define STM32_MAC_IP_CHECKSUM_OFFLOAD       3
+
+/*
+ * Simulated MAC settings, the offload is emulated with SIM_MAC_OFFLOAD=3
+ * on the make command line (see Makefile.sim), lwIP computes the
+ * checksums otherwise.
+ */
+#if !defined(POSIX_MAC_IP_CHECKSUM_OFFLOAD)
+#define POSIX_MAC_IP_CHECKSUM_OFFLOAD       0
+#endif
 
 /*
  * PWM driver system settings.
@@ -0,0 +1,478 @@
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "nullstreams.h"
+#include "ff.h"
+
+#include "appbench.h"
+#include "dictionary.h"
+#include "globalconfig.h"
+#include "iniutils.h"
+#include "direntx.h"
+#include "chksum.h"
+#include "shellutils.h"
+#include "fs.h"
+#include "ccm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_KEYS       64
+#define INI_SECTIONS    8
+#define INI_KEYS        8
+#define TREE_DIRS       4
+#define TREE_FILES      8
+#define LIST_FILES      128
+#define LIST_NAME       APPBENCH_DIR "/list/long file name %03u.txt"
+#define COPY_WORDS      256
+
+static NullStream ns;
+static char keys[DICT_KEYS][12];
+static char misses[DICT_KEYS][12];
+static uint8_t dumpbuf[256];
+static char path[64];
+static uint32_t ini_size;
+static uint32_t ini_pairs;
+static uint32_t ram_src[COPY_WORDS], ram_dst[COPY_WORDS];
+static CCM_BSS uint32_t ccm_src[COPY_WORDS], ccm_dst[COPY_WORDS];
+
+/*===========================================================================*/
+/* Dictionary.                                                               */
+/*===========================================================================*/
+
+static int dict_setup(void)
+{
+    unsigned i;
+
+    for (i = 0; i < DICT_KEYS; i++) {
+        chsnprintf(keys[i], sizeof(keys[i]), "bench.k%02u", i);
+        chsnprintf(misses[i], sizeof(misses[i]), "bench.x%02u", i);
+        if (dict_install(keys[i], "value") == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+/* Every install replaces the definition of an existing key. */
+static uint64_t dict_install_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        (void)dict_install(keys[i % DICT_KEYS], "value");
+    return n;
+}
+
+static uint64_t dict_hit_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        (void)dict_lookup(keys[i % DICT_KEYS]);
+    return n;
+}
+
+static uint64_t dict_miss_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        (void)dict_lookup(misses[i % DICT_KEYS]);
+    return n;
+}
+
+/*===========================================================================*/
+/* Typed configuration.                                                      */
+/*===========================================================================*/
+
+/* Needs the "web.port" key of the application table. */
+static int config_setup(void)
+{
+    return getconfig("web", "port") != NULL ? 0 : -1;
+}
+
+static uint64_t config_int_run(uint32_t n)
+{
+    uint32_t i;
+    volatile int32_t v;
+
+    for (i = 0; i < n; i++)
+        v = configInt(CONFIG_KEY("web", "port"));
+    (void)v;
+    return n;
+}
+
+static uint64_t config_text_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        (void)getconfig("web", "port");
+    return n;
+}
+
+/*===========================================================================*/
+/* Formatting into the null stream.                                          */
+/*===========================================================================*/
+
+static int null_setup(void)
+{
+    unsigned i;
+
+    nullObjectInit(&ns);
+    for (i = 0; i < sizeof(dumpbuf); i++)
+        dumpbuf[i] = (uint8_t)i;
+    return 0;
+}
+
+static uint64_t printf_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        chprintf((BaseSequentialStream *)&ns, "%s=%d 0x%08x %5u %c\r\n",
+                "key", -12345, 0xdeadbeefU, 42U, 'x');
+    return n;
+}
+
+static uint64_t hexdump_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        hexdump((BaseSequentialStream *)&ns, dumpbuf, sizeof(dumpbuf));
+    return (uint64_t)n * sizeof(dumpbuf);
+}
+
+/*===========================================================================*/
+/* Synthetic volume.                                                         */
+/*===========================================================================*/
+
+static int write_file(const char *name, const char *text, uint32_t *size)
+{
+    UINT written;
+    FIL f;
+
+    if (f_open(&f, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return -1;
+    if ((f_write(&f, text, strlen(text), &written) != FR_OK) ||
+        (written != strlen(text))) {
+        f_close(&f);
+        return -1;
+    }
+    if (size != NULL)
+        *size += written;
+    return f_close(&f) == FR_OK ? 0 : -1;
+}
+
+static void remove_tree(void)
+{
+    unsigned d, f;
+
+    for (d = 0; d < TREE_DIRS; d++) {
+        for (f = 0; f < TREE_FILES; f++) {
+            chsnprintf(path, sizeof(path), APPBENCH_DIR "/d%u/f%u.txt", d, f);
+            f_unlink(path);
+        }
+        chsnprintf(path, sizeof(path), APPBENCH_DIR "/d%u", d);
+        f_unlink(path);
+    }
+    for (f = 0; f < LIST_FILES; f++) {
+        chsnprintf(path, sizeof(path), LIST_NAME, f);
+        f_unlink(path);
+    }
+    f_unlink(APPBENCH_DIR "/list");
+    f_unlink(APPBENCH_DIR "/bench.ini");
+    f_unlink(APPBENCH_DIR);
+}
+
+static int ini_setup(void)
+{
+    char line[48];
+    unsigned s, k;
+
+    if (!fs_ready)
+        return -1;
+    remove_tree();
+    if (f_mkdir(APPBENCH_DIR) != FR_OK)
+        return -1;
+
+    /* Written line by line, a section is made of a comment, a header,
+       the pairs and a blank line. */
+    ini_size = 0;
+    if (write_file(APPBENCH_DIR "/bench.ini", "; benchmark input\r\n",
+                   &ini_size) != 0)
+        return -1;
+    for (s = 0; s < INI_SECTIONS; s++) {
+        FIL f;
+        UINT written;
+
+        if (f_open(&f, APPBENCH_DIR "/bench.ini", FA_WRITE | FA_OPEN_EXISTING)
+            != FR_OK)
+            return -1;
+        f_lseek(&f, f_size(&f));
+        chsnprintf(line, sizeof(line), "[section%u]\r\n", s);
+        f_write(&f, line, strlen(line), &written);
+        ini_size += written;
+        for (k = 0; k < INI_KEYS; k++) {
+            chsnprintf(line, sizeof(line), "name%u = value %u of section %u\r\n",
+                       k, k, s);
+            f_write(&f, line, strlen(line), &written);
+            ini_size += written;
+        }
+        f_write(&f, "\r\n", 2, &written);
+        ini_size += written;
+        f_close(&f);
+    }
+    return 0;
+}
+
+static int count_pair(void *usrcfg, const char *section, const char *name,
+                      const char *value)
+{
+    (void)usrcfg;
+    (void)section;
+    (void)name;
+    (void)value;
+    ini_pairs++;
+    return 1;
+}
+
+static uint64_t ini_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        parse_ini(APPBENCH_DIR "/bench.ini", count_pair, NULL);
+    return (uint64_t)n * ini_size;
+}
+
+static int tree_setup(void)
+{
+    unsigned d, f;
+
+    if (!fs_ready)
+        return -1;
+    remove_tree();
+    if (f_mkdir(APPBENCH_DIR) != FR_OK)
+        return -1;
+    for (d = 0; d < TREE_DIRS; d++) {
+        chsnprintf(path, sizeof(path), APPBENCH_DIR "/d%u", d);
+        if (f_mkdir(path) != FR_OK)
+            return -1;
+        for (f = 0; f < TREE_FILES; f++) {
+            chsnprintf(path, sizeof(path), APPBENCH_DIR "/d%u/f%u.txt", d, f);
+            if (write_file(path, "x", NULL) != 0)
+                return -1;
+        }
+    }
+    nullObjectInit(&ns);
+    return 0;
+}
+
+/* scan_files() appends to the path and restores it on return. */
+static uint64_t tree_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        strcpy(path, APPBENCH_DIR);
+        scan_files((BaseSequentialStream *)&ns, path);
+    }
+    return (uint64_t)n * TREE_DIRS * (TREE_FILES + 1);
+}
+
+/*===========================================================================*/
+/* Listing of a large directory.                                             */
+/*===========================================================================*/
+
+/* The original direntx readdir(), kept as the reference: a malloc'ed
+   DIR, a static FILINFO without a long name buffer and a strncpy() of
+   _MAX_LFN bytes per entry. Its closedir() leaked the DIR, it is
+   freed here. */
+namespace old {
+
+    typedef struct _dirent {
+        int d_ino;
+        int d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[_MAX_LFN];
+    } dirent;
+
+    static FILINFO fnop;
+
+    static DIR *opendir(const char *path)
+    {
+        DIR *tmpdir = (DIR *)malloc(sizeof(DIR));
+
+        if (tmpdir) {
+            if (f_opendir(tmpdir, path) == FR_OK)
+                return tmpdir;
+            free(tmpdir);
+        }
+        return NULL;
+    }
+
+    static dirent *readdir(DIR *dirp)
+    {
+        static dirent dire;
+
+        if ((f_readdir(dirp, &fnop) == FR_OK) && fnop.fname[0] != 0) {
+            dire.d_type = fnop.fattrib;
+            strncpy(dire.d_name, fnop.fname, _MAX_LFN);
+            return &dire;
+        }
+        return NULL;
+    }
+
+    static int closedir(DIR *dirp)
+    {
+        f_closedir(dirp);
+        free(dirp);
+        return 0;
+    }
+}
+
+static uint32_t list_entries;
+static uint32_t list_sum;
+
+static int list_setup(void)
+{
+    unsigned f;
+
+    if (!fs_ready)
+        return -1;
+    remove_tree();
+    if ((f_mkdir(APPBENCH_DIR) != FR_OK) ||
+        (f_mkdir(APPBENCH_DIR "/list") != FR_OK))
+        return -1;
+    for (f = 0; f < LIST_FILES; f++) {
+        chsnprintf(path, sizeof(path), LIST_NAME, f);
+        if (write_file(path, "x", NULL) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static uint64_t readdir_run(uint32_t n)
+{
+    old::dirent *ep;
+    DIR *dirp;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        if ((dirp = old::opendir(APPBENCH_DIR "/list")) == NULL)
+            break;
+        while ((ep = old::readdir(dirp)) != NULL) {
+            list_entries++;
+            list_sum += (uint8_t)ep->d_name[0];
+        }
+        old::closedir(dirp);
+    }
+    return (uint64_t)n * LIST_FILES;
+}
+
+static uint64_t batch_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        DirReader dir(APPBENCH_DIR "/list");
+
+        for (const dirxent_t &e : dir) {
+            list_entries++;
+            list_sum += (uint8_t)e.name[0];
+        }
+    }
+    return (uint64_t)n * LIST_FILES;
+}
+
+/*===========================================================================*/
+/* Memory copies, ram0 against CCM.                                          */
+/*===========================================================================*/
+
+/* The ram0 copy contends with the Ethernet and SDIO DMA, run both cases
+   during network or card traffic to see the difference. The barrier
+   publishes the destination so the copies are not optimized out. */
+#define COPY_BARRIER(p) __asm__ volatile ("" : : "r" (p) : "memory")
+
+static uint64_t copy_ram_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        memcpy(ram_dst, ram_src, sizeof(ram_dst));
+        COPY_BARRIER(ram_dst);
+    }
+    return (uint64_t)n * sizeof(ram_dst);
+}
+
+static uint64_t copy_ccm_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        memcpy(ccm_dst, ccm_src, sizeof(ccm_dst));
+        COPY_BARRIER(ccm_dst);
+    }
+    return (uint64_t)n * sizeof(ccm_dst);
+}
+
+/*===========================================================================*/
+/* Internet checksum, the lwIP kernels.                                      */
+/*===========================================================================*/
+
+static volatile uint16_t chksum_sink;
+
+/* Two bytes off a word as an IP payload after the Ethernet header. */
+static uint64_t chksum_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        chksum_sink = chksumData((uint8_t *)ram_src + 2, sizeof(ram_src) - 4);
+    return (uint64_t)n * (sizeof(ram_src) - 4);
+}
+
+static uint64_t chksum_copy_run(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        chksum_sink = chksumCopy((uint8_t *)ram_dst + 2, (uint8_t *)ram_src + 2,
+                                 sizeof(ram_src) - 4);
+    return (uint64_t)n * (sizeof(ram_src) - 4);
+}
+
+/*===========================================================================*/
+/* Cases and shell command.                                                  */
+/*===========================================================================*/
+
+const bench_case_t appbench_cases[] = {
+    {"dict_install", "op", dict_setup, dict_install_run, NULL},
+    {"dict_hit", "op", dict_setup, dict_hit_run, NULL},
+    {"dict_miss", "op", dict_setup, dict_miss_run, NULL},
+    {"config_int", "op", config_setup, config_int_run, NULL},
+    {"config_text", "op", config_setup, config_text_run, NULL},
+    {"printf_null", "op", null_setup, printf_run, NULL},
+    {"hexdump_null", "B", null_setup, hexdump_run, NULL},
+    {"ini_parse", "B", ini_setup, ini_run, remove_tree},
+    {"dir_walk", "entry", tree_setup, tree_run, remove_tree},
+    {"dir_readdir", "entry", list_setup, readdir_run, remove_tree},
+    {"dir_batch", "entry", list_setup, batch_run, remove_tree},
+    {"copy_ram0", "B", NULL, copy_ram_run, NULL},
+    {"copy_ccm", "B", NULL, copy_ccm_run, NULL},
+    {"chksum", "B", NULL, chksum_run, NULL},
+    {"chksum_copy", "B", NULL, chksum_copy_run, NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+void cmd_bench(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    if ((argc == 1) && !strcmp(argv[0], "-h")) {
+        chprintf(chp, "Usage: bench [list|name...]\r\n");
+        return;
+    }
+    benchRunAll(chp, appbench_cases, argc, argv);
+}
@@ -0,0 +1,32 @@
+#ifndef __APPBENCH_H__
+#define __APPBENCH_H__
+
+/**
+ * Benchmarks of the application components: dictionary, INI parser,
+ * chprintf/hexdump formatting, directory walks and listings, memory
+ * copies and checksums, see utils/bench.h.
+ **/
+
+#include "bench.h"
+
+/**
+ * Directory holding the synthetic INI file and directory tree, created
+ * by the file system cases and removed afterwards.
+ **/
+#if !defined(APPBENCH_DIR)
+#define APPBENCH_DIR            "/bench.tmp"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const bench_case_t appbench_cases[];
+
+void cmd_bench(BaseSequentialStream *chp, int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,20 +19,23 @@
 #include "shell.h"
 
 #include "usb_cdc.h"
+#include "deftimer.h"
 #include "fs.h"
+#include "ccm.h"
 
 #include "ff.h"
+#include "direntx.h"
 
 /**
- * @brief FS object.
+ * @brief FS object, the window is bounced by the SDC driver.
  */
-FATFS SDC_FS;
+CCM_BSS FATFS SDC_FS;
 
 /* FS mounted and ready.*/
 bool fs_ready = FALSE;
 
 /* Generic large buffer.*/
-static uint8_t fbuff[1024];
+static CCM_BSS uint8_t fbuff[1024];
 
 /*===========================================================================*/
 /* Card insertion monitor.                                                   */
@@ -44,7 +47,7 @@ static uint8_t fbuff[1024];
 /**
  * @brief   Card monitor timer.
  */
-static virtual_timer_t tmr;
+static deferred_timer_t tmr;
 
 /**
  * @brief   Debounce counter.
@@ -99,6 +102,8 @@ void RemoveHandler(eventid_t id)
 
 /**
  * @brief   Insertion monitor timer callback function.
+ * @note    This is a deferred timer callback, it runs in the deferred
+ *          timers service thread and not in the system tick ISR.
  *
  * @param[in] p         pointer to the @p BaseBlockDevice object
  *
@@ -107,11 +112,10 @@ void RemoveHandler(eventid_t id)
 static void tmrfunc(void *p) {
   BaseBlockDevice *bbdp = (BaseBlockDevice *) p;
 
-  chSysLockFromISR();
   if (cnt > 0) {
     if (blkIsInserted(bbdp)) {
       if (--cnt == 0) {
-        chEvtBroadcastI(&inserted_event);
+        chEvtBroadcast(&inserted_event);
       }
     }
     else
@@ -120,15 +124,15 @@ static void tmrfunc(void *p) {
   else {
     if (!blkIsInserted(bbdp)) {
       cnt = POLLING_INTERVAL;
-      chEvtBroadcastI(&removed_event);
+      chEvtBroadcast(&removed_event);
     }
   }
-  chVTSetI(&tmr, MS2ST(POLLING_DELAY), tmrfunc, bbdp);
-  chSysUnlockFromISR();
 }
 
 /**
  * @brief   Polling monitor start.
+ * @pre     The deferred timers service must have been started with
+ *          @p dtInit().
  *
  * @param[in] p         pointer to an object implementing @p BaseBlockDevice
  *
@@ -139,10 +143,9 @@ void tmr_init(void *p)
 
   chEvtObjectInit(&inserted_event);
   chEvtObjectInit(&removed_event);
-  chSysLock();
   cnt = POLLING_INTERVAL;
-  chVTSetI(&tmr, MS2ST(POLLING_DELAY), tmrfunc, p);
-  chSysUnlock();
+  dtObjectInit(&tmr, "sdcpoll");
+  dtSetPeriodic(&tmr, MS2ST(POLLING_DELAY), tmrfunc, p);
 }
 
 
@@ -272,6 +275,42 @@ void cmd_tree(BaseSequentialStream *chp, int argc, char *argv[]) {
 }
 
 
+/*
+ * List one directory with the long names, sizes and dates.
+ */
+void cmd_dir(BaseSequentialStream *chp, int argc, char *argv[]) {
+    unsigned long files = 0, bytes = 0;
+
+    if (argc > 1) {
+        chprintf(chp, "Usage: dir [path]\r\n");
+        return;
+    }
+    if (!fs_ready) {
+        chprintf(chp, "File System not mounted\r\n");
+        return;
+    }
+    DirReader dir(argc > 0 ? argv[0] : "/");
+    for (const dirxent_t &e : dir) {
+        chprintf(chp, "%4d-%02d-%02d %02d:%02d ", ((e.date >> 9) & 0x7F) + 1980,
+                 (e.date >> 5) & 0x0F, e.date & 0x1F, e.time >> 11,
+                 (e.time >> 5) & 0x3F);
+        if (e.attrib & AM_DIR) {
+            chprintf(chp, "<DIR>      %s/\r\n", e.name);
+        } else {
+            chprintf(chp, "%10lu %s\r\n", (unsigned long)e.size, e.name);
+            files++;
+            bytes += e.size;
+        }
+    }
+    if (dir.result() != FR_OK) {
+        chprintf(chp, "FS: dir(%s) failed\r\n", argc > 0 ? argv[0] : "/");
+        verbose_error(chp, dir.result());
+        return;
+    }
+    chprintf(chp, "%lu file(s), %lu bytes\r\n", files, bytes);
+}
+
+
 void cmd_free(BaseSequentialStream *chp, int argc, char *argv[]) {
     FRESULT err;
     uint32_t clusters;
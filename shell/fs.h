@@ -30,6 +30,7 @@ void tmr_init(void *p);
 FRESULT scan_files(BaseSequentialStream *chp, char *path);
 void cmd_free(BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_tree(BaseSequentialStream *chp, int argc, char *argv[]);
+void cmd_dir(BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_setlabel(BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_getlabel(BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_hello(BaseSequentialStream *chp, int argc, char *argv[]);
@@ -4,6 +4,18 @@
 #include "test.h"
 #include "chprintf.h"
 #include "shell.h"
+#include "deftimer.h"
+#include "tmscope.h"
+#include "cpuload.h"
+#include "evtrace.h"
+#include "pcprof.h"
+#include "allocprof.h"
+#include "stackwm.h"
+#include "ccm.h"
+#include "appbench.h"
+#include "metrics.h"
+#include "globalconfig.h"
+#include "telemetry.h"
 
 #include "ff.h"
 
@@ -14,6 +26,16 @@
 #include <string.h>
 #include <stdlib.h>
 
+/* Saved stack pointer of a thread that is not running. */
+#if defined(SIMULATOR)
+#define THD_SAVED_SP(tp)    ((tp)->p_ctx.esp)
+#else
+#define THD_SAVED_SP(tp)    ((tp)->p_ctx.r13)
+#endif
+
+/* Pointers printed with %lx, truncated to 32 bits on 64 bit hosts. */
+#define PTR_ARG(p)          ((unsigned long)(uint32_t)(uintptr_t)(p))
+
 
 /*===========================================================================*/
 /* Command line related.                                                     */
@@ -30,6 +52,37 @@ static void cmd_mem(BaseSequentialStream *chp, int argc, char *argv[]) {
     chprintf(chp, "core free memory : %u bytes\r\n", chCoreGetStatusX());
     chprintf(chp, "heap fragments   : %u\r\n", n);
     chprintf(chp, "heap free total  : %u bytes\r\n", size);
+#if CCM_ENABLED
+    chprintf(chp, "ccm free memory  : %u bytes\r\n", ccmGetStatusX());
+#endif
+}
+
+static void cmd_stacks(BaseSequentialStream *chp, int argc, char *argv[]) {
+    static stackwm_info_t info[24];
+    size_t i, n;
+    unsigned long reclaim = 0;
+
+    (void)argv;
+    if (argc > 0) {
+        chprintf(chp, "Usage: stacks\r\n");
+        return;
+    }
+    n = stackwmScan(info, sizeof(info) / sizeof(info[0]));
+    if (n > sizeof(info) / sizeof(info[0]))
+        n = sizeof(info) / sizeof(info[0]);
+    chprintf(chp, "name             stack   used   free use%% suggest reclaim\r\n");
+    for (i = 0; i < n; i++) {
+        chprintf(chp, "%-14s %7lu %6lu %6lu %3lu%% %7lu %7lu\r\n",
+                info[i].name, (unsigned long)info[i].size,
+                (unsigned long)info[i].used,
+                (unsigned long)(info[i].size - info[i].used),
+                info[i].size ? (unsigned long)info[i].used * 100UL / info[i].size : 0UL,
+                (unsigned long)info[i].suggest,
+                (unsigned long)info[i].reclaim);
+        reclaim += info[i].reclaim;
+    }
+    chprintf(chp, "%lu bytes reclaimable, suggest = peak + %u bytes margin\r\n",
+            reclaim, (unsigned)STACKWM_MARGIN);
 }
 
 static void cmd_threads(BaseSequentialStream *chp, int argc, char *argv[]) {
@@ -57,13 +110,668 @@ static void cmd_threads(BaseSequentialStream *chp, int argc, char *argv[]) {
 #if (CH_CFG_USE_REGISTRY == TRUE)
                 (const char *) tp->p_name,
 #endif
-                (uint32_t)tp, (uint32_t)tp->p_ctx.r13,
-                (uint32_t)tp->p_prio, (uint32_t)(tp->p_refs - 1),
+                PTR_ARG(tp), PTR_ARG(THD_SAVED_SP(tp)),
+                (unsigned long)tp->p_prio, (unsigned long)(tp->p_refs - 1),
                 states[tp->p_state]);
         tp = chRegNextThread(tp);
     } while (tp != NULL);
 }
 
+static void cmd_dtimers(BaseSequentialStream *chp, int argc, char *argv[]) {
+    deferred_timer_t *dtp;
+
+    if ((argc > 1) || ((argc == 1) && strcmp(argv[0], "reset"))) {
+        chprintf(chp, "Usage: dtimers [reset]\r\n");
+        return;
+    }
+    if (argc == 1) {
+        for (dtp = dtGetFirst(); dtp != NULL; dtp = dtGetNext(dtp))
+            dtResetStats(dtp);
+        return;
+    }
+    /* Times are in realtime counter cycles. */
+    chprintf(chp, "    name       runs     best    worst     last  latency overruns\r\n");
+    for (dtp = dtGetFirst(); dtp != NULL; dtp = dtGetNext(dtp)) {
+        chprintf(chp, "%10s %8lu %8lu %8lu %8lu %8lu %8lu\r\n",
+                dtGetName(dtp),
+                (uint32_t)dtp->dt_tm.n,
+                (uint32_t)(dtp->dt_tm.n ? dtp->dt_tm.best : 0),
+                (uint32_t)dtp->dt_tm.worst, (uint32_t)dtp->dt_tm.last,
+                (uint32_t)dtp->dt_latency, (uint32_t)dtp->dt_overruns);
+    }
+}
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t r = 0, b = 1ULL << 62;
+
+    while (b > v)
+        b >>= 2;
+    while (b != 0) {
+        if (v >= r + b) {
+            v -= r + b;
+            r = (r >> 1) + b;
+        }
+        else
+            r >>= 1;
+        b >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+static tm_point_t *tm_find(const char *name) {
+    tm_point_t *tpp;
+
+    for (tpp = tmpGetFirst(); tpp != NULL; tpp = tmpGetNext(tpp))
+        if (!strcmp(tmpGetName(tpp), name))
+            return tpp;
+    return NULL;
+}
+
+static void tm_hist(BaseSequentialStream *chp, tm_point_t *tpp) {
+    tm_point_t tp;
+    unsigned k;
+
+    tmpGetSnapshot(tpp, &tp);
+    chprintf(chp, "  cycles <       count\r\n");
+    for (k = 0; k < TM_POINT_BUCKETS; k++) {
+        if (tp.tp_hist[k] == 0)
+            continue;
+        if (k < TM_POINT_BUCKETS - 1)
+            chprintf(chp, "%10lu %10lu\r\n", 1UL << k,
+                    (unsigned long)tp.tp_hist[k]);
+        else
+            chprintf(chp, "       inf %10lu\r\n",
+                    (unsigned long)tp.tp_hist[k]);
+    }
+}
+
+static void cmd_tm(BaseSequentialStream *chp, int argc, char *argv[]) {
+    tm_point_t *tpp, tp;
+    uint32_t sdev;
+
+    if ((argc == 1) && !strcmp(argv[0], "reset")) {
+        tmpResetAll();
+        return;
+    }
+    if ((argc == 2) && (!strcmp(argv[0], "reset") ||
+                        !strcmp(argv[0], "hist"))) {
+        if ((tpp = tm_find(argv[1])) == NULL) {
+            chprintf(chp, "%s: no such point\r\n", argv[1]);
+            return;
+        }
+        if (argv[0][0] == 'r')
+            tmpReset(tpp);
+        else
+            tm_hist(chp, tpp);
+        return;
+    }
+    if (argc > 0) {
+        chprintf(chp, "Usage: tm [reset [name]|hist name]\r\n");
+        return;
+    }
+    /* Times are in realtime counter cycles. */
+    chprintf(chp, "        name        n     last     best    worst     mean     sdev\r\n");
+    for (tpp = tmpGetFirst(); tpp != NULL; tpp = tmpGetNext(tpp)) {
+        tmpGetSnapshot(tpp, &tp);
+        sdev = tp.tp_n > 1 ? isqrt64((uint64_t)(tp.tp_m2 / (tp.tp_n - 1))) : 0;
+        chprintf(chp, "%12s %8lu %8lu %8lu %8lu %8lu %8lu\r\n",
+                tp.tp_name, (unsigned long)tp.tp_n,
+                (unsigned long)tp.tp_last,
+                (unsigned long)(tp.tp_n ? tp.tp_best : 0),
+                (unsigned long)tp.tp_worst, (unsigned long)tp.tp_mean,
+                (unsigned long)sdev);
+    }
+}
+
+#define TOP_MAX_THREADS 16
+
+static uint32_t top_permille(uint64_t part, uint64_t whole) {
+    return whole ? (uint32_t)((part * 1000) / whole) : 0;
+}
+
+/*
+ * Prints the raw cumulative counters as CSV rows, one per thread plus
+ * one for the IRQ bucket, for analysis on the host.
+ */
+static void top_csv(BaseSequentialStream *chp, const cpuload_totals_t *tot,
+                    const cpuload_sample_t *s, size_t n) {
+    char elapsed[21], cycles[21];
+    size_t i;
+
+    u64toa(tot->elapsed, elapsed);
+    for (i = 0; i < n; i++)
+        chprintf(chp, "%s,%s,%lu,%s,%lu,%lu\r\n",
+                elapsed, s[i].name ? s[i].name : "-", s[i].prio,
+                u64toa(s[i].cnt.cycles, cycles),
+                s[i].cnt.switches, s[i].cnt.preempted);
+    chprintf(chp, "%s,irq,0,%s,%lu,0\r\n",
+            elapsed, u64toa(tot->irq_cycles, cycles), tot->irq_count);
+}
+
+static void cmd_top(BaseSequentialStream *chp, int argc, char *argv[]) {
+    static cpuload_sample_t prev[TOP_MAX_THREADS], cur[TOP_MAX_THREADS];
+    cpuload_totals_t ptot, ctot;
+    size_t np, nc, i, j;
+    uint32_t interval = 1000, count = 1;
+    uint64_t window, cycles;
+    uint32_t pm, switches, preempted;
+    bool csv = false;
+
+    if ((argc > 0) && !strcmp(argv[0], "csv")) {
+        csv = true;
+        argc--;
+        argv++;
+    }
+    if (argc > 2) {
+        chprintf(chp, "Usage: top [csv] [interval_ms] [count]\r\n");
+        return;
+    }
+    if (argc > 0)
+        interval = atoi(argv[0]);
+    if (argc > 1)
+        count = atoi(argv[1]);
+    if (interval == 0)
+        interval = 1000;
+
+    if (csv)
+        chprintf(chp, "elapsed,name,prio,cycles,switches,preempted\r\n");
+    np = cpuloadSnapshot(&ptot, prev, TOP_MAX_THREADS);
+    while (count-- > 0) {
+        chThdSleepMilliseconds(interval);
+        nc = cpuloadSnapshot(&ctot, cur, TOP_MAX_THREADS);
+        if (csv) {
+            top_csv(chp, &ctot, cur, nc);
+        }
+        else {
+            window = ctot.elapsed - ptot.elapsed;
+            pm = top_permille(ctot.irq_cycles - ptot.irq_cycles, window);
+            chprintf(chp, "window %lu ms, %lu ctxsw/s, %lu irq/s, irq %lu.%lu%%\r\n",
+                    interval,
+                    (ctot.switches - ptot.switches) * 1000 / interval,
+                    (ctot.irq_count - ptot.irq_count) * 1000 / interval,
+                    pm / 10, pm % 10);
+            chprintf(chp, "      name prio   cpu%%   sw/s preempt\r\n");
+            for (i = 0; i < nc; i++) {
+                /* Threads created during the window start from zero. */
+                cycles = cur[i].cnt.cycles;
+                switches = cur[i].cnt.switches;
+                preempted = cur[i].cnt.preempted;
+                for (j = 0; j < np; j++) {
+                    if (prev[j].tp == cur[i].tp) {
+                        cycles -= prev[j].cnt.cycles;
+                        switches -= prev[j].cnt.switches;
+                        preempted -= prev[j].cnt.preempted;
+                        break;
+                    }
+                }
+                pm = top_permille(cycles, window);
+                chprintf(chp, "%10s %4lu %3lu.%lu%% %6lu %7lu\r\n",
+                        cur[i].name ? cur[i].name : "-", cur[i].prio,
+                        pm / 10, pm % 10,
+                        switches * 1000 / interval, preempted);
+            }
+        }
+        memcpy(prev, cur, sizeof(cur));
+        np = nc;
+        ptot = ctot;
+    }
+}
+
+/*
+ * evtraceSerialize() and pcprofSerialize() callbacks: hex dump on the
+ * shell, 32 bytes per line, or binary into a file.
+ */
+struct trace_hex {
+    BaseSequentialStream *chp;
+    char line[65];
+    size_t col;
+};
+
+static int trace_hex_write(void *ctx, const void *buf, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    struct trace_hex *th = (struct trace_hex *)ctx;
+    const uint8_t *p = (const uint8_t *)buf;
+
+    while (n-- > 0) {
+        th->line[th->col++] = hex[*p >> 4];
+        th->line[th->col++] = hex[*p++ & 15];
+        if (th->col == 64) {
+            th->line[th->col] = 0;
+            chprintf(th->chp, "%s\r\n", th->line);
+            th->col = 0;
+        }
+    }
+    return 0;
+}
+
+static int trace_file_write(void *ctx, const void *buf, size_t n) {
+    UINT written;
+
+    if (f_write((FIL *)ctx, buf, n, &written) != FR_OK)
+        return 1;
+    return written == n ? 0 : 1;
+}
+
+static void cmd_trace(BaseSequentialStream *chp, int argc, char *argv[]) {
+    unsigned mask = EVTRACE_CLASS_ALL;
+    FRESULT err;
+    FIL f;
+
+    if ((argc > 0) && !strcmp(argv[0], "start")) {
+        /* Systick and the other interrupts fill the ring quickly. */
+        if ((argc > 1) && !strcmp(argv[1], "noirq"))
+            mask &= ~EVTRACE_CLASS_IRQ;
+        evtraceStart(mask);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "stop")) {
+        evtraceStop();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "clear")) {
+        evtraceClear();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "dump")) {
+        struct trace_hex th;
+
+        th.chp = chp;
+        th.col = 0;
+        chprintf(chp, "-- evtrace begin --\r\n");
+        evtraceSerialize(trace_hex_write, &th);
+        if (th.col > 0) {
+            th.line[th.col] = 0;
+            chprintf(chp, "%s\r\n", th.line);
+        }
+        chprintf(chp, "-- evtrace end --\r\n");
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "save")) {
+        err = f_open(&f, argv[1], FA_WRITE | FA_CREATE_ALWAYS);
+        if (err != FR_OK) {
+            chprintf(chp, "FS: f_open(%s) failed.\r\n", argv[1]);
+            verbose_error(chp, err);
+            return;
+        }
+        if (evtraceSerialize(trace_file_write, &f))
+            chprintf(chp, "FS: f_write() failed\r\n");
+        f_close(&f);
+    }
+    else if (argc == 0) {
+        chprintf(chp, "%s, %u records\r\n",
+                evtraceGetClasses() ? "recording" : "stopped",
+                evtraceCount());
+    }
+    else {
+        chprintf(chp, "Usage: trace [start [noirq]|stop|clear|dump|save file]\r\n");
+    }
+}
+
+static void cmd_prof(BaseSequentialStream *chp, int argc, char *argv[]) {
+    FRESULT err;
+    FIL f;
+
+    if ((argc > 0) && (argc < 3) && !strcmp(argv[0], "start")) {
+        pcprofStart(argc > 1 ? (unsigned)atoi(argv[1]) : 0);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "stop")) {
+        pcprofStop();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "clear")) {
+        pcprofClear();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "dump")) {
+        struct trace_hex th;
+
+        th.chp = chp;
+        th.col = 0;
+        chprintf(chp, "-- pcprof begin --\r\n");
+        pcprofSerialize(trace_hex_write, &th);
+        if (th.col > 0) {
+            th.line[th.col] = 0;
+            chprintf(chp, "%s\r\n", th.line);
+        }
+        chprintf(chp, "-- pcprof end --\r\n");
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "save")) {
+        err = f_open(&f, argv[1], FA_WRITE | FA_CREATE_ALWAYS);
+        if (err != FR_OK) {
+            chprintf(chp, "FS: f_open(%s) failed.\r\n", argv[1]);
+            verbose_error(chp, err);
+            return;
+        }
+        if (pcprofSerialize(trace_file_write, &f))
+            chprintf(chp, "FS: f_write() failed\r\n");
+        f_close(&f);
+    }
+    else if (argc == 0) {
+        if (pcprofGetRate())
+            chprintf(chp, "sampling at %u Hz, ", pcprofGetRate());
+        else
+            chprintf(chp, "stopped, ");
+        chprintf(chp, "%u samples\r\n", pcprofCount());
+    }
+    else {
+        chprintf(chp, "Usage: prof [start [hz]|stop|clear|dump|save file]\r\n");
+    }
+}
+
+static const char * const alloc_kinds[] = {"heap", "pool", "malloc", "any"};
+
+/* The registry walk is completed so that no thread reference is kept. */
+static const char *alloc_thread_name(uint32_t addr) {
+    thread_t *tp = chRegFirstThread();
+    const char *name = "exited";
+
+    while (tp != NULL) {
+        if ((uint32_t)(uintptr_t)tp == addr) {
+            name = chRegGetThreadNameX(tp);
+            if (name == NULL)
+                name = "";
+        }
+        tp = chRegNextThread(tp);
+    }
+    return name;
+}
+
+/* Live blocks, all of them or the ones allocated after the mark. */
+static void alloc_blocks(BaseSequentialStream *chp, bool leaks) {
+    allocprof_totals_t tot[ALLOCPROF_KINDS];
+    allocprof_block_t b;
+    uint32_t mark, now = (uint32_t)chVTGetSystemTimeX();
+    unsigned cursor = 0, n = 0;
+    unsigned long bytes = 0;
+
+    (void)allocprofGetTotals(tot, &mark, NULL);
+    chprintf(chp, "      addr   size     caller   kind   age ms thread\r\n");
+    while (allocprofNextBlock(&cursor, &b)) {
+        if (leaks && (b.seq <= mark))
+            continue;
+        chprintf(chp, "0x%08lx %6lu 0x%08lx %6s %8lu %s\r\n",
+                (unsigned long)b.addr, (unsigned long)b.size,
+                (unsigned long)b.caller, alloc_kinds[b.kind],
+                (unsigned long)(((uint64_t)(now - b.ts) * 1000U) /
+                                CH_CFG_ST_FREQUENCY),
+                alloc_thread_name(b.tp));
+        n++;
+        bytes += b.size;
+    }
+    chprintf(chp, "%u blocks, %lu bytes%s\r\n", n, bytes,
+            leaks ? " allocated since the mark" : "");
+}
+
+/* Call sites ordered by live bytes, selection of the n largest. */
+static void alloc_sites(BaseSequentialStream *chp, unsigned limit) {
+    static allocprof_site_t sites[ALLOCPROF_MAX_SITES];
+    size_t n = allocprofGetSites(sites, ALLOCPROF_MAX_SITES);
+    size_t i, j, best;
+
+    chprintf(chp, "    caller   kind     live blocks   allocs    frees\r\n");
+    for (i = 0; (i < n) && (i < limit); i++) {
+        best = i;
+        for (j = i + 1; j < n; j++) {
+            if (sites[j].live_bytes > sites[best].live_bytes)
+                best = j;
+        }
+        allocprof_site_t tmp = sites[i];
+        sites[i] = sites[best];
+        sites[best] = tmp;
+        chprintf(chp, "0x%08lx %6s %8lu %6lu %8lu %8lu\r\n",
+                (unsigned long)sites[i].caller, alloc_kinds[sites[i].kind],
+                (unsigned long)sites[i].live_bytes,
+                (unsigned long)sites[i].live_count,
+                (unsigned long)sites[i].allocs,
+                (unsigned long)sites[i].frees);
+    }
+    if (n > limit)
+        chprintf(chp, "%u more sites\r\n", (unsigned)(n - limit));
+}
+
+/* Free fragments of the default heap and a map of the heap area. */
+#define ALLOC_MAP_COLS  64
+#define ALLOC_MAP_ROWS  4
+
+static void alloc_frag(BaseSequentialStream *chp) {
+    static allocprof_frag_t frags[ALLOCPROF_MAX_FRAGS];
+    static char map[ALLOC_MAP_COLS * ALLOC_MAP_ROWS];
+    size_t i, n, listed;
+    uint32_t base, cellsize, total = 0, largest = 0;
+
+    n = allocprofGetFrags(frags, ALLOCPROF_MAX_FRAGS);
+    listed = n < ALLOCPROF_MAX_FRAGS ? n : ALLOCPROF_MAX_FRAGS;
+    chprintf(chp, "      addr     size\r\n");
+    for (i = 0; i < listed; i++) {
+        chprintf(chp, "0x%08lx %8lu\r\n", (unsigned long)frags[i].addr,
+                (unsigned long)frags[i].size);
+        total += frags[i].size;
+        if (frags[i].size > largest)
+            largest = frags[i].size;
+    }
+    chprintf(chp, "%u fragments, %lu bytes free, largest %lu",
+            (unsigned)n, (unsigned long)total, (unsigned long)largest);
+    if (total > 0)
+        chprintf(chp, ", %lu%% fragmented",
+                (unsigned long)(100U - (uint32_t)(((uint64_t)largest * 100U) / total)));
+    chprintf(chp, listed < n ? " (first %u listed)\r\n" : "\r\n",
+            (unsigned)listed);
+
+    if (!allocprofMap(map, sizeof(map), &base, &cellsize))
+        return;
+    chprintf(chp, "0x%08lx, %lu bytes per cell, '#' live, '.' free, ':' both\r\n",
+            (unsigned long)base, (unsigned long)cellsize);
+    for (i = 0; i < ALLOC_MAP_ROWS; i++) {
+        streamWrite(chp, (const uint8_t *)&map[i * ALLOC_MAP_COLS],
+                ALLOC_MAP_COLS);
+        chprintf(chp, "\r\n");
+    }
+}
+
+static void cmd_alloc(BaseSequentialStream *chp, int argc, char *argv[]) {
+    FRESULT err;
+    FIL f;
+
+    if ((argc > 0) && (argc < 3) && !strcmp(argv[0], "sites")) {
+        alloc_sites(chp, argc > 1 ? (unsigned)atoi(argv[1]) : 16U);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "live")) {
+        alloc_blocks(chp, false);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "leaks")) {
+        alloc_blocks(chp, true);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "mark")) {
+        allocprofMark();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "reset")) {
+        allocprofResetPeaks();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "frag")) {
+        alloc_frag(chp);
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "dump")) {
+        struct trace_hex th;
+
+        th.chp = chp;
+        th.col = 0;
+        chprintf(chp, "-- allocprof begin --\r\n");
+        allocprofSerialize(trace_hex_write, &th);
+        if (th.col > 0) {
+            th.line[th.col] = 0;
+            chprintf(chp, "%s\r\n", th.line);
+        }
+        chprintf(chp, "-- allocprof end --\r\n");
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "save")) {
+        err = f_open(&f, argv[1], FA_WRITE | FA_CREATE_ALWAYS);
+        if (err != FR_OK) {
+            chprintf(chp, "FS: f_open(%s) failed.\r\n", argv[1]);
+            verbose_error(chp, err);
+            return;
+        }
+        if (allocprofSerialize(trace_file_write, &f))
+            chprintf(chp, "FS: f_write() failed\r\n");
+        f_close(&f);
+    }
+    else if (argc == 0) {
+        allocprof_totals_t tot[ALLOCPROF_KINDS];
+        uint32_t seq, mark, untracked;
+        unsigned i;
+
+        seq = allocprofGetTotals(tot, &mark, &untracked);
+        chprintf(chp, "  kind     live blocks     peak   allocs    frees\r\n");
+        for (i = 0; i < ALLOCPROF_KINDS; i++) {
+            chprintf(chp, "%6s %8lu %6lu %8lu %8lu %8lu\r\n", alloc_kinds[i],
+                    (unsigned long)tot[i].cur_bytes,
+                    (unsigned long)tot[i].cur_count,
+                    (unsigned long)tot[i].peak_bytes,
+                    (unsigned long)tot[i].allocs,
+                    (unsigned long)tot[i].frees);
+        }
+        chprintf(chp, "%lu allocations, mark at %lu, %lu untracked\r\n",
+                (unsigned long)seq, (unsigned long)mark,
+                (unsigned long)untracked);
+    }
+    else {
+        chprintf(chp, "Usage: alloc [sites [n]|live|mark|leaks|frag|reset|dump|save file]\r\n");
+    }
+}
+
+/* metricsExport() callback writing to the shell stream. */
+static int stats_write(void *ctx, const void *buf, size_t n) {
+    BaseSequentialStream *chp = (BaseSequentialStream *)ctx;
+
+    return streamWrite(chp, (const uint8_t *)buf, n) != n;
+}
+
+static void cmd_stats(BaseSequentialStream *chp, int argc, char *argv[]) {
+    unsigned flags = 0;
+
+    if ((argc > 0) && !strcmp(argv[0], "-p")) {
+        flags |= METRICS_EXPORT_PROMETHEUS;
+        argc--;
+        argv++;
+    }
+    if (argc > 1) {
+        chprintf(chp, "Usage: stats [-p] [prefix]\r\n");
+        return;
+    }
+    metricsExport(stats_write, chp, argc > 0 ? argv[0] : NULL, flags);
+}
+
+/* parseconfig() callback printing the problems. */
+static void config_report(void *arg, unsigned line, const char *section,
+                          const char *name, const char *msg) {
+    BaseSequentialStream *chp = (BaseSequentialStream *)arg;
+
+    if (line > 0)
+        chprintf(chp, "line %u: ", line);
+    if (*name != '\0')
+        chprintf(chp, "%s.%s: ", section, name);
+    chprintf(chp, "%s\r\n", msg);
+}
+
+static void cmd_config(BaseSequentialStream *chp, int argc, char *argv[]) {
+    static const char *types[] = {"int", "bool", "ip", "str"};
+    const cfgdef_t *dp;
+    const uint8_t *ip;
+    uint32_t k, ipaddr;
+    char key[40];
+    size_t i;
+    int err;
+
+    if ((argc == 2) && !strcmp(argv[0], "load")) {
+        err = parseconfig(argv[1], config_report, chp);
+        if (err < 0)
+            chprintf(chp, "cannot read %s\r\n", argv[1]);
+        else if (err > 0)
+            chprintf(chp, "%d error(s), configuration not changed\r\n", err);
+        else {
+            chprintf(chp, "loaded from the %s\r\n", configSource());
+            telemConfigure();
+        }
+        return;
+    }
+    if (argc > 0) {
+        chprintf(chp, "Usage: config [load file]\r\n");
+        return;
+    }
+    for (i = 0; (dp = configDef(i)) != NULL; i++) {
+        chsnprintf(key, sizeof(key), "%s.%s", dp->section, dp->name);
+        chprintf(chp, "%-24s %-4s ", key, types[dp->type]);
+        if (getconfig(dp->section, dp->name) == NULL) {
+            chprintf(chp, "-\r\n");
+            continue;
+        }
+        k = cfgKey(dp->section, dp->name);
+        switch (dp->type) {
+        case CFG_INT:
+            chprintf(chp, "%ld\r\n", (long)configInt(k));
+            break;
+        case CFG_BOOL:
+            chprintf(chp, "%s\r\n", configBool(k) ? "true" : "false");
+            break;
+        case CFG_IP:
+            ip = (const uint8_t *)&(ipaddr = configIp(k));
+            chprintf(chp, "%u.%u.%u.%u\r\n", ip[0], ip[1], ip[2], ip[3]);
+            break;
+        case CFG_STR:
+            chprintf(chp, "%s\r\n", configStr(k).ptr);
+            break;
+        }
+    }
+}
+
+static void cmd_telem(BaseSequentialStream *chp, int argc, char *argv[]) {
+    telemstats_t st;
+    char list[TELEM_MAX_DESTS * 24];
+    size_t len, n;
+    int i;
+
+    if ((argc == 1) && !strcmp(argv[0], "start")) {
+        telemStart();
+    }
+    else if ((argc == 1) && !strcmp(argv[0], "stop")) {
+        telemStop();
+    }
+    else if ((argc > 0) && !strcmp(argv[0], "dest")) {
+        len = 0;
+        for (i = 1; i < argc; i++) {
+            n = strlen(argv[i]);
+            if (len + n + 2 > sizeof(list)) {
+                chprintf(chp, "destination list too long\r\n");
+                return;
+            }
+            memcpy(list + len, argv[i], n);
+            len += n;
+            list[len++] = ' ';
+        }
+        list[len] = '\0';
+        if (telemSetDests(list) < 0)
+            chprintf(chp, "bad destination list\r\n");
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "rate")) {
+        telemSetRate((uint32_t)atoi(argv[1]));
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "period")) {
+        telemSetPeriod((uint32_t)atoi(argv[1]));
+    }
+    else if ((argc == 2) && !strcmp(argv[0], "gen")) {
+        telemGenerate((uint32_t)atoi(argv[1]));
+    }
+    else if (argc == 0) {
+        telemGetStats(&st);
+        telemFormatDests(list, sizeof(list));
+        chprintf(chp, "%s, to %s\r\n", telemRunning() ? "running" : "stopped",
+                 list[0] != '\0' ? list : "nowhere");
+        chprintf(chp, "samples %lu dropped %lu datagrams %lu bytes %lu\r\n",
+                 (unsigned long)st.samples, (unsigned long)st.dropped,
+                 (unsigned long)st.datagrams, (unsigned long)st.bytes);
+        chprintf(chp, "errors %lu throttled %lu nobuf %lu\r\n",
+                 (unsigned long)st.errors, (unsigned long)st.throttled,
+                 (unsigned long)st.nobuf);
+    }
+    else {
+        chprintf(chp, "Usage: telem [start|stop|dest addr[:port]...|rate kB/s|"
+                      "period ms|gen hz]\r\n");
+    }
+}
+
 static void cmd_test(BaseSequentialStream *chp, int argc, char *argv[]) {
     thread_t *tp;
 
@@ -84,8 +792,20 @@ static void cmd_test(BaseSequentialStream *chp, int argc, char *argv[]) {
 static const ShellCommand commands[] = {
     {"mem", cmd_mem},
     {"threads", cmd_threads},
+    {"stacks", cmd_stacks},
     {"test", cmd_test},
+    {"dtimers", cmd_dtimers},
+    {"tm", cmd_tm},
+    {"top", cmd_top},
+    {"trace", cmd_trace},
+    {"prof", cmd_prof},
+    {"alloc", cmd_alloc},
+    {"bench", cmd_bench},
+    {"stats", cmd_stats},
+    {"config", cmd_config},
+    {"telem", cmd_telem},
     {"ls", cmd_tree},
+    {"dir", cmd_dir},
 	{"free", cmd_free },
     {"mkdir", cmd_mkdir},
     {"setlabel", cmd_setlabel},
@@ -95,7 +815,7 @@ static const ShellCommand commands[] = {
 };
 
 const ShellConfig shell_cfg = {
-    (BaseSequentialStream *)&SD6,
+    (BaseSequentialStream *)&BOARD_SHELL_SD,
     commands
 };
 
@@ -1,6 +1,7 @@
 # List of all the board related files.
 SHELLAPPSRC = $(SHELLAPP)/shellapps.cpp \
-	      $(SHELLAPP)/fs.cpp
+	      $(SHELLAPP)/fs.cpp \
+	      $(SHELLAPP)/appbench.cpp
 
 # Required include directories
 SHELLAPPINC = $(SHELLAPP)/
@@ -0,0 +1,140 @@
+/**
+ * Test for the configuration images of utils/cfgimage.cpp on the host.
+ *
+ * An image is built from INI text with a test key table, the typed
+ * values, the index, the validation and the error reports are checked.
+ **/
+#include "cfgimage.h"
+#include "check.h"
+
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+static const cfgdef_t table[] = {
+  {"net", "ip", CFG_IP, "192.168.0.10", false},
+  {"net", "dhcp", CFG_BOOL, "off", false},
+  {"web", "port", CFG_INT, "80", false},
+  {"web", "root", CFG_STR, NULL, false},
+  {"sys", "name", CFG_STR, NULL, true},
+};
+
+#define NKEYS (sizeof(table) / sizeof(table[0]))
+
+struct memfile {
+  const char *data;
+  size_t size;
+  size_t pos;
+};
+
+static int read_mem(void *readctx, char *buf, size_t size) {
+  memfile *f = (memfile *)readctx;
+  size_t n = f->size - f->pos;
+
+  if (n > size)
+    n = size;
+  memcpy(buf, f->data + f->pos, n);
+  f->pos += n;
+  return (int)n;
+}
+
+static std::string reports;
+
+static void report(void *arg, unsigned line, const char *section,
+                   const char *name, const char *msg) {
+  char buf[128];
+
+  (void)arg;
+  snprintf(buf, sizeof(buf), "%u %s.%s %s;", line, section, name, msg);
+  reports += buf;
+}
+
+static int build(cfgimg_t *img, const char *text) {
+  static iniparser_t ip;
+  memfile f = {text, strlen(text), 0};
+
+  reports.clear();
+  return cfgimgParse(img, table, NKEYS, &ip, read_mem, &f, report, NULL);
+}
+
+static uint32_t value(const cfgimg_t *img, uint32_t key) {
+  int k = cfgimgFind(img, key);
+
+  return k >= 0 ? img->slots[k].value : 0xdeadbeefU;
+}
+
+static void test_values(void) {
+  static cfgimg_t img, copy;
+  uint8_t ip[4];
+  uint32_t v;
+  size_t i;
+
+  CHECK(build(&img, "[net]\nip = 10.1.2.3\ndhcp = Yes\n"
+                    "[web]\nport = -0x10\n[sys]\nname = \"board 1\"\n") == 0,
+        "valid input");
+  cfgimgFinish(&img, 1234, 0x56789abc);
+  CHECK(img.hdr.size == CFGIMG_HEAD_SIZE + 9 + 4 + 6 + 8,
+        "image size is the head and the used pool");
+  v = value(&img, CONFIG_KEY("net", "ip"));
+  memcpy(ip, &v, 4);
+  CHECK(ip[0] == 10 && ip[1] == 1 && ip[2] == 2 && ip[3] == 3, "ip value");
+  CHECK(value(&img, CONFIG_KEY("net", "dhcp")) == 1, "bool value");
+  CHECK((int32_t)value(&img, CONFIG_KEY("web", "port")) == -16, "int value");
+  CHECK(strcmp(cfgimgText(&img, cfgimgFind(&img, CONFIG_KEY("sys", "name"))),
+               "board 1") == 0, "string value");
+  CHECK(cfgimgText(&img, cfgimgFind(&img, CONFIG_KEY("web", "root"))) == NULL,
+        "key without value or default");
+  CHECK(cfgimgFind(&img, CONFIG_KEY("web", "none")) < 0, "unknown key");
+  for (i = 0; i < NKEYS; i++)
+    CHECK(cfgimgFind(&img, cfgKey(table[i].section, table[i].name)) == (int)i,
+          "index");
+
+  /* Used in place after a plain copy, as after a read from the card. */
+  CHECK(cfgimgValid(&img, img.hdr.size, cfgimgSchema(table, NKEYS)),
+        "valid image");
+  memcpy(&copy, &img, img.hdr.size);
+  CHECK(cfgimgValid(&copy, img.hdr.size, img.hdr.schema), "copied image");
+  CHECK(value(&copy, CONFIG_KEY("web", "port")) == (uint32_t)-16,
+        "value of the copy");
+  CHECK(img.hdr.srcsize == 1234 && img.hdr.srctime == 0x56789abc,
+        "source key");
+  CHECK(!cfgimgValid(&img, img.hdr.size - 1, img.hdr.schema), "short read");
+  CHECK(!cfgimgValid(&img, img.hdr.size, img.hdr.schema + 1), "other table");
+  copy.pool[0] ^= 1;
+  CHECK(!cfgimgValid(&copy, img.hdr.size, img.hdr.schema), "corrupted image");
+}
+
+static void test_errors(void) {
+  static cfgimg_t img;
+  static const cfgdef_t dup[] = {
+    {"a", "b", CFG_INT, NULL, false},
+    {"a", "b", CFG_INT, NULL, false},
+  };
+
+  CHECK(build(&img, "[net]\nip = 10.1.2\nfoo = 1\nip = 1.2.3.4\n"
+                    "[web]\nport = 80x\n") == 5, "error count");
+  CHECK(reports == "2 net.ip invalid value;3 net.foo unknown key;"
+                   "4 net.ip duplicate key;6 web.port invalid value;"
+                   "0 sys.name missing key;", reports.c_str());
+  /* Only the first bad line of the parser is known. */
+  CHECK(build(&img, "bad line\n[sys]\nname = x\n") == 1, "syntax error");
+  CHECK(reports == "1 . syntax error;", reports.c_str());
+  CHECK(cfgimgInit(&img, dup, 2) < 0, "duplicate keys");
+  CHECK(build(&img, "[web]\nport = 99999999999999999999\n[sys]\nname = x\n")
+        == 1, "int out of range");
+  CHECK(build(&img, "[sys]\nname = x\n") == 0, "defaults");
+  CHECK(value(&img, CONFIG_KEY("web", "port")) == 80, "default value");
+}
+
+int main(void) {
+
+  test_values();
+  test_errors();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
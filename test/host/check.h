@@ -0,0 +1,22 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+/**
+ * Minimal check macro of the host tests.
+ *
+ * CHECK() prints the failed condition with its location and counts it in
+ * failures, the test goes on. main() reports the count and returns non
+ * zero when it is set.
+ **/
+#include <stdio.h>
+
+static int failures;
+
+#define CHECK(cond, msg) do {                                           \
+    if (!(cond)) {                                                      \
+      printf("FAIL: %s (%s:%d)\n", msg, __FILE__, __LINE__);           \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+#endif
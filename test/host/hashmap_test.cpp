@@ -0,0 +1,298 @@
+/**
+ * Test and benchmark for utils/hashmap.h and the dictionary shim on the
+ * host.
+ *
+ * StringMap is checked against std::unordered_map over a random
+ * sequence of inserts, replacements and erases. The benchmark compares
+ * the dictionary shim with the original chained K&R table, kept below
+ * as the reference, on the config style keys of the appbench cases.
+ **/
+#include "hashmap.h"
+#include "dictionary.h"
+#include "check.h"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace hashmap;
+
+#define RANDOM_OPS      200000U
+#define RANDOM_KEYS     5000U
+#define BENCH_OPS       1000000U
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+/* The K&R table replaced by the shim, the reference of the benchmark. */
+namespace kr {
+
+  #define HASHSIZE 101
+
+  struct nlist {
+    nlist *next;
+    char *name;
+    char *defn;
+  };
+
+  static nlist *hashtab[HASHSIZE];
+
+  static unsigned hash(const char *s) {
+    unsigned hashval;
+    for (hashval = 0; *s != '\0'; s++)
+      hashval = *s + 31 * hashval;
+    return hashval % HASHSIZE;
+  }
+
+  static nlist *lookup(const char *s) {
+    nlist *np;
+    for (np = hashtab[hash(s)]; np != NULL; np = np->next)
+      if (strcmp(s, np->name) == 0)
+        return np;
+    return NULL;
+  }
+
+  static nlist *install(const char *name, const char *defn) {
+    nlist *np;
+    unsigned hashval;
+    if ((np = lookup(name)) == NULL) {
+      np = (nlist *)malloc(sizeof(*np));
+      if (np == NULL || (np->name = strdup(name)) == NULL)
+        return NULL;
+      hashval = hash(name);
+      np->next = hashtab[hashval];
+      hashtab[hashval] = np;
+    } else
+      free((void *)np->defn);
+    if ((np->defn = strdup(defn)) == NULL)
+      return NULL;
+    return np;
+  }
+
+  static void clear(void) {
+    unsigned i;
+    for (i = 0; i < HASHSIZE; i++) {
+      while (hashtab[i] != NULL) {
+        nlist *np = hashtab[i];
+        hashtab[i] = np->next;
+        free(np->name);
+        free(np->defn);
+        free(np);
+      }
+    }
+  }
+}
+
+static void test_arena(void) {
+  Arena a(64);
+  char *s;
+  void *p, *q;
+
+  CHECK(a.used() == 0 && a.reserved() == 0, "arena not empty");
+  p = a.alloc(1);
+  q = a.alloc(3);
+  CHECK(((uintptr_t)p % sizeof(void *)) == 0 &&
+        ((uintptr_t)q % sizeof(void *)) == 0, "unaligned block");
+  CHECK((char *)q - (char *)p == sizeof(void *), "blocks not packed");
+  s = a.strdup("network_ip", 7);
+  CHECK(strcmp(s, "network") == 0, "strdup length");
+  p = a.alloc(1000);
+  CHECK(p != NULL && a.reserved() > 1000, "block larger than a chunk");
+  memset(p, 0x55, 1000);
+  CHECK(strcmp(s, "network") == 0, "earlier block overwritten");
+  a.clear();
+  CHECK(a.used() == 0 && a.reserved() == 0, "arena not released");
+}
+
+static void test_basic(void) {
+  StringMap<int> m;
+  const char *key;
+  char buf[8];
+
+  CHECK(m.find("a") == NULL, "find in empty map");
+  CHECK(!m.erase("a"), "erase from empty map");
+  CHECK(*m.insert("a", 1) == 1, "insert value");
+  strcpy(buf, "b");
+  CHECK(*m.insert(buf, 2, &key) == 2, "insert value");
+  buf[0] = 'x';
+  CHECK(strcmp(key, "b") == 0 && key != buf, "key not interned");
+  CHECK(m.find("b") != NULL && *m.find("b") == 2, "find interned key");
+  CHECK(*m.insert("a", 3) == 3 && m.size() == 2, "replace value");
+  CHECK(m.erase("a") && m.find("a") == NULL && m.size() == 1, "erase");
+  CHECK(*m.find("b") == 2, "erase removed another key");
+  CHECK(m.reserve(100) && m.capacity() >= 128, "reserve");
+  CHECK(*m.find("b") == 2, "key lost by reserve");
+  m.clear();
+  CHECK(m.size() == 0 && m.find("b") == NULL, "clear");
+  CHECK(m.arena().used() == 0, "clear kept the keys");
+}
+
+static void count_entry(const char *key, int value, void *arg) {
+  (void)key;
+  *(long *)arg += value;
+}
+
+/* Random operations mirrored on std::unordered_map, with a small key
+   space so that many operations hit existing and erased keys. */
+static void test_random(void) {
+  StringMap<int> m;
+  std::unordered_map<std::string, int> ref;
+  char key[16];
+  unsigned i;
+  long sum = 0, refsum = 0;
+
+  srand(1);
+  for (i = 0; i < RANDOM_OPS; i++) {
+    int op = rand() % 4, v = rand();
+
+    snprintf(key, sizeof(key), "key_%u", (unsigned)(rand() % RANDOM_KEYS));
+    if (op == 0) {
+      CHECK(m.erase(key) == (ref.erase(key) != 0), "erase mismatch");
+    }
+    else if (op == 1) {
+      int *p = m.find(key);
+      std::unordered_map<std::string, int>::iterator it = ref.find(key);
+
+      CHECK((p == NULL) == (it == ref.end()), "find mismatch");
+      CHECK(p == NULL || *p == it->second, "value mismatch");
+    }
+    else {
+      m.insert(key, v);
+      ref[key] = v;
+    }
+    CHECK(m.size() == ref.size(), "size mismatch");
+    if (failures)
+      return;
+  }
+  for (std::unordered_map<std::string, int>::iterator it = ref.begin();
+       it != ref.end(); ++it) {
+    CHECK(m.find(it->first.c_str()) != NULL &&
+          *m.find(it->first.c_str()) == it->second, "final content");
+    refsum += it->second;
+  }
+  m.forEach(count_entry, &sum);
+  CHECK(sum == refsum, "forEach content");
+  printf("random: %u ops, %u entries, capacity %u, max probe %u\n",
+         RANDOM_OPS, (unsigned)m.size(), (unsigned)m.capacity(),
+         (unsigned)m.maxProbe());
+}
+
+static void test_dictionary(void) {
+  nlist *np, *np2;
+  char *defn;
+
+  np = dict_install("network_ip", "192.168.1.10");
+  CHECK(np != NULL && strcmp(np->name, "network_ip") == 0, "dict_install");
+  CHECK(dict_lookup("network_ip") == np, "dict_lookup");
+  CHECK(dict_lookup("network_mask") == NULL, "dict_lookup miss");
+  defn = np->defn;
+  np2 = dict_install("network_ip", "10.0.0.1");
+  CHECK(np2 == np && np->defn == defn, "shorter defn not in place");
+  CHECK(strcmp(np->defn, "10.0.0.1") == 0, "replaced defn");
+  np2 = dict_install("network_ip", "192.168.100.100");
+  CHECK(np2 == np && strcmp(np->defn, "192.168.100.100") == 0,
+        "longer defn");
+  CHECK(dict_count() == 1, "dict_count");
+  CHECK(dict_remove("network_ip") && !dict_remove("network_ip"),
+        "dict_remove");
+  CHECK(dict_lookup("network_ip") == NULL, "removed entry found");
+  dict_install("a", "1");
+  dict_clear();
+  CHECK(dict_count() == 0 && dict_lookup("a") == NULL, "dict_clear");
+}
+
+static void bench(const char *name, std::vector<std::string> &keys,
+                  std::vector<std::string> &misses) {
+  std::chrono::steady_clock::time_point start;
+  double t_kr[3], t_dict[3];
+  unsigned r, i, n = (unsigned)keys.size();
+  unsigned rounds = BENCH_OPS / n;
+  volatile unsigned found = 0;
+
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++) {
+    kr::clear();
+    for (i = 0; i < n; i++)
+      kr::install(keys[i].c_str(), "value");
+  }
+  t_kr[0] = elapsed(start);
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < n; i++)
+      found += kr::lookup(keys[i].c_str()) != NULL;
+  t_kr[1] = elapsed(start);
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < n; i++)
+      found += kr::lookup(misses[i].c_str()) != NULL;
+  t_kr[2] = elapsed(start);
+  kr::clear();
+
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++) {
+    dict_clear();
+    for (i = 0; i < n; i++)
+      dict_install(keys[i].c_str(), "value");
+  }
+  t_dict[0] = elapsed(start);
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < n; i++)
+      found += dict_lookup(keys[i].c_str()) != NULL;
+  t_dict[1] = elapsed(start);
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < n; i++)
+      found += dict_lookup(misses[i].c_str()) != NULL;
+  t_dict[2] = elapsed(start);
+  dict_clear();
+
+  printf("%s: %u keys, ns/op  k&r install %.1f hit %.1f miss %.1f"
+         "  hashmap install %.1f hit %.1f miss %.1f\n", name, n,
+         t_kr[0] * 1e9 / (n * rounds),
+         t_kr[1] * 1e9 / (n * rounds),
+         t_kr[2] * 1e9 / (n * rounds),
+         t_dict[0] * 1e9 / (n * rounds),
+         t_dict[1] * 1e9 / (n * rounds),
+         t_dict[2] * 1e9 / (n * rounds));
+}
+
+/* Keys shaped like the "section_name" entries of globalconfig. */
+static void bench_dictionary(unsigned n) {
+  std::vector<std::string> keys, misses;
+  char key[32];
+  unsigned i;
+
+  for (i = 0; i < n; i++) {
+    snprintf(key, sizeof(key), "section%u_key%u", i / 8, i % 8);
+    keys.push_back(key);
+    snprintf(key, sizeof(key), "section%u_nokey%u", i / 8, i % 8);
+    misses.push_back(key);
+  }
+  bench(n <= 64 ? "small" : "large", keys, misses);
+}
+
+int main(void) {
+
+  test_arena();
+  test_basic();
+  test_random();
+  test_dictionary();
+  if (!failures) {
+    bench_dictionary(32);
+    bench_dictionary(2000);
+  }
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * Test and benchmark for the INI parser of utils/iniparser.cpp on the
+ * host.
+ *
+ * The parser is fed from memory with reads of every size from 1 byte
+ * to a block, so that the lines straddle the block boundaries at every
+ * position, and must give the same pairs and first bad line each time.
+ * The benchmark compares it on a large synthetic file with the original
+ * parse_ini(), kept below as the reference, which read the file through
+ * f_gets(), one f_read() call per byte.
+ **/
+#include "iniutils.h"
+#include "check.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SECTIONS  20000U
+#define BENCH_KEYS      10U
+#define BENCH_ROUNDS    5U
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+/* Memory input, at most chunk bytes per read. */
+struct memfile {
+  const char *data;
+  size_t size;
+  size_t pos;
+  size_t chunk;
+};
+
+static int read_mem(void *readctx, char *buf, size_t size) {
+  memfile *f = (memfile *)readctx;
+  size_t n = f->size - f->pos;
+
+  if (n > size)
+    n = size;
+  if (n > f->chunk)
+    n = f->chunk;
+  memcpy(buf, f->data + f->pos, n);
+  f->pos += n;
+  return (int)n;
+}
+
+static int read_fail(void *readctx, char *buf, size_t size) {
+  (void)readctx;
+  (void)buf;
+  (void)size;
+  return -1;
+}
+
+/* Pairs as "line:section.name=value" strings, the values are made C
+   strings in place as the parse_ini() adapter does. */
+static int collect(void *usrcfg, unsigned line, const inislice_t *section,
+                   const inislice_t *name, const inislice_t *value) {
+  std::vector<std::string> *out = (std::vector<std::string> *)usrcfg;
+  char buf[600];
+
+  ((char *)name->ptr)[name->len] = '\0';
+  ((char *)value->ptr)[value->len] = '\0';
+  snprintf(buf, sizeof(buf), "%u:%s.%s=%s", line, section->ptr, name->ptr,
+           value->ptr);
+  out->push_back(buf);
+  return strcmp(name->ptr, "reject") == 0;
+}
+
+static int parse(const std::string &text, size_t chunk,
+                 std::vector<std::string> &out) {
+  static iniparser_t ip;
+  memfile f = {text.data(), text.size(), 0, chunk};
+
+  out.clear();
+  return ini_parse(&ip, read_mem, &f, collect, &out);
+}
+
+/* Parses text with every read size, returns the pairs and the result
+   of the block sized reads. */
+static int parse_all(const std::string &text, std::vector<std::string> &out) {
+  std::vector<std::string> ref, got;
+  size_t chunk;
+  int ret = parse(text, INI_BLOCK_SIZE, ref);
+
+  for (chunk = 1; chunk < INI_BLOCK_SIZE; chunk++) {
+    if (parse(text, chunk, got) != ret || got != ref) {
+      printf("chunk %u differs\n", (unsigned)chunk);
+      failures++;
+      break;
+    }
+  }
+  out = ref;
+  return ret;
+}
+
+static void test_syntax(void) {
+  std::vector<std::string> out;
+  std::string text =
+    "; comment\r\n"
+    "# comment\r\n"
+    "top = before any section\r\n"
+    "  [ network ]   ; trailing comment\r\n"
+    "address=10.0.0.1\r\n"
+    "\t mask \t=\t 255.0.0.0 \t; comment\r\n"
+    "empty =\r\n"
+    "quoted = \"a ; b \" ; comment\n"
+    "single = ' x '\n"
+    "\n"
+    "[web]\n"
+    "url = http://host/#anchor\n"
+    "last = no newline";
+
+  CHECK(parse_all(text, out) == 0, "valid input reported bad");
+  CHECK(out.size() == 8, "pair count");
+  if (out.size() == 8) {
+    CHECK(out[0] == "3:.top=before any section", "pair before section");
+    CHECK(out[1] == "5:network.address=10.0.0.1", "plain pair");
+    CHECK(out[2] == "6:network.mask=255.0.0.0", "spaces and comment");
+    CHECK(out[3] == "7:network.empty=", "empty value");
+    CHECK(out[4] == "8:network.quoted=a ; b ", "double quotes");
+    CHECK(out[5] == "9:network.single= x ", "single quotes");
+    CHECK(out[6] == "12:web.url=http://host/#anchor", "# inside value");
+    CHECK(out[7] == "13:web.last=no newline", "last line");
+  }
+}
+
+static void test_errors(void) {
+  std::vector<std::string> out;
+  std::string longline(INI_LINE_MAX + 10, 'x');
+  std::string longsection(INI_SECTION_MAX, 's');
+  static iniparser_t ip;
+
+  CHECK(parse_all("a = 1\nno equal sign\nb = 2\n", out) == 2, "missing =");
+  CHECK(out.size() == 2, "parse goes on after a bad line");
+  CHECK(parse_all("a = 1\n\n= 1\n", out) == 3, "empty name");
+  CHECK(parse_all("[sect\na = 1\n", out) == 1, "missing ]");
+  CHECK(parse_all("[s] junk\n", out) == 1, "junk after ]");
+  CHECK(parse_all("a = \"open\n", out) == 1, "unterminated quote");
+  CHECK(parse_all("a = \"x\" y\n", out) == 1, "junk after quote");
+  CHECK(parse_all("a = 1\nreject = 2\nb = 3\n", out) == 2, "handler error");
+  CHECK(out.size() == 3, "pairs after a handler error");
+  CHECK(parse_all("a = 1\n" + longline + "\nb = 2\n", out) == 2,
+        "long line");
+  CHECK(out.size() == 2 && out[1] == "3:.b=2", "line count after long line");
+  CHECK(parse_all("a = 1\n" + longline, out) == 2, "long last line");
+  CHECK(parse_all("[" + longsection + "]\n", out) == 1, "long section");
+  CHECK(parse_all(std::string(3 * INI_BLOCK_SIZE, '\n') + "x\n", out) ==
+        3 * INI_BLOCK_SIZE + 1, "line number across blocks");
+  CHECK(ini_parse(&ip, read_fail, NULL, collect, &out) == -1, "read error");
+}
+
+/* Synthetic file shaped like the appbench input. */
+static std::string make_ini(void) {
+  std::string text = "; benchmark input\r\n";
+  char line[64];
+  unsigned s, k;
+
+  for (s = 0; s < BENCH_SECTIONS; s++) {
+    snprintf(line, sizeof(line), "[section%u]\r\n", s);
+    text += line;
+    for (k = 0; k < BENCH_KEYS; k++) {
+      snprintf(line, sizeof(line), "name%u = value %u of section %u\r\n",
+               k, k, s);
+      text += line;
+    }
+    text += "\r\n";
+  }
+  return text;
+}
+
+/* The original parse_ini() over f_gets(), kept as the reference. */
+namespace old {
+
+  #define MAX_LINE_LEN 250
+  #define MAX_SESSION_LEN 50
+
+  typedef int (*onparseini)(void *usrcfg, const char *section,
+                            const char *name, const char *value);
+
+  /* f_read() of a single byte, as f_gets() does, not inlined to keep
+     the call cost of the target. */
+  __attribute__((noinline))
+  static int f_read1(memfile *f, char *c) {
+    return read_mem(f, c, 1);
+  }
+
+  static char *f_gets(char *buff, int len, memfile *fp) {
+    int n = 0;
+    char c, *p = buff;
+
+    while (n < len - 1) {
+      if (f_read1(fp, &c) != 1)
+        break;
+      *p++ = c;
+      n++;
+      if (c == '\n')
+        break;
+    }
+    *p = 0;
+    return n ? buff : 0;
+  }
+
+  static char *rtrim(char *str, char trimchar) {
+    char *pos;
+    if ((pos = strrchr(str, trimchar)) != NULL)
+      *pos = '\0';
+    return str;
+  }
+
+  static char *rstrip(char *s) {
+    char *pstr = s + strlen(s);
+    while (pstr > s && isspace((unsigned char)(*--pstr)))
+      *pstr = '\0';
+    return s;
+  }
+
+  static char *lskip(const char *s) {
+    while (*s && isspace((unsigned char)(*s)))
+      s++;
+    return (char *)s;
+  }
+
+  static int parse_ini(memfile *fp, onparseini handler, void *usercfg) {
+    char *linebuff, *p, *pend;
+    char section[MAX_SESSION_LEN] = "";
+
+    linebuff = (char *)malloc(MAX_LINE_LEN);
+    if (!linebuff)
+      return -1;
+    while (f_gets(linebuff, MAX_LINE_LEN, fp) != NULL) {
+      p = linebuff;
+      p = lskip(rstrip(p));
+      if (*p == ';')
+        continue;
+      p = rtrim(p, ';');
+      if (strlen(p) == 0)
+        continue;
+      if (*p == '[') {
+        pend = strchr(p + 1, ']');
+        if (pend) {
+          *pend = '\0';
+          strncpy(section, p + 1, MAX_SESSION_LEN - 1);
+        }
+        else {
+          free(linebuff);
+          return -1;
+        }
+      }
+      if ((pend = strstr(p, "=")) != NULL) {
+        *pend = '\0';
+        if (handler)
+          handler(usercfg, section, lskip(rstrip(p)), lskip(rstrip(pend + 1)));
+      }
+    }
+    free(linebuff);
+    return 0;
+  }
+}
+
+static unsigned long old_pairs, new_pairs, old_sum, new_sum;
+
+static int count_old(void *usrcfg, const char *section, const char *name,
+                     const char *value) {
+  (void)usrcfg;
+  old_pairs++;
+  old_sum += strlen(section) + strlen(name) + strlen(value);
+  return 0;
+}
+
+static int count_new(void *usrcfg, unsigned line, const inislice_t *section,
+                     const inislice_t *name, const inislice_t *value) {
+  (void)usrcfg;
+  (void)line;
+  new_pairs++;
+  new_sum += section->len + name->len + value->len;
+  return 0;
+}
+
+static void bench(void) {
+  static iniparser_t ip;
+  std::string text = make_ini();
+  std::chrono::steady_clock::time_point start;
+  double t_old, t_new;
+  unsigned r;
+
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    memfile f = {text.data(), text.size(), 0, (size_t)-1};
+    old::parse_ini(&f, count_old, NULL);
+  }
+  t_old = elapsed(start) / BENCH_ROUNDS;
+  start = std::chrono::steady_clock::now();
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    memfile f = {text.data(), text.size(), 0, (size_t)-1};
+    ini_parse(&ip, read_mem, &f, count_new, NULL);
+  }
+  t_new = elapsed(start) / BENCH_ROUNDS;
+
+  CHECK(old_pairs == new_pairs && old_sum == new_sum,
+        "parsers disagree on the benchmark input");
+  printf("ini: %.1f MB, %u pairs, f_gets %.1f MB/s, block %.1f MB/s\n",
+         text.size() / 1e6, BENCH_SECTIONS * BENCH_KEYS,
+         text.size() / t_old / 1e6, text.size() / t_new / 1e6);
+}
+
+int main(void) {
+
+  test_syntax();
+  test_errors();
+  if (!failures)
+    bench();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * Stress test and benchmark for utils/ringbuffer.h on the host.
+ *
+ * The SPSC ring is checked for strict FIFO ordering, the MPSC ring for
+ * per-producer ordering and for the total count, with producers and
+ * consumer on separate POSIX threads. The notification is checked with
+ * a consumer that sleeps on a binary semaphore whenever the ring is
+ * empty, a lost wakeup shows up as a wait that times out.
+ **/
+#include "ringbuffer.h"
+#include "check.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace lockfree;
+
+#define SPSC_ITEMS      5000000U
+#define MPSC_PRODUCERS  4U
+#define MPSC_ITEMS      1000000U
+#define WAKEUP_ITEMS    200000U
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+static void test_spsc_basic(void) {
+  SpscRing<uint32_t, 8> rb;
+  uint32_t v, in[12], out[12];
+  unsigned i;
+
+  CHECK(rb.empty(), "not empty after construction");
+  CHECK(!rb.pop(v), "pop from empty ring");
+  for (i = 0; i < 8; i++)
+    CHECK(rb.push(i), "push failed");
+  CHECK(!rb.push(8), "push into full ring");
+  CHECK(rb.size() == 8, "wrong size");
+  for (i = 0; i < 8; i++)
+    CHECK(rb.pop(v) && v == i, "wrong FIFO order");
+
+  for (i = 0; i < 12; i++)
+    in[i] = 100 + i;
+  CHECK(rb.pushN(in, 5) == 5, "pushN count");
+  CHECK(rb.pushN(&in[5], 7) == 3, "pushN partial count");
+  CHECK(rb.popN(out, 12) == 8, "popN count");
+  for (i = 0; i < 8; i++)
+    CHECK(out[i] == 100 + i, "popN order across wrap");
+}
+
+static void notify_count(void *arg) {
+  (*(unsigned *)arg)++;
+}
+
+static void test_notify(void) {
+  SpscRing<uint32_t, 4> rb;
+  MpscRing<uint32_t, 4> mrb;
+  unsigned n = 0, m = 0;
+  uint32_t v;
+
+  rb.setNotify(notify_count, &n);
+  rb.push(1);
+  rb.push(2);
+  CHECK(n == 1, "SPSC notify must fire on empty to non-empty only");
+  rb.pop(v);
+  rb.pop(v);
+  rb.push(3);
+  CHECK(n == 2, "SPSC notify after drain");
+
+  mrb.setNotify(notify_count, &m);
+  mrb.push(1);
+  mrb.push(2);
+  CHECK(m == 1, "MPSC notify must fire on empty to non-empty only");
+  mrb.pop(v);
+  mrb.pop(v);
+  mrb.push(3);
+  CHECK(m == 2, "MPSC notify after drain");
+}
+
+static void test_spsc_stress(void) {
+  static SpscRing<uint32_t, 1024> rb;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ordered = true;
+
+  std::thread producer([] {
+    uint32_t i = 0;
+    while (i < SPSC_ITEMS) {
+      if (rb.push(i))
+        i++;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  uint32_t expected = 0, v;
+  while (expected < SPSC_ITEMS) {
+    if (rb.pop(v)) {
+      if (v != expected)
+        ordered = false;
+      expected++;
+    }
+    else
+      std::this_thread::yield();
+  }
+  producer.join();
+  CHECK(ordered, "SPSC stress lost ordering");
+  CHECK(rb.empty(), "SPSC not empty at end");
+  printf("spsc: %u items, %.1f Mitems/s\n", SPSC_ITEMS,
+         SPSC_ITEMS / elapsed(start) / 1e6);
+}
+
+static void test_spsc_batch_stress(void) {
+  static SpscRing<uint32_t, 1024> rb;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool ordered = true;
+
+  std::thread producer([] {
+    uint32_t buf[32], i = 0, j;
+    size_t n;
+    while (i < SPSC_ITEMS) {
+      for (j = 0; j < 32; j++)
+        buf[j] = i + j;
+      n = rb.pushN(buf, (SPSC_ITEMS - i) < 32 ? SPSC_ITEMS - i : 32);
+      if (n == 0)
+        std::this_thread::yield();
+      i += (uint32_t)n;
+    }
+  });
+
+  uint32_t expected = 0, buf[32];
+  size_t n, j;
+  while (expected < SPSC_ITEMS) {
+    n = rb.popN(buf, 32);
+    if (n == 0)
+      std::this_thread::yield();
+    for (j = 0; j < n; j++) {
+      if (buf[j] != expected)
+        ordered = false;
+      expected++;
+    }
+  }
+  producer.join();
+  CHECK(ordered, "SPSC batch stress lost ordering");
+  printf("spsc batch32: %u items, %.1f Mitems/s\n", SPSC_ITEMS,
+         SPSC_ITEMS / elapsed(start) / 1e6);
+}
+
+static void test_mpsc_stress(void) {
+  static MpscRing<uint32_t, 1024> rb;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  std::vector<uint32_t> next(MPSC_PRODUCERS, 0);
+  bool ordered = true;
+  uint32_t total = 0, v, id;
+
+  for (id = 0; id < MPSC_PRODUCERS; id++) {
+    producers.push_back(std::thread([id] {
+      uint32_t i = 0;
+      while (i < MPSC_ITEMS) {
+        if (rb.push((id << 28) | i))
+          i++;
+        else
+          std::this_thread::yield();
+      }
+    }));
+  }
+
+  while (total < MPSC_PRODUCERS * MPSC_ITEMS) {
+    if (rb.pop(v)) {
+      id = v >> 28;
+      if (id >= MPSC_PRODUCERS || (v & 0x0FFFFFFF) != next[id])
+        ordered = false;
+      else
+        next[id]++;
+      total++;
+    }
+    else
+      std::this_thread::yield();
+  }
+  for (id = 0; id < MPSC_PRODUCERS; id++)
+    producers[id].join();
+  CHECK(ordered, "MPSC stress lost per-producer ordering");
+  CHECK(rb.empty(), "MPSC not empty at end");
+  printf("mpsc: %u producers, %u items, %.1f Mitems/s\n", MPSC_PRODUCERS,
+         total, total / elapsed(start) / 1e6);
+}
+
+/* Binary semaphore, the notification target of the blocking tests. */
+class BinarySemaphore {
+public:
+  BinarySemaphore() : signaled(false) {}
+
+  static void signal(void *arg) {
+    BinarySemaphore *sp = (BinarySemaphore *)arg;
+    std::lock_guard<std::mutex> lock(sp->mtx);
+
+    sp->signaled = true;
+    sp->cond.notify_one();
+  }
+
+  /* Returns false if nothing was signaled within one second. */
+  bool wait(void) {
+    std::unique_lock<std::mutex> lock(mtx);
+    bool ok = cond.wait_for(lock, std::chrono::seconds(1),
+                            [this] { return signaled; });
+
+    signaled = false;
+    return ok;
+  }
+
+private:
+  std::mutex mtx;
+  std::condition_variable cond;
+  bool signaled;
+};
+
+/* Large items widen the window between the checks of the producer and
+   the publication, the producers pace themselves so that the ring often
+   runs empty and the consumer keeps going to sleep. */
+struct Item {
+  uint32_t v;
+  uint32_t pad[255];
+
+  Item() : v(0) {}
+  Item(uint32_t x) : v(x) {}
+};
+
+static void test_spsc_wakeup(void) {
+  static SpscRing<Item, 4> rb;
+  BinarySemaphore sem;
+  unsigned timeouts = 0;
+  bool ordered = true;
+
+  rb.setNotify(BinarySemaphore::signal, &sem);
+  std::thread producer([] {
+    uint32_t i = 0;
+    while (i < WAKEUP_ITEMS) {
+      if (rb.push(Item(i)))
+        i++;
+      if ((i & 15) == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  uint32_t expected = 0;
+  Item v;
+  while (expected < WAKEUP_ITEMS && timeouts < 3) {
+    if (rb.pop(v)) {
+      if (v.v != expected)
+        ordered = false;
+      expected++;
+    }
+    else if (!sem.wait())
+      timeouts++;
+  }
+  producer.join();
+  CHECK(timeouts == 0, "SPSC consumer missed a wakeup");
+  CHECK(ordered && expected == WAKEUP_ITEMS, "SPSC blocking consumer lost items");
+}
+
+static void test_mpsc_wakeup(void) {
+  static MpscRing<Item, 4> rb;
+  std::vector<std::thread> producers;
+  BinarySemaphore sem;
+  unsigned timeouts = 0;
+  uint32_t total = 0, id;
+  Item v;
+
+  rb.setNotify(BinarySemaphore::signal, &sem);
+  for (id = 0; id < MPSC_PRODUCERS; id++) {
+    producers.push_back(std::thread([id] {
+      uint32_t i = 0;
+      while (i < WAKEUP_ITEMS / MPSC_PRODUCERS) {
+        if (rb.push(Item((id << 28) | i)))
+          i++;
+        if ((i & 15) == 0)
+          std::this_thread::yield();
+      }
+    }));
+  }
+
+  while (total < WAKEUP_ITEMS && timeouts < 3) {
+    if (rb.pop(v))
+      total++;
+    else if (!sem.wait())
+      timeouts++;
+  }
+  for (id = 0; id < MPSC_PRODUCERS; id++)
+    producers[id].join();
+  CHECK(timeouts == 0, "MPSC consumer missed a wakeup");
+  CHECK(total == WAKEUP_ITEMS, "MPSC blocking consumer lost items");
+}
+
+int main(void) {
+
+  test_spsc_basic();
+  test_notify();
+  test_spsc_stress();
+  test_spsc_batch_stress();
+  test_mpsc_stress();
+  test_spsc_wakeup();
+  test_mpsc_wakeup();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * Test of utils/sha1.cpp on the host.
+ *
+ * SHA-1 against the FIPS 180 examples and the one million 'a' message,
+ * the same messages hashed in random pieces must give the same digest.
+ * base64 against the RFC 4648 examples and the handshake example of
+ * RFC 6455. Also gives the SHA-1 throughput of the portable code.
+ **/
+#include "sha1.h"
+#include "check.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+static std::string hex(const uint8_t *p, size_t n) {
+  static const char digits[] = "0123456789abcdef";
+  std::string s;
+
+  for (size_t i = 0; i < n; i++) {
+    s += digits[p[i] >> 4];
+    s += digits[p[i] & 15];
+  }
+  return s;
+}
+
+static std::string digest(const std::string &msg) {
+  uint8_t d[SHA1_DIGEST_SIZE];
+
+  sha1Digest(msg.data(), msg.size(), d);
+  return hex(d, sizeof(d));
+}
+
+static void test_vectors(void) {
+  static const struct {
+    const char *msg, *digest;
+  } vectors[] = {
+    {"", "da39a3ee5e6b4b0d3255bfef95601890afd80709"},
+    {"abc", "a9993e364706816aba3e25717850c26c9cd0d89d"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     "84983e441c3bd26ebaae4aa1f95129e5e54670f1"},
+    {"The quick brown fox jumps over the lazy dog",
+     "2fd4e1c67a2d28fced849ee1bb76e7391b93eb12"},
+  };
+
+  for (const auto &v : vectors)
+    CHECK(digest(v.msg) == v.digest, v.msg);
+  CHECK(digest(std::string(1000000, 'a')) ==
+        "34aa973cd4c4daa4f61eeb2bdbad27316534016f", "million a");
+}
+
+static void test_pieces(void) {
+  std::mt19937 rng(12345);
+  unsigned r;
+
+  for (r = 0; r < 2000 && failures < 10; r++) {
+    std::vector<uint8_t> msg(rng() % 300);
+    uint8_t whole[SHA1_DIGEST_SIZE], parts[SHA1_DIGEST_SIZE];
+    size_t at = 0, n;
+    sha1_t ctx;
+
+    for (auto &b : msg)
+      b = (uint8_t)rng();
+    sha1Digest(msg.data(), msg.size(), whole);
+    sha1Init(&ctx);
+    while (at < msg.size()) {
+      n = rng() % (msg.size() - at + 1);
+      sha1Update(&ctx, msg.data() + at, n);
+      at += n;
+    }
+    sha1Final(&ctx, parts);
+    CHECK(memcmp(whole, parts, sizeof(whole)) == 0, "pieces differ");
+  }
+}
+
+static void test_base64(void) {
+  static const char *vectors[][2] = {
+    {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+    {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+  };
+  static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  uint8_t d[SHA1_DIGEST_SIZE];
+  char out[64];
+  sha1_t ctx;
+
+  for (const auto &v : vectors) {
+    CHECK(base64Encode(out, sizeof(out), v[0], strlen(v[0])) == strlen(v[1]),
+          v[0]);
+    CHECK(strcmp(out, v[1]) == 0, v[1]);
+  }
+  CHECK(base64Encode(out, 9, "foobar", 6) == 8, "exact fit");
+  CHECK(base64Encode(out, 8, "foobar", 6) == 0, "no room for the terminator");
+
+  /* RFC 6455 section 1.3. */
+  sha1Init(&ctx);
+  sha1Update(&ctx, "dGhlIHNhbXBsZSBub25jZQ==", 24);
+  sha1Update(&ctx, guid, sizeof(guid) - 1);
+  sha1Final(&ctx, d);
+  base64Encode(out, sizeof(out), d, sizeof(d));
+  CHECK(strcmp(out, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == 0, "websocket accept");
+}
+
+static void bench(void) {
+  std::vector<uint8_t> buf(1 << 20, 0x5a);
+  uint8_t d[SHA1_DIGEST_SIZE];
+  auto t0 = std::chrono::steady_clock::now();
+  unsigned r;
+
+  for (r = 0; r < 32; r++)
+    sha1Digest(buf.data(), buf.size(), d);
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  printf("sha1: %.1f MB/s\n", 32.0 * buf.size() / dt.count() / 1e6);
+}
+
+int main(void) {
+
+  test_vectors();
+  test_pieces();
+  test_base64();
+  if (!failures)
+    bench();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * Test of web/webassets.c on the host.
+ *
+ * The Accept-Encoding negotiation against the usual browser headers and
+ * the corner cases of RFC 7231 (quality values, *, case, header end),
+ * the content types and the bundle lookup on a hand made table.
+ **/
+#include "webassets.h"
+#include "check.h"
+
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t data[] = {0};
+
+/* Sorted by path, the compressed variant first. */
+extern "C" const webasset_t web_assets[] = {
+  {"/a.css",      data, 1, WEBASSET_GZIP},
+  {"/app.js",     data, 2, WEBASSET_GZIP},
+  {"/app.js",     data, 3, 0},
+  {"/index.html", data, 4, WEBASSET_GZIP},
+  {"/index.html", data, 5, 0},
+  {"/logo.png",   data, 6, 0},
+  {"/z/x.js",     data, 7, WEBASSET_GZIP},
+};
+extern "C" const unsigned web_assets_count =
+  sizeof(web_assets) / sizeof(web_assets[0]);
+
+static bool accepts(const char *ae) {
+  std::string req = "GET / HTTP/1.1\r\nHost: 192.168.0.10\r\n";
+
+  if (ae != NULL)
+    req += std::string("Accept-Encoding: ") + ae + "\r\n";
+  req += "Connection: keep-alive\r\n\r\n";
+  return webAcceptsGzip(req.data(), req.size());
+}
+
+static void test_accept(void) {
+  static const struct {
+    const char *ae;
+    bool gzip;
+  } vectors[] = {
+    {"gzip, deflate, br", true},
+    {"gzip, deflate, br, zstd", true},
+    {"gzip", true},
+    {"GZip", true},
+    {"x-gzip", true},
+    {"deflate, gzip;q=1.0, *;q=0.5", true},
+    {"gzip;q=0.001", true},
+    {"gzip ; q=0.5", true},
+    {"*", true},
+    {"identity", false},
+    {"", false},
+    {"deflate, br", false},
+    {"gzip;q=0", false},
+    {"gzip;q=0.000", false},
+    {"gzip;q=0., *", false},
+    {"*;q=0", false},
+    {"gzip;q=0, *", false},
+    {"*, gzip;q=0", false},
+    {"gzipx, xgzip", false},
+    {"br;q=1, gzip;q=0.8", true},
+  };
+
+  for (const auto &v : vectors)
+    CHECK(accepts(v.ae) == v.gzip, v.ae);
+  CHECK(!accepts(NULL), "no header");
+
+  /* Header name case, bare LF, a header after the end is not read. */
+  static const char lf[] = "GET / HTTP/1.1\naccept-encoding:gzip\n\n";
+  static const char body[] =
+    "GET / HTTP/1.1\r\nHost: x\r\n\r\nAccept-Encoding: gzip\r\n";
+  static const char cut[] = "GET / HTTP/1.1\r\nAccept-Encoding: gz";
+  CHECK(webAcceptsGzip(lf, sizeof(lf) - 1), "lower case name, LF");
+  CHECK(!webAcceptsGzip(body, sizeof(body) - 1), "after the header");
+  CHECK(!webAcceptsGzip(cut, sizeof(cut) - 1), "truncated");
+  CHECK(!webAcceptsGzip(cut, 0), "empty request");
+}
+
+static void test_types(void) {
+  static const char *vectors[][2] = {
+    {"/index.html", "text/html; charset=utf-8"},
+    {"/A.CSS", "text/css"},
+    {"/js/app.js", "application/javascript"},
+    {"/logo.svg", "image/svg+xml"},
+    {"/file", "application/octet-stream"},
+    {"/dir.d/file", "application/octet-stream"},
+    {"/file.", "application/octet-stream"},
+    {"/archive.tar", "application/octet-stream"},
+  };
+
+  for (const auto &v : vectors)
+    CHECK(strcmp(webContentType(v[0], strlen(v[0])), v[1]) == 0, v[0]);
+}
+
+static uint32_t find(const char *path, bool gzip) {
+  const webasset_t *ap = webAssetFind(path, strlen(path), gzip);
+
+  return ap != NULL ? ap->size : 0;
+}
+
+static void test_find(void) {
+
+  CHECK(find("/a.css", true) == 1, "only compressed, gzip");
+  CHECK(find("/a.css", false) == 1, "only compressed, no gzip");
+  CHECK(find("/app.js", true) == 2, "both, gzip");
+  CHECK(find("/app.js", false) == 3, "both, no gzip");
+  CHECK(find("/index.html", true) == 4, "index gzip");
+  CHECK(find("/index.html", false) == 5, "index plain");
+  CHECK(find("/logo.png", true) == 6, "only plain");
+  CHECK(find("/z/x.js", false) == 7, "last entry");
+  CHECK(find("/", true) == 0, "root is not an entry");
+  CHECK(find("/app", true) == 0, "prefix");
+  CHECK(find("/app.jsx", true) == 0, "longer");
+  CHECK(find("/0", true) == 0, "before the first");
+  CHECK(find("/zz", true) == 0, "after the last");
+  CHECK(webAssetFind("/app.js?x", 7, false)->size == 3, "not terminated");
+}
+
+int main(void) {
+
+  test_accept();
+  test_types();
+  test_find();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
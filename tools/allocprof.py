@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Symbolizes the tables of the allocation profiler (utils/allocprof.h).
+
+The input is either the binary stream ("ALP1" header, as written by
+"alloc save" or served at /alloc.bin) or a shell log that contains the
+hex lines printed by "alloc dump". The callers are resolved against the
+firmware ELF with nm (and addr2line for -l), then the per allocator
+totals, the live bytes by call site and by function, the leak
+candidates allocated after "alloc mark" and the heap fragments are
+printed.
+
+usage: allocprof.py [-e elf] [-p prefix] [-n count] [-l] input
+
+  -e elf      firmware image, default build/ch.elf, build-sim/ch for
+              the simulator
+  -p prefix   binutils prefix, default arm-none-eabi- for ARM images
+              and none otherwise
+  -n count    rows listed per table, default 20, 0 for all
+  -l          resolve source lines instead of functions
+"""
+
+import collections
+import getopt
+import struct
+import subprocess
+import sys
+
+from pcprof import EM_ARM, Symbols, elf_machine
+
+HEADER = struct.Struct("<4sIIIIIIIII")
+TOTALS = struct.Struct("<IIIII")
+SITE = struct.Struct("<IB3xIIII")
+BLOCK = struct.Struct("<IIIIIIB3x")
+THREAD = struct.Struct("<I16s")
+FRAG = struct.Struct("<II")
+
+KINDS = ["heap", "pool", "malloc", "any"]
+CALLER_OTHER, CALLER_EXTERNAL = 0, 1
+SPECIAL = {CALLER_OTHER: "[other sites]", CALLER_EXTERNAL: "[host]"}
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"ALP1":
+        return data
+    # Shell log: only the hex lines between the begin/end markers.
+    hexdata, inside = [], False
+    for line in data.decode("ascii", "replace").splitlines():
+        line = line.strip()
+        if line == "-- allocprof begin --":
+            inside = True
+        elif line == "-- allocprof end --":
+            break
+        elif inside and line:
+            hexdata.append(line)
+    return bytes.fromhex("".join(hexdata))
+
+
+def parse(data):
+    fields = HEADER.unpack_from(data, 0)
+    if fields[0] != b"ALP1":
+        raise ValueError("not an allocation profiler dump")
+    hdr = dict(zip(("tick_hz", "seq", "mark", "untracked", "nsites",
+                    "nblocks", "nthreads", "nfrags", "frag_total"),
+                   fields[1:]))
+    off = HEADER.size
+    totals = []
+    for _ in KINDS[:-1]:
+        totals.append(TOTALS.unpack_from(data, off))
+        off += TOTALS.size
+    sites = []
+    for _ in range(hdr["nsites"]):
+        sites.append(SITE.unpack_from(data, off))
+        off += SITE.size
+    blocks = []
+    for _ in range(hdr["nblocks"]):
+        block = BLOCK.unpack_from(data, off)
+        off += BLOCK.size
+        # Padding, the block was released while the table was copied.
+        if block[0] != 0:
+            blocks.append(block)
+    threads = {}
+    for _ in range(hdr["nthreads"]):
+        tp, name = THREAD.unpack_from(data, off)
+        threads[tp] = name.split(b"\0", 1)[0].decode("ascii", "replace")
+        off += THREAD.size
+    frags = []
+    for _ in range(hdr["nfrags"]):
+        frags.append(FRAG.unpack_from(data, off))
+        off += FRAG.size
+    return hdr, totals, sites, blocks, threads, frags
+
+
+def resolve_lines(elf, prefix, syms, callers):
+    """Maps every caller to "function file:line" with a single addr2line,
+    the return address minus one falls within the call instruction."""
+    callers = sorted(c for c in callers if c not in SPECIAL)
+    names = dict(SPECIAL)
+    if not callers:
+        return names
+    out = subprocess.check_output(
+        [prefix + "addr2line", "-f", "-C", "-e", elf] +
+        ["0x%x" % (syms.address(c) - 1) for c in callers],
+        universal_newlines=True).splitlines()
+    for i, c in enumerate(callers):
+        func, line = out[2 * i], out[2 * i + 1]
+        names[c] = "%s %s" % (func, line.rsplit("/", 1)[-1])
+    return names
+
+
+def ranked(rows, limit):
+    rows = sorted(rows, key=lambda r: -r[0])
+    return rows[:limit] if limit > 0 else rows
+
+
+def main(argv):
+    try:
+        opts, args = getopt.getopt(argv[1:], "e:p:n:l")
+    except getopt.GetoptError:
+        opts, args = [], []
+    if len(args) != 1:
+        sys.stderr.write(__doc__)
+        return 2
+    elf, prefix, limit, lines = "build/ch.elf", None, 20, False
+    for opt, val in opts:
+        if opt == "-e":
+            elf = val
+        elif opt == "-p":
+            prefix = val
+        elif opt == "-n":
+            limit = int(val)
+        elif opt == "-l":
+            lines = True
+
+    hdr, totals, sites, blocks, threads, frags = parse(load(args[0]))
+    arm = elf_machine(elf) == EM_ARM
+    if prefix is None:
+        prefix = "arm-none-eabi-" if arm else ""
+    syms = Symbols(elf, prefix, arm)
+    callers = set(s[0] for s in sites)
+    if lines:
+        names = resolve_lines(elf, prefix, syms, callers)
+    else:
+        names = dict((c, SPECIAL.get(c) or syms.lookup(c)) for c in callers)
+
+    out = sys.stdout
+    out.write("%u allocations, mark at %u, %u untracked\n\n"
+              % (hdr["seq"], hdr["mark"], hdr["untracked"]))
+    out.write("%-7s %9s %7s %9s %9s %9s\n"
+              % ("kind", "live", "blocks", "peak", "allocs", "frees"))
+    for kind, (cur, peak, count, allocs, frees) in zip(KINDS, totals):
+        out.write("%-7s %9u %7u %9u %9u %9u\n"
+                  % (kind, cur, count, peak, allocs, frees))
+
+    out.write("\nLive bytes by call site\n")
+    out.write("%9s %7s %9s %9s %-7s %s\n"
+              % ("live", "blocks", "allocs", "frees", "kind", "location"))
+    for row in ranked([(s[2], s) for s in sites], limit):
+        caller, kind, live, count, allocs, frees = row[1]
+        out.write("%9u %7u %9u %9u %-7s %s\n"
+                  % (live, count, allocs, frees, KINDS[kind], names[caller]))
+
+    by_func = collections.Counter()
+    for caller, kind, live, count, allocs, frees in sites:
+        by_func[names[caller].split(" ", 1)[0]] += live
+    out.write("\nLive bytes by function\n")
+    for live, func in ranked([(v, k) for k, v in by_func.items()], limit):
+        out.write("%9u  %s\n" % (live, func))
+
+    by_thread = collections.Counter()
+    for addr, size, caller, tp, ts, seq, kind in blocks:
+        by_thread[tp] += size
+    out.write("\nLive bytes by allocating thread\n")
+    for live, tp in ranked([(v, k) for k, v in by_thread.items()], limit):
+        out.write("%9u  %s (0x%08x)\n" % (live, threads.get(tp, "exited"), tp))
+
+    leaks = [b for b in blocks if b[5] > hdr["mark"]]
+    out.write("\nLeak candidates, %u blocks allocated since the mark\n"
+              % len(leaks))
+    for size, block in ranked([(b[1], b) for b in leaks], limit):
+        addr, size, caller, tp, ts, seq, kind = block
+        out.write("0x%08x %7u %-7s #%-6u %s [%s]\n"
+                  % (addr, size, KINDS[kind], seq, names.get(caller, "?"),
+                     threads.get(tp, "exited")))
+
+    total = sum(f[1] for f in frags)
+    largest = max([f[1] for f in frags] or [0])
+    out.write("\nHeap fragments, %u in the heap" % hdr["frag_total"])
+    if hdr["nfrags"] < hdr["frag_total"]:
+        out.write(", first %u listed" % hdr["nfrags"])
+    out.write("\n")
+    for addr, size in frags:
+        out.write("0x%08x %7u\n" % (addr, size))
+    if total:
+        out.write("%u bytes free, largest %u, %.1f%% fragmented\n"
+                  % (total, largest, 100.0 - 100.0 * largest / total))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
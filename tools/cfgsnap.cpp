@@ -0,0 +1,99 @@
+/**
+ * Builds the configuration snapshot of an INI file on the host.
+ *
+ *   cfgsnap config.ini [config.bin]
+ *
+ * The image is made by the code of the target (utils/cfgimage.cpp)
+ * from the key table of the application (appconfig.cpp), it is the
+ * file that parseconfig() writes after loading config.ini. It is keyed
+ * by the size and the modification time of the INI file, in local time
+ * as FAT stores it, so the INI file must be copied to the card with
+ * its time preserved (cp -p, or a file manager) or parseconfig() will
+ * parse it again and replace the snapshot.
+ *
+ * Built by "make -C test/host".
+ **/
+#include "appconfig.h"
+#include "cfgimage.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static int read_stdio(void *readctx, char *buf, size_t size) {
+  size_t n = fread(buf, 1, size, (FILE *)readctx);
+
+  return ferror((FILE *)readctx) ? -1 : (int)n;
+}
+
+static void report(void *arg, unsigned line, const char *section,
+                   const char *name, const char *msg) {
+  fprintf(stderr, "%s:", (const char *)arg);
+  if (line > 0)
+    fprintf(stderr, "%u:", line);
+  if (*name != '\0')
+    fprintf(stderr, " %s.%s:", section, name);
+  fprintf(stderr, " %s\n", msg);
+}
+
+/* FAT date << 16 | time of a file modification time. */
+static uint32_t fat_time(time_t t) {
+  struct tm *tm = localtime(&t);
+  uint32_t date, tod;
+
+  date = ((uint32_t)(tm->tm_year - 80) << 9) | ((uint32_t)(tm->tm_mon + 1) << 5) |
+         (uint32_t)tm->tm_mday;
+  tod = ((uint32_t)tm->tm_hour << 11) | ((uint32_t)tm->tm_min << 5) |
+        (uint32_t)(tm->tm_sec / 2);
+  return (date << 16) | tod;
+}
+
+int main(int argc, char *argv[]) {
+  static cfgimg_t img;
+  static iniparser_t ip;
+  char out[4096];
+  struct stat st;
+  const char *dot;
+  FILE *f;
+  int errors;
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: cfgsnap config.ini [config.bin]\n");
+    return 2;
+  }
+  if (argc == 3)
+    snprintf(out, sizeof(out), "%s", argv[2]);
+  else {
+    /* Same name as on the target, the extension replaced. */
+    dot = strrchr(argv[1], '.');
+    if (dot == NULL || strchr(dot, '/') != NULL)
+      dot = argv[1] + strlen(argv[1]);
+    snprintf(out, sizeof(out), "%.*s.bin", (int)(dot - argv[1]), argv[1]);
+  }
+
+  if ((f = fopen(argv[1], "rb")) == NULL || fstat(fileno(f), &st) != 0) {
+    perror(argv[1]);
+    if (f != NULL)
+      fclose(f);
+    return 1;
+  }
+  errors = cfgimgParse(&img, appconfig, appconfig_count, &ip, read_stdio, f,
+                       report, argv[1]);
+  fclose(f);
+  if (errors != 0) {
+    fprintf(stderr, "%s: %d error(s), no snapshot written\n", argv[1],
+            errors < 0 ? 1 : errors);
+    return 1;
+  }
+  cfgimgFinish(&img, (uint32_t)st.st_size, fat_time(st.st_mtime));
+
+  if ((f = fopen(out, "wb")) == NULL ||
+      fwrite(&img, 1, img.hdr.size, f) != img.hdr.size || fclose(f) != 0) {
+    perror(out);
+    return 1;
+  }
+  printf("%s: %u keys, %u bytes, seed %u\n", out, (unsigned)img.hdr.nkeys,
+         (unsigned)img.hdr.size, (unsigned)img.hdr.seed);
+  return 0;
+}
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Converts a kernel event trace (utils/evtrace.h) to Chrome trace JSON.
+
+The input is either the binary stream ("EVT1" header, as written by
+"trace save" or served at /trace.bin) or a shell log that contains the
+hex lines printed by "trace dump". The output loads in chrome://tracing
+and in the Perfetto UI.
+
+usage: evtrace2json.py input [output.json]
+"""
+
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<4sIIII")
+THREAD = struct.Struct("<I16s")
+RECORD = struct.Struct("<IIHBB")
+
+SWITCH, IRQ_ENTER, IRQ_LEAVE, MARK = 16, 17, 18, 19
+
+OBJECT_EVENTS = {
+    1: "sem_wait",
+    2: "sem_signal",
+    3: "mtx_lock",
+    4: "mtx_unlock",
+    5: "mb_post",
+    6: "mb_fetch",
+    7: "vt_fire",
+}
+
+PID = 1
+IRQ_TID = 0
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"EVT1":
+        return data
+    # Shell log: only the hex lines between the begin/end markers.
+    hexdata, inside = [], False
+    for line in data.decode("ascii", "replace").splitlines():
+        line = line.strip()
+        if line == "-- evtrace begin --":
+            inside = True
+        elif line == "-- evtrace end --":
+            break
+        elif inside and line:
+            hexdata.append(line)
+    return bytes.fromhex("".join(hexdata))
+
+
+def parse(data):
+    magic, clock_hz, nrecords, nthreads, lost = HEADER.unpack_from(data, 0)
+    if magic != b"EVT1":
+        raise ValueError("not an event trace")
+    off = HEADER.size
+    threads = {}
+    for _ in range(nthreads):
+        tp, name = THREAD.unpack_from(data, off)
+        threads[tp] = name.split(b"\0", 1)[0].decode("ascii", "replace")
+        off += THREAD.size
+    records = []
+    for _ in range(nrecords):
+        records.append(RECORD.unpack_from(data, off))
+        off += RECORD.size
+    return clock_hz, lost, threads, records
+
+
+def convert(clock_hz, lost, threads, records):
+    events = []
+    tids = {}
+
+    def tid_of(tp):
+        if tp not in tids:
+            tids[tp] = len(tids) + 1
+            name = threads.get(tp, "0x%08x" % tp)
+            events.append({"ph": "M", "pid": PID, "tid": tids[tp],
+                           "name": "thread_name", "args": {"name": name}})
+        return tids[tp]
+
+    events.append({"ph": "M", "pid": PID, "tid": IRQ_TID,
+                   "name": "thread_name", "args": {"name": "irq"}})
+    events.append({"ph": "M", "pid": PID, "name": "process_name",
+                   "args": {"name": "chibios (%u records lost)" % lost}})
+
+    # The 32 bits counter wraps, records are in order so unwrap it.
+    base, prev = 0, None
+    running, since = None, None
+    irq_depth = 0
+    ts = 0.0
+    for raw_ts, obj, arg, rtype, _ in records:
+        if prev is not None and raw_ts < prev:
+            base += 1 << 32
+        prev = raw_ts
+        ts = (base + raw_ts) * 1e6 / clock_hz
+
+        if rtype == SWITCH:
+            if running is not None:
+                events.append({"ph": "X", "pid": PID, "tid": tid_of(running),
+                               "name": threads.get(running, "thread"),
+                               "ts": since, "dur": ts - since})
+            running, since = obj, ts
+        elif rtype == IRQ_ENTER:
+            irq_depth += 1
+            events.append({"ph": "B", "pid": PID, "tid": IRQ_TID,
+                           "name": "exc %u" % arg, "ts": ts})
+        elif rtype == IRQ_LEAVE:
+            # The ring may start in the middle of a handler.
+            if irq_depth > 0:
+                irq_depth -= 1
+                events.append({"ph": "E", "pid": PID, "tid": IRQ_TID,
+                               "ts": ts})
+        else:
+            tid = tid_of(running) if running is not None else IRQ_TID
+            if rtype == MARK:
+                name, args = "mark %u" % obj, {"arg": arg}
+            else:
+                name = OBJECT_EVENTS.get(rtype, "event %u" % rtype)
+                if rtype in (1, 2):
+                    arg = arg - 0x10000 if arg & 0x8000 else arg
+                args = {"obj": "0x%08x" % obj, "arg": arg}
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": tid,
+                           "name": name, "ts": ts, "args": args})
+
+    if running is not None:
+        events.append({"ph": "X", "pid": PID, "tid": tid_of(running),
+                       "name": threads.get(running, "thread"),
+                       "ts": since, "dur": ts - since})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write(__doc__)
+        return 2
+    trace = convert(*parse(load(argv[1])))
+    out = open(argv[2], "w") if len(argv) == 3 else sys.stdout
+    json.dump(trace, out)
+    if out is not sys.stdout:
+        out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Compares the latency benchmarks of two test suite logs.
+
+The logs are the shell output of the "test" command, on the board or in
+the simulator. The "--- JSON: " lines printed by the latency sequence
+(ChibiOS/test/rt/testlat.c) are extracted from both logs and the
+average, 99th percentile and maximum are compared benchmark by
+benchmark. The exit status is 1 when the average or the 99th percentile
+of a benchmark grew by more than the threshold.
+
+usage: latcompare.py [-t percent] base.log new.log
+"""
+
+import getopt
+import json
+import sys
+
+PREFIX = "--- JSON: "
+FIELDS = ("avg", "p99", "max")
+CHECKED = ("avg", "p99")
+
+
+def load(path):
+    results = {}
+    with open(path, "rb") as f:
+        for line in f.read().decode("ascii", "replace").splitlines():
+            line = line.strip()
+            if line.startswith(PREFIX):
+                entry = json.loads(line[len(PREFIX):])
+                results[entry["bench"]] = entry
+    return results
+
+
+def change(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float("inf")
+    return 100.0 * (new - old) / old
+
+
+def main(argv):
+    try:
+        opts, args = getopt.getopt(argv[1:], "t:")
+    except getopt.GetoptError:
+        opts, args = [], []
+    if len(args) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+    threshold = 10.0
+    for opt, val in opts:
+        if opt == "-t":
+            threshold = float(val)
+
+    base, new = load(args[0]), load(args[1])
+    if not base or not new:
+        sys.stderr.write("no latency results found\n")
+        return 2
+
+    regressions = 0
+    sys.stdout.write("%-12s %5s %10s %10s %8s\n"
+                     % ("bench", "", "base ns", "new ns", "change"))
+    for bench in sorted(set(base) | set(new)):
+        if bench not in base or bench not in new:
+            sys.stdout.write("%-12s only in %s\n"
+                             % (bench, args[0] if bench in base else args[1]))
+            continue
+        for field in FIELDS:
+            old, cur = base[bench][field], new[bench][field]
+            pct = change(old, cur)
+            flag = ""
+            if field in CHECKED and pct > threshold:
+                flag = "  REGRESSION"
+                regressions += 1
+            sys.stdout.write("%-12s %5s %10u %10u %+7.1f%%%s\n"
+                             % (bench, field, old, cur, pct, flag))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Builds the static asset bundle of the HTTP server (web/webassets.h).
+
+Every file under the input directory becomes an asset whose URL path is
+its path relative to the directory. A file is gzip compressed (level 9,
+no name and no time stamp so that the output is reproducible) and the
+compressed variant is stored when it is smaller than the file by at
+least -m percent, else the file is stored as is. With -p the file is
+also stored uncompressed next to its compressed variant, for the clients
+that do not accept gzip, at the cost of the flash space.
+
+The output is a C source with the data of the assets and the web_assets
+table sorted by path, it only depends on webassets.h.
+
+usage: mkassets.py [-p] [-m percent] [-o output] directory
+
+  -p          keep the uncompressed variant of the compressed files
+  -m percent  minimum saving to store the compressed variant, default 10
+  -o output   C source to write, default standard output
+"""
+
+import getopt
+import gzip
+import io
+import os
+import sys
+
+
+def compress(data):
+    buf = io.BytesIO()
+    with gzip.GzipFile(filename='', mode='wb', compresslevel=9,
+                       fileobj=buf, mtime=0) as f:
+        f.write(data)
+    return buf.getvalue()
+
+
+def scan(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(filenames):
+            if name.startswith('.'):
+                continue
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, root).replace(os.sep, '/')
+            files.append(('/' + rel, full))
+    return files
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def c_bytes(data, out):
+    for i in range(0, len(data), 16):
+        out.write('  ' + ' '.join('0x%02x,' % b for b in data[i:i + 16])
+                  + '\n')
+
+
+def main():
+    plain = False
+    margin = 10
+    output = None
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'pm:o:')
+    except getopt.GetoptError as e:
+        sys.exit('mkassets.py: %s\n%s' % (e, __doc__))
+    for o, a in opts:
+        if o == '-p':
+            plain = True
+        elif o == '-m':
+            margin = int(a)
+        elif o == '-o':
+            output = a
+    if len(args) != 1:
+        sys.exit(__doc__)
+
+    # (path, flags, data), the compressed variant sorts first.
+    assets = []
+    total = stored = 0
+    files = scan(args[0])
+    for path, full in files:
+        with open(full, 'rb') as f:
+            data = f.read()
+        packed = compress(data)
+        total += len(data)
+        if len(packed) * 100 <= len(data) * (100 - margin):
+            assets.append((path, 1, packed))
+            stored += len(packed)
+            if plain:
+                assets.append((path, 0, data))
+                stored += len(data)
+        else:
+            assets.append((path, 0, data))
+            stored += len(data)
+    assets.sort(key=lambda a: (a[0].encode(), -a[1]))
+
+    out = io.StringIO()
+    out.write('/* Generated by tools/mkassets.py from %s, do not edit.\n'
+              '   %d files, %d bytes, %d bytes stored. */\n\n'
+              % (args[0], len(files), total, stored))
+    out.write('#include "webassets.h"\n\n')
+    for i, (path, flags, data) in enumerate(assets):
+        out.write('/* %s%s */\n' % (path, ' (gzip)' if flags else ''))
+        out.write('static const uint8_t asset%d[%d] = {\n'
+                  % (i, max(len(data), 1)))
+        c_bytes(data or b'\0', out)
+        out.write('};\n\n')
+    out.write('const webasset_t web_assets[] = {\n')
+    for i, (path, flags, data) in enumerate(assets):
+        out.write('  {%s, asset%d, %d, %s},\n'
+                  % (c_string(path), i, len(data),
+                     'WEBASSET_GZIP' if flags else '0'))
+    if not assets:
+        out.write('  {"", NULL, 0, 0}\n')
+    out.write('};\n\n')
+    out.write('const unsigned web_assets_count = %d;\n' % len(assets))
+
+    # Written only when changed, so that it is not compiled again.
+    text = out.getvalue()
+    if output is None:
+        sys.stdout.write(text)
+        return
+    try:
+        with open(output) as f:
+            if f.read() == text:
+                return
+    except IOError:
+        pass
+    with open(output, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+"""Symbolizes the samples of the PC profiler (utils/pcprof.h).
+
+The input is either the binary stream ("PRF1" header, as written by
+"prof save" or served at /prof.bin) or a shell log that contains the
+hex lines printed by "prof dump". The sampled PCs are resolved against
+the firmware ELF with nm (and addr2line for -l) and printed as a flat
+profile followed by one profile per thread.
+
+With -r the hottest functions are ranked by samples per byte of code
+and selected until the given RAM budget is used, these are the
+candidates for CH_RAMFUNC/OSAL_RAMFUNC (CORTEX_USE_RAMTEXT). The
+functions already linked in RAM are listed apart. The samples taken in
+interrupt handlers carry no PC, the handlers must be chosen by hand.
+
+usage: pcprof.py [-e elf] [-p prefix] [-n count] [-l] [-r bytes] input
+
+  -e elf      firmware image, default build/ch.elf, build-sim/ch for
+              the simulator
+  -p prefix   binutils prefix, default arm-none-eabi- for ARM images
+              and none otherwise
+  -n count    functions listed per profile, default 20, 0 for all
+  -l          resolve source lines instead of functions
+  -r bytes    list the RAM placement candidates within bytes of code
+"""
+
+import bisect
+import collections
+import getopt
+import struct
+import subprocess
+import sys
+
+HEADER = struct.Struct("<4sIIII")
+THREAD = struct.Struct("<I16s")
+SAMPLE = struct.Struct("<II")
+
+PC_IRQ, PC_EXTERNAL = 0, 1
+SPECIAL = {PC_IRQ: "[interrupt]", PC_EXTERNAL: "[host]"}
+
+EM_ARM = 40
+
+# Start of the SRAM in the ARM images, the code below is in flash.
+ARM_SRAM_BASE = 0x20000000
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] == b"PRF1":
+        return data
+    # Shell log: only the hex lines between the begin/end markers.
+    hexdata, inside = [], False
+    for line in data.decode("ascii", "replace").splitlines():
+        line = line.strip()
+        if line == "-- pcprof begin --":
+            inside = True
+        elif line == "-- pcprof end --":
+            break
+        elif inside and line:
+            hexdata.append(line)
+    return bytes.fromhex("".join(hexdata))
+
+
+def parse(data):
+    magic, rate_hz, nsamples, nthreads, lost = HEADER.unpack_from(data, 0)
+    if magic != b"PRF1":
+        raise ValueError("not a profiler dump")
+    off = HEADER.size
+    threads = {}
+    for _ in range(nthreads):
+        tp, name = THREAD.unpack_from(data, off)
+        threads[tp] = name.split(b"\0", 1)[0].decode("ascii", "replace")
+        off += THREAD.size
+    samples = []
+    for _ in range(nsamples):
+        samples.append(SAMPLE.unpack_from(data, off))
+        off += SAMPLE.size
+    return rate_hz, lost, threads, samples
+
+
+def elf_machine(path):
+    with open(path, "rb") as f:
+        ident = f.read(20)
+    if ident[:4] != b"\x7fELF":
+        raise ValueError("%s is not an ELF file" % path)
+    return struct.unpack_from("<H" if ident[5] == 1 else ">H", ident, 18)[0]
+
+
+class Symbols(object):
+    """Function lookup built from "nm -n -S", PCs of the simulator are
+    offsets from __executable_start, PCs of the target are absolute."""
+
+    def __init__(self, elf, prefix, arm):
+        out = subprocess.check_output(
+            [prefix + "nm", "-n", "-S", "-C", "--defined-only", elf],
+            universal_newlines=True)
+        base = 0
+        funcs = []
+        for line in out.splitlines():
+            fields = line.split(None, 3)
+            if len(fields) == 4:
+                addr, size, kind, name = fields
+                size = int(size, 16)
+            elif len(fields) == 3:
+                addr, kind, name = fields
+                size = None
+            else:
+                continue
+            addr = int(addr, 16)
+            if name == "__executable_start":
+                base = addr
+            if kind not in "TtWw":
+                continue
+            # Thumb symbols have bit 0 set.
+            if arm:
+                addr &= ~1
+            funcs.append((addr, size, name))
+        funcs.sort(key=lambda f: f[0])
+        self.base = 0 if arm else base
+        self.addrs = [f[0] for f in funcs]
+        self.funcs = funcs
+        self.byname = dict((f[2], f) for f in funcs)
+
+    def address(self, pc):
+        return pc + self.base
+
+    def lookup(self, pc):
+        if pc in SPECIAL:
+            return SPECIAL[pc]
+        addr = self.address(pc)
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "[unknown]"
+        start, size, name = self.funcs[i]
+        if size is not None and addr >= start + size:
+            return "[unknown]"
+        return name
+
+
+def resolve_lines(elf, prefix, syms, pcs):
+    """Maps every PC to "function file:line" with a single addr2line."""
+    pcs = sorted(pc for pc in pcs if pc not in SPECIAL)
+    names = dict(SPECIAL)
+    if not pcs:
+        return names
+    out = subprocess.check_output(
+        [prefix + "addr2line", "-f", "-C", "-e", elf] +
+        ["0x%x" % syms.address(pc) for pc in pcs],
+        universal_newlines=True).splitlines()
+    for i, pc in enumerate(pcs):
+        func, line = out[2 * i], out[2 * i + 1]
+        names[pc] = "%s %s" % (func, line.rsplit("/", 1)[-1])
+    return names
+
+
+def report(title, counts, total, limit, out):
+    out.write("\n%s, %u samples\n" % (title, total))
+    out.write("%8s %7s %7s  %s\n" % ("samples", "self", "cumul", "location"))
+    cumul = 0
+    ranked = counts.most_common(limit if limit > 0 else None)
+    for name, n in ranked:
+        cumul += n
+        out.write("%8u %6.2f%% %6.2f%%  %s\n"
+                  % (n, 100.0 * n / total, 100.0 * cumul / total, name))
+
+
+def ram_candidates(syms, counts, budget, arm, out):
+    """Greedy selection by samples per byte, the functions that do not fit
+    are skipped so smaller ones can still use the budget."""
+    rows, in_ram = [], []
+    for name, n in counts.items():
+        func = syms.byname.get(name)
+        if func is None or not func[1]:
+            continue
+        if arm and func[0] >= ARM_SRAM_BASE:
+            in_ram.append((n, func[1], name))
+        else:
+            rows.append((float(n) / func[1], n, func[1], name))
+    rows.sort(key=lambda r: -r[0])
+
+    total = sum(counts.values())
+    out.write("\nRAM candidates within %u bytes\n" % budget)
+    out.write("%8s %7s %7s %7s  %s\n"
+              % ("samples", "self", "size", "cumul", "function"))
+    used = 0
+    for density, n, size, name in rows:
+        if used + size > budget:
+            continue
+        used += size
+        out.write("%8u %6.2f%% %7u %7u  %s\n"
+                  % (n, 100.0 * n / total, size, used, name))
+    if in_ram:
+        out.write("\nAlready in RAM\n")
+        for n, size, name in sorted(in_ram, reverse=True):
+            out.write("%8u %6.2f%% %7u          %s\n"
+                      % (n, 100.0 * n / total, size, name))
+
+
+def main(argv):
+    try:
+        opts, args = getopt.getopt(argv[1:], "e:p:n:lr:")
+    except getopt.GetoptError:
+        opts, args = [], []
+    if len(args) != 1:
+        sys.stderr.write(__doc__)
+        return 2
+    elf, prefix, limit, lines, budget = "build/ch.elf", None, 20, False, None
+    for opt, val in opts:
+        if opt == "-e":
+            elf = val
+        elif opt == "-p":
+            prefix = val
+        elif opt == "-n":
+            limit = int(val)
+        elif opt == "-l":
+            lines = True
+        elif opt == "-r":
+            budget = int(val, 0)
+
+    rate_hz, lost, threads, samples = parse(load(args[0]))
+    if not samples:
+        sys.stderr.write("no samples\n")
+        return 1
+    arm = elf_machine(elf) == EM_ARM
+    if prefix is None:
+        prefix = "arm-none-eabi-" if arm else ""
+    syms = Symbols(elf, prefix, arm)
+    if lines:
+        names = resolve_lines(elf, prefix, syms,
+                              set(pc for pc, _ in samples))
+        name_of = names.get
+    else:
+        cache = {}
+
+        def name_of(pc):
+            if pc not in cache:
+                cache[pc] = syms.lookup(pc)
+            return cache[pc]
+
+    flat = collections.Counter()
+    per_thread = collections.defaultdict(collections.Counter)
+    for pc, tp in samples:
+        name = name_of(pc)
+        flat[name] += 1
+        per_thread[tp][name] += 1
+
+    out = sys.stdout
+    out.write("%u samples at %u Hz (%.2f s), %u dropped\n"
+              % (len(samples), rate_hz,
+                 len(samples) / float(rate_hz) if rate_hz else 0.0, lost))
+    report("Flat profile", flat, len(samples), limit, out)
+    for tp, counts in sorted(per_thread.items(),
+                             key=lambda item: -sum(item[1].values())):
+        if tp == 0:
+            title = "Interrupts"
+        else:
+            title = "Thread %s (0x%08x)" % (threads.get(tp, "exited"), tp)
+        report(title, counts, sum(counts.values()), limit, out)
+    if budget is not None:
+        funcs = collections.Counter()
+        for pc, _ in samples:
+            funcs[syms.lookup(pc)] += 1
+        ram_candidates(syms, funcs, budget, arm, out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
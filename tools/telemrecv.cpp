@@ -0,0 +1,286 @@
+/**
+ * Receives the UDP telemetry of the board and measures the throughput
+ * and the losses.
+ *
+ *   telemrecv [-p port] [-t seconds] [-q]
+ *   telemrecv [-p port] -r capture.pcap
+ *
+ * The datagrams are those of utils/telemetry.h. Every second, and once
+ * more at the end (-t, Ctrl-C or the end of the capture), it prints the
+ * datagrams, samples and payload bytes per second, the sequence numbers
+ * skipped (lost, as a share of the sequence numbers passed), the
+ * datagrams arriving behind the stream (late, reordered or duplicated,
+ * a reordered one was counted as lost when it was skipped) and the
+ * samples the board dropped because its ring was full. -q only prints
+ * the totals.
+ *
+ * With -r the datagrams to the port are read from an Ethernet pcap file
+ * instead, with the capture timestamps, e.g. from tcpdump or from the
+ * SIM_MAC_PCAP_OUT capture of the simulator (see Makefile.sim).
+ *
+ * Built by "make -C test/host".
+ **/
+#include "telemetry.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PCAP_MAGIC      0xA1B2C3D4U
+
+struct counts {
+  uint64_t datagrams;
+  uint64_t samples;
+  uint64_t bytes;
+  uint64_t lost;                /* Sequence numbers skipped.            */
+  uint64_t late;                /* Datagrams behind the stream.         */
+  uint64_t malformed;
+  uint64_t restarts;
+};
+
+struct stream {
+  bool started;
+  uint32_t next;                /* Next expected sequence number.       */
+  uint32_t dropped0;            /* Board drops at the first datagram.   */
+  uint32_t dropped;
+  counts total;
+  counts last;                  /* Totals at the previous report.       */
+  double t0, tlast;
+};
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+  (void)sig;
+  stop = 1;
+}
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void account(stream *s, const uint8_t *buf, size_t len) {
+  telemhdr_t hdr;
+  int32_t gap;
+
+  if (len < sizeof(hdr)) {
+    s->total.malformed++;
+    return;
+  }
+  memcpy(&hdr, buf, sizeof(hdr));
+  if (hdr.magic != TELEM_MAGIC || hdr.size == 0 ||
+      len != sizeof(hdr) + (size_t)hdr.count * hdr.size) {
+    s->total.malformed++;
+    return;
+  }
+  /* Sequence 0 after the stream started: the board restarted. */
+  if (!s->started || (hdr.seq == 0 && s->next != 0)) {
+    if (s->started)
+      s->total.restarts++;
+    s->started = true;
+    s->next = hdr.seq;
+    s->dropped0 = hdr.dropped;
+  }
+  gap = (int32_t)(hdr.seq - s->next);
+  if (gap >= 0) {
+    s->total.lost += (uint32_t)gap;
+    s->next = hdr.seq + 1;
+  }
+  else {
+    /* Counted as lost when skipped, or a duplicate. */
+    s->total.late++;
+  }
+  s->dropped = hdr.dropped;
+  s->total.datagrams++;
+  s->total.samples += hdr.count;
+  s->total.bytes += len;
+}
+
+static void report(stream *s, double t, bool final) {
+  const counts &c = final ? counts() : s->last;
+  double dt = final ? t - s->t0 : t - s->tlast;
+  int64_t dgrams = (int64_t)(s->total.datagrams - c.datagrams);
+  int64_t lost = (int64_t)(s->total.lost - c.lost);
+  int64_t late = (int64_t)(s->total.late - c.late);
+  /* Sequence numbers passed, those received in order and the skipped. */
+  int64_t seqs = dgrams - late + lost;
+
+  if (dt <= 0)
+    dt = 1e-9;
+  printf("%s%7.1fs %8.0f dgram/s %10.0f samples/s %8.3f MB/s "
+         "lost %lld (%.3f%%) late %lld board dropped %u",
+         final ? "total " : "", t - s->t0, dgrams / dt,
+         (s->total.samples - c.samples) / dt,
+         (s->total.bytes - c.bytes) / dt / 1e6, (long long)lost,
+         seqs > 0 ? 100.0 * lost / seqs : 0.0, (long long)late,
+         s->dropped - s->dropped0);
+  if (s->total.malformed > 0 || s->total.restarts > 0)
+    printf(" malformed %llu restarts %llu",
+           (unsigned long long)s->total.malformed,
+           (unsigned long long)s->total.restarts);
+  printf("\n");
+  fflush(stdout);
+  s->last = s->total;
+  s->tlast = t;
+}
+
+static int receive(stream *s, unsigned port, double seconds, bool quiet) {
+  static uint8_t buf[65536];
+  struct sockaddr_in sa;
+  struct pollfd pfd;
+  double t, tnext;
+  int fd, size = 4 << 20;
+  ssize_t n;
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return 1;
+  }
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons((uint16_t)port);
+  sa.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+    perror("bind");
+    close(fd);
+    return 1;
+  }
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  s->t0 = s->tlast = now();
+  tnext = s->t0 + 1;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while (!stop) {
+    t = now();
+    if (seconds > 0 && t - s->t0 >= seconds)
+      break;
+    if (t >= tnext) {
+      if (!quiet)
+        report(s, t, false);
+      tnext += 1;
+    }
+    if (poll(&pfd, 1, (int)((tnext - t) * 1000) + 1) <= 0)
+      continue;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) >= 0)
+      account(s, buf, (size_t)n);
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      perror("recv");
+      break;
+    }
+  }
+  close(fd);
+  report(s, now(), true);
+  return 0;
+}
+
+static uint16_t be16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static int replay(stream *s, unsigned port, const char *name, bool quiet) {
+  static uint8_t buf[65536];
+  struct {
+    uint32_t magic;
+    uint16_t major, minor;
+    int32_t zone;
+    uint32_t sigfigs, snaplen, network;
+  } hdr;
+  struct {
+    uint32_t sec, usec, incl, orig;
+  } rec;
+  const uint8_t *ip, *udp;
+  double t = 0, tnext = 0;
+  bool first = true;
+  size_t hlen;
+  FILE *f;
+
+  if ((f = fopen(name, "rb")) == NULL) {
+    perror(name);
+    return 1;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != PCAP_MAGIC ||
+      hdr.network != 1) {
+    fprintf(stderr, "%s: not an Ethernet pcap file\n", name);
+    fclose(f);
+    return 1;
+  }
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    if (rec.incl > sizeof(buf) || fread(buf, 1, rec.incl, f) != rec.incl)
+      break;
+    t = rec.sec + rec.usec / 1e6;
+    if (first) {
+      s->t0 = s->tlast = t;
+      tnext = t + 1;
+      first = false;
+    }
+    while (t >= tnext) {
+      if (!quiet)
+        report(s, tnext, false);
+      tnext += 1;
+    }
+    /* Ethernet, IPv4 without fragments, UDP to the port. */
+    if (rec.incl < 14 + 20 + 8 || be16(buf + 12) != 0x0800)
+      continue;
+    ip = buf + 14;
+    hlen = (ip[0] & 0x0F) * 4U;
+    if ((ip[0] >> 4) != 4 || ip[9] != 17 || (be16(ip + 6) & 0x3FFF) != 0 ||
+        14 + hlen + 8 > rec.incl)
+      continue;
+    udp = ip + hlen;
+    if (be16(udp + 2) != port || be16(udp + 4) < 8 ||
+        14 + hlen + be16(udp + 4) > rec.incl)
+      continue;
+    account(s, udp + 8, be16(udp + 4) - 8U);
+  }
+  fclose(f);
+  report(s, t, true);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  static stream s;
+  const char *capture = NULL;
+  unsigned port = TELEM_DEFAULT_PORT;
+  double seconds = 0;
+  bool quiet = false;
+  int c;
+
+  while ((c = getopt(argc, argv, "p:t:r:q")) != -1) {
+    switch (c) {
+    case 'p':
+      port = (unsigned)atoi(optarg);
+      break;
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      capture = optarg;
+      break;
+    case 'q':
+      quiet = true;
+      break;
+    default:
+      fprintf(stderr, "usage: telemrecv [-p port] [-t seconds] [-q] "
+                      "[-r capture.pcap]\n");
+      return 2;
+    }
+  }
+  if (capture != NULL)
+    return replay(&s, port, capture, quiet);
+  return receive(&s, port, seconds, quiet);
+}
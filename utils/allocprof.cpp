@@ -0,0 +1,557 @@
+#include "ch.h"
+#include "allocprof.h"
+
+#include <string.h>
+
+#define BLOCKS_MASK     (ALLOCPROF_MAX_BLOCKS - 1)
+#define BLOCKS_LIMIT    (ALLOCPROF_MAX_BLOCKS / 4 * 3)
+#define SITES_HASH      (ALLOCPROF_MAX_SITES * 2)
+#define SITE_OTHER      (ALLOCPROF_MAX_SITES - 1)
+
+#if (ALLOCPROF_MAX_BLOCKS & BLOCKS_MASK) != 0
+#error "ALLOCPROF_MAX_BLOCKS must be a power of two"
+#endif
+
+#if (ALLOCPROF_MAX_SITES & (ALLOCPROF_MAX_SITES - 1)) != 0
+#error "ALLOCPROF_MAX_SITES must be a power of two"
+#endif
+
+#if ALLOCPROF_MAX_SITES > 255
+#error "ALLOCPROF_MAX_SITES does not fit the site_index entries"
+#endif
+
+#if !CH_CFG_USE_HEAP
+#error "the allocation profiler requires CH_CFG_USE_HEAP"
+#endif
+
+/**
+ * Live block, p is NULL for a free slot. The table uses linear probing
+ * with backward shift deletion, so a lookup stops at the first free
+ * slot and no tombstones accumulate.
+ **/
+struct block {
+    void *p;
+    uint32_t size;
+    uint32_t tp;
+    uint32_t ts;
+    uint32_t seq;
+    uint16_t site;
+    uint8_t kind;
+};
+
+/**
+ * The call sites are stored in creation order, site_index maps the
+ * hash of (caller, kind) to the site number plus one. All the tables
+ * are only accessed with the kernel locked.
+ **/
+static struct block blocks[ALLOCPROF_MAX_BLOCKS];
+static unsigned nblocks;
+static allocprof_site_t sites[ALLOCPROF_MAX_SITES];
+static uint8_t site_index[SITES_HASH];
+static unsigned nsites;
+static allocprof_totals_t totals[ALLOCPROF_KINDS];
+static uint32_t seq;
+static uint32_t mark;
+static uint32_t untracked;
+static bool active;
+
+/* Only used with scratchmtx held, the shell and the HTTP server can
+   draw the map or dump at the same time. */
+static MUTEX_DECL(scratchmtx);
+static allocprof_site_t snap[ALLOCPROF_MAX_SITES];
+static allocprof_frag_t frags[ALLOCPROF_MAX_FRAGS];
+static allocprof_thread_t threads[ALLOCPROF_MAX_THREADS];
+
+#if defined(SIMULATOR)
+/* Callers are stored relative to the image start, see pcprof.cpp. */
+extern "C" char __executable_start[], etext[];
+
+static inline uint32_t caller_addr(const void *caller)
+{
+    uintptr_t pc = (uintptr_t)caller;
+
+    if ((pc >= (uintptr_t)__executable_start) && (pc < (uintptr_t)etext))
+        return (uint32_t)(pc - (uintptr_t)__executable_start);
+    return ALLOCPROF_CALLER_EXTERNAL;
+}
+#else
+static inline uint32_t caller_addr(const void *caller)
+{
+    return (uint32_t)(uintptr_t)caller;
+}
+#endif
+
+static inline unsigned hash32(uint32_t k)
+{
+    return (unsigned)((k * 2654435761U) >> 16);
+}
+
+static inline unsigned block_slot(const void *p)
+{
+    return hash32((uint32_t)((uintptr_t)p >> 3)) & BLOCKS_MASK;
+}
+
+static unsigned site_get(uint32_t caller, unsigned kind)
+{
+    unsigned h = hash32(caller ^ kind) & (SITES_HASH - 1);
+    allocprof_site_t *sp;
+
+    while (site_index[h] != 0) {
+        sp = &sites[site_index[h] - 1];
+        if ((sp->caller == caller) && (sp->kind == kind))
+            return site_index[h] - 1;
+        h = (h + 1) & (SITES_HASH - 1);
+    }
+    if (nsites >= SITE_OTHER) {
+        /* Table full, the last entry collects all the new callers. */
+        if (nsites == SITE_OTHER) {
+            sites[SITE_OTHER].caller = ALLOCPROF_CALLER_OTHER;
+            sites[SITE_OTHER].kind = ALLOCPROF_KINDS;
+            nsites++;
+        }
+        return SITE_OTHER;
+    }
+    sp = &sites[nsites];
+    sp->caller = caller;
+    sp->kind = (uint8_t)kind;
+    site_index[h] = (uint8_t)(++nsites);
+    return nsites - 1;
+}
+
+static void block_release(unsigned i)
+{
+    struct block *bp = &blocks[i];
+    allocprof_site_t *sp = &sites[bp->site];
+    allocprof_totals_t *tot = &totals[bp->kind];
+    unsigned j, k;
+
+    sp->live_bytes -= bp->size;
+    sp->live_count--;
+    sp->frees++;
+    tot->cur_bytes -= bp->size;
+    tot->cur_count--;
+    tot->frees++;
+    nblocks--;
+
+    /* Moves back the following entries that are not at their home slot
+       or after it, up to the first free slot.*/
+    j = i;
+    while (true) {
+        j = (j + 1) & BLOCKS_MASK;
+        if (blocks[j].p == NULL)
+            break;
+        k = block_slot(blocks[j].p);
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+            continue;
+        blocks[i] = blocks[j];
+        i = j;
+    }
+    blocks[i].p = NULL;
+}
+
+static int block_find(const void *p)
+{
+    unsigned i = block_slot(p);
+
+    while (blocks[i].p != NULL) {
+        if (blocks[i].p == p)
+            return (int)i;
+        i = (i + 1) & BLOCKS_MASK;
+    }
+    return -1;
+}
+
+/**
+ * Allocation hook, invoked by the heap and pools thread API and by the
+ * malloc wrappers from thread context, with or without the kernel
+ * locked.
+ **/
+void _allocprof_alloc(unsigned kind, void *p, size_t size, const void *caller)
+{
+    uint32_t c = caller_addr(caller);
+    allocprof_totals_t *tot = &totals[kind];
+    struct block *bp;
+    syssts_t sts;
+    unsigned site;
+    int i;
+
+    if (!active || (p == NULL))
+        return;
+
+    sts = chSysGetStatusAndLockX();
+    /* A stale entry, the block was released through an untracked path
+       (chPoolFreeI(), newlib internals). */
+    i = block_find(p);
+    if (i >= 0)
+        block_release((unsigned)i);
+    if (nblocks >= BLOCKS_LIMIT) {
+        untracked++;
+        chSysRestoreStatusX(sts);
+        return;
+    }
+    site = site_get(c, kind);
+    i = (int)block_slot(p);
+    while (blocks[i].p != NULL)
+        i = (i + 1) & BLOCKS_MASK;
+    bp = &blocks[i];
+    bp->p = p;
+    bp->size = (uint32_t)size;
+    bp->tp = (uint32_t)(uintptr_t)chThdGetSelfX();
+    bp->ts = (uint32_t)chVTGetSystemTimeX();
+    bp->seq = ++seq;
+    bp->site = (uint16_t)site;
+    bp->kind = (uint8_t)kind;
+    nblocks++;
+
+    sites[site].live_bytes += (uint32_t)size;
+    sites[site].live_count++;
+    sites[site].allocs++;
+    tot->cur_bytes += (uint32_t)size;
+    tot->cur_count++;
+    tot->allocs++;
+    if (tot->cur_bytes > tot->peak_bytes)
+        tot->peak_bytes = tot->cur_bytes;
+    chSysRestoreStatusX(sts);
+}
+
+/**
+ * Release hook, unknown blocks are ignored.
+ **/
+void _allocprof_free(unsigned kind, void *p)
+{
+    syssts_t sts;
+    int i;
+
+    (void)kind;
+    if (!active || (p == NULL))
+        return;
+
+    sts = chSysGetStatusAndLockX();
+    i = block_find(p);
+    if (i >= 0)
+        block_release((unsigned)i);
+    chSysRestoreStatusX(sts);
+}
+
+/*
+ * Link time wrappers of the malloc family, see the --wrap options in the
+ * makefiles. realloc() is recorded as a release and a new allocation.
+ */
+extern "C" {
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t nmemb, size_t n);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n)
+{
+    void *p = __real_malloc(n);
+
+#if ALLOCPROF_ENABLED
+    _allocprof_alloc(ALLOCPROF_MALLOC, p, n, __builtin_return_address(0));
+#endif
+    return p;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t n)
+{
+    void *p = __real_calloc(nmemb, n);
+
+#if ALLOCPROF_ENABLED
+    _allocprof_alloc(ALLOCPROF_MALLOC, p, nmemb * n,
+                     __builtin_return_address(0));
+#endif
+    return p;
+}
+
+void *__wrap_realloc(void *p, size_t n)
+{
+    void *q = __real_realloc(p, n);
+
+#if ALLOCPROF_ENABLED
+    if ((q != NULL) || (n == 0))
+        _allocprof_free(ALLOCPROF_MALLOC, p);
+    _allocprof_alloc(ALLOCPROF_MALLOC, q, n, __builtin_return_address(0));
+#endif
+    return q;
+}
+
+void __wrap_free(void *p)
+{
+#if ALLOCPROF_ENABLED
+    _allocprof_free(ALLOCPROF_MALLOC, p);
+#endif
+    __real_free(p);
+}
+}
+
+/**
+ * Starts recording, to be invoked once after the kernel initialization.
+ **/
+void allocprofInit(void)
+{
+    chSysLock();
+    active = ALLOCPROF_ENABLED;
+    chSysUnlock();
+}
+
+/**
+ * Marks the start of a leak detection interval, the blocks allocated
+ * from now on and still live are reported by "alloc leaks".
+ **/
+void allocprofMark(void)
+{
+    chSysLock();
+    mark = seq;
+    chSysUnlock();
+}
+
+/**
+ * Restarts the peaks from the current usage and clears the allocation
+ * and release counts, the live blocks are kept.
+ **/
+void allocprofResetPeaks(void)
+{
+    unsigned i;
+
+    chSysLock();
+    for (i = 0; i < ALLOCPROF_KINDS; i++) {
+        totals[i].peak_bytes = totals[i].cur_bytes;
+        totals[i].allocs = 0;
+        totals[i].frees = 0;
+    }
+    for (i = 0; i < nsites; i++) {
+        sites[i].allocs = 0;
+        sites[i].frees = 0;
+    }
+    untracked = 0;
+    chSysUnlock();
+}
+
+/**
+ * Copies the per allocator totals, an array of ALLOCPROF_KINDS
+ * elements. Returns the allocation sequence number, mark and untracked
+ * receive the mark and the number of allocations not recorded, either
+ * can be NULL.
+ **/
+uint32_t allocprofGetTotals(allocprof_totals_t *tot, uint32_t *markp,
+                            uint32_t *untrackedp)
+{
+    uint32_t n;
+
+    chSysLock();
+    memcpy(tot, totals, sizeof(totals));
+    if (markp != NULL)
+        *markp = mark;
+    if (untrackedp != NULL)
+        *untrackedp = untracked;
+    n = seq;
+    chSysUnlock();
+    return n;
+}
+
+/**
+ * Copies up to n call sites in creation order, returns their number.
+ **/
+size_t allocprofGetSites(allocprof_site_t *dst, size_t n)
+{
+    chSysLock();
+    if (n > nsites)
+        n = nsites;
+    memcpy(dst, sites, n * sizeof(allocprof_site_t));
+    chSysUnlock();
+    return n;
+}
+
+/**
+ * Copies the next live block from the slot *cursor on, initially zero,
+ * and advances the cursor. Returns zero once the table is exhausted.
+ * Each block is copied atomically, the table itself can change between
+ * two calls.
+ **/
+int allocprofNextBlock(unsigned *cursor, allocprof_block_t *bp)
+{
+    unsigned i;
+
+    chSysLock();
+    for (i = *cursor; i < ALLOCPROF_MAX_BLOCKS; i++) {
+        const struct block *sp = &blocks[i];
+
+        if (sp->p != NULL) {
+            bp->addr = (uint32_t)(uintptr_t)sp->p;
+            bp->size = sp->size;
+            bp->caller = sites[sp->site].caller;
+            bp->tp = sp->tp;
+            bp->ts = sp->ts;
+            bp->seq = sp->seq;
+            bp->kind = sp->kind;
+            memset(bp->pad, 0, sizeof(bp->pad));
+            chSysUnlock();
+            *cursor = i + 1;
+            return 1;
+        }
+    }
+    chSysUnlock();
+    *cursor = i;
+    return 0;
+}
+
+/**
+ * Copies up to n free fragments of the default heap in address order,
+ * returns the number of fragments in the heap.
+ **/
+size_t allocprofGetFrags(allocprof_frag_t *dst, size_t n)
+{
+    heap_fragment_t hf[ALLOCPROF_MAX_FRAGS];
+    size_t i, total;
+
+    if (n > ALLOCPROF_MAX_FRAGS)
+        n = ALLOCPROF_MAX_FRAGS;
+    total = chHeapGetFragments(NULL, hf, n);
+    for (i = 0; (i < n) && (i < total); i++) {
+        dst[i].addr = (uint32_t)(uintptr_t)hf[i].hf_addr;
+        dst[i].size = (uint32_t)hf[i].hf_size;
+    }
+    return total;
+}
+
+static void map_mark(char *map, unsigned cells, uint32_t base,
+                     uint32_t cellsize, uint32_t addr, uint32_t size,
+                     char bit)
+{
+    unsigned first, last;
+
+    if (size == 0)
+        return;
+    first = (addr - base) / cellsize;
+    last = (addr + size - 1 - base) / cellsize;
+    while ((first <= last) && (first < cells))
+        map[first++] |= bit;
+}
+
+/**
+ * Draws a map of the default heap, one character per cell: '#' only
+ * live heap blocks, '.' only free fragments, ':' both and ' ' neither,
+ * headers and memory taken from the core allocator by other users.
+ * The map spans from the lowest to the highest address of the recorded
+ * heap blocks and the free fragments, base and cellsize receive the
+ * start address and the bytes per cell. Returns zero when there is
+ * nothing to draw.
+ **/
+int allocprofMap(char *map, unsigned cells, uint32_t *base,
+                 uint32_t *cellsize)
+{
+    allocprof_block_t b;
+    uint32_t lo = 0xFFFFFFFFU, hi = 0, cs;
+    unsigned cursor, i;
+    size_t nfrags;
+
+    chMtxLock(&scratchmtx);
+    nfrags = allocprofGetFrags(frags, ALLOCPROF_MAX_FRAGS);
+    if (nfrags > ALLOCPROF_MAX_FRAGS)
+        nfrags = ALLOCPROF_MAX_FRAGS;
+    for (i = 0; i < nfrags; i++) {
+        if (frags[i].addr < lo)
+            lo = frags[i].addr;
+        if (frags[i].addr + frags[i].size > hi)
+            hi = frags[i].addr + frags[i].size;
+    }
+    cursor = 0;
+    while (allocprofNextBlock(&cursor, &b)) {
+        if (b.kind != ALLOCPROF_HEAP)
+            continue;
+        if (b.addr < lo)
+            lo = b.addr;
+        if (b.addr + b.size > hi)
+            hi = b.addr + b.size;
+    }
+    if ((cells == 0) || (hi <= lo)) {
+        chMtxUnlock(&scratchmtx);
+        return 0;
+    }
+
+    cs = (hi - lo + cells - 1) / cells;
+    memset(map, 0, cells);
+    for (i = 0; i < nfrags; i++)
+        map_mark(map, cells, lo, cs, frags[i].addr, frags[i].size, 1);
+    chMtxUnlock(&scratchmtx);
+    cursor = 0;
+    while (allocprofNextBlock(&cursor, &b)) {
+        if (b.kind == ALLOCPROF_HEAP)
+            map_mark(map, cells, lo, cs, b.addr, b.size, 2);
+    }
+    for (i = 0; i < cells; i++)
+        map[i] = " .#:"[(unsigned)map[i] & 3U];
+    *base = lo;
+    *cellsize = cs;
+    return 1;
+}
+
+/**
+ * Writes the header, the call sites, the live blocks, the thread table
+ * and the heap fragments through the out callback. Recording goes on
+ * meanwhile, the sites and totals are a consistent snapshot while the
+ * blocks are copied one at a time. Concurrent dumps and maps wait for
+ * each other. Returns zero on success or the first non zero value
+ * returned by the callback.
+ **/
+int allocprofSerialize(allocprof_write_t out, void *ctx)
+{
+    allocprof_header_t hdr;
+    allocprof_block_t b;
+    unsigned cursor;
+    thread_t *tp;
+    int err;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "ALP1", 4);
+    hdr.tick_hz = CH_CFG_ST_FREQUENCY;
+
+    chMtxLock(&scratchmtx);
+    chSysLock();
+    hdr.seq = seq;
+    hdr.mark = mark;
+    hdr.untracked = untracked;
+    hdr.nsites = nsites;
+    hdr.nblocks = nblocks;
+    memcpy(hdr.totals, totals, sizeof(totals));
+    memcpy(snap, sites, nsites * sizeof(allocprof_site_t));
+    chSysUnlock();
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+        if (hdr.nthreads < ALLOCPROF_MAX_THREADS) {
+            allocprof_thread_t *atp = &threads[hdr.nthreads++];
+            const char *name = chRegGetThreadNameX(tp);
+
+            atp->tp = (uint32_t)(uintptr_t)tp;
+            memset(atp->name, 0, sizeof(atp->name));
+            if (name != NULL)
+                strncpy(atp->name, name, sizeof(atp->name) - 1);
+        }
+        tp = chRegNextThread(tp);
+    }
+
+    hdr.frag_total = (uint32_t)allocprofGetFrags(frags, ALLOCPROF_MAX_FRAGS);
+    hdr.nfrags = hdr.frag_total < ALLOCPROF_MAX_FRAGS ?
+                 hdr.frag_total : ALLOCPROF_MAX_FRAGS;
+
+    /* The blocks count is only known once they are copied, the header
+       announces the blocks present at the snapshot and the stream is
+       padded or truncated to match.*/
+    err = out(ctx, &hdr, sizeof(hdr));
+    if (!err && hdr.nsites)
+        err = out(ctx, snap, hdr.nsites * sizeof(allocprof_site_t));
+    cursor = 0;
+    for (uint32_t n = 0; !err && (n < hdr.nblocks); n++) {
+        if (!allocprofNextBlock(&cursor, &b))
+            memset(&b, 0, sizeof(b));
+        err = out(ctx, &b, sizeof(b));
+    }
+    if (!err && hdr.nthreads)
+        err = out(ctx, threads, hdr.nthreads * sizeof(allocprof_thread_t));
+    if (!err && hdr.nfrags)
+        err = out(ctx, frags, hdr.nfrags * sizeof(allocprof_frag_t));
+    chMtxUnlock(&scratchmtx);
+    return err;
+}
@@ -0,0 +1,207 @@
+#ifndef __ALLOCPROF_H__
+#define __ALLOCPROF_H__
+
+/**
+ * Allocation profiler.
+ *
+ * Every chHeapAlloc()/chHeapFree(), chPoolAlloc()/chPoolFree() and
+ * malloc()/calloc()/realloc()/free() is recorded with the caller
+ * address, the size, the current thread and a system time stamp. The
+ * live blocks are kept in an open addressing table keyed by address,
+ * each one refers to a call site entry that accumulates the live bytes
+ * and the allocation and release counts, so an update is a short hash
+ * probe under the kernel lock.
+ *
+ * allocprofMark() stores the current allocation sequence number, the
+ * blocks still live with a greater number are the leak candidates of
+ * the marked interval.
+ *
+ * The heap and pool hooks are wired in chconf.h, the malloc family is
+ * wrapped at link time (--wrap=malloc,...), newlib internal _malloc_r()
+ * users are not seen. Recording starts with allocprofInit(), blocks
+ * allocated before are ignored when released.
+ *
+ * The tables are serialized as: a header, the call sites, the live
+ * blocks, a table of the registered threads and the free fragments of
+ * the default heap, see tools/allocprof.py for the symbolization.
+ *
+ * This header is included from chconf.h so it must stay plain C and
+ * must not depend on the kernel types.
+ **/
+
+/**
+ * Set to FALSE in order to remove the heap and pool hooks, the malloc
+ * wrappers then only forward the calls.
+ **/
+#if !defined(ALLOCPROF_ENABLED)
+#define ALLOCPROF_ENABLED       TRUE
+#endif
+
+/**
+ * Live blocks table size, must be a power of two. It is filled up to
+ * three quarters, the further allocations are only counted.
+ **/
+#if !defined(ALLOCPROF_MAX_BLOCKS)
+#define ALLOCPROF_MAX_BLOCKS    256
+#endif
+
+/**
+ * Number of call sites, the last one collects the callers that do not
+ * fit.
+ **/
+#if !defined(ALLOCPROF_MAX_SITES)
+#define ALLOCPROF_MAX_SITES     64
+#endif
+
+/**
+ * Maximum number of heap fragments and threads stored in a dump.
+ **/
+#if !defined(ALLOCPROF_MAX_FRAGS)
+#define ALLOCPROF_MAX_FRAGS     32
+#endif
+
+#if !defined(ALLOCPROF_MAX_THREADS)
+#define ALLOCPROF_MAX_THREADS   24
+#endif
+
+/**
+ * Allocators, the first two match CH_TRACE_ALLOC_HEAP and
+ * CH_TRACE_ALLOC_POOL.
+ **/
+#define ALLOCPROF_HEAP          0U
+#define ALLOCPROF_POOL          1U
+#define ALLOCPROF_MALLOC        2U
+#define ALLOCPROF_KINDS         3U
+
+/**
+ * Special caller values, neither is a valid return address.
+ **/
+#define ALLOCPROF_CALLER_OTHER  0U      /* Call sites table full.       */
+#define ALLOCPROF_CALLER_EXTERNAL 1U    /* Simulator only, host code
+                                           outside the firmware image.  */
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Per allocator totals.
+ **/
+typedef struct {
+  uint32_t cur_bytes;           /* Live bytes.                          */
+  uint32_t peak_bytes;          /* High-water mark of cur_bytes.        */
+  uint32_t cur_count;           /* Live blocks.                         */
+  uint32_t allocs;              /* Recorded allocations.                */
+  uint32_t frees;               /* Recorded releases.                   */
+} allocprof_totals_t;
+
+/**
+ * Call site, 24 bytes, little endian on the wire. In the simulator
+ * caller is the offset from the start of the executable image.
+ **/
+typedef struct {
+  uint32_t caller;              /* Return address or ALLOCPROF_CALLER_xxx. */
+  uint8_t kind;                 /* ALLOCPROF_xxx allocator.             */
+  uint8_t pad[3];
+  uint32_t live_bytes;
+  uint32_t live_count;
+  uint32_t allocs;
+  uint32_t frees;
+} allocprof_site_t;
+
+/**
+ * Live block, 28 bytes on the wire.
+ **/
+typedef struct {
+  uint32_t addr;
+  uint32_t size;                /* Requested size.                      */
+  uint32_t caller;
+  uint32_t tp;                  /* Allocating thread.                   */
+  uint32_t ts;                  /* System time of the allocation.       */
+  uint32_t seq;                 /* Allocation sequence number.          */
+  uint8_t kind;
+  uint8_t pad[3];
+} allocprof_block_t;
+
+/**
+ * Heap fragment, 8 bytes on the wire.
+ **/
+typedef struct {
+  uint32_t addr;
+  uint32_t size;
+} allocprof_frag_t;
+
+/**
+ * Serialized stream header.
+ **/
+typedef struct {
+  char magic[4];                /* "ALP1".                              */
+  uint32_t tick_hz;             /* Time stamps frequency.               */
+  uint32_t seq;                 /* Allocations recorded.                */
+  uint32_t mark;                /* Sequence number at the mark.         */
+  uint32_t untracked;           /* Allocations not recorded, table full. */
+  uint32_t nsites;
+  uint32_t nblocks;
+  uint32_t nthreads;
+  uint32_t nfrags;              /* Fragments following, at most
+                                   ALLOCPROF_MAX_FRAGS.                 */
+  uint32_t frag_total;          /* Fragments in the heap.               */
+  allocprof_totals_t totals[ALLOCPROF_KINDS];
+} allocprof_header_t;
+
+/**
+ * Serialized thread table entry.
+ **/
+typedef struct {
+  uint32_t tp;
+  char name[16];
+} allocprof_thread_t;
+
+/**
+ * Output callback used by allocprofSerialize(), returns zero on success.
+ **/
+typedef int (*allocprof_write_t)(void *ctx, const void *buf, size_t n);
+
+#if ALLOCPROF_ENABLED
+void _allocprof_alloc(unsigned kind, void *p, size_t size,
+                      const void *caller);
+void _allocprof_free(unsigned kind, void *p);
+#endif
+
+void allocprofInit(void);
+void allocprofMark(void);
+void allocprofResetPeaks(void);
+uint32_t allocprofGetTotals(allocprof_totals_t *totals, uint32_t *mark,
+                            uint32_t *untracked);
+size_t allocprofGetSites(allocprof_site_t *sites, size_t n);
+int allocprofNextBlock(unsigned *cursor, allocprof_block_t *bp);
+size_t allocprofGetFrags(allocprof_frag_t *frags, size_t n);
+int allocprofMap(char *map, unsigned cells, uint32_t *base,
+                 uint32_t *cellsize);
+int allocprofSerialize(allocprof_write_t out, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+/**
+ * Hook bodies used by chconf.h, expanded inside the allocator so that
+ * the return address is the one of its caller.
+ **/
+#if ALLOCPROF_ENABLED
+#define ALLOCPROF_ALLOC_HOOK(src, p, size)                                  \
+  _allocprof_alloc(src, p, size, __builtin_return_address(0))
+#define ALLOCPROF_FREE_HOOK(src, p)         _allocprof_free(src, p)
+#else
+#define ALLOCPROF_ALLOC_HOOK(src, p, size)
+#define ALLOCPROF_FREE_HOOK(src, p)
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "bench.h"
+#include "cycles.h"
+
+#include <string.h>
+
+#define BENCH_MAX_CASES     16
+
+static uint32_t timed_run(const bench_case_t *bcp, uint32_t n,
+                          uint64_t *units)
+{
+    rtcnt_t start = chSysGetRealtimeCounterX();
+
+    *units = bcp->run(n);
+    return (uint32_t)(chSysGetRealtimeCounterX() - start);
+}
+
+static uint32_t ns_per_iter(uint32_t cycles, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)cycles * 1000000000ULL) /
+                      ((uint64_t)CYCLES_CLOCK_HZ * n));
+}
+
+/* Split so that units * CYCLES_CLOCK_HZ cannot overflow. */
+static uint64_t per_second(uint64_t units, uint32_t cycles)
+{
+    if (cycles == 0)
+        return 0;
+    return (units / cycles) * CYCLES_CLOCK_HZ +
+           ((units % cycles) * CYCLES_CLOCK_HZ) / cycles;
+}
+
+/**
+ * Calibrates and times one case, returns zero on success or -1 when
+ * the case setup failed.
+ **/
+int benchRun(const bench_case_t *bcp, bench_result_t *brp)
+{
+    const uint32_t target = (CYCLES_CLOCK_HZ / 1000U) * BENCH_TARGET_MS;
+    uint32_t runs[BENCH_REPEATS];
+    uint32_t n = 1, t;
+    uint64_t units;
+    unsigned i, j;
+    tprio_t prio;
+
+    if ((bcp->setup != NULL) && (bcp->setup() != 0))
+        return -1;
+    prio = chThdSetPriority(BENCH_PRIORITY);
+
+    /* Calibration, it also warms up the caches and the heap. */
+    while (((t = timed_run(bcp, n, &units)) < target) && (n < 0x40000000U))
+        n <<= 1;
+
+    for (i = 0; i < BENCH_REPEATS; i++) {
+        t = timed_run(bcp, n, &units);
+        for (j = i; (j > 0) && (runs[j - 1] > t); j--)
+            runs[j] = runs[j - 1];
+        runs[j] = t;
+    }
+
+    chThdSetPriority(prio);
+    if (bcp->teardown != NULL)
+        bcp->teardown();
+
+    brp->iterations = n;
+    brp->units = units;
+    brp->best = runs[0];
+    brp->median = runs[BENCH_REPEATS / 2];
+    return 0;
+}
+
+void benchHeader(BaseSequentialStream *chp)
+{
+    chprintf(chp, "%-14s %10s %10s %7s %12s\r\n",
+            "bench", "iters", "ns/iter", "spread", "rate");
+}
+
+/**
+ * Prints one table row, the spread is the distance between the median
+ * and the best run, in per mille of the best run.
+ **/
+void benchReport(BaseSequentialStream *chp, const bench_case_t *bcp,
+                 const bench_result_t *brp)
+{
+    uint32_t spread = brp->best ?
+        (uint32_t)(((uint64_t)(brp->median - brp->best) * 1000U) /
+                   brp->best) : 0;
+
+    chprintf(chp, "%-14s %10lu %10lu %3lu.%lu%% %12lu %s/s\r\n",
+            bcp->name, (unsigned long)brp->iterations,
+            (unsigned long)ns_per_iter(brp->median, brp->iterations),
+            (unsigned long)(spread / 10), (unsigned long)(spread % 10),
+            (unsigned long)per_second(brp->units, brp->median), bcp->unit);
+}
+
+static void bench_json(BaseSequentialStream *chp, const bench_case_t *bcp,
+                       const bench_result_t *brp)
+{
+    chprintf(chp, "--- JSON: {\"bench\":\"%s\",\"unit\":\"%s\","
+            "\"iters\":%lu,\"ns_best\":%lu,\"ns_median\":%lu,"
+            "\"rate\":%lu}\r\n",
+            bcp->name, bcp->unit, (unsigned long)brp->iterations,
+            (unsigned long)ns_per_iter(brp->best, brp->iterations),
+            (unsigned long)ns_per_iter(brp->median, brp->iterations),
+            (unsigned long)per_second(brp->units, brp->median));
+}
+
+static bool selected(const char *name, int argc, char *argv[])
+{
+    int i;
+
+    if (argc == 0)
+        return true;
+    for (i = 0; i < argc; i++) {
+        if (strncmp(name, argv[i], strlen(argv[i])) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Runs the cases of a NULL name terminated array whose name starts
+ * with one of the arguments, all of them without arguments. "list"
+ * only prints the names. Returns the number of cases skipped because
+ * their setup failed.
+ **/
+int benchRunAll(BaseSequentialStream *chp, const bench_case_t *cases,
+                int argc, char *argv[])
+{
+    static bench_result_t results[BENCH_MAX_CASES];
+    const bench_case_t *done[BENCH_MAX_CASES];
+    const bench_case_t *bcp;
+    unsigned i, ndone = 0;
+    int skipped = 0;
+
+    if ((argc == 1) && !strcmp(argv[0], "list")) {
+        for (bcp = cases; bcp->name != NULL; bcp++)
+            chprintf(chp, "%s\r\n", bcp->name);
+        return 0;
+    }
+
+    benchHeader(chp);
+    for (bcp = cases; (bcp->name != NULL) && (ndone < BENCH_MAX_CASES);
+         bcp++) {
+        if (!selected(bcp->name, argc, argv))
+            continue;
+        if (benchRun(bcp, &results[ndone]) != 0) {
+            chprintf(chp, "%-14s skipped\r\n", bcp->name);
+            skipped++;
+            continue;
+        }
+        benchReport(chp, bcp, &results[ndone]);
+        done[ndone++] = bcp;
+    }
+    for (i = 0; i < ndone; i++)
+        bench_json(chp, done[i], &results[i]);
+    return skipped;
+}
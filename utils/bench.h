@@ -0,0 +1,81 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/**
+ * Micro-benchmark harness for the application code.
+ *
+ * Each case runs a number of iterations of its workload, the harness
+ * first doubles the iteration count until one run lasts at least
+ * BENCH_TARGET_MS, then repeats the run BENCH_REPEATS times and keeps
+ * the best and the median duration. The calling thread is raised to
+ * BENCH_PRIORITY meanwhile so the other application threads do not
+ * disturb the measurement.
+ *
+ * Results are printed as a table row and as a "--- JSON: " line, the
+ * same format used by the kernel latency benchmarks.
+ **/
+
+#include "ch.h"
+#include "hal.h"
+
+/**
+ * Minimum duration of one timed run.
+ **/
+#if !defined(BENCH_TARGET_MS)
+#define BENCH_TARGET_MS         50U
+#endif
+
+/**
+ * Number of timed runs, the median is reported.
+ **/
+#if !defined(BENCH_REPEATS)
+#define BENCH_REPEATS           5U
+#endif
+
+/**
+ * Priority of the thread while measuring.
+ **/
+#if !defined(BENCH_PRIORITY)
+#define BENCH_PRIORITY          (NORMALPRIO + 20)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A benchmark case. setup() returns zero when the case can run, run()
+ * executes n iterations and returns the processed units (bytes,
+ * entries...), at least one per iteration.
+ **/
+typedef struct {
+  const char *name;
+  const char *unit;
+  int (*setup)(void);
+  uint64_t (*run)(uint32_t n);
+  void (*teardown)(void);
+} bench_case_t;
+
+/**
+ * Result of a benchmark case, durations are in realtime counter cycles
+ * for the whole run.
+ **/
+typedef struct {
+  uint32_t iterations;
+  uint64_t units;
+  uint32_t best;
+  uint32_t median;
+} bench_result_t;
+
+int benchRun(const bench_case_t *bcp, bench_result_t *brp);
+void benchHeader(BaseSequentialStream *chp);
+void benchReport(BaseSequentialStream *chp, const bench_case_t *bcp,
+                 const bench_result_t *brp);
+int benchRunAll(BaseSequentialStream *chp, const bench_case_t *cases,
+                int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
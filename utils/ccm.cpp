@@ -0,0 +1,52 @@
+#include "ch.h"
+#include "ccm.h"
+
+#if CCM_ENABLED
+/* End of the statically placed objects, from the linker script. */
+extern "C" uint8_t __ram4_free__[], __ram4_end__[];
+
+static uint8_t *nextmem = (uint8_t *)MEM_ALIGN_NEXT(__ram4_free__);
+#endif
+
+/**
+ * Allocates size bytes, rounded to the port alignment, from the free
+ * CCM. Returns NULL when it is exhausted, the memory is never released.
+ **/
+void *ccmAllocI(size_t size)
+{
+#if CCM_ENABLED
+    void *p;
+
+    chDbgCheckClassI();
+    size = MEM_ALIGN_NEXT(size);
+    if (ccmGetStatusX() < size)
+        return NULL;
+    p = nextmem;
+    nextmem += size;
+    return p;
+#else
+    return chCoreAllocI(size);
+#endif
+}
+
+void *ccmAlloc(size_t size)
+{
+    void *p;
+
+    chSysLock();
+    p = ccmAllocI(size);
+    chSysUnlock();
+    return p;
+}
+
+/**
+ * Returns the free CCM bytes, zero in the simulator.
+ **/
+size_t ccmGetStatusX(void)
+{
+#if CCM_ENABLED
+    return (size_t)((uint8_t *)MEM_ALIGN_PREV(__ram4_end__) - nextmem);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,92 @@
+#ifndef __CCM_H__
+#define __CCM_H__
+
+/**
+ * Core coupled memory placement.
+ *
+ * The 64KB CCM at 0x10000000 (ram4 in STM32F407xG.ld) is on the D-bus
+ * of the core only, the accesses never wait for the DMA controllers and
+ * the Ethernet MAC that share the bus matrix with ram0. It is not
+ * reachable by any DMA and it cannot hold code.
+ *
+ * Objects are pinned there with the section attributes below, the
+ * startup code copies CCM_DATA from flash, clears CCM_BSS and leaves
+ * CCM_NOINIT alone. The rest of the region is handed out by ccmAlloc(),
+ * a bump allocator like chCoreAlloc(), which is also a memgetfunc_t for
+ * the pools and heaps that must live in CCM.
+ *
+ * Suitable objects are thread working areas, kernel objects, the lwIP
+ * pools (the MAC driver copies the frames to its own buffers) and the
+ * FatFs windows (the SDC driver bounces CCM buffers through its
+ * internal one). DMA stream setup asserts on CCM addresses, see
+ * STM32_DMA_IS_CCM().
+ *
+ * In the simulator the attributes are empty and ccmAlloc() takes from
+ * the core memory.
+ *
+ * This header is included from lwipopts.h, possibly before the kernel
+ * headers.
+ **/
+
+#if !defined(FALSE)
+#define FALSE                   0
+#endif
+
+#if !defined(TRUE)
+#define TRUE                    1
+#endif
+
+/**
+ * Set to FALSE in order to keep everything in ram0, target only.
+ **/
+#if !defined(CCM_ENABLED) || defined(SIMULATOR)
+#undef CCM_ENABLED
+#if defined(SIMULATOR)
+#define CCM_ENABLED             FALSE
+#else
+#define CCM_ENABLED             TRUE
+#endif
+#endif
+
+#define CCM_BASE                0x10000000U
+#define CCM_SIZE                0x00010000U
+
+#if CCM_ENABLED
+#define CCM_DATA                __attribute__((section(".ram4_init")))
+#define CCM_BSS                 __attribute__((section(".ram4_clear")))
+#define CCM_NOINIT              __attribute__((section(".ram4")))
+#define CCM_IS_CCM(p)                                                       \
+  ((uint32_t)(uintptr_t)(p) - CCM_BASE < CCM_SIZE)
+#else
+#define CCM_DATA
+#define CCM_BSS
+#define CCM_NOINIT
+#define CCM_IS_CCM(p)           0
+#endif
+
+/**
+ * Static thread working area in CCM, the stack is painted when the
+ * thread is created.
+ **/
+#define CCM_THD_WORKING_AREA(s, n)  CCM_NOINIT THD_WORKING_AREA(s, n)
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *ccmAlloc(size_t size);
+void *ccmAllocI(size_t size);
+size_t ccmGetStatusX(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+#endif
@@ -0,0 +1,338 @@
+#include "cfgimage.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (CONFIG_MAX_KEYS & (CONFIG_MAX_KEYS - 1)) != 0 || CONFIG_MAX_KEYS > 128
+#error "CONFIG_MAX_KEYS must be a power of two up to 128"
+#endif
+
+#if CONFIG_POOL_SIZE >= CFGIMG_NONE
+#error "CONFIG_POOL_SIZE too large"
+#endif
+
+static_assert(sizeof(cfgimg_hdr_t) == 32, "image header layout");
+static_assert(sizeof(cfgimg_slot_t) == 12, "image slot layout");
+
+/* Seeds tried for the index, the expected number is a few. */
+#define MAX_SEEDS       10000U
+
+typedef struct {
+    cfgimg_t *img;
+    const cfgdef_t *defs;
+    cfgreport_t report;
+    void *arg;
+    int errors;
+    unsigned firstline;         /* First line reported, 0 if none.      */
+    uint8_t seen[CONFIG_MAX_KEYS];
+} cfgload_t;
+
+static uint32_t fnv(uint32_t h, const void *p, size_t n)
+{
+    const uint8_t *b = (const uint8_t *)p;
+
+    while (n-- > 0)
+        h = (h ^ *b++) * 16777619U;
+    return h;
+}
+
+static inline unsigned index_of(uint32_t key, uint32_t seed)
+{
+    uint32_t h = key ^ seed;
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    return h & (CFGIMG_INDEX_SIZE - 1);
+}
+
+static bool parse_int(const char *s, uint32_t *v)
+{
+    char *end;
+    long l;
+
+    /* strtol() saturates, with a 32 bits long only errno tells. */
+    errno = 0;
+    l = strtol(s, &end, 0);
+    if (end == s || *end != '\0' || errno == ERANGE || l < INT32_MIN ||
+        l > INT32_MAX)
+        return false;
+    *v = (uint32_t)(int32_t)l;
+    return true;
+}
+
+static bool same(const char *s, const char *lower)
+{
+    while (*lower != '\0') {
+        if ((*s | 0x20) != *lower)
+            return false;
+        s++;
+        lower++;
+    }
+    return *s == '\0';
+}
+
+static bool parse_bool(const char *s, uint32_t *v)
+{
+    if (same(s, "true") || same(s, "yes") || same(s, "on") || same(s, "1"))
+        *v = 1;
+    else if (same(s, "false") || same(s, "no") || same(s, "off") || same(s, "0"))
+        *v = 0;
+    else
+        return false;
+    return true;
+}
+
+/* The address is stored in memory order, as in ip_addr_t.addr. */
+static bool parse_ip(const char *s, uint32_t *v)
+{
+    uint8_t b[4];
+    unsigned i, n;
+
+    for (i = 0; i < 4; i++) {
+        if (*s < '0' || *s > '9')
+            return false;
+        for (n = 0; *s >= '0' && *s <= '9' && n <= 255; s++)
+            n = n * 10 + (unsigned)(*s - '0');
+        if (n > 255 || *s != (i < 3 ? '.' : '\0'))
+            return false;
+        b[i] = (uint8_t)n;
+        s++;
+    }
+    memcpy(v, b, sizeof(b));
+    return true;
+}
+
+/**
+ * Hash of the key table, the defaults included, an image built for
+ * another table is not valid.
+ **/
+uint32_t cfgimgSchema(const cfgdef_t *defs, size_t n)
+{
+    uint32_t h = 2166136261U;
+    uint8_t b[2];
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        h = fnv(h, defs[k].section, strlen(defs[k].section) + 1);
+        h = fnv(h, defs[k].name, strlen(defs[k].name) + 1);
+        if (defs[k].defval != NULL)
+            h = fnv(h, defs[k].defval, strlen(defs[k].defval) + 1);
+        b[0] = (uint8_t)defs[k].type;
+        b[1] = (uint8_t)defs[k].required | (defs[k].defval != NULL ? 2 : 0);
+        h = fnv(h, b, sizeof(b));
+    }
+    return h;
+}
+
+/**
+ * Empty image of the key table. Returns -1 if the table is too large
+ * or two keys have the same hash.
+ **/
+int cfgimgInit(cfgimg_t *img, const cfgdef_t *defs, size_t n)
+{
+    uint32_t seed;
+    size_t j, k;
+
+    if (n > CONFIG_MAX_KEYS)
+        return -1;
+    memset(img, 0, CFGIMG_HEAD_SIZE);
+    img->hdr.magic = CFGIMG_MAGIC;
+    img->hdr.version = CFGIMG_VERSION;
+    img->hdr.nkeys = (uint16_t)n;
+    img->hdr.schema = cfgimgSchema(defs, n);
+    for (k = 0; k < n; k++) {
+        img->slots[k].key = cfgKey(defs[k].section, defs[k].name);
+        img->slots[k].text = CFGIMG_NONE;
+        for (j = 0; j < k; j++) {
+            if (img->slots[j].key == img->slots[k].key)
+                return -1;
+        }
+    }
+
+    for (seed = 0; seed < MAX_SEEDS; seed++) {
+        memset(img->index, 0, sizeof(img->index));
+        for (k = 0; k < n; k++) {
+            unsigned i = index_of(img->slots[k].key, seed);
+
+            if (img->index[i] != 0)
+                break;
+            img->index[i] = (uint8_t)(k + 1);
+        }
+        if (k == n) {
+            img->hdr.seed = seed;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Stores the text and the typed value of key number k, returns an
+ * error message or NULL.
+ **/
+const char *cfgimgSet(cfgimg_t *img, const cfgdef_t *defs, size_t k,
+                      const char *text)
+{
+    cfgimg_slot_t *sp = &img->slots[k];
+    size_t len = strlen(text);
+    size_t used = img->hdr.size;
+    bool ok = true;
+
+    switch (defs[k].type) {
+    case CFG_INT:
+        ok = parse_int(text, &sp->value);
+        break;
+    case CFG_BOOL:
+        ok = parse_bool(text, &sp->value);
+        break;
+    case CFG_IP:
+        ok = parse_ip(text, &sp->value);
+        break;
+    case CFG_STR:
+        break;
+    }
+    if (!ok)
+        return "invalid value";
+    /* The header size counts the pool until the image is finished. */
+    if (used + len + 1 > CONFIG_POOL_SIZE)
+        return "out of string space";
+    memcpy(&img->pool[used], text, len + 1);
+    sp->text = (uint16_t)used;
+    sp->len = (uint16_t)len;
+    img->hdr.size = (uint32_t)(used + len + 1);
+    return NULL;
+}
+
+/**
+ * Stores the defaults of the keys without a value, returns -1 if one
+ * does not parse.
+ **/
+int cfgimgDefaults(cfgimg_t *img, const cfgdef_t *defs, size_t n)
+{
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        if ((img->slots[k].text == CFGIMG_NONE) && (defs[k].defval != NULL) &&
+            (cfgimgSet(img, defs, k, defs[k].defval) != NULL))
+            return -1;
+    }
+    return 0;
+}
+
+static void report(cfgload_t *lp, unsigned line, const char *section,
+                   const char *name, const char *msg)
+{
+    lp->errors++;
+    if (lp->firstline == 0)
+        lp->firstline = line;
+    if (lp->report != NULL)
+        lp->report(lp->arg, line, section, name, msg);
+}
+
+static int onconfigparse(void * usercfg, unsigned line,
+    const inislice_t * section,
+    const inislice_t * name,
+    const inislice_t * value)
+{
+    cfgload_t *lp = (cfgload_t *)usercfg;
+    const cfgdef_t *dp;
+    const char *msg;
+    int k;
+
+    /* The bytes after the slices can be overwritten. */
+    ((char *)name->ptr)[name->len] = '\0';
+    ((char *)value->ptr)[value->len] = '\0';
+    k = cfgimgFind(lp->img, cfgKey(section->ptr, name->ptr));
+    dp = k >= 0 ? &lp->defs[k] : NULL;
+    if (dp == NULL || strcmp(dp->section, section->ptr) != 0 ||
+        strcmp(dp->name, name->ptr) != 0) {
+        report(lp, line, section->ptr, name->ptr, "unknown key");
+        return -1;
+    }
+    if (lp->seen[k]) {
+        report(lp, line, section->ptr, name->ptr, "duplicate key");
+        return -1;
+    }
+    lp->seen[k] = 1;
+    if ((msg = cfgimgSet(lp->img, lp->defs, (size_t)k, value->ptr)) != NULL) {
+        report(lp, line, section->ptr, name->ptr, msg);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Builds the image of the INI input of reader. The problems are passed
+ * to report, returns their number or -1 on a read error. The image
+ * must be finished by cfgimgFinish().
+ **/
+int cfgimgParse(cfgimg_t *img, const cfgdef_t *defs, size_t n,
+                iniparser_t *ip, iniread_t reader, void *readctx,
+                cfgreport_t report_cb, void *arg)
+{
+    cfgload_t load;
+    size_t k;
+    int ret;
+
+    if (cfgimgInit(img, defs, n) < 0)
+        return -1;
+    memset(&load, 0, sizeof(load));
+    load.img = img;
+    load.defs = defs;
+    load.report = report_cb;
+    load.arg = arg;
+    ret = ini_parse(ip, reader, readctx, onconfigparse, &load);
+    if (ret < 0)
+        return -1;
+    /* Only the first bad line is known, it can be a syntax error. */
+    if ((ret > 0) && ((unsigned)ret != load.firstline))
+        report(&load, (unsigned)ret, "", "", "syntax error");
+    for (k = 0; k < n; k++) {
+        if (!load.seen[k] && defs[k].required)
+            report(&load, 0, defs[k].section, defs[k].name, "missing key");
+    }
+    if (cfgimgDefaults(img, defs, n) < 0)
+        report(&load, 0, "", "", "invalid default");
+    return load.errors;
+}
+
+/**
+ * Seals the image, the source file size and time become part of it.
+ **/
+void cfgimgFinish(cfgimg_t *img, uint32_t srcsize, uint32_t srctime)
+{
+    size_t size = CFGIMG_HEAD_SIZE + img->hdr.size;
+
+    img->hdr.srcsize = srcsize;
+    img->hdr.srctime = srctime;
+    img->hdr.size = (uint32_t)size;
+    img->hdr.check = fnv(2166136261U, (const uint8_t *)img + sizeof(img->hdr),
+                         size - sizeof(img->hdr));
+}
+
+/**
+ * Checks an image of size bytes against the key table hash.
+ **/
+bool cfgimgValid(const cfgimg_t *img, size_t size, uint32_t schema)
+{
+    return (size >= CFGIMG_HEAD_SIZE) && (size <= sizeof(cfgimg_t)) &&
+           (img->hdr.magic == CFGIMG_MAGIC) &&
+           (img->hdr.version == CFGIMG_VERSION) &&
+           (img->hdr.size == size) && (img->hdr.schema == schema) &&
+           (img->hdr.nkeys <= CONFIG_MAX_KEYS) &&
+           (img->hdr.check == fnv(2166136261U,
+                                  (const uint8_t *)img + sizeof(img->hdr),
+                                  size - sizeof(img->hdr)));
+}
+
+/**
+ * Number of the key, -1 if it is not in the image.
+ **/
+int cfgimgFind(const cfgimg_t *img, uint32_t key)
+{
+    unsigned k = img->index[index_of(key, img->hdr.seed)];
+
+    return (k != 0) && (img->slots[k - 1].key == key) ? (int)k - 1 : -1;
+}
@@ -0,0 +1,91 @@
+#ifndef __CFGIMAGE_H__
+#define __CFGIMAGE_H__
+
+/**
+ * Compiled configuration image.
+ *
+ * An image holds the parsed values of a key table: a header, a perfect
+ * hash index from the key hashes to the key numbers, one slot per key
+ * with the typed value and a string pool with the text of the values.
+ * It contains no pointers, so it is used in place wherever it is, the
+ * configuration banks of globalconfig.cpp are images.
+ *
+ * After a successful load parseconfig() writes the image next to the
+ * INI file. The header records the size and FAT timestamp of the INI
+ * file and a hash of the key table, a later load reads the image back
+ * with a single f_read() when they still match, without parsing. The
+ * host tool tools/cfgsnap.cpp builds the same image offline from this
+ * code.
+ *
+ * The index is a table of CFGIMG_INDEX_SIZE entries addressed by
+ * mixing the key hash with a seed chosen when the image is built so
+ * that no two keys collide, a lookup reads one entry and compares one
+ * hash.
+ *
+ * The image is little endian, as the target and the x86 hosts. This
+ * header does not depend on the kernel.
+ **/
+
+#include "globalconfig.h"
+#include "iniutils.h"
+
+#define CFGIMG_MAGIC            0x47464343U     /* "CCFG".              */
+#define CFGIMG_VERSION          1
+
+/* Index entries, a quarter full at most. */
+#define CFGIMG_INDEX_SIZE       (4 * CONFIG_MAX_KEYS)
+
+/* Pool offset of a slot without a value. */
+#define CFGIMG_NONE             0xFFFFU
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t nkeys;
+    uint32_t schema;            /* Hash of the key table.               */
+    uint32_t srcsize;           /* Size of the INI file.                */
+    uint32_t srctime;           /* FAT date << 16 | time of the file.   */
+    uint32_t seed;              /* Index seed.                          */
+    uint32_t size;              /* Image bytes, header included.        */
+    uint32_t check;             /* FNV-1a of the bytes after the header.*/
+} cfgimg_hdr_t;
+
+typedef struct {
+    uint32_t key;               /* Key hash.                            */
+    uint32_t value;             /* int32_t, 0/1 or the IP address.      */
+    uint16_t text;              /* Pool offset or CFGIMG_NONE.          */
+    uint16_t len;
+} cfgimg_slot_t;
+
+/* The pool is last, an image is stored up to the used part. */
+typedef struct {
+    cfgimg_hdr_t hdr;
+    uint8_t index[CFGIMG_INDEX_SIZE];   /* Key number + 1, 0 if free.   */
+    cfgimg_slot_t slots[CONFIG_MAX_KEYS];
+    char pool[CONFIG_POOL_SIZE];
+} cfgimg_t;
+
+#define CFGIMG_HEAD_SIZE        (sizeof(cfgimg_t) - CONFIG_POOL_SIZE)
+
+uint32_t cfgimgSchema(const cfgdef_t *defs, size_t n);
+int cfgimgInit(cfgimg_t *img, const cfgdef_t *defs, size_t n);
+const char *cfgimgSet(cfgimg_t *img, const cfgdef_t *defs, size_t k,
+                      const char *text);
+int cfgimgDefaults(cfgimg_t *img, const cfgdef_t *defs, size_t n);
+int cfgimgParse(cfgimg_t *img, const cfgdef_t *defs, size_t n,
+                iniparser_t *ip, iniread_t reader, void *readctx,
+                cfgreport_t report, void *arg);
+void cfgimgFinish(cfgimg_t *img, uint32_t srcsize, uint32_t srctime);
+bool cfgimgValid(const cfgimg_t *img, size_t size, uint32_t schema);
+int cfgimgFind(const cfgimg_t *img, uint32_t key);
+
+/**
+ * Text of key number k, NULL if it has no value.
+ **/
+static inline const char *cfgimgText(const cfgimg_t *img, int k)
+{
+    return img->slots[k].text != CFGIMG_NONE ?
+           &img->pool[img->slots[k].text] : NULL;
+}
+
+#endif
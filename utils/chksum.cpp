@@ -0,0 +1,190 @@
+#include "chksum.h"
+
+#include <string.h>
+
+#if defined(__ARM_ARCH_7EM__) && !defined(SIMULATOR)
+#define CHKSUM_USE_ASM          1
+#else
+#define CHKSUM_USE_ASM          0
+#endif
+
+/* Bit position of a byte in the halfword of its address. */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define BYTE_SHIFT(a)           ((~(uintptr_t)(a) & 1) * 8)
+#else
+#define BYTE_SHIFT(a)           (((uintptr_t)(a) & 1) * 8)
+#endif
+
+static inline uint32_t load32(const uint8_t *p)
+{
+    uint32_t w;
+
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline void store32(uint8_t *p, uint32_t w)
+{
+    memcpy(p, &w, sizeof(w));
+}
+
+static inline uint16_t fold(uint64_t acc, bool swap)
+{
+    uint32_t s;
+
+    s = (uint32_t)(acc & 0xFFFFU) + (uint32_t)((acc >> 16) & 0xFFFFU) +
+        (uint32_t)((acc >> 32) & 0xFFFFU) + (uint32_t)(acc >> 48);
+    s = (s >> 16) + (s & 0xFFFFU);
+    s = (s >> 16) + (s & 0xFFFFU);
+    return swap ? (uint16_t)((s << 8) | (s >> 8)) : (uint16_t)s;
+}
+
+#if CHKSUM_USE_ASM
+/* Sum of n blocks of 32 bytes at the word aligned p, with end around
+   carry. ldrd does not change the flags, the carry runs through. */
+static uint32_t sum_blocks(const uint8_t **pp, size_t n)
+{
+    const uint8_t *p = *pp;
+    uint32_t s = 0, a, b, c, d;
+
+    while (n-- > 0) {
+        __asm__ ("ldrd   %[a], %[b], [%[p]], #8\n\t"
+                 "ldrd   %[c], %[d], [%[p]], #8\n\t"
+                 "adds   %[s], %[s], %[a]\n\t"
+                 "adcs   %[s], %[s], %[b]\n\t"
+                 "adcs   %[s], %[s], %[c]\n\t"
+                 "adcs   %[s], %[s], %[d]\n\t"
+                 "ldrd   %[a], %[b], [%[p]], #8\n\t"
+                 "ldrd   %[c], %[d], [%[p]], #8\n\t"
+                 "adcs   %[s], %[s], %[a]\n\t"
+                 "adcs   %[s], %[s], %[b]\n\t"
+                 "adcs   %[s], %[s], %[c]\n\t"
+                 "adcs   %[s], %[s], %[d]\n\t"
+                 "adc    %[s], %[s], #0"
+                 : [s] "+r" (s), [p] "+r" (p), [a] "=&r" (a), [b] "=&r" (b),
+                   [c] "=&r" (c), [d] "=&r" (d)
+                 :
+                 : "cc", "memory");
+    }
+    *pp = p;
+    return s;
+}
+
+/* Same, copying the blocks from the word aligned *sp to *dp. */
+static uint32_t copy_blocks(uint8_t **dp, const uint8_t **sp, size_t n)
+{
+    uint8_t *d = *dp;
+    const uint8_t *p = *sp;
+    uint32_t s = 0, a, b, c, e;
+
+    while (n-- > 0) {
+        __asm__ ("ldrd   %[a], %[b], [%[p]], #8\n\t"
+                 "ldrd   %[c], %[e], [%[p]], #8\n\t"
+                 "strd   %[a], %[b], [%[d]], #8\n\t"
+                 "strd   %[c], %[e], [%[d]], #8\n\t"
+                 "adds   %[s], %[s], %[a]\n\t"
+                 "adcs   %[s], %[s], %[b]\n\t"
+                 "adcs   %[s], %[s], %[c]\n\t"
+                 "adcs   %[s], %[s], %[e]\n\t"
+                 "ldrd   %[a], %[b], [%[p]], #8\n\t"
+                 "ldrd   %[c], %[e], [%[p]], #8\n\t"
+                 "strd   %[a], %[b], [%[d]], #8\n\t"
+                 "strd   %[c], %[e], [%[d]], #8\n\t"
+                 "adcs   %[s], %[s], %[a]\n\t"
+                 "adcs   %[s], %[s], %[b]\n\t"
+                 "adcs   %[s], %[s], %[c]\n\t"
+                 "adcs   %[s], %[s], %[e]\n\t"
+                 "adc    %[s], %[s], #0"
+                 : [s] "+r" (s), [p] "+r" (p), [d] "+r" (d), [a] "=&r" (a),
+                   [b] "=&r" (b), [c] "=&r" (c), [e] "=&r" (e)
+                 :
+                 : "cc", "memory");
+    }
+    *dp = d;
+    *sp = p;
+    return s;
+}
+#endif
+
+/**
+ * One's complement sum of len bytes at data, not inverted.
+ **/
+uint16_t chksumData(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    bool swap = ((uintptr_t)p & 1) != 0;
+    uint64_t acc = 0;
+    size_t n;
+
+    /* Head and tail bytes are summed at the place of their address. */
+    while ((len > 0) && (((uintptr_t)p & 3) != 0)) {
+        acc += (uint32_t)*p << BYTE_SHIFT(p);
+        p++;
+        len--;
+    }
+    n = len / 4;
+    len &= 3;
+#if CHKSUM_USE_ASM
+    acc += sum_blocks(&p, n / 8);
+    n &= 7;
+#endif
+    for (; n >= 4; n -= 4, p += 16)
+        acc += (uint64_t)load32(p) + load32(p + 4) + load32(p + 8) +
+               load32(p + 12);
+    for (; n > 0; n--, p += 4)
+        acc += load32(p);
+    for (; len > 0; len--, p++)
+        acc += (uint32_t)*p << BYTE_SHIFT(p);
+    return fold(acc, swap);
+}
+
+/**
+ * Copies len bytes from src to dst and returns their sum as
+ * chksumData() does. The words are aligned on dst, src can have any
+ * alignment.
+ **/
+uint16_t chksumCopy(void *dst, const void *src, size_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    bool swap = ((uintptr_t)d & 1) != 0;
+    uint64_t acc = 0;
+    uint32_t w;
+    size_t n;
+
+    /* The sum is that of the copy, at the addresses of dst. */
+    while ((len > 0) && (((uintptr_t)d & 3) != 0)) {
+        *d = *s++;
+        acc += (uint32_t)*d << BYTE_SHIFT(d);
+        d++;
+        len--;
+    }
+    n = len / 4;
+    len &= 3;
+#if CHKSUM_USE_ASM
+    if (((uintptr_t)s & 3) == 0) {
+        acc += copy_blocks(&d, &s, n / 8);
+        n &= 7;
+    }
+#endif
+    for (; n >= 4; n -= 4, d += 16, s += 16) {
+        uint32_t w0 = load32(s), w1 = load32(s + 4);
+        uint32_t w2 = load32(s + 8), w3 = load32(s + 12);
+
+        store32(d, w0);
+        store32(d + 4, w1);
+        store32(d + 8, w2);
+        store32(d + 12, w3);
+        acc += (uint64_t)w0 + w1 + w2 + w3;
+    }
+    for (; n > 0; n--, d += 4, s += 4) {
+        w = load32(s);
+        store32(d, w);
+        acc += w;
+    }
+    for (; len > 0; len--, d++) {
+        *d = *s++;
+        acc += (uint32_t)*d << BYTE_SHIFT(d);
+    }
+    return fold(acc, swap);
+}
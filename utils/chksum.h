@@ -0,0 +1,38 @@
+#ifndef __CHKSUM_H__
+#define __CHKSUM_H__
+
+/**
+ * Internet checksum (RFC 1071) kernels for lwIP.
+ *
+ * chksumData() is LWIP_CHKSUM and chksumCopy() is LWIP_CHKSUM_COPY in
+ * lwipopts.h. Both return the one's complement sum of the data taken
+ * as 16 bits words in host order, folded and not inverted, as the
+ * generic lwip_standard_chksum() does, and are bit exact with it.
+ *
+ * The sum is taken a 32 bits word at a time from aligned addresses, a
+ * word adds two halfwords at once since 2^16 = 1 modulo 0xFFFF, and
+ * the result is byte swapped when the data starts at an odd address.
+ * On the Cortex-M4 the aligned part runs through an unrolled ldrd and
+ * adcs chain, one cycle per word plus the loads. chksumCopy() stores
+ * the words as it sums them, so a payload copied into a pbuf is read
+ * once. Elsewhere, the host tests included, the portable C loops with
+ * a 64 bits accumulator are used.
+ *
+ * This header is included from lwipopts.h.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t chksumData(const void *data, size_t len);
+uint16_t chksumCopy(void *dst, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+#include "ch.h"
+#include "cpuload.h"
+
+/**
+ * Cycle stamp of the last charge, everything between this stamp and
+ * "now" belongs to whoever is running: the current thread, or the IRQ
+ * bucket when irq_nest is not zero.
+ **/
+static rtcnt_t last;
+static unsigned irq_nest;
+static cpuload_totals_t totals;
+
+static inline uint32_t charge(void)
+{
+    rtcnt_t now = chSysGetRealtimeCounterX();
+    uint32_t delta = (uint32_t)(now - last);
+
+    last = now;
+    totals.elapsed += delta;
+    return delta;
+}
+
+#if CPULOAD_ENABLED
+void _cpuload_thread_init(thread_t *tp)
+{
+    /* The first thread is initialized by chSysInit(), the accounting
+       starts there and not at the counter origin. */
+    if (last == 0)
+        last = chSysGetRealtimeCounterX();
+    tp->p_cpu.cycles = 0;
+    tp->p_cpu.switches = 0;
+    tp->p_cpu.preempted = 0;
+}
+
+/* Invoked by chSysSwitch() with the kernel locked, at thread level. */
+void _cpuload_switch(thread_t *ntp, thread_t *otp)
+{
+    otp->p_cpu.cycles += charge();
+    if (otp->p_state == CH_STATE_READY)
+        otp->p_cpu.preempted++;
+    ntp->p_cpu.switches++;
+    totals.switches++;
+}
+
+/* IRQ prologue/epilogue hooks, interrupts are enabled here so a short
+   port level critical zone protects against nested handlers. */
+void _cpuload_irq_enter(void)
+{
+    port_lock_from_isr();
+    if (irq_nest++ == 0) {
+        currp->p_cpu.cycles += charge();
+        totals.irq_count++;
+    }
+    port_unlock_from_isr();
+}
+
+void _cpuload_irq_leave(void)
+{
+    port_lock_from_isr();
+    if (--irq_nest == 0)
+        totals.irq_cycles += charge();
+    port_unlock_from_isr();
+}
+#endif
+
+/**
+ * Copies the system totals and the counters of up to n threads.
+ * Returns the number of thread entries written.
+ **/
+size_t cpuloadSnapshot(cpuload_totals_t *tot, cpuload_sample_t *buf, size_t n)
+{
+    thread_t *tp;
+    size_t i = 0;
+
+    chSysLock();
+    /* Brings the accounting up to date, the caller is running. */
+#if CPULOAD_ENABLED
+    currp->p_cpu.cycles += charge();
+#else
+    (void)charge();
+#endif
+    *tot = totals;
+    chSysUnlock();
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+        if (i < n) {
+            buf[i].tp = tp;
+            buf[i].name = chRegGetThreadNameX(tp);
+            buf[i].prio = (uint32_t)tp->p_prio;
+#if CPULOAD_ENABLED
+            chSysLock();
+            buf[i].cnt = tp->p_cpu;
+            chSysUnlock();
+#else
+            buf[i].cnt.cycles = 0;
+            buf[i].cnt.switches = 0;
+            buf[i].cnt.preempted = 0;
+#endif
+            i++;
+        }
+        tp = chRegNextThread(tp);
+    }
+    return i;
+}
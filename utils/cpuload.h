@@ -0,0 +1,95 @@
+#ifndef __CPULOAD_H__
+#define __CPULOAD_H__
+
+/**
+ * Per-thread CPU accounting.
+ *
+ * Cycles are measured with the realtime counter (the DWT cycle counter
+ * on Cortex-M) and charged to the running thread on every context
+ * switch, or to the "irq" bucket between the outermost IRQ prologue
+ * and epilogue. Idle time is the runtime of the idle thread.
+ *
+ * The hooks are wired in chconf.h, this header is included from there
+ * so it must stay plain C and must not depend on the kernel types.
+ **/
+
+/**
+ * Set to FALSE in order to remove the accounting hooks.
+ **/
+#if !defined(CPULOAD_ENABLED)
+#define CPULOAD_ENABLED         TRUE
+#endif
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Per-thread counters, embedded in thread_t as p_cpu.
+ **/
+typedef struct {
+  uint64_t cycles;              /* Cycles spent running.                */
+  uint32_t switches;            /* Times switched in.                   */
+  uint32_t preempted;           /* Times switched out while ready.      */
+} cpuload_thread_t;
+
+/**
+ * System wide counters.
+ **/
+typedef struct {
+  uint64_t elapsed;             /* Cycles accounted since boot.         */
+  uint64_t irq_cycles;          /* Cycles spent in IRQ handlers.        */
+  uint32_t irq_count;           /* Number of (outermost) IRQs.          */
+  uint32_t switches;            /* Total context switches.              */
+} cpuload_totals_t;
+
+/**
+ * One thread entry of a snapshot.
+ **/
+typedef struct {
+  const void *tp;               /* Thread identity, used for matching.  */
+  const char *name;
+  uint32_t prio;
+  cpuload_thread_t cnt;
+} cpuload_sample_t;
+
+#if CPULOAD_ENABLED
+struct ch_thread;
+void _cpuload_thread_init(struct ch_thread *tp);
+void _cpuload_switch(struct ch_thread *ntp, struct ch_thread *otp);
+void _cpuload_irq_enter(void);
+void _cpuload_irq_leave(void);
+#endif
+
+size_t cpuloadSnapshot(cpuload_totals_t *tot, cpuload_sample_t *buf,
+                       size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+/**
+ * Hook bodies used by chconf.h.
+ **/
+#if CPULOAD_ENABLED
+#define CPULOAD_THREAD_FIELDS       cpuload_thread_t p_cpu;
+#define CPULOAD_THREAD_INIT(tp)     _cpuload_thread_init(tp)
+#define CPULOAD_SWITCH(ntp, otp)    _cpuload_switch(ntp, otp)
+#define CPULOAD_IRQ_ENTER()         _cpuload_irq_enter()
+#define CPULOAD_IRQ_LEAVE()         _cpuload_irq_leave()
+#else
+#define CPULOAD_THREAD_FIELDS
+#define CPULOAD_THREAD_INIT(tp)
+#define CPULOAD_SWITCH(ntp, otp)
+#define CPULOAD_IRQ_ENTER()
+#define CPULOAD_IRQ_LEAVE()
+#endif
+
+#endif
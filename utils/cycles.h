@@ -0,0 +1,19 @@
+#ifndef __CYCLES_H__
+#define __CYCLES_H__
+
+/**
+ * Frequency of the realtime counter returned by
+ * chSysGetRealtimeCounterX(), used to turn cycle counts into time.
+ *
+ * On the STM32 targets the counter is the DWT cycle counter clocked
+ * by HCLK, other ports are assumed to count microseconds.
+ **/
+#if !defined(CYCLES_CLOCK_HZ)
+#if defined(STM32_HCLK)
+#define CYCLES_CLOCK_HZ         STM32_HCLK
+#else
+#define CYCLES_CLOCK_HZ         1000000U
+#endif
+#endif
+
+#endif
@@ -1,55 +1,73 @@
 #include "dictionary.h"
+#include "hashmap.h"
 
 #include <string.h>
-#include <stdlib.h>
 
 /**
- * This code is copied from the C Book
- * "The C Programming Language" by D. Ritchie and 
- * B. Kernighan.
+ * The global dictionary, a C interface over hashmap::StringMap.
  *
- * I tend to avoid C++ maps here in favor for 
- * a simple C implementation.
+ * It used to be the chained table of "The C Programming Language",
+ * with 101 buckets and three heap blocks per entry. The entries are
+ * now allocated from the arena of the map together with the keys, the
+ * nodes do not move so the returned pointers stay valid until the
+ * entry is removed or the dictionary cleared.
+ *
+ * Replacing a definition reuses its storage when the new text fits,
+ * otherwise the old text is abandoned in the arena. The memory of the
+ * removed entries is only released by dict_clear().
  **/
 
-static nlist *hashtab[HASHSIZE]; /* pointer table */
-
-/* hash: form hash value for string s */
-static unsigned hash(const char *s)
-{
-    unsigned hashval;
-    for (hashval = 0; *s != '\0'; s++)
-        hashval = *s + 31 * hashval;
-    return hashval % HASHSIZE;
-}
+static hashmap::StringMap<nlist *> table;
 
-/* lookup: look for s in hashtab */
+/* lookup: look for s in the table */
 nlist *dict_lookup(const char *s)
 {
-    nlist *np;
-    for (np = hashtab[hash(s)]; np != NULL; np = np->next)
-        if (strcmp(s, np->name) == 0)
-            return np; /* found */
-    return NULL; /* not found */
+    nlist **npp = table.find(s);
+
+    return npp != NULL ? *npp : NULL;
 }
 
-/* install: put (name, defn) in hashtab */
+/* install: put (name, defn) in the table */
 nlist *dict_install(const char *name, const char *defn)
 {
+    hashmap::Arena &arena = table.arena();
     nlist *np;
-    unsigned hashval;
+    const char *key;
+    size_t len = strlen(defn);
+
     if ((np = dict_lookup(name)) == NULL) { /* not found */
-        np = (nlist *) malloc(sizeof(*np));
-        if (np == NULL || (np->name = strdup(name)) == NULL)
+        np = (nlist *)arena.alloc(sizeof(*np));
+        if (np == NULL || table.insert(name, np, &key) == NULL)
             return NULL;
-        hashval = hash(name);
-        np->next = hashtab[hashval];
-        hashtab[hashval] = np;
-    } else /* already there */
-        free((void *) np->defn); /*free previous defn */
-    if ((np->defn = strdup(defn)) == NULL)
+        np->next = NULL;
+        np->name = (char *)key;
+        np->defn = NULL;
+    }
+    if (np->defn != NULL && strlen(np->defn) >= len) {
+        memcpy(np->defn, defn, len + 1);
+        return np;
+    }
+    if ((np->defn = arena.strdup(defn, len)) == NULL) {
+        table.erase(name);
         return NULL;
+    }
     return np;
 }
 
+/* remove: delete name, returns zero when not found */
+int dict_remove(const char *name)
+{
+    return table.erase(name) ? 1 : 0;
+}
+
+/* clear: delete all the entries and release their memory */
+void dict_clear(void)
+{
+    table.clear();
+}
+
+unsigned dict_count(void)
+{
+    return (unsigned)table.size();
+}
 
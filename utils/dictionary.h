@@ -10,17 +10,18 @@
 extern "C" {
 #endif
 
-#define HASHSIZE 101
-
 typedef struct _nlist 
 { /* table entry: */
-  _nlist *next; /* next entry in chain */
+  _nlist *next; /* unused, always NULL */
   char *name; /* defined name */
   char *defn; /* replacement text */
 } nlist;
 
 nlist *dict_install(const char *name, const char *defn);
 nlist *dict_lookup(const char *s);
+int dict_remove(const char *name);
+void dict_clear(void);
+unsigned dict_count(void);
 
 #ifdef __cplusplus
 }
@@ -1,49 +1,106 @@
+#include "ch.h"
 #include "direntx.h"
+#include "ccm.h"
 #include <string.h>
-#include <stdlib.h>
+
+/* The pool is loaded on the first dirxAlloc(). */
+static CCM_BSS dirx_t objects[DIRX_POOL_SIZE];
+static MEMORYPOOL_DECL(dirxpool, sizeof(dirx_t), NULL);
+static bool loaded;
 
 /**
- * Functions here are not re-entrant!
- * carefull when using multiple threads.
+ * Opens the directory path, the state is in dp.
  **/
-static FILINFO fnop;
-
-DIR * opendir(const char * path)
+FRESULT dirxOpen(dirx_t *dp, const char *path)
 {
-    DIR * tmpdir = (DIR *) malloc(sizeof(DIR));
-    if (tmpdir)
-    {
-        if (f_opendir(tmpdir, path) == FR_OK)
-            return tmpdir;
-        else
-            free(tmpdir);
-    }
-    return NULL;
+    dp->pending = false;
+    dp->end = false;
+    dp->fno.lfname = dp->lfn;
+    dp->fno.lfsize = sizeof(dp->lfn);
+    dp->res = f_opendir(&dp->dir, path);
+    dp->open = (dp->res == FR_OK);
+    return dp->res;
 }
 
-dirent * readdir(DIR * dirp)
+/**
+ * Reads the next batch of entries into dp->batch. Returns the number of
+ * entries, 0 at the end of the directory or -1 on an error, the entries
+ * read before an error are returned first.
+ **/
+int dirxRead(dirx_t *dp)
 {
-    static dirent dire;
-
-    if ((f_readdir(dirp, &fnop) == FR_OK) &&
-        fnop.fname[0] != 0) 
-    {
-        dire.d_type = fnop.fattrib;
+    uint8_t *p = (uint8_t *)dp->batch;
+    uint8_t *end = p + sizeof(dp->batch);
+    dirxent_t *ep;
+    const char *name;
+    size_t len, reclen;
+    int n = 0;
 
-        strncpy(dire.d_name, fnop.fname, _MAX_LFN);
+    if (!dp->open || (dp->res != FR_OK))
+        return -1;
+    while (!dp->end) {
+        if (!dp->pending) {
+            dp->res = f_readdir(&dp->dir, &dp->fno);
+            if (dp->res != FR_OK)
+                break;
+            if (dp->fno.fname[0] == '\0') {
+                dp->end = true;
+                break;
+            }
+            dp->pending = true;
+        }
+        name = (dp->lfn[0] != '\0') ? dp->lfn : dp->fno.fname;
+        len = strlen(name);
+        reclen = DIRX_RECLEN(len);
+        if (p + reclen > end)
+            break;
+        ep = (dirxent_t *)p;
+        ep->size = dp->fno.fsize;
+        ep->date = dp->fno.fdate;
+        ep->time = dp->fno.ftime;
+        ep->attrib = dp->fno.fattrib;
+        ep->namelen = (uint8_t)len;
+        ep->reclen = (uint16_t)reclen;
+        memcpy(ep->name, name, len + 1);
+        dp->pending = false;
+        p += reclen;
+        n++;
+    }
+    return (n == 0) && (dp->res != FR_OK) ? -1 : n;
+}
 
-        return &dire;
+/**
+ * Closes the directory, returns the first error of the listing.
+ **/
+FRESULT dirxClose(dirx_t *dp)
+{
+    if (dp->open) {
+        f_closedir(&dp->dir);
+        dp->open = false;
     }
-    return NULL;
+    return dp->res;
 }
 
-int closedir(DIR * dirp)
+/**
+ * Takes a dirx_t from the static pool, NULL if they are all in use.
+ **/
+dirx_t *dirxAlloc(void)
 {
-    if (dirp)
-    {
-        f_closedir(dirp);
-        return 0;
+    dirx_t *dp;
+    size_t i;
+
+    chSysLock();
+    if (!loaded) {
+        for (i = 0; i < DIRX_POOL_SIZE; i++)
+            chPoolFreeI(&dirxpool, &objects[i]);
+        loaded = true;
     }
-    return -1;
+    dp = (dirx_t *)chPoolAllocI(&dirxpool);
+    chSysUnlock();
+    return dp;
 }
 
+void dirxFree(dirx_t *dp)
+{
+    chPoolFree(&dirxpool, dp);
+}
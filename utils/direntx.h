@@ -7,33 +7,179 @@
  * Date : Fri Mar 06 2015
  **/
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+/**
+ * Batched directory iteration over FatFs.
+ *
+ * All the state of a listing is in a dirx_t owned by the caller, or
+ * taken from a small static pool with dirxAlloc(), so any number of
+ * listings can be open on different threads (FatFs itself must then
+ * be built with _FS_REENTRANT). dirxRead() fills the batch buffer of
+ * the dirx_t with as many entries as fit, each a dirxent_t record with
+ * the size, attributes, FAT timestamp and name, the long name when the
+ * entry has one. An entry that does not fit is kept for the next call,
+ * so the memory of a listing is bounded by sizeof(dirx_t) whatever the
+ * size of the directory.
+ *
+ * In C++, DirReader iterates the entries with a range for:
+ *
+ *   DirReader dir("/logs");
+ *   for (const dirxent_t &e : dir)
+ *       chprintf(chp, "%s %lu\r\n", e.name, (unsigned long)e.size);
+ *   if (dir.result() != FR_OK)
+ *       ...
+ **/
 
 #include "ff.h"
 
-/** 
- * The functions contained here is to emulate/translate
- * normal dirent.h calls - opendir, readdir and closedir
- * to fatfs calls.
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bytes of entry records per dirxRead() call, at least one record of
+ * the longest name.
+ **/
+#if !defined(DIRX_BATCH_SIZE)
+#define DIRX_BATCH_SIZE         512
+#endif
+
+/**
+ * Number of dirx_t of the pool of dirxAlloc().
  **/
-typedef struct _dirent {
-    int	d_ino;
-    int d_off;
-    unsigned short d_reclen;
-    unsigned char  d_type;
-    char d_name[_MAX_LFN];
-} dirent;
+#if !defined(DIRX_POOL_SIZE)
+#define DIRX_POOL_SIZE          2
+#endif
+
+typedef struct {
+    uint32_t size;              /* File size.                           */
+    uint16_t date;              /* FAT date of the last change.         */
+    uint16_t time;              /* FAT time of the last change.         */
+    uint8_t attrib;             /* AM_ flags.                           */
+    uint8_t namelen;
+    uint16_t reclen;            /* Record bytes, a multiple of 4.       */
+    char name[1];               /* NUL terminated, longer than 1.       */
+} dirxent_t;
+
+#define DIRX_RECLEN(namelen)                                                \
+    ((offsetof(dirxent_t, name) + (namelen) + 1 + 3) & ~(size_t)3)
 
-DIR * opendir(const char * filename);
-dirent * readdir(DIR * dirp);
-int closedir(DIR * dirp);
+#if (DIRX_BATCH_SIZE & 3) != 0 || DIRX_BATCH_SIZE < (12 + _MAX_LFN + 1 + 3)
+#error "DIRX_BATCH_SIZE must be a multiple of 4 holding the longest name"
+#endif
 
+typedef struct {
+    DIR dir;
+    FILINFO fno;                /* Last entry read from FatFs.          */
+    FRESULT res;                /* First error, FR_OK if none.          */
+    bool open;
+    bool pending;               /* fno did not fit in the last batch.   */
+    bool end;
+    char lfn[_MAX_LFN + 1];
+    uint32_t batch[DIRX_BATCH_SIZE / 4];
+} dirx_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FRESULT dirxOpen(dirx_t *dp, const char *path);
+int dirxRead(dirx_t *dp);
+FRESULT dirxClose(dirx_t *dp);
+dirx_t *dirxAlloc(void);
+void dirxFree(dirx_t *dp);
 
 #ifdef __cplusplus
 }
 #endif
 
+/**
+ * First entry of the last batch.
+ **/
+static inline const dirxent_t *dirxFirst(const dirx_t *dp)
+{
+    return (const dirxent_t *)dp->batch;
+}
+
+/**
+ * Entry after ep in the same batch, the caller counts the entries.
+ **/
+static inline const dirxent_t *dirxNext(const dirxent_t *ep)
+{
+    return (const dirxent_t *)((const uint8_t *)ep + ep->reclen);
+}
+
+#ifdef __cplusplus
+
+/**
+ * Range for listing of a directory. The state comes from the pool of
+ * dirxAlloc(), or from the caller. A failure to open, an empty pool or
+ * a read error end the iteration and are returned by result().
+ **/
+class DirReader {
+public:
+    class iterator {
+    public:
+        iterator(DirReader *reader, const dirxent_t *ep, int left)
+            : reader(reader), ep(ep), left(left) {}
+        const dirxent_t &operator*() const { return *ep; }
+        const dirxent_t *operator->() const { return ep; }
+        bool operator!=(const iterator &other) const { return ep != other.ep; }
+        iterator &operator++()
+        {
+            if (--left > 0)
+                ep = dirxNext(ep);
+            else
+                *this = reader->fill();
+            return *this;
+        }
+    private:
+        DirReader *reader;
+        const dirxent_t *ep;
+        int left;
+    };
+
+    explicit DirReader(const char *path)
+        : dp(dirxAlloc()), pooled(true)
+    {
+        res = dp != NULL ? dirxOpen(dp, path) : FR_TOO_MANY_OPEN_FILES;
+    }
+
+    DirReader(dirx_t *dp, const char *path)
+        : dp(dp), pooled(false)
+    {
+        res = dirxOpen(dp, path);
+    }
+
+    ~DirReader()
+    {
+        if (dp != NULL) {
+            dirxClose(dp);
+            if (pooled)
+                dirxFree(dp);
+        }
+    }
+
+    DirReader(const DirReader &) = delete;
+    DirReader &operator=(const DirReader &) = delete;
+
+    /* Single pass, begin() reads the first batch. */
+    iterator begin() { return fill(); }
+    iterator end() { return iterator(this, NULL, 0); }
+
+    FRESULT result() const { return dp != NULL ? dp->res : res; }
+
+private:
+    iterator fill()
+    {
+        int n = res == FR_OK ? dirxRead(dp) : -1;
+
+        return n > 0 ? iterator(this, dirxFirst(dp), n) : end();
+    }
+
+    dirx_t *dp;
+    bool pooled;
+    FRESULT res;
+};
+
 #endif
 
+#endif
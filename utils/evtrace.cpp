@@ -0,0 +1,195 @@
+#include "ch.h"
+#include "hal.h"
+#include "evtrace.h"
+#include "cycles.h"
+
+#include <string.h>
+
+#define EVTRACE_MASK    (EVTRACE_BUFFER_SIZE - 1)
+
+#if (EVTRACE_BUFFER_SIZE & EVTRACE_MASK) != 0
+#error "EVTRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+/**
+ * The ring and its write counter, the record for a given count lives
+ * at ring[count & EVTRACE_MASK]. Only written with the kernel locked
+ * or, in the IRQ hooks, inside a port level critical zone.
+ **/
+static evtrace_record_t ring[EVTRACE_BUFFER_SIZE];
+static uint32_t count;
+static unsigned classes;
+
+/* Only used with dumpmtx held, the shell and the HTTP server can dump
+   at the same time. */
+static MUTEX_DECL(dumpmtx);
+static evtrace_thread_t threads[EVTRACE_MAX_THREADS];
+
+static inline void put(unsigned type, uint32_t obj, uint32_t arg)
+{
+    evtrace_record_t *rp = &ring[count++ & EVTRACE_MASK];
+
+    rp->ts = (uint32_t)chSysGetRealtimeCounterX();
+    rp->obj = obj;
+    rp->arg = (uint16_t)arg;
+    rp->type = (uint8_t)type;
+    rp->flags = 0;
+}
+
+static inline uint32_t irq_number(void)
+{
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    return __get_IPSR();
+#else
+    return 0;
+#endif
+}
+
+#if EVTRACE_ENABLED
+/* Invoked by chSysSwitch() with the kernel locked. */
+void _evtrace_switch(thread_t *ntp, thread_t *otp)
+{
+    if (classes & EVTRACE_CLASS_SWITCH)
+        put(EVTRACE_SWITCH, (uint32_t)(uintptr_t)ntp, otp->p_state);
+}
+
+/* IRQ prologue/epilogue hooks, same locking as the cpuload hooks. */
+void _evtrace_irq_enter(void)
+{
+    port_lock_from_isr();
+    if (classes & EVTRACE_CLASS_IRQ)
+        put(EVTRACE_IRQ_ENTER, 0, irq_number());
+    port_unlock_from_isr();
+}
+
+void _evtrace_irq_leave(void)
+{
+    port_lock_from_isr();
+    if (classes & EVTRACE_CLASS_IRQ)
+        put(EVTRACE_IRQ_LEAVE, 0, irq_number());
+    port_unlock_from_isr();
+}
+
+/* Kernel objects hook, always invoked with the kernel locked. */
+void _evtrace_object(unsigned type, const void *objp, uint32_t arg)
+{
+    if (classes & EVTRACE_CLASS_OBJECT)
+        put(type, (uint32_t)(uintptr_t)objp, arg);
+}
+#endif
+
+/**
+ * Starts recording the given EVTRACE_CLASS_xxx event classes, the
+ * records already in the ring are kept.
+ **/
+void evtraceStart(unsigned mask)
+{
+    chSysLock();
+    classes = mask & EVTRACE_CLASS_ALL;
+    chSysUnlock();
+}
+
+void evtraceStop(void)
+{
+    chSysLock();
+    classes = 0;
+    chSysUnlock();
+}
+
+void evtraceClear(void)
+{
+    chSysLock();
+    count = 0;
+    chSysUnlock();
+}
+
+unsigned evtraceGetClasses(void)
+{
+    return classes;
+}
+
+/**
+ * Returns the number of records currently held in the ring.
+ **/
+size_t evtraceCount(void)
+{
+    uint32_t n = count;
+
+    return n > EVTRACE_BUFFER_SIZE ? EVTRACE_BUFFER_SIZE : n;
+}
+
+/**
+ * Records a user marker, can be called from any context.
+ **/
+void evtraceMark(uint32_t id, uint16_t arg)
+{
+    syssts_t sts = chSysGetStatusAndLockX();
+
+    if (classes & EVTRACE_CLASS_MARK)
+        put(EVTRACE_MARK, id, arg);
+    chSysRestoreStatusX(sts);
+}
+
+/**
+ * Writes the header, the thread table and the records through the
+ * out callback. Recording is paused meanwhile so the ring is stable,
+ * then the previous classes are restored. Concurrent dumps wait for
+ * each other. Returns zero on success or the first non zero value
+ * returned by the callback.
+ **/
+int evtraceSerialize(evtrace_write_t out, void *ctx)
+{
+    evtrace_header_t hdr;
+    thread_t *tp;
+    unsigned saved;
+    uint32_t n, first, chunk;
+    int err;
+
+    chMtxLock(&dumpmtx);
+    chSysLock();
+    saved = classes;
+    classes = 0;
+    n = count;
+    chSysUnlock();
+
+    memcpy(hdr.magic, "EVT1", 4);
+    hdr.clock_hz = CYCLES_CLOCK_HZ;
+    hdr.lost = n > EVTRACE_BUFFER_SIZE ? n - EVTRACE_BUFFER_SIZE : 0;
+    hdr.nrecords = n - hdr.lost;
+    hdr.nthreads = 0;
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+        if (hdr.nthreads < EVTRACE_MAX_THREADS) {
+            evtrace_thread_t *etp = &threads[hdr.nthreads++];
+            const char *name = chRegGetThreadNameX(tp);
+
+            etp->tp = (uint32_t)(uintptr_t)tp;
+            memset(etp->name, 0, sizeof(etp->name));
+            if (name != NULL)
+                strncpy(etp->name, name, sizeof(etp->name) - 1);
+        }
+        tp = chRegNextThread(tp);
+    }
+
+    err = out(ctx, &hdr, sizeof(hdr));
+    if (!err)
+        err = out(ctx, threads, hdr.nthreads * sizeof(evtrace_thread_t));
+
+    /* Oldest first, the ring content may be split in two chunks. */
+    first = hdr.lost & EVTRACE_MASK;
+    chunk = EVTRACE_BUFFER_SIZE - first;
+    if (chunk > hdr.nrecords)
+        chunk = hdr.nrecords;
+    if (!err && chunk)
+        err = out(ctx, &ring[first], chunk * sizeof(evtrace_record_t));
+    if (!err && hdr.nrecords > chunk)
+        err = out(ctx, &ring[0],
+                    (hdr.nrecords - chunk) * sizeof(evtrace_record_t));
+
+    chSysLock();
+    classes = saved;
+    chSysUnlock();
+    chMtxUnlock(&dumpmtx);
+    return err;
+}
@@ -0,0 +1,140 @@
+#ifndef __EVTRACE_H__
+#define __EVTRACE_H__
+
+/**
+ * Binary kernel event trace recorder.
+ *
+ * Context switches, IRQ enter/leave, semaphore, mutex and mailbox
+ * operations, virtual timer expirations and user markers are stored
+ * with a realtime counter timestamp into a RAM ring, the oldest records
+ * are overwritten once the ring is full.
+ *
+ * The ring is serialized as: a header, a table of the registered
+ * threads and the records oldest first, see tools/evtrace2json.py for
+ * the conversion to Chrome/Perfetto trace JSON.
+ *
+ * The hooks are wired in chconf.h, this header is included from there
+ * so it must stay plain C and must not depend on the kernel types.
+ **/
+
+/**
+ * Set to FALSE in order to remove the recorder hooks.
+ **/
+#if !defined(EVTRACE_ENABLED)
+#define EVTRACE_ENABLED         TRUE
+#endif
+
+/**
+ * Number of records in the ring, must be a power of two.
+ **/
+#if !defined(EVTRACE_BUFFER_SIZE)
+#define EVTRACE_BUFFER_SIZE     512
+#endif
+
+/**
+ * Maximum number of threads stored in the serialized thread table.
+ **/
+#if !defined(EVTRACE_MAX_THREADS)
+#define EVTRACE_MAX_THREADS     24
+#endif
+
+/**
+ * Record types, 1..15 are the CH_TRACE_xxx kernel object events.
+ **/
+#define EVTRACE_SWITCH          16U     /* obj = new thread, arg = old
+                                           thread state.                */
+#define EVTRACE_IRQ_ENTER       17U     /* arg = exception number.      */
+#define EVTRACE_IRQ_LEAVE       18U
+#define EVTRACE_MARK            19U     /* obj = marker id.             */
+
+/**
+ * Event classes for evtraceStart().
+ **/
+#define EVTRACE_CLASS_SWITCH    0x01U
+#define EVTRACE_CLASS_IRQ       0x02U
+#define EVTRACE_CLASS_OBJECT    0x04U
+#define EVTRACE_CLASS_MARK      0x08U
+#define EVTRACE_CLASS_ALL       0x0FU
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * One trace record, 12 bytes, little endian on the wire.
+ **/
+typedef struct {
+  uint32_t ts;                  /* Realtime counter value.              */
+  uint32_t obj;                 /* Thread or object address, marker id. */
+  uint16_t arg;                 /* Event specific argument.             */
+  uint8_t type;                 /* EVTRACE_xxx or CH_TRACE_xxx.         */
+  uint8_t flags;                /* Reserved, zero.                      */
+} evtrace_record_t;
+
+/**
+ * Serialized stream header.
+ **/
+typedef struct {
+  char magic[4];                /* "EVT1".                              */
+  uint32_t clock_hz;            /* Timestamp frequency.                 */
+  uint32_t nrecords;            /* Records following the thread table.  */
+  uint32_t nthreads;            /* Thread table entries.                */
+  uint32_t lost;                /* Records overwritten since the clear. */
+} evtrace_header_t;
+
+/**
+ * Serialized thread table entry.
+ **/
+typedef struct {
+  uint32_t tp;
+  char name[16];
+} evtrace_thread_t;
+
+/**
+ * Output callback used by evtraceSerialize(), returns zero on success.
+ **/
+typedef int (*evtrace_write_t)(void *ctx, const void *buf, size_t n);
+
+#if EVTRACE_ENABLED
+struct ch_thread;
+void _evtrace_switch(struct ch_thread *ntp, struct ch_thread *otp);
+void _evtrace_irq_enter(void);
+void _evtrace_irq_leave(void);
+void _evtrace_object(unsigned type, const void *objp, uint32_t arg);
+#endif
+
+void evtraceStart(unsigned classes);
+void evtraceStop(void);
+void evtraceClear(void);
+unsigned evtraceGetClasses(void);
+size_t evtraceCount(void);
+void evtraceMark(uint32_t id, uint16_t arg);
+int evtraceSerialize(evtrace_write_t out, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+/**
+ * Hook bodies used by chconf.h.
+ **/
+#if EVTRACE_ENABLED
+#define EVTRACE_SWITCH_HOOK(ntp, otp)       _evtrace_switch(ntp, otp)
+#define EVTRACE_IRQ_ENTER_HOOK()            _evtrace_irq_enter()
+#define EVTRACE_IRQ_LEAVE_HOOK()            _evtrace_irq_leave()
+#define EVTRACE_OBJECT_HOOK(ev, objp, arg)  _evtrace_object(ev, objp, arg)
+#else
+#define EVTRACE_SWITCH_HOOK(ntp, otp)
+#define EVTRACE_IRQ_ENTER_HOOK()
+#define EVTRACE_IRQ_LEAVE_HOOK()
+#define EVTRACE_OBJECT_HOOK(ev, objp, arg)
+#endif
+
+#endif
@@ -1,44 +1,239 @@
+#include "ch.h"
+#include "ff.h"
 #include "globalconfig.h"
-#include "dictionary.h"
-#include "iniutils.h"
+#include "cfgimage.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_DICT_NAME 200
-static char tmpstr[MAX_DICT_NAME];
+static const cfgdef_t *defs;
+static size_t ndefs;
+static uint32_t schema;
 
-static int onconfigparse(void * usercfg, const char * section, const char * name, const char * value)
+static cfgimg_t banks[2];
+static cfgimg_t * volatile current = &banks[0];
+static const char *source = "defaults";
+
+/* Only used with loadmtx held, off the caller stack. */
+static MUTEX_DECL(loadmtx);
+static FIL file;
+
+static int read_file(void *readctx, char *buf, size_t size)
 {
-    (void) usercfg;
+    UINT n;
 
-    strncpy(tmpstr, section, MAX_DICT_NAME);
-    strcat(tmpstr, "_");
-    strcat(tmpstr, name);
+    if (f_read((FIL *)readctx, buf, (UINT)size, &n) != FR_OK)
+        return -1;
+    return (int)n;
+}
 
-    // add the item into the dictionary
-    if ( dict_install(tmpstr, value) != NULL)
+/* filename with the ".bin" extension, false if it does not fit. */
+static bool snapshot_path(const char *filename, char *path, size_t size)
+{
+    const char *dot = strrchr(filename, '.');
+    size_t len;
+
+    if ((dot == NULL) || (strchr(dot, '/') != NULL))
+        dot = filename + strlen(filename);
+    len = (size_t)(dot - filename);
+    if (len + sizeof(".bin") > size)
+        return false;
+    memcpy(path, filename, len);
+    memcpy(path + len, ".bin", sizeof(".bin"));
+    return true;
+}
+
+/* Reads the snapshot into img with one f_read(), it must match the INI
+   file and the key table. */
+static bool load_snapshot(const char *path, cfgimg_t *img, uint32_t srcsize,
+                          uint32_t srctime)
+{
+    UINT n;
+    bool ok;
+
+    if (f_open(&file, path, FA_READ) != FR_OK)
+        return false;
+    ok = (f_read(&file, img, sizeof(*img), &n) == FR_OK) &&
+         cfgimgValid(img, n, schema) && (img->hdr.srcsize == srcsize) &&
+         (img->hdr.srctime == srctime);
+    f_close(&file);
+    return ok;
+}
+
+static void save_snapshot(const char *path, const cfgimg_t *img)
+{
+    UINT n;
+
+    if (f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return;
+    if ((f_write(&file, img, img->hdr.size, &n) != FR_OK) ||
+        (n != img->hdr.size)) {
+        f_close(&file);
+        f_unlink(path);
+        return;
+    }
+    f_close(&file);
+}
+
+/**
+ * Installs the key table, which must stay in memory, and loads the
+ * defaults. Returns -1 if the table is too large, if two keys collide
+ * or if a default does not parse.
+ **/
+int configInit(const cfgdef_t *table, size_t n)
+{
+    int ret;
+
+    chMtxLock(&loadmtx);
+    ret = cfgimgInit(&banks[0], table, n);
+    if (ret == 0)
+        ret = cfgimgDefaults(&banks[0], table, n);
+    if (ret == 0) {
+        cfgimgFinish(&banks[0], 0, 0);
+        defs = table;
+        ndefs = n;
+        schema = banks[0].hdr.schema;
+        current = &banks[0];
+        source = "defaults";
+    }
+    chMtxUnlock(&loadmtx);
+    return ret;
+}
+
+/**
+ * Loads filename over the defaults, or its snapshot if it is up to
+ * date. The new values are published only if the file has no errors,
+ * returns the number of errors or -1 if the file cannot be read.
+ **/
+int parseconfig(const char *filename, cfgreport_t report, void *arg)
+{
+    cfgimg_t *img;
+    iniparser_t *ip;
+    FILINFO fno;
+    uint32_t srcsize, srctime;
+    char path[64];
+    bool snapshot;
+    int ret;
+
+    chMtxLock(&loadmtx);
+    img = current == &banks[0] ? &banks[1] : &banks[0];
+#if _USE_LFN
+    fno.lfname = 0;
+    fno.lfsize = 0;
+#endif
+    if ((defs == NULL) || (f_stat(filename, &fno) != FR_OK)) {
+        chMtxUnlock(&loadmtx);
+        return -1;
+    }
+    srcsize = (uint32_t)fno.fsize;
+    srctime = ((uint32_t)fno.fdate << 16) | fno.ftime;
+    snapshot = CONFIG_SNAPSHOT && snapshot_path(filename, path, sizeof(path));
+
+    if (snapshot && load_snapshot(path, img, srcsize, srctime)) {
+        current = img;
+        source = "snapshot";
+        chMtxUnlock(&loadmtx);
         return 0;
-    else 
+    }
+
+    ip = (iniparser_t *)malloc(sizeof(iniparser_t));
+    if ((ip == NULL) || (f_open(&file, filename, FA_READ) != FR_OK)) {
+        free(ip);
+        chMtxUnlock(&loadmtx);
         return -1;
+    }
+    ret = cfgimgParse(img, defs, ndefs, ip, read_file, &file, report, arg);
+    f_close(&file);
+    free(ip);
+
+    if (ret == 0) {
+        cfgimgFinish(img, srcsize, srctime);
+        current = img;
+        source = "ini";
+        if (snapshot)
+            save_snapshot(path, img);
+    }
+    chMtxUnlock(&loadmtx);
+    return ret;
+}
+
+/**
+ * Origin of the published values: "defaults", "ini" or "snapshot".
+ **/
+const char *configSource(void)
+{
+    return source;
+}
+
+size_t configCount(void)
+{
+    return ndefs;
+}
+
+const cfgdef_t *configDef(size_t i)
+{
+    return i < ndefs ? &defs[i] : NULL;
+}
+
+/* Slot of key in the published bank img, NULL if key is not in the
+   table or has no value. */
+static const cfgimg_slot_t *get_slot(const cfgimg_t *img, uint32_t key,
+                                     cfgtype_t type)
+{
+    int k = cfgimgFind(img, key);
+
+    if (k < 0 || img->slots[k].text == CFGIMG_NONE)
+        return NULL;
+    chDbgAssert(defs[k].type == type, "wrong config type");
+    (void)type;
+    return &img->slots[k];
+}
+
+int32_t configInt(uint32_t key)
+{
+    const cfgimg_slot_t *sp = get_slot(current, key, CFG_INT);
+
+    return sp != NULL ? (int32_t)sp->value : 0;
 }
 
-int parseconfig(const char * filename)
+bool configBool(uint32_t key)
 {
-   return parse_ini(filename, onconfigparse, NULL);
+    const cfgimg_slot_t *sp = get_slot(current, key, CFG_BOOL);
+
+    return sp != NULL ? sp->value != 0 : false;
 }
 
-const char * getconfig(const char * section, const char * name)
+uint32_t configIp(uint32_t key)
 {
-    strncpy(tmpstr, section, MAX_DICT_NAME);
-    strcat(tmpstr, "_");
-    strcat(tmpstr, name);
+    const cfgimg_slot_t *sp = get_slot(current, key, CFG_IP);
+
+    return sp != NULL ? sp->value : 0;
+}
 
-    nlist * dta = dict_lookup(tmpstr);
-    if (dta)
-        return dta->defn;
+cfgstr_t configStr(uint32_t key)
+{
+    const cfgimg_t *img = current;
+    const cfgimg_slot_t *sp = get_slot(img, key, CFG_STR);
+    cfgstr_t s = {"", 0};
 
-    return NULL;
+    if (sp != NULL) {
+        s.ptr = &img->pool[sp->text];
+        s.len = sp->len;
+    }
+    return s;
 }
 
+/**
+ * Text of any key, NULL if it is unknown or has no value. The key is
+ * hashed at run time, prefer CONFIG_KEY() and the typed getters.
+ **/
+const char *getconfig(const char *section, const char *name)
+{
+    const cfgimg_t *img = current;
+    int k = cfgimgFind(img, cfgKey(section, name));
 
+    if (k < 0 || strcmp(defs[k].section, section) != 0 ||
+        strcmp(defs[k].name, name) != 0)
+        return NULL;
+    return cfgimgText(img, k);
+}
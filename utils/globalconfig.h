@@ -3,12 +3,127 @@
 
 /**
  * Author : Cola Vergil
- * Email  : vpcola@gmail.com 
+ * Email  : vpcola@gmail.com
  * Date : Fri Mar 06 2015
  **/
 
-int parseconfig(const char * filename);
-const char * getconfig(const char * name);
+/**
+ * Typed configuration.
+ *
+ * The application declares its keys in a cfgdef_t table given to
+ * configInit(): section, name, type, default text and whether the key
+ * must appear in the file. parseconfig() reads an INI file and parses
+ * each value once into the typed slot of its key. Unknown keys, values
+ * that do not parse and missing required keys are reported at that
+ * point through a callback.
+ *
+ * A key is identified by the hash of its section and name. CONFIG_KEY()
+ * computes it at compile time, so a lookup is a probe of a small index
+ * on a 32 bits integer, without string work, allocation or locking.
+ * The keys of a table must have distinct hashes, configInit() checks
+ * it.
+ *
+ * The values are kept in two banks. A load fills the inactive bank and
+ * publishes it with a single pointer store, the readers on any thread
+ * see either the previous or the new configuration. The string views
+ * point into a bank and stay valid until the second following load.
+ *
+ * With CONFIG_SNAPSHOT a successful load also writes the bank, a
+ * compiled image, next to the INI file with the ".bin" extension. The
+ * next load of the unchanged file reads the image back instead of
+ * parsing, see cfgimage.h.
+ *
+ * This header needs C++11 for constexpr.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maximum number of keys and string storage of a bank, the text of
+ * every value is kept.
+ **/
+#if !defined(CONFIG_MAX_KEYS)
+#define CONFIG_MAX_KEYS         32
+#endif
+
+#if !defined(CONFIG_POOL_SIZE)
+#define CONFIG_POOL_SIZE        512
+#endif
 
+/**
+ * Set to FALSE in order to always parse the INI file.
+ **/
+#if !defined(CONFIG_SNAPSHOT)
+#define CONFIG_SNAPSHOT         TRUE
 #endif
 
+typedef enum {
+    CFG_INT,                    /* Decimal, hex or octal int32_t.       */
+    CFG_BOOL,                   /* true/false, yes/no, on/off, 1/0.     */
+    CFG_IP,                     /* Dotted quad IPv4 address.            */
+    CFG_STR                     /* Any text.                            */
+} cfgtype_t;
+
+typedef struct {
+    const char *section;
+    const char *name;
+    cfgtype_t type;
+    const char *defval;         /* Default text, NULL for none.         */
+    bool required;              /* Must be present in the file.         */
+} cfgdef_t;
+
+/**
+ * View of a string value, ptr is NUL terminated.
+ **/
+typedef struct {
+    const char *ptr;
+    size_t len;
+} cfgstr_t;
+
+/**
+ * Receives the problems found by parseconfig(), section and name are
+ * those of the file or of the table. line is 0 for a missing key, the
+ * name is empty for a line that does not parse.
+ **/
+typedef void (*cfgreport_t)(void *arg, unsigned line, const char *section,
+                            const char *name, const char *msg);
+
+/**
+ * FNV-1a hash of section, a NUL separator and name.
+ **/
+constexpr uint32_t cfgHashStep(const char *s, uint32_t h)
+{
+    return *s == '\0' ? h : cfgHashStep(s + 1, (h ^ (uint8_t)*s) * 16777619U);
+}
+
+constexpr uint32_t cfgKey(const char *section, const char *name)
+{
+    return cfgHashStep(name, cfgHashStep(section, 2166136261U) * 16777619U);
+}
+
+template <uint32_t K>
+struct cfgConstKey {
+    static const uint32_t value = K;
+};
+
+/**
+ * Key of a (section, name) pair, evaluated at compile time.
+ **/
+#define CONFIG_KEY(section, name)   (cfgConstKey<cfgKey(section, name)>::value)
+
+int configInit(const cfgdef_t *defs, size_t n);
+int parseconfig(const char *filename, cfgreport_t report, void *arg);
+
+const char *configSource(void);
+size_t configCount(void);
+const cfgdef_t *configDef(size_t i);
+
+int32_t configInt(uint32_t key);
+bool configBool(uint32_t key);
+uint32_t configIp(uint32_t key);
+cfgstr_t configStr(uint32_t key);
+
+const char *getconfig(const char *section, const char *name);
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+
+/**
+ * Open addressing string map with the keys interned in an arena.
+ *
+ * StringMap<V> maps C strings to values of type V. The table is a
+ * power of two array of slots probed linearly with the Robin Hood
+ * rule: an insertion displaces the entries closer to their home slot,
+ * so the probe lengths stay short and a lookup for a missing key stops
+ * as soon as it meets an entry richer than itself. Deletion shifts the
+ * following entries back instead of leaving tombstones. The table
+ * doubles when it is 7/8 full.
+ *
+ * Each slot keeps the full 32 bits hash, the keys are only compared on
+ * a hash match and a resize does not hash again. The hash is FNV-1a
+ * followed by the murmur3 finalizer, which mixes the short, similar
+ * keys of the configuration files well.
+ *
+ * The keys are copied into an Arena owned by the map, a bump allocator
+ * over chunks taken with malloc(), so an entry costs no allocation of
+ * its own and there is no fragmentation. Erased keys are only
+ * reclaimed by clear(). The arena can store the values too, see the
+ * dictionary shim in dictionary.cpp.
+ *
+ * The maps are not thread safe. The pointers returned by find() and
+ * insert() are valid until the next insert() or erase().
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace hashmap {
+
+  /**
+   * 32 bits string hash, len receives the string length when not NULL.
+   **/
+  inline uint32_t hashString(const char *s, size_t *len) {
+    const char *p = s;
+    uint32_t h = 2166136261U;
+
+    while (*p != '\0') {
+      h ^= (uint8_t)*p++;
+      h *= 16777619U;
+    }
+    if (len != NULL)
+      *len = (size_t)(p - s);
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+  }
+
+  /**
+   * Bump allocator over a list of malloc'ed chunks. The blocks are
+   * aligned to a pointer size and are released all together.
+   **/
+  class Arena {
+  public:
+    explicit Arena(size_t chunksize = 512)
+      : chunks(NULL), next(NULL), end(NULL), chunksize(chunksize),
+        usedbytes(0), reservedbytes(0) {}
+
+    ~Arena() { clear(); }
+
+    void *alloc(size_t n) {
+      char *p;
+
+      n = (n + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+      if ((size_t)(end - next) < n) {
+        if (!grow(n))
+          return NULL;
+      }
+      p = next;
+      next += n;
+      usedbytes += n;
+      return p;
+    }
+
+    /* Copies the len characters of s and a terminator. */
+    char *strdup(const char *s, size_t len) {
+      char *p = (char *)alloc(len + 1);
+
+      if (p != NULL) {
+        memcpy(p, s, len);
+        p[len] = '\0';
+      }
+      return p;
+    }
+
+    void clear(void) {
+      while (chunks != NULL) {
+        Chunk *c = chunks;
+
+        chunks = c->next;
+        free(c);
+      }
+      next = end = NULL;
+      usedbytes = reservedbytes = 0;
+    }
+
+    /* Bytes handed out, and bytes taken from the heap. */
+    size_t used(void) const { return usedbytes; }
+    size_t reserved(void) const { return reservedbytes; }
+
+  private:
+    struct Chunk {
+      Chunk *next;
+      void *align;
+    };
+
+    /* The rest of the current chunk is abandoned. */
+    bool grow(size_t n) {
+      size_t size = sizeof(Chunk) + (n > chunksize ? n : chunksize);
+      Chunk *c = (Chunk *)malloc(size);
+
+      if (c == NULL)
+        return false;
+      c->next = chunks;
+      chunks = c;
+      next = (char *)(c + 1);
+      end = (char *)c + size;
+      reservedbytes += size;
+      return true;
+    }
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    Chunk *chunks;
+    char *next;
+    char *end;
+    size_t chunksize;
+    size_t usedbytes;
+    size_t reservedbytes;
+  };
+
+  /**
+   * String keyed map, V must be copyable and default constructible.
+   **/
+  template <typename V>
+  class StringMap {
+  public:
+    explicit StringMap(size_t chunksize = 512)
+      : slots(NULL), mask(0), count(0), keys(chunksize) {}
+
+    ~StringMap() { free(slots); }
+
+    /* Returns the value of key or NULL. */
+    V *find(const char *key) {
+      size_t i = lookup(key, hashString(key, NULL));
+
+      return i != NPOS ? &slots[i].value : NULL;
+    }
+
+    const V *find(const char *key) const {
+      return const_cast<StringMap *>(this)->find(key);
+    }
+
+    /* Inserts key or replaces its value, returns the stored value or
+       NULL when out of memory. The interned copy of the key is stored
+       in ikey when not NULL. */
+    V *insert(const char *key, const V &value, const char **ikey = NULL) {
+      size_t len, i;
+      uint32_t h = hashString(key, &len);
+      Slot s;
+
+      i = lookup(key, h);
+      if (i != NPOS) {
+        slots[i].value = value;
+        if (ikey != NULL)
+          *ikey = slots[i].key;
+        return &slots[i].value;
+      }
+      if (((count + 1) * 8 > (mask + 1) * 7) && !resize(mask ? 2 * (mask + 1) : 16))
+        return NULL;
+      s.key = keys.strdup(key, len);
+      if (s.key == NULL)
+        return NULL;
+      s.hash = h;
+      s.value = value;
+      count++;
+      if (ikey != NULL)
+        *ikey = s.key;
+      return &slots[place(s)].value;
+    }
+
+    /* Removes key, returns false when it is not in the map. */
+    bool erase(const char *key) {
+      size_t i = lookup(key, hashString(key, NULL));
+      size_t j;
+
+      if (i == NPOS)
+        return false;
+      /* Backward shift of the entries displaced by the erased one. */
+      for (j = (i + 1) & mask;
+           (slots[j].key != NULL) && (distance(j) != 0);
+           j = (j + 1) & mask) {
+        slots[i] = slots[j];
+        i = j;
+      }
+      slots[i].key = NULL;
+      slots[i].value = V();
+      count--;
+      return true;
+    }
+
+    /* Removes all the entries and releases the keys, the table is
+       kept. */
+    void clear(void) {
+      size_t i;
+
+      for (i = 0; slots != NULL && i <= mask; i++) {
+        slots[i].key = NULL;
+        slots[i].value = V();
+      }
+      count = 0;
+      keys.clear();
+    }
+
+    /* Sizes the table for n entries without further resizing. */
+    bool reserve(size_t n) {
+      size_t cap = 16;
+
+      while (n * 8 > cap * 7)
+        cap *= 2;
+      return cap <= mask + 1 || resize(cap);
+    }
+
+    /* Invokes fn(key, value, arg) for each entry, in table order. */
+    template <typename F>
+    void forEach(F fn, void *arg) {
+      size_t i;
+
+      for (i = 0; slots != NULL && i <= mask; i++) {
+        if (slots[i].key != NULL)
+          fn(slots[i].key, slots[i].value, arg);
+      }
+    }
+
+    /* Longest probe sequence, a measure of the clustering. */
+    size_t maxProbe(void) const {
+      size_t i, d, m = 0;
+
+      for (i = 0; slots != NULL && i <= mask; i++) {
+        if ((slots[i].key != NULL) && ((d = distance(i)) > m))
+          m = d;
+      }
+      return m;
+    }
+
+    size_t size(void) const { return count; }
+    size_t capacity(void) const { return slots != NULL ? mask + 1 : 0; }
+
+    /* Arena of the interned keys, it can hold other data that lives as
+       long as the map content. */
+    Arena &arena(void) { return keys; }
+
+  private:
+    struct Slot {
+      const char *key;          /* NULL for an empty slot.            */
+      uint32_t hash;
+      V value;
+    };
+
+    static const size_t NPOS = (size_t)-1;
+
+    /* Distance of the entry in slot i from its home slot. */
+    size_t distance(size_t i) const {
+      return (i - (slots[i].hash & mask)) & mask;
+    }
+
+    size_t lookup(const char *key, uint32_t h) const {
+      size_t i, d;
+
+      if (count == 0)
+        return NPOS;
+      for (i = h & mask, d = 0; slots[i].key != NULL;
+           i = (i + 1) & mask, d++) {
+        if (distance(i) < d)
+          break;
+        if ((slots[i].hash == h) && (strcmp(slots[i].key, key) == 0))
+          return i;
+      }
+      return NPOS;
+    }
+
+    /* Robin Hood insertion of a new key, returns its slot. */
+    size_t place(Slot s) {
+      size_t i, d, sd, at = NPOS;
+      Slot t;
+
+      for (i = s.hash & mask, d = 0; ; i = (i + 1) & mask, d++) {
+        if (slots[i].key == NULL) {
+          slots[i] = s;
+          return at != NPOS ? at : i;
+        }
+        sd = distance(i);
+        if (sd < d) {
+          t = slots[i];
+          slots[i] = s;
+          s = t;
+          d = sd;
+          if (at == NPOS)
+            at = i;
+        }
+      }
+    }
+
+    bool resize(size_t cap) {
+      Slot *old = slots;
+      size_t oldcap = slots != NULL ? mask + 1 : 0;
+      size_t i;
+
+      slots = (Slot *)malloc(cap * sizeof(Slot));
+      if (slots == NULL) {
+        slots = old;
+        return false;
+      }
+      for (i = 0; i < cap; i++) {
+        slots[i].key = NULL;
+        slots[i].value = V();
+      }
+      mask = cap - 1;
+      for (i = 0; i < oldcap; i++) {
+        if (old[i].key != NULL)
+          (void)place(old[i]);
+      }
+      free(old);
+      return true;
+    }
+
+    StringMap(const StringMap &);
+    StringMap &operator=(const StringMap &);
+
+    Slot *slots;
+    size_t mask;
+    size_t count;
+    Arena keys;
+  };
+
+}
+
+#endif
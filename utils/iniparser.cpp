@@ -0,0 +1,172 @@
+#include "iniutils.h"
+
+#include <string.h>
+
+typedef struct {
+    iniparser_t *ip;
+    onparseslice handler;
+    void *usercfg;
+    inislice_t section;
+    unsigned line;
+    unsigned error;             /* First bad line, 0 if none.           */
+} inistate_t;
+
+static inline bool is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') ||
+           (c == '\f');
+}
+
+static const char *skip_space(const char *s, const char *e)
+{
+    while ((s < e) && is_space(*s))
+        s++;
+    return s;
+}
+
+static const char *trim_space(const char *s, const char *e)
+{
+    while ((e > s) && is_space(e[-1]))
+        e--;
+    return e;
+}
+
+/* Nothing but a comment left on the line. */
+static bool at_end(const char *s, const char *e)
+{
+    s = skip_space(s, e);
+    return (s == e) || (*s == ';');
+}
+
+static void bad_line(inistate_t *sp)
+{
+    if (sp->error == 0)
+        sp->error = sp->line;
+}
+
+/* Parses the line [s, e), e is at the newline or at the end of data. */
+static void parse_line(inistate_t *sp, const char *s, const char *e)
+{
+    const char *q, *eq;
+    inislice_t name, value;
+
+    sp->line++;
+    if ((size_t)(e - s) >= INI_LINE_MAX) {
+        bad_line(sp);
+        return;
+    }
+    s = skip_space(s, e);
+    e = trim_space(s, e);
+    if ((s == e) || (*s == ';') || (*s == '#'))
+        return;
+
+    if (*s == '[') {
+        q = (const char *)memchr(s + 1, ']', (size_t)(e - s - 1));
+        if ((q == NULL) || !at_end(q + 1, e)) {
+            bad_line(sp);
+            return;
+        }
+        s = skip_space(s + 1, q);
+        q = trim_space(s, q);
+        if ((size_t)(q - s) >= INI_SECTION_MAX) {
+            bad_line(sp);
+            return;
+        }
+        memcpy(sp->ip->section, s, (size_t)(q - s));
+        sp->ip->section[q - s] = '\0';
+        sp->section.len = (size_t)(q - s);
+        return;
+    }
+
+    eq = (const char *)memchr(s, '=', (size_t)(e - s));
+    if ((eq == NULL) || (eq == s)) {
+        bad_line(sp);
+        return;
+    }
+    name.ptr = s;
+    name.len = (size_t)(trim_space(s, eq) - s);
+
+    s = skip_space(eq + 1, e);
+    if ((s < e) && ((*s == '"') || (*s == '\''))) {
+        q = (const char *)memchr(s + 1, *s, (size_t)(e - s - 1));
+        if ((q == NULL) || !at_end(q + 1, e)) {
+            bad_line(sp);
+            return;
+        }
+        value.ptr = s + 1;
+        value.len = (size_t)(q - s - 1);
+    }
+    else {
+        q = (const char *)memchr(s, ';', (size_t)(e - s));
+        value.ptr = s;
+        value.len = (size_t)(trim_space(s, q != NULL ? q : e) - s);
+    }
+
+    if ((sp->handler != NULL) &&
+        (sp->handler(sp->usercfg, sp->line, &sp->section, &name, &value) != 0))
+        bad_line(sp);
+}
+
+/**
+ * Parses the input of reader into the slice handler. Returns 0 when
+ * the input is valid, the number of the first bad line, or -1 on a
+ * read error.
+ **/
+int ini_parse(iniparser_t * ip,
+    iniread_t reader,
+    void * readctx,
+    onparseslice handler,
+    void * usercfg)
+{
+    inistate_t state;
+    char *p, *end, *nl;
+    size_t keep = 0;
+    bool skip = false;
+    int n;
+
+    state.ip = ip;
+    state.handler = handler;
+    state.usercfg = usercfg;
+    state.section.ptr = ip->section;
+    state.section.len = 0;
+    state.line = 0;
+    state.error = 0;
+    ip->section[0] = '\0';
+
+    do {
+        if ((n = reader(readctx, ip->buf + keep, INI_BLOCK_SIZE)) < 0)
+            return -1;
+        p = ip->buf;
+        end = ip->buf + keep + n;
+
+        while ((nl = (char *)memchr(p, '\n', (size_t)(end - p))) != NULL) {
+            if (skip) {
+                /* Tail of a line that did not fit. */
+                state.line++;
+                bad_line(&state);
+                skip = false;
+            }
+            else
+                parse_line(&state, p, nl);
+            p = nl + 1;
+        }
+
+        keep = (size_t)(end - p);
+        if (n == 0) {
+            if (skip) {
+                state.line++;
+                bad_line(&state);
+            }
+            else if (keep > 0)
+                parse_line(&state, p, end);
+        }
+        else if (skip || (keep >= INI_LINE_MAX)) {
+            skip = true;
+            keep = 0;
+        }
+        else if (keep > 0)
+            memmove(ip->buf, p, keep);
+    } while (n > 0);
+
+    return (int)state.error;
+}
@@ -1,73 +1,80 @@
 #include "iniutils.h"
 #include "ff.h"
-#include "shellutils.h"
 
 #include <string.h>
 #include <stdlib.h>
 
-#define MAX_LINE_LEN 250
-#define MAX_SESSION_LEN 50
+typedef struct {
+    onparseini handler;
+    void * usercfg;
+} inicompat_t;
 
-int parse_ini(const char * filename, 
-    onparseini handler,
+static int read_file(void * readctx, char * buf, size_t size)
+{
+    UINT n;
+
+    if (f_read((FIL *) readctx, buf, (UINT) size, &n) != FR_OK)
+        return -1;
+    return (int) n;
+}
+
+/**
+ * Parses filename into the slice handler, see ini_parse(). Returns -1
+ * if the file cannot be read.
+ **/
+int parse_ini_slices(const char * filename,
+    onparseslice handler,
     void * usercfg)
 {
     FIL fp;
-    char * linebuff = NULL, * p, * pend;
-    char section[MAX_SESSION_LEN];
+    iniparser_t * ip;
+    int ret;
 
     if(f_open(&fp, (const TCHAR *) filename, FA_READ) != FR_OK)
         return -1;
 
-    linebuff = (char *) malloc(MAX_LINE_LEN);
-    if (!linebuff) return -1;
+    // one block for the whole file, nothing is allocated per line
+    ip = (iniparser_t *) malloc(sizeof(iniparser_t));
+    if (!ip) {
+        f_close(&fp);
+        return -1;
+    }
 
-    while(f_gets(linebuff, MAX_LINE_LEN, &fp) != NULL)
-    {
-        p = linebuff;
-        p = lskip(rstrip(p));
-        if (*p == ';') 
-            continue; // skip comments
-        // TODO: also trim end of line comments
-        p = rtrim(p, ';');
-        if (strlen(p) == 0) continue;
+    ret = ini_parse(ip, read_file, &fp, handler, usercfg);
 
-        if (*p == '[') // beginning of a section
-        {
-            // Search the end of the section
-            pend = strchr(p+1, ']');
-            if (pend)
-            {
-                // end of section is found, copy section
-                *pend = '\0';
-                strncpy(section, p+1, MAX_SESSION_LEN);
-            }else
-            {
-                free(linebuff);
-                // end of line comments not found!
-                f_close(&fp);
-                return -1;
-            }
-        }
-        // look for name=value pair
-        if ((pend = strstr(p, "=")) != NULL)
-        {
-            // Split the string
-            // and call the handler for the name/value 
-            // pair
-            *pend = '\0';
-            if (handler) handler(usercfg, 
-                (const char *) section,
-                (const char *) lskip(rstrip(p)),
-                (const char *) lskip(rstrip(pend+1)));
-        }
+    free(ip);
+    f_close(&fp);
 
-    }
+    return ret;
+}
 
-    free(linebuff);
-    f_close(&fp);
+static int onslice(void * usrcfg, unsigned line,
+    const inislice_t * section,
+    const inislice_t * name,
+    const inislice_t * value)
+{
+    inicompat_t * cp = (inicompat_t *) usrcfg;
 
+    (void) line;
+    // terminate in place, the bytes after the slices are free
+    ((char *) name->ptr)[name->len] = '\0';
+    ((char *) value->ptr)[value->len] = '\0';
+    if (cp->handler)
+        cp->handler(cp->usercfg, section->ptr, name->ptr, value->ptr);
     return 0;
 }
 
+/**
+ * Parses filename into a handler of C strings, its return value is
+ * ignored. Returns 0, the first bad line or -1 as parse_ini_slices().
+ **/
+int parse_ini(const char * filename,
+    onparseini handler,
+    void * usercfg)
+{
+    inicompat_t compat;
 
+    compat.handler = handler;
+    compat.usercfg = usercfg;
+    return parse_ini_slices(filename, onslice, &compat);
+}
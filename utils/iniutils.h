@@ -6,13 +6,82 @@
  * Email  : vpcola@gmail.com
  * Date : Fri Mar 06 2015
  **/
+
+/**
+ * Streaming INI parser.
+ *
+ * The input is read in INI_BLOCK_SIZE blocks, a sector, so that FatFs
+ * transfers whole sectors straight into the parser buffer. The lines
+ * are tokenized in place and handed to the callback as slices of the
+ * buffer, a line cut by a block boundary is moved to the front of the
+ * buffer before the next read.
+ *
+ * Syntax, the spaces around the tokens are ignored:
+ *
+ *   ; comment          # comment
+ *   [section]          ; comment
+ *   name = value       ; comment
+ *   name = "value; with spaces "
+ *
+ * The values can be quoted with double or single quotes, the quotes
+ * are removed and there are no escapes. ';' starts a comment after an
+ * unquoted value or a section header.
+ *
+ * A line that does not parse, is longer than INI_LINE_MAX or has a
+ * section name longer than INI_SECTION_MAX is skipped, the parse goes
+ * on and returns the number of the first bad line. A non zero return
+ * of the slice handler marks its line as bad too.
+ *
+ * The byte after each name and value slice belongs to the buffer and
+ * can be overwritten, ptr[len] = '\0' makes a C string in place. The
+ * section slice points to a NUL terminated copy.
+ *
+ * ini_parse() is independent of the file system and also builds on the
+ * host, see test/host/ini_test.cpp.
+ **/
+
+#include <stddef.h>
+
+#define INI_BLOCK_SIZE  512
+#define INI_LINE_MAX    256
+#define INI_SECTION_MAX 64
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct {
+  const char *ptr;
+  size_t len;
+} inislice_t;
+
+/* Reads up to size bytes, returns the count, 0 at the end, -1 on error. */
+typedef int (*iniread_t)(void * readctx, char * buf, size_t size);
+
 typedef int (*onparseini)(void * usrcfg, const char * section, const char *name, const char * value);
 
-int parse_ini(const char * filename, 
+typedef int (*onparseslice)(void * usrcfg, unsigned line,
+    const inislice_t * section,
+    const inislice_t * name,
+    const inislice_t * value);
+
+/* Parser state, about 850 bytes. */
+typedef struct {
+  char section[INI_SECTION_MAX];
+  char buf[INI_LINE_MAX + INI_BLOCK_SIZE + 1];
+} iniparser_t;
+
+int ini_parse(iniparser_t * ip,
+    iniread_t reader,
+    void * readctx,
+    onparseslice handler,
+    void * usercfg);
+
+int parse_ini_slices(const char * filename,
+    onparseslice handler,
+    void * usercfg);
+
+int parse_ini(const char * filename,
     onparseini handler,
     void * usercfg);
 
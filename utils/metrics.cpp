@@ -0,0 +1,166 @@
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "memstreams.h"
+#include "metrics.h"
+
+#include <string.h>
+
+/**
+ * Registered metrics, in registration order. The list only grows and a
+ * metric is fully linked before it becomes reachable, so it is walked
+ * without locking.
+ **/
+static metric_t *head;
+static metric_t *tail;
+
+/**
+ * Export state, the text is assembled in buf and handed to the output
+ * callback when the next line does not fit.
+ **/
+typedef struct {
+    metrics_write_t out;
+    void *ctx;
+    const char *eol;
+    size_t len;
+    int err;
+    char buf[METRICS_BUFFER_SIZE];
+} emitter_t;
+
+static const char * const type_names[] = {"counter", "gauge", "histogram"};
+
+/**
+ * Records one observation, safe from any context. The bucket and the
+ * sum are updated independently, a concurrent export can see them off
+ * by one observation. The count is the sum of the buckets.
+ **/
+void metricObserve(metric_t *mp, uint32_t v)
+{
+    unsigned i = 0;
+
+    while ((i < mp->nbounds) && (v > mp->bounds[i]))
+        i++;
+    __atomic_fetch_add(&mp->buckets[i], 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&mp->sum, v, __ATOMIC_RELAXED);
+}
+
+/**
+ * Links a metric into the registry, registering it twice has no effect.
+ **/
+void metricsRegister(metric_t *mp)
+{
+    chSysLock();
+    if ((mp->next == NULL) && (mp != tail)) {
+        if (tail != NULL)
+            tail->next = mp;
+        else
+            head = mp;
+        tail = mp;
+    }
+    chSysUnlock();
+}
+
+static void flush(emitter_t *ep)
+{
+    if ((ep->len > 0) && (ep->err == 0))
+        ep->err = ep->out(ep->ctx, ep->buf, ep->len);
+    ep->len = 0;
+}
+
+/* chsnprintf() taking a va_list. */
+static int vformat(char *str, size_t size, const char *fmt, va_list ap)
+{
+    MemoryStream ms;
+    int n;
+
+    msObjectInit(&ms, (uint8_t *)str, size - 1, 0);
+    n = chvprintf((BaseSequentialStream *)&ms, fmt, ap);
+    str[ms.eos] = 0;
+    return n;
+}
+
+/* Formats one line at the end of the buffer, flushing it first when the
+   line does not fit. Longer lines are truncated. */
+static void emit(emitter_t *ep, const char *fmt, ...)
+{
+    size_t room = sizeof(ep->buf) - ep->len;
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vformat(ep->buf + ep->len, room, fmt, ap);
+    va_end(ap);
+    if ((size_t)n >= room) {
+        flush(ep);
+        va_start(ap, fmt);
+        n = vformat(ep->buf, sizeof(ep->buf), fmt, ap);
+        va_end(ap);
+        if ((size_t)n >= sizeof(ep->buf))
+            n = sizeof(ep->buf) - 1;
+    }
+    ep->len += n;
+}
+
+static void export_metric(emitter_t *ep, const metric_t *mp)
+{
+    uint32_t cumulative = 0;
+    unsigned i;
+
+    if (mp->type == METRIC_HISTOGRAM) {
+        for (i = 0; i < mp->nbounds; i++) {
+            cumulative += mp->buckets[i];
+            emit(ep, "%s_bucket{le=\"%lu\"} %lu%s", mp->name,
+                 (unsigned long)mp->bounds[i], (unsigned long)cumulative,
+                 ep->eol);
+        }
+        cumulative += mp->buckets[mp->nbounds];
+        emit(ep, "%s_bucket{le=\"+Inf\"} %lu%s", mp->name,
+             (unsigned long)cumulative, ep->eol);
+        emit(ep, "%s_sum %lu%s", mp->name, (unsigned long)mp->sum, ep->eol);
+        emit(ep, "%s_count %lu%s", mp->name, (unsigned long)cumulative,
+             ep->eol);
+    }
+    else if (mp->label != NULL) {
+        for (i = 0; i < mp->nlabels; i++)
+            emit(ep, "%s{%s=\"%s\"} %lu%s", mp->name, mp->label,
+                 mp->lvalues[i], (unsigned long)mp->read(i), ep->eol);
+    }
+    else {
+        emit(ep, "%s %lu%s", mp->name,
+             (unsigned long)(mp->read != NULL ? mp->read(0) : mp->value),
+             ep->eol);
+    }
+}
+
+/**
+ * Writes the metrics whose name starts with prefix, all of them when it
+ * is NULL. Lines end with "\n" in the Prometheus format and with "\r\n"
+ * otherwise, for the shell. Returns the first non-zero value returned
+ * by the output callback.
+ **/
+int metricsExport(metrics_write_t out, void *ctx, const char *prefix,
+                  unsigned flags)
+{
+    const bool prom = (flags & METRICS_EXPORT_PROMETHEUS) != 0;
+    size_t plen = prefix != NULL ? strlen(prefix) : 0;
+    const metric_t *mp;
+    emitter_t em;
+
+    em.out = out;
+    em.ctx = ctx;
+    em.eol = prom ? "\n" : "\r\n";
+    em.len = 0;
+    em.err = 0;
+
+    for (mp = head; (mp != NULL) && (em.err == 0); mp = mp->next) {
+        if ((plen > 0) && (strncmp(mp->name, prefix, plen) != 0))
+            continue;
+        if (prom) {
+            emit(&em, "# HELP %s %s\n", mp->name, mp->help);
+            emit(&em, "# TYPE %s %s\n", mp->name, type_names[mp->type]);
+        }
+        export_metric(&em, mp);
+    }
+    flush(&em);
+    return em.err;
+}
@@ -0,0 +1,159 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+/**
+ * Metrics registry.
+ *
+ * A metric is a statically allocated metric_t, declared with one of the
+ * METRIC_*_DECL() macros and linked into the registry once with
+ * metricsRegister(). Counters and gauges either hold their value, updated
+ * with the atomic metricInc()/metricAdd()/metricSet() from any context
+ * including ISRs, or are read at export time through a callback. A
+ * callback metric can also be a family of values sharing one label,
+ * e.g. lwip_memp_used{pool="TCP_PCB"}.
+ *
+ * Histograms have fixed upper bounds, an observation increments the
+ * first bucket whose bound is not lower than the value and the implicit
+ * +Inf bucket catches the rest.
+ *
+ * metricsExport() walks the registry and produces the Prometheus text
+ * format, or a compact "name value" listing, through an output callback
+ * with a small stack buffer and no allocation.
+ *
+ * This header is included from ffconf.h so it must stay plain C and
+ * must not depend on the kernel types.
+ **/
+
+/**
+ * Set to FALSE in order to remove the FatFs disk I/O hooks.
+ **/
+#if !defined(METRICS_DISKIO_ENABLED)
+#define METRICS_DISKIO_ENABLED  TRUE
+#endif
+
+/**
+ * Size of the export buffer, also the maximum length of one line.
+ **/
+#if !defined(METRICS_BUFFER_SIZE)
+#define METRICS_BUFFER_SIZE     128
+#endif
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  METRIC_COUNTER = 0,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM
+} metric_type_t;
+
+typedef struct metric metric_t;
+
+/**
+ * A registered metric, the fields are initialized by the METRIC_*_DECL()
+ * macros only.
+ **/
+struct metric {
+  const char *name;
+  const char *help;
+  metric_type_t type;
+  volatile uint32_t value;          /* Counter or gauge value.          */
+  uint32_t (*read)(unsigned i);     /* Export time source, or NULL.     */
+  const char *label;                /* Label of a family, or NULL.      */
+  const char * const *lvalues;      /* Label values, one per member.    */
+  unsigned nlabels;
+  const uint32_t *bounds;           /* Histogram bucket upper bounds.   */
+  volatile uint32_t *buckets;       /* nbounds + 1 counters.            */
+  unsigned nbounds;
+  volatile uint32_t sum;
+  metric_t *next;
+};
+
+#define METRIC_COUNTER_DECL(var, name, help)                                \
+  metric_t var = {name, help, METRIC_COUNTER, 0, NULL, NULL, NULL, 0,       \
+                  NULL, NULL, 0, 0, NULL}
+
+#define METRIC_GAUGE_DECL(var, name, help)                                  \
+  metric_t var = {name, help, METRIC_GAUGE, 0, NULL, NULL, NULL, 0,         \
+                  NULL, NULL, 0, 0, NULL}
+
+/**
+ * Counter or gauge whose value is read(0) at export time.
+ **/
+#define METRIC_READ_DECL(var, type, name, help, read)                       \
+  metric_t var = {name, help, type, 0, read, NULL, NULL, 0,                 \
+                  NULL, NULL, 0, 0, NULL}
+
+/**
+ * Family of counters or gauges, member i has the label value lvalues[i]
+ * and the value read(i).
+ **/
+#define METRIC_FAMILY_DECL(var, type, name, help, read, label, lvalues)     \
+  metric_t var = {name, help, type, 0, read, label, lvalues,                \
+                  sizeof(lvalues) / sizeof(lvalues[0]),                     \
+                  NULL, NULL, 0, 0, NULL}
+
+/**
+ * Histogram over a const uint32_t array of increasing bounds, buckets is
+ * a volatile uint32_t array with one more element than bounds.
+ **/
+#define METRIC_HISTOGRAM_DECL(var, name, help, bounds, buckets)             \
+  metric_t var = {name, help, METRIC_HISTOGRAM, 0, NULL, NULL, NULL, 0,     \
+                  bounds, buckets,                                          \
+                  sizeof(buckets) / sizeof(buckets[0]) - 1, 0, NULL}
+
+/**
+ * Output callback used by metricsExport(), returns zero on success.
+ **/
+typedef int (*metrics_write_t)(void *ctx, const void *buf, size_t n);
+
+/**
+ * metricsExport() flags.
+ **/
+#define METRICS_EXPORT_PROMETHEUS   1U  /* HELP and TYPE comment lines. */
+
+static inline void metricAdd(metric_t *mp, uint32_t n) {
+
+  __atomic_fetch_add(&mp->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metricInc(metric_t *mp) {
+
+  metricAdd(mp, 1U);
+}
+
+static inline void metricSet(metric_t *mp, uint32_t v) {
+
+  __atomic_store_n(&mp->value, v, __ATOMIC_RELAXED);
+}
+
+void metricObserve(metric_t *mp, uint32_t v);
+void metricsRegister(metric_t *mp);
+int metricsExport(metrics_write_t out, void *ctx, const char *prefix,
+                  unsigned flags);
+void sysmetricsInit(void);
+void _metrics_diskio(int wr, unsigned count, uint32_t cycles, int res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+/**
+ * Hook body used by ffconf.h.
+ **/
+#if METRICS_DISKIO_ENABLED
+#define METRICS_DISKIO_HOOK(wr, count, cycles, res)                         \
+  _metrics_diskio(wr, count, cycles, res)
+#else
+#define METRICS_DISKIO_HOOK(wr, count, cycles, res)
+#endif
+
+#endif
@@ -0,0 +1,248 @@
+#include "ch.h"
+#include "hal.h"
+#include "pcprof.h"
+
+#include <string.h>
+
+#if defined(SIMULATOR)
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+/**
+ * The sample buffer is filled once, samples taken after it is full
+ * are only counted so that a dump covers the start of a workload.
+ * Only written by the sampling handler, cleared with the kernel locked
+ * and read with the sampler paused. A dump pauses the sampler with its
+ * own flag, the rate set by pcprofStart() and pcprofStop() meanwhile
+ * is kept.
+ **/
+static pcprof_sample_t samples[PCPROF_BUFFER_SIZE];
+static volatile uint32_t count;
+static volatile uint32_t dropped;
+static volatile unsigned rate;
+static volatile bool paused;
+static unsigned last_rate;
+
+/* Only used with dumpmtx held, the shell and the HTTP server can dump
+   at the same time. */
+static MUTEX_DECL(dumpmtx);
+static pcprof_thread_t threads[PCPROF_MAX_THREADS];
+
+static inline void put(uint32_t pc, const void *tp)
+{
+    uint32_t n = count;
+
+    if (n >= PCPROF_BUFFER_SIZE) {
+        dropped = dropped + 1;
+        return;
+    }
+    samples[n].pc = pc;
+    samples[n].tp = (uint32_t)(uintptr_t)tp;
+    count = n + 1;
+}
+
+#if defined(SIMULATOR)
+/**
+ * Host backend, a SIGPROF timer on the monotonic clock stands for the
+ * GPT interrupt. PCs are stored relative to the image start so they
+ * match the ELF symbols of a position independent executable.
+ *
+ * The handler runs on its own stack, a host signal frame is larger
+ * than the free space of most thread working areas.
+ **/
+extern "C" char __executable_start[], etext[];
+
+static timer_t prof_timer;
+static bool prof_timer_created;
+static uint8_t prof_sigstack[65536];
+
+static void sample_handler(int sig, siginfo_t *si, void *ctx)
+{
+    ucontext_t *ucp = (ucontext_t *)ctx;
+#if defined(__x86_64__)
+    uintptr_t pc = (uintptr_t)ucp->uc_mcontext.gregs[REG_RIP];
+#else
+    uintptr_t pc = (uintptr_t)ucp->uc_mcontext.gregs[REG_EIP];
+#endif
+
+    (void)sig;
+    (void)si;
+    if ((rate == 0) || paused)
+        return;
+    if ((pc >= (uintptr_t)__executable_start) && (pc < (uintptr_t)etext))
+        put((uint32_t)(pc - (uintptr_t)__executable_start), currp);
+    else
+        put(PCPROF_PC_EXTERNAL, currp);
+}
+
+static void timer_arm(unsigned hz)
+{
+    struct itimerspec its;
+
+    if (!prof_timer_created) {
+        struct sigaction sa;
+        struct sigevent sev;
+        stack_t ss;
+
+        ss.ss_sp = prof_sigstack;
+        ss.ss_size = sizeof(prof_sigstack);
+        ss.ss_flags = 0;
+        sigaltstack(&ss, NULL);
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = sample_handler;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGPROF, &sa, NULL);
+
+        memset(&sev, 0, sizeof(sev));
+        sev.sigev_notify = SIGEV_SIGNAL;
+        sev.sigev_signo = SIGPROF;
+        if (timer_create(CLOCK_MONOTONIC, &sev, &prof_timer) != 0)
+            return;
+        prof_timer_created = true;
+    }
+    memset(&its, 0, sizeof(its));
+    if (hz > 0) {
+        its.it_interval.tv_nsec = 1000000000L / hz;
+        its.it_value = its.it_interval;
+    }
+    timer_settime(prof_timer, 0, &its, NULL);
+}
+
+#else
+/**
+ * Target backend. The handler runs in the GPT interrupt, when no other
+ * exception is active (RETTOBASE) the interrupted code was a thread
+ * and its PC is in the exception frame on the process stack. Samples
+ * taken over another handler go to the PCPROF_PC_IRQ bucket.
+ **/
+static void sample_cb(GPTDriver *gptp)
+{
+    (void)gptp;
+    if ((rate == 0) || paused)
+        return;
+    if (SCB->ICSR & SCB_ICSR_RETTOBASE_Msk)
+        put(((const uint32_t *)__get_PSP())[6], currp);
+    else
+        put(PCPROF_PC_IRQ, NULL);
+}
+
+static const GPTConfig gptcfg = {
+    PCPROF_TIMER_HZ,
+    sample_cb,
+    0,
+    0
+};
+
+static void timer_arm(unsigned hz)
+{
+    if (PCPROF_GPTD.state == GPT_CONTINUOUS)
+        gptStopTimer(&PCPROF_GPTD);
+    if (hz > 0) {
+        gptStart(&PCPROF_GPTD, &gptcfg);
+        gptStartContinuous(&PCPROF_GPTD, PCPROF_TIMER_HZ / hz);
+    }
+    else {
+        gptStop(&PCPROF_GPTD);
+    }
+}
+#endif
+
+/**
+ * Starts sampling at hz samples per second, clamped to the
+ * PCPROF_MIN_RATE..PCPROF_MAX_RATE range, zero selects the default
+ * rate. The samples already in the buffer are kept.
+ **/
+void pcprofStart(unsigned hz)
+{
+    if (hz == 0)
+        hz = PCPROF_DEFAULT_RATE;
+    else if (hz < PCPROF_MIN_RATE)
+        hz = PCPROF_MIN_RATE;
+    else if (hz > PCPROF_MAX_RATE)
+        hz = PCPROF_MAX_RATE;
+    last_rate = hz;
+    rate = hz;
+    timer_arm(hz);
+}
+
+void pcprofStop(void)
+{
+    rate = 0;
+    timer_arm(0);
+}
+
+void pcprofClear(void)
+{
+    chMtxLock(&dumpmtx);
+    chSysLock();
+    count = 0;
+    dropped = 0;
+    chSysUnlock();
+    chMtxUnlock(&dumpmtx);
+}
+
+/**
+ * Returns the sampling rate, zero when stopped.
+ **/
+unsigned pcprofGetRate(void)
+{
+    return rate;
+}
+
+/**
+ * Returns the number of samples currently held in the buffer.
+ **/
+size_t pcprofCount(void)
+{
+    return count;
+}
+
+/**
+ * Writes the header, the thread table and the samples through the
+ * out callback. Sampling is paused meanwhile so the buffer is stable,
+ * concurrent dumps and clears wait for each other. Returns zero on
+ * success or the first non zero value returned by the callback.
+ **/
+int pcprofSerialize(pcprof_write_t out, void *ctx)
+{
+    pcprof_header_t hdr;
+    thread_t *tp;
+    int err;
+
+    chMtxLock(&dumpmtx);
+    paused = true;
+
+    memcpy(hdr.magic, "PRF1", 4);
+    hdr.rate_hz = last_rate;
+    hdr.nsamples = count;
+    hdr.nthreads = 0;
+    hdr.lost = dropped;
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+        if (hdr.nthreads < PCPROF_MAX_THREADS) {
+            pcprof_thread_t *ptp = &threads[hdr.nthreads++];
+            const char *name = chRegGetThreadNameX(tp);
+
+            ptp->tp = (uint32_t)(uintptr_t)tp;
+            memset(ptp->name, 0, sizeof(ptp->name));
+            if (name != NULL)
+                strncpy(ptp->name, name, sizeof(ptp->name) - 1);
+        }
+        tp = chRegNextThread(tp);
+    }
+
+    err = out(ctx, &hdr, sizeof(hdr));
+    if (!err)
+        err = out(ctx, threads, hdr.nthreads * sizeof(pcprof_thread_t));
+    if (!err && hdr.nsamples)
+        err = out(ctx, samples, hdr.nsamples * sizeof(pcprof_sample_t));
+
+    paused = false;
+    chMtxUnlock(&dumpmtx);
+    return err;
+}
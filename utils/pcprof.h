@@ -0,0 +1,120 @@
+#ifndef __PCPROF_H__
+#define __PCPROF_H__
+
+/**
+ * Sampling PC profiler.
+ *
+ * A periodic timer interrupt stores the interrupted program counter
+ * and the current thread into a RAM buffer, once the buffer is full
+ * the further samples are only counted. On the target the timer is a
+ * spare TIM driven through the GPT driver, in the simulator it is a
+ * SIGPROF host timer.
+ *
+ * The buffer is serialized as: a header, a table of the registered
+ * threads and the samples oldest first, see tools/pcprof.py for the
+ * symbolization into flat and per-thread profiles.
+ **/
+
+/**
+ * Number of samples in the buffer, 8 bytes each.
+ **/
+#if !defined(PCPROF_BUFFER_SIZE)
+#define PCPROF_BUFFER_SIZE      2048
+#endif
+
+/**
+ * Maximum number of threads stored in the serialized thread table.
+ **/
+#if !defined(PCPROF_MAX_THREADS)
+#define PCPROF_MAX_THREADS      24
+#endif
+
+/**
+ * Sampling timer, its IRQ priority should be the highest one allowed
+ * to use the kernel (2) so that only the critical zones delay it, a
+ * sample taken at the end of a critical zone is charged to the
+ * instruction that unlocked the kernel.
+ **/
+#if !defined(PCPROF_GPTD) && !defined(SIMULATOR)
+#define PCPROF_GPTD             GPTD7
+#endif
+
+/**
+ * Timer clock, the sampling period is an integer number of ticks.
+ **/
+#if !defined(PCPROF_TIMER_HZ)
+#define PCPROF_TIMER_HZ         100000U
+#endif
+
+/**
+ * Sampling rates accepted by pcprofStart(), 16 bits timers at
+ * PCPROF_TIMER_HZ cannot go below 2 Hz.
+ **/
+#define PCPROF_MIN_RATE         10U
+#define PCPROF_MAX_RATE         20000U
+#define PCPROF_DEFAULT_RATE     1000U
+
+/**
+ * Special sample PC values, neither is a valid instruction address.
+ **/
+#define PCPROF_PC_IRQ           0U      /* An interrupt handler was
+                                           running, tp is zero.         */
+#define PCPROF_PC_EXTERNAL      1U      /* Simulator only, host code
+                                           outside the firmware image.  */
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * One sample, 8 bytes, little endian on the wire. In the simulator
+ * pc is the offset from the start of the executable image.
+ **/
+typedef struct {
+  uint32_t pc;                  /* Interrupted PC or PCPROF_PC_xxx.     */
+  uint32_t tp;                  /* Current thread address.              */
+} pcprof_sample_t;
+
+/**
+ * Serialized stream header.
+ **/
+typedef struct {
+  char magic[4];                /* "PRF1".                              */
+  uint32_t rate_hz;             /* Sampling rate.                       */
+  uint32_t nsamples;            /* Samples following the thread table.  */
+  uint32_t nthreads;            /* Thread table entries.                */
+  uint32_t lost;                /* Samples dropped, buffer full.        */
+} pcprof_header_t;
+
+/**
+ * Serialized thread table entry.
+ **/
+typedef struct {
+  uint32_t tp;
+  char name[16];
+} pcprof_thread_t;
+
+/**
+ * Output callback used by pcprofSerialize(), returns zero on success.
+ **/
+typedef int (*pcprof_write_t)(void *ctx, const void *buf, size_t n);
+
+void pcprofStart(unsigned hz);
+void pcprofStop(void);
+void pcprofClear(void);
+unsigned pcprofGetRate(void);
+size_t pcprofCount(void);
+int pcprofSerialize(pcprof_write_t out, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+#endif
@@ -0,0 +1,363 @@
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+/**
+ * Lock-free ring buffers for ISR-to-thread data paths.
+ *
+ * SpscRing is a single producer / single consumer ring, MpscRing is
+ * a bounded multiple producer / single consumer ring (per-slot
+ * sequence numbers, D. Vyukov's scheme). Neither takes the kernel
+ * lock, so producers may be interrupt handlers running above the
+ * kernel priority mask.
+ *
+ * On Cortex-M3/M4 the atomics are built on LDREX/STREX and DMB, on
+ * any other target (the Linux host) std::atomic is used instead.
+ *
+ * An optional notification hook is invoked by the producer when the
+ * ring goes from empty to non-empty, it can be used to wake up the
+ * consumer thread (see rbNotifyBSemFromISR / rbNotifyEventFromISR).
+ * The producer re-reads the consumer position behind a full fence
+ * after publishing, and a pop that finds the ring empty re-checks it
+ * behind the same fence, so a consumer that goes to sleep after an
+ * empty pop is always notified of the next push.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define RB_USE_LDREX        1
+#include "ch.h"
+#else
+#define RB_USE_LDREX        0
+#include <atomic>
+#endif
+
+namespace lockfree {
+
+  /**
+   * Producer side notification, invoked from the producer context
+   * (thread or ISR) with the argument given to setNotify().
+   **/
+  typedef void (*rbnotify_t)(void *arg);
+
+  /**
+   * 32 bits free running counter with acquire/release accessors.
+   **/
+  class AtomicIndex {
+  public:
+    AtomicIndex() : v(0) {}
+
+#if RB_USE_LDREX
+    uint32_t loadRelaxed(void) const { return v; }
+
+    uint32_t loadAcquire(void) const {
+      uint32_t r = v;
+      __DMB();
+      return r;
+    }
+
+    void storeRelease(uint32_t n) {
+      __DMB();
+      v = n;
+    }
+
+    /* Orders the preceding stores before the following loads. */
+    static void fence(void) { __DMB(); }
+
+    /* The exclusive monitor is cleared on exception entry/return, so
+       an ISR preempting the sequence just makes the STREX fail and
+       the loop retry. */
+    bool compareExchange(uint32_t &expected, uint32_t desired) {
+      uint32_t cur;
+
+      do {
+        cur = __LDREXW(&v);
+        if (cur != expected) {
+          __CLREX();
+          expected = cur;
+          return false;
+        }
+      } while (__STREXW(desired, &v) != 0U);
+      __DMB();
+      return true;
+    }
+
+  private:
+    volatile uint32_t v;
+#else
+    uint32_t loadRelaxed(void) const {
+      return v.load(std::memory_order_relaxed);
+    }
+
+    uint32_t loadAcquire(void) const {
+      return v.load(std::memory_order_acquire);
+    }
+
+    void storeRelease(uint32_t n) {
+      v.store(n, std::memory_order_release);
+    }
+
+    /* Orders the preceding stores before the following loads. */
+    static void fence(void) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    bool compareExchange(uint32_t &expected, uint32_t desired) {
+      return v.compare_exchange_weak(expected, desired,
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint32_t> v;
+#endif
+  };
+
+  /**
+   * Single producer / single consumer ring of N elements of type T,
+   * N must be a power of two.
+   **/
+  template <typename T, uint32_t N>
+  class SpscRing {
+    typedef char size_must_be_power_of_two[((N & (N - 1)) == 0 && N > 0) ? 1 : -1];
+
+  public:
+    SpscRing() : notify(NULL), notifyarg(NULL) {}
+
+    void setNotify(rbnotify_t fn, void *arg) {
+      notifyarg = arg;
+      notify = fn;
+    }
+
+    /* Producer side. */
+    bool push(const T &item) {
+      uint32_t h = head.loadRelaxed();
+      uint32_t t = tail.loadAcquire();
+
+      if ((h - t) == N)
+        return false;
+      buf[h & (N - 1)] = item;
+      publish(h, h + 1);
+      return true;
+    }
+
+    /* Pushes up to n items, returns the number of items pushed. */
+    size_t pushN(const T *items, size_t n) {
+      uint32_t h = head.loadRelaxed();
+      uint32_t t = tail.loadAcquire();
+      uint32_t space = N - (h - t);
+      size_t i;
+
+      if (n > space)
+        n = space;
+      if (n == 0)
+        return 0;
+      for (i = 0; i < n; i++)
+        buf[(h + i) & (N - 1)] = items[i];
+      publish(h, h + (uint32_t)n);
+      return n;
+    }
+
+    /* Consumer side. */
+    bool pop(T &item) {
+      uint32_t t = tail.loadRelaxed();
+      uint32_t h = available(t);
+
+      if (h == t)
+        return false;
+      item = buf[t & (N - 1)];
+      tail.storeRelease(t + 1);
+      return true;
+    }
+
+    /* Pops up to n items, returns the number of items popped. */
+    size_t popN(T *items, size_t n) {
+      uint32_t t = tail.loadRelaxed();
+      uint32_t h = available(t);
+      size_t i;
+
+      if (n > (size_t)(h - t))
+        n = h - t;
+      for (i = 0; i < n; i++)
+        items[i] = buf[(t + i) & (N - 1)];
+      if (n > 0)
+        tail.storeRelease(t + (uint32_t)n);
+      return n;
+    }
+
+    /* Approximate when called concurrently with the other side. */
+    size_t size(void) const {
+      return head.loadAcquire() - tail.loadAcquire();
+    }
+
+    bool empty(void) const { return size() == 0; }
+
+    static size_t capacity(void) { return N; }
+
+  private:
+    /* The consumer is asleep or about to sleep only if it has consumed
+       everything before the first new item, tail is read after the
+       fence so the check cannot miss its last pop. */
+    void publish(uint32_t h, uint32_t nh) {
+      head.storeRelease(nh);
+      if (notify != NULL) {
+        AtomicIndex::fence();
+        if (tail.loadAcquire() == h)
+          notify(notifyarg);
+      }
+    }
+
+    /* Head as seen by the consumer, an empty ring is checked again
+       behind the fence that pairs with the one in publish(). */
+    uint32_t available(uint32_t t) const {
+      uint32_t h = head.loadAcquire();
+
+      if (h == t) {
+        AtomicIndex::fence();
+        h = head.loadAcquire();
+      }
+      return h;
+    }
+
+    AtomicIndex head;
+    AtomicIndex tail;
+    rbnotify_t notify;
+    void *notifyarg;
+    T buf[N];
+  };
+
+  /**
+   * Bounded multiple producer / single consumer ring of N elements of
+   * type T, N must be a power of two. Producers never wait on each
+   * other: a producer preempted between reserving and publishing a
+   * slot only delays the consumer.
+   **/
+  template <typename T, uint32_t N>
+  class MpscRing {
+    typedef char size_must_be_power_of_two[((N & (N - 1)) == 0 && N > 1) ? 1 : -1];
+
+  public:
+    MpscRing() : tail(0), notify(NULL), notifyarg(NULL) {
+      uint32_t i;
+
+      for (i = 0; i < N; i++)
+        cells[i].seq.storeRelease(i);
+    }
+
+    void setNotify(rbnotify_t fn, void *arg) {
+      notifyarg = arg;
+      notify = fn;
+    }
+
+    /* Producer side, callable from any thread or ISR. */
+    bool push(const T &item) {
+      uint32_t pos = head.loadRelaxed();
+      Cell *c;
+
+      while (true) {
+        c = &cells[pos & (N - 1)];
+        int32_t diff = (int32_t)(c->seq.loadAcquire() - pos);
+        if (diff == 0) {
+          if (head.compareExchange(pos, pos + 1))
+            break;
+        }
+        else if (diff < 0)
+          return false;
+        else
+          pos = head.loadRelaxed();
+      }
+      c->data = item;
+      c->seq.storeRelease(pos + 1);
+      if (notify != NULL) {
+        /* Same pairing as SpscRing::publish(). */
+        AtomicIndex::fence();
+        if (consumed.loadAcquire() == pos)
+          notify(notifyarg);
+      }
+      return true;
+    }
+
+    /* Consumer side, a single thread only. */
+    bool pop(T &item) {
+      Cell *c = &cells[tail & (N - 1)];
+
+      if ((int32_t)(c->seq.loadAcquire() - (tail + 1)) < 0) {
+        AtomicIndex::fence();
+        if ((int32_t)(c->seq.loadAcquire() - (tail + 1)) < 0)
+          return false;
+      }
+      item = c->data;
+      c->seq.storeRelease(tail + N);
+      tail++;
+      consumed.storeRelease(tail);
+      return true;
+    }
+
+    /* Pops up to n items, returns the number of items popped. */
+    size_t popN(T *items, size_t n) {
+      size_t i;
+
+      for (i = 0; i < n; i++) {
+        if (!pop(items[i]))
+          break;
+      }
+      return i;
+    }
+
+    /* Approximate when called concurrently with the producers. */
+    size_t size(void) const {
+      return head.loadAcquire() - consumed.loadAcquire();
+    }
+
+    bool empty(void) const { return size() == 0; }
+
+    static size_t capacity(void) { return N; }
+
+  private:
+    struct Cell {
+      AtomicIndex seq;
+      T data;
+    };
+
+    AtomicIndex head;
+    AtomicIndex consumed;
+    uint32_t tail;
+    rbnotify_t notify;
+    void *notifyarg;
+    Cell cells[N];
+  };
+
+#if defined(_CHIBIOS_RT_)
+  /**
+   * Ready made notification hooks, the consumer thread waits on the
+   * binary semaphore / event source passed as argument to setNotify().
+   * These are the only places where the kernel is locked and only on
+   * the empty to non-empty transition. The FromISR variants are for
+   * ISR producers, the others for thread producers, neither may be
+   * called with the kernel already locked.
+   **/
+  static inline void rbNotifyBSemFromISR(void *arg) {
+    chSysLockFromISR();
+    chBSemSignalI((binary_semaphore_t *)arg);
+    chSysUnlockFromISR();
+  }
+
+  static inline void rbNotifyEventFromISR(void *arg) {
+    chSysLockFromISR();
+    chEvtBroadcastI((event_source_t *)arg);
+    chSysUnlockFromISR();
+  }
+
+  static inline void rbNotifyBSem(void *arg) {
+    chBSemSignal((binary_semaphore_t *)arg);
+  }
+
+  static inline void rbNotifyEvent(void *arg) {
+    chEvtBroadcast((event_source_t *)arg);
+  }
+#endif
+
+}
+
+#endif
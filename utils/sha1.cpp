@@ -0,0 +1,174 @@
+#include "sha1.h"
+
+#include <string.h>
+
+static inline uint32_t rol(uint32_t x, unsigned n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* One 64 bytes block, the message schedule is kept in a 16 words
+   circular window. */
+static void transform(uint32_t state[5], const uint8_t *block)
+{
+    uint32_t w[16], a, b, c, d, e, f, k, t;
+    unsigned i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = load_be32(block + 4 * i);
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    for (i = 0; i < 80; i++) {
+        if (i >= 16) {
+            t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^
+                w[i & 15];
+            w[i & 15] = rol(t, 1);
+        }
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999U;
+        }
+        else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1U;
+        }
+        else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDCU;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6U;
+        }
+        t = rol(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void sha1Init(sha1_t *ctx)
+{
+    ctx->state[0] = 0x67452301U;
+    ctx->state[1] = 0xEFCDAB89U;
+    ctx->state[2] = 0x98BADCFEU;
+    ctx->state[3] = 0x10325476U;
+    ctx->state[4] = 0xC3D2E1F0U;
+    ctx->length = 0;
+}
+
+void sha1Update(sha1_t *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t used = (size_t)(ctx->length % SHA1_BLOCK_SIZE), n;
+
+    ctx->length += len;
+    if (used > 0) {
+        n = SHA1_BLOCK_SIZE - used;
+        if (n > len)
+            n = len;
+        memcpy(ctx->block + used, p, n);
+        p += n;
+        len -= n;
+        if (used + n < SHA1_BLOCK_SIZE)
+            return;
+        transform(ctx->state, ctx->block);
+    }
+    /* Whole blocks are hashed in place. */
+    for (; len >= SHA1_BLOCK_SIZE; len -= SHA1_BLOCK_SIZE, p += SHA1_BLOCK_SIZE)
+        transform(ctx->state, p);
+    memcpy(ctx->block, p, len);
+}
+
+void sha1Final(sha1_t *ctx, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    size_t used = (size_t)(ctx->length % SHA1_BLOCK_SIZE);
+    uint64_t bits = ctx->length * 8;
+    unsigned i;
+
+    /* 0x80, zeros up to 56 modulo 64, the bit length big endian. */
+    ctx->block[used++] = 0x80;
+    if (used > SHA1_BLOCK_SIZE - 8) {
+        memset(ctx->block + used, 0, SHA1_BLOCK_SIZE - used);
+        transform(ctx->state, ctx->block);
+        used = 0;
+    }
+    memset(ctx->block + used, 0, SHA1_BLOCK_SIZE - 8 - used);
+    store_be32(ctx->block + 56, (uint32_t)(bits >> 32));
+    store_be32(ctx->block + 60, (uint32_t)bits);
+    transform(ctx->state, ctx->block);
+    for (i = 0; i < 5; i++)
+        store_be32(digest + 4 * i, ctx->state[i]);
+}
+
+/**
+ * SHA-1 digest of len bytes at data.
+ **/
+void sha1Digest(const void *data, size_t len, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    sha1_t ctx;
+
+    sha1Init(&ctx);
+    sha1Update(&ctx, data, len);
+    sha1Final(&ctx, digest);
+}
+
+/**
+ * Encodes len bytes from src into dst as base64 with padding, and
+ * terminates it. Returns the length of the encoding, or 0 if it does
+ * not fit into size bytes with the terminator.
+ **/
+size_t base64Encode(char *dst, size_t size, const void *src, size_t len)
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t *p = (const uint8_t *)src;
+    size_t n = BASE64_ENCODED_SIZE(len);
+    char *d = dst;
+    uint32_t v;
+
+    if (n >= size)
+        return 0;
+    for (; len >= 3; len -= 3, p += 3) {
+        v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        *d++ = alphabet[v >> 18];
+        *d++ = alphabet[(v >> 12) & 63];
+        *d++ = alphabet[(v >> 6) & 63];
+        *d++ = alphabet[v & 63];
+    }
+    if (len > 0) {
+        v = (uint32_t)p[0] << 16;
+        if (len > 1)
+            v |= (uint32_t)p[1] << 8;
+        *d++ = alphabet[v >> 18];
+        *d++ = alphabet[(v >> 12) & 63];
+        *d++ = len > 1 ? alphabet[(v >> 6) & 63] : '=';
+        *d++ = '=';
+    }
+    *d = '\0';
+    return n;
+}
@@ -0,0 +1,44 @@
+#ifndef __SHA1_H__
+#define __SHA1_H__
+
+/**
+ * SHA-1 (FIPS 180-4) and base64 (RFC 4648), for the Sec-WebSocket-Accept
+ * key of the WebSocket handshake (RFC 6455) and alike.
+ *
+ * SHA-1 is no longer collision resistant, it must not be used to sign
+ * or authenticate anything. The context is 92 bytes and the block
+ * transform needs no tables, so it can run on a thread stack.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_SIZE        20
+#define SHA1_BLOCK_SIZE         64
+
+/**
+ * Size of the base64 encoding of n bytes, without the terminator.
+ **/
+#define BASE64_ENCODED_SIZE(n)  ((((n) + 2) / 3) * 4)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint32_t state[5];
+  uint64_t length;              /* Bytes hashed so far.                 */
+  uint8_t block[SHA1_BLOCK_SIZE];
+} sha1_t;
+
+void sha1Init(sha1_t *ctx);
+void sha1Update(sha1_t *ctx, const void *data, size_t len);
+void sha1Final(sha1_t *ctx, uint8_t digest[SHA1_DIGEST_SIZE]);
+void sha1Digest(const void *data, size_t len, uint8_t digest[SHA1_DIGEST_SIZE]);
+size_t base64Encode(char *dst, size_t size, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -78,3 +78,24 @@ char* lskip(const char* s)
 }
 
 
+
+// format an unsigned 64 bit value in decimal, chprintf
+// only handles 32 bit integers. buf must hold 21 chars.
+char * u64toa(uint64_t value, char * buf)
+{
+    char tmp[20];
+    int i = 0;
+
+    do {
+        tmp[i++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    char *p = buf;
+    while (i > 0)
+        *p++ = tmp[--i];
+    *p = '\0';
+
+    return buf;
+}
+
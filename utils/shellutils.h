@@ -21,6 +21,8 @@ char * ltrim(char * str, char trimchar);
 char * rstrip(char * str);
 char * lskip(const char* s);
 
+char * u64toa(uint64_t value, char * buf);
+
 int _getpid(void);
 int _kill(int pid, int sig);
 
@@ -0,0 +1,183 @@
+#include "ch.h"
+#include "hal.h"
+#include "stackwm.h"
+
+#if STACKWM_MPU_GUARD
+#include "mpu.h"
+#endif
+
+#if STACKWM_ENABLED && !CH_DBG_FILL_THREADS
+#error "stack high-water marks require CH_DBG_FILL_THREADS"
+#endif
+
+#define FILL32          (0x01010101U * (uint32_t)CH_DBG_STACK_FILL_VALUE)
+#define ALIGN8(n)       (((n) + 7U) & ~7U)
+
+#if !defined(SIMULATOR)
+/* Stacks allocated by the linker script, painted by the startup code. */
+extern "C" uint8_t __main_stack_base__[], __main_stack_end__[];
+extern "C" uint8_t __process_stack_base__[], __process_stack_end__[];
+#endif
+
+#if STACKWM_MPU_GUARD
+#define GUARD_REGION_EXC    MPU_REGION_6
+#define GUARD_REGION_THD    MPU_REGION_7
+#define GUARD_ATTRIBUTES    (MPU_RASR_ATTR_AP_NA_NA | MPU_RASR_ATTR_XN |    \
+                             MPU_RASR_SIZE_32 | MPU_RASR_ENABLE)
+
+static inline uint32_t guard_base(const uint8_t *base)
+{
+    return ((uint32_t)(uintptr_t)base + STACKWM_GUARD_SIZE - 1U) &
+           ~(uint32_t)(STACKWM_GUARD_SIZE - 1U);
+}
+
+/* Invoked by chSysSwitch() with the kernel locked, before the switch. */
+void _stackwm_switch(thread_t *ntp)
+{
+    if (ntp->p_stk.base != NULL) {
+        mpuConfigureRegion(GUARD_REGION_THD, guard_base(ntp->p_stk.base),
+                           GUARD_ATTRIBUTES);
+    }
+    else {
+        mpuConfigureRegion(GUARD_REGION_THD, 0, 0);
+    }
+    __DSB();
+    __ISB();
+}
+
+/* Stack overflow into a guard region. */
+extern "C" void MemManage_Handler(void)
+{
+    chSysHalt("stack overflow");
+}
+#endif
+
+#if STACKWM_ENABLED
+/**
+ * Invoked by _thread_init(), after the context setup for the created
+ * threads. The main thread has no context yet, on the target it runs
+ * on the process stack.
+ **/
+void _stackwm_thread_init(thread_t *tp)
+{
+    if (tp == &ch.mainthread) {
+#if defined(SIMULATOR)
+        tp->p_stk.base = NULL;
+        tp->p_stk.top = NULL;
+#else
+        tp->p_stk.base = __process_stack_base__;
+        tp->p_stk.top = __process_stack_end__;
+#endif
+        return;
+    }
+    tp->p_stk.base = (uint8_t *)(tp + 1);
+#if defined(SIMULATOR)
+    tp->p_stk.top = (uint8_t *)tp->p_ctx.esp + sizeof(struct port_intctx);
+#else
+    tp->p_stk.top = (uint8_t *)tp->p_ctx.r13 + sizeof(struct port_intctx);
+#endif
+}
+#endif
+
+/**
+ * Enables the MPU guards, if configured, to be invoked once after the
+ * kernel initialization from the main thread.
+ **/
+void stackwmInit(void)
+{
+#if STACKWM_MPU_GUARD
+    chSysLock();
+    mpuConfigureRegion(GUARD_REGION_EXC, guard_base(__main_stack_base__),
+                       GUARD_ATTRIBUTES);
+    mpuEnable(MPU_CTRL_PRIVDEFENA);
+    _stackwm_switch(chThdGetSelfX());
+    chSysUnlock();
+#endif
+}
+
+/* Painted bytes at the bottom of a stack, compared a word at a time.
+   With the MPU guards the bytes up to the end of the guard block are
+   counted as unused without being read, the guard of the running
+   thread and of the exception stack would fault. */
+static uint32_t unused_bytes(const uint8_t *base, const uint8_t *top)
+{
+#if STACKWM_MPU_GUARD
+    const uint32_t *p = (const uint32_t *)(uintptr_t)(guard_base(base) +
+                                                      STACKWM_GUARD_SIZE);
+
+    if ((const uint8_t *)p >= top)
+        return (uint32_t)(top - base);
+#else
+    const uint32_t *p = (const uint32_t *)base;
+#endif
+
+    while (((const uint8_t *)(p + 1) <= top) && (*p == FILL32))
+        p++;
+    return (uint32_t)((const uint8_t *)p - base);
+}
+
+static void fill_info(stackwm_info_t *ip, const char *name, const void *tp,
+                      const uint8_t *base, const uint8_t *top)
+{
+    uint32_t guard = STACKWM_MPU_GUARD ? 2U * STACKWM_GUARD_SIZE : 0U;
+
+    ip->name = name != NULL ? name : "";
+    ip->tp = tp;
+    ip->size = (uint32_t)(top - base);
+    ip->used = ip->size - unused_bytes(base, top);
+    ip->suggest = ALIGN8(ip->used + STACKWM_MARGIN + guard);
+    ip->reclaim = 0;
+}
+
+/**
+ * Measures the stacks of the registered threads followed, on the
+ * target, by the exception stack. Up to n entries are written into buf,
+ * returns the number of measured stacks.
+ **/
+size_t stackwmScan(stackwm_info_t *buf, size_t n)
+{
+    thread_t *tp;
+    size_t i = 0;
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+#if STACKWM_ENABLED
+        if ((tp->p_stk.top != NULL) && (i < n)) {
+            stackwm_info_t *ip = &buf[i];
+            uint32_t wa, newwa;
+
+            fill_info(ip, chRegGetThreadNameX(tp), tp, tp->p_stk.base,
+                      tp->p_stk.top);
+            if (tp == &ch.mainthread) {
+                if (ip->size > ip->suggest)
+                    ip->reclaim = ip->size - ip->suggest;
+            }
+            else {
+                /* Whole working areas on both sides, the thread
+                   structure, the port overhead and the alignment
+                   included, the overhead stays in the suggested one. */
+                wa = (uint32_t)(tp->p_stk.top - (uint8_t *)tp);
+                newwa = (uint32_t)THD_WORKING_AREA_SIZE(ip->suggest);
+                if (wa > newwa)
+                    ip->reclaim = wa - newwa;
+            }
+        }
+        if (tp->p_stk.top != NULL)
+            i++;
+#endif
+        tp = chRegNextThread(tp);
+    }
+
+#if !defined(SIMULATOR)
+    if (i < n) {
+        stackwm_info_t *ip = &buf[i];
+
+        fill_info(ip, "exceptions", NULL, __main_stack_base__,
+                  __main_stack_end__);
+        if (ip->size > ip->suggest)
+            ip->reclaim = ip->size - ip->suggest;
+    }
+    i++;
+#endif
+    return i;
+}
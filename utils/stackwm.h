@@ -0,0 +1,132 @@
+#ifndef __STACKWM_H__
+#define __STACKWM_H__
+
+/**
+ * Stack high-water marks.
+ *
+ * The thread working areas are painted with CH_DBG_STACK_FILL_VALUE
+ * when the threads are created (CH_DBG_FILL_THREADS), the process and
+ * exception stacks by the startup code (CRT0_INIT_STACKS). A scan
+ * counts the painted bytes left at the bottom of each stack, the rest
+ * is the peak usage since boot.
+ *
+ * The stack bounds of every thread are recorded by the thread init
+ * hook, in the simulator the top is derived from the initial context
+ * and can be a few bytes low, the main thread runs on the host stack
+ * and is not measured.
+ *
+ * The suggested size is the peak plus STACKWM_MARGIN rounded to eight
+ * bytes, for the threads it is the THD_WORKING_AREA() argument and the
+ * port overhead (context frames and PORT_INT_REQUIRED_STACK) is kept
+ * as extra headroom, for the process and exception stacks it is the
+ * USE_PROCESS_STACKSIZE and USE_EXCEPTIONS_STACKSIZE value.
+ *
+ * With STACKWM_MPU_GUARD the lowest 32 bytes aligned block of the
+ * running thread stack and of the exception stack are made no access
+ * MPU regions, an overflow then raises a MemManage fault and halts the
+ * system with "stack overflow" instead of corrupting the memory below.
+ * The thread region is moved by the context switch hook. The bytes
+ * below the end of the guard block are not measured, they count as
+ * unused.
+ *
+ * The hooks are wired in chconf.h, this header is included from there
+ * so it must stay plain C and must not depend on the kernel types.
+ **/
+
+/**
+ * Set to FALSE in order to remove the thread hooks.
+ **/
+#if !defined(STACKWM_ENABLED)
+#define STACKWM_ENABLED         TRUE
+#endif
+
+/**
+ * Set to TRUE in order to enable the MPU stack guards, target only.
+ **/
+#if !defined(STACKWM_MPU_GUARD) || defined(SIMULATOR)
+#undef STACKWM_MPU_GUARD
+#define STACKWM_MPU_GUARD       FALSE
+#endif
+
+/**
+ * Headroom added to the peak usage in the suggested sizes.
+ **/
+#if !defined(STACKWM_MARGIN)
+#define STACKWM_MARGIN          64
+#endif
+
+/**
+ * Size of a guard region, the MPU minimum. The guard is aligned so up
+ * to twice this size at the bottom of a stack is not usable.
+ **/
+#define STACKWM_GUARD_SIZE      32
+
+#if STACKWM_MPU_GUARD && !STACKWM_ENABLED
+#error "STACKWM_MPU_GUARD requires STACKWM_ENABLED"
+#endif
+
+#if !defined(_FROM_ASM_)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stack bounds, embedded in thread_t as p_stk. Both are NULL when
+ * unknown.
+ **/
+typedef struct {
+  uint8_t *base;                /* Lowest stack address.                */
+  uint8_t *top;                 /* Initial stack pointer.               */
+} stackwm_thread_t;
+
+/**
+ * One stack of a scan.
+ **/
+typedef struct {
+  const char *name;
+  const void *tp;               /* Thread, NULL for the exception stack. */
+  uint32_t size;                /* Stack bytes.                         */
+  uint32_t used;                /* Peak usage.                          */
+  uint32_t suggest;             /* Suggested size parameter.            */
+  uint32_t reclaim;             /* Bytes saved by the suggested size.   */
+} stackwm_info_t;
+
+#if STACKWM_ENABLED
+struct ch_thread;
+void _stackwm_thread_init(struct ch_thread *tp);
+#if STACKWM_MPU_GUARD
+void _stackwm_switch(struct ch_thread *ntp);
+#endif
+#endif
+
+void stackwmInit(void);
+size_t stackwmScan(stackwm_info_t *buf, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_FROM_ASM_) */
+
+/**
+ * Hook bodies used by chconf.h.
+ **/
+#if STACKWM_ENABLED
+#define STACKWM_THREAD_FIELDS       stackwm_thread_t p_stk;
+#define STACKWM_THREAD_INIT(tp)     _stackwm_thread_init(tp)
+#else
+#define STACKWM_THREAD_FIELDS
+#define STACKWM_THREAD_INIT(tp)
+#endif
+
+#if STACKWM_MPU_GUARD
+#define STACKWM_SWITCH(ntp, otp)    _stackwm_switch(ntp)
+#else
+#define STACKWM_SWITCH(ntp, otp)
+#endif
+
+#endif
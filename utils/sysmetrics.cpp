@@ -0,0 +1,379 @@
+#include "ch.h"
+#include "hal.h"
+#include "metrics.h"
+#include "cpuload.h"
+#include "cycles.h"
+
+#include "lwip/opt.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+/**
+ * Built-in metrics: scheduler, memory, lwIP and SDC/FatFs I/O. Apart
+ * from the disk I/O counters, updated by the FatFs hook, the values are
+ * read from the existing kernel and lwIP counters at export time.
+ **/
+
+static uint32_t cycles_to_ms(uint64_t cycles)
+{
+    return (uint32_t)(cycles / (CYCLES_CLOCK_HZ / 1000U));
+}
+
+/*===========================================================================*/
+/* Scheduler.                                                                */
+/*===========================================================================*/
+
+static cpuload_totals_t totals(void)
+{
+    cpuload_totals_t tot;
+
+    (void)cpuloadSnapshot(&tot, NULL, 0);
+    return tot;
+}
+
+static uint32_t read_switches(unsigned i)
+{
+    (void)i;
+    return totals().switches;
+}
+
+static uint32_t read_irqs(unsigned i)
+{
+    (void)i;
+    return totals().irq_count;
+}
+
+static uint32_t read_cpu_ms(unsigned i)
+{
+    (void)i;
+    return cycles_to_ms(totals().elapsed);
+}
+
+static uint32_t read_irq_ms(unsigned i)
+{
+    (void)i;
+    return cycles_to_ms(totals().irq_cycles);
+}
+
+static uint32_t read_idle_ms(unsigned i)
+{
+    uint64_t cycles = 0;
+
+    (void)i;
+#if CPULOAD_ENABLED
+    chSysLock();
+    cycles = chSysGetIdleThreadX()->p_cpu.cycles;
+    chSysUnlock();
+#endif
+    return cycles_to_ms(cycles);
+}
+
+static uint32_t read_threads(unsigned i)
+{
+    thread_t *tp = chRegFirstThread();
+    uint32_t n = 0;
+
+    (void)i;
+    while (tp != NULL) {
+        n++;
+        tp = chRegNextThread(tp);
+    }
+    return n;
+}
+
+static METRIC_READ_DECL(m_switches, METRIC_COUNTER,
+        "ch_context_switches_total", "Context switches.", read_switches);
+static METRIC_READ_DECL(m_irqs, METRIC_COUNTER,
+        "ch_irq_total", "Outermost interrupts.", read_irqs);
+static METRIC_READ_DECL(m_cpu_ms, METRIC_COUNTER,
+        "ch_cpu_ms_total", "Accounted CPU time.", read_cpu_ms);
+static METRIC_READ_DECL(m_irq_ms, METRIC_COUNTER,
+        "ch_cpu_irq_ms_total", "CPU time spent in interrupts.", read_irq_ms);
+static METRIC_READ_DECL(m_idle_ms, METRIC_COUNTER,
+        "ch_cpu_idle_ms_total", "CPU time spent in the idle thread.",
+        read_idle_ms);
+static METRIC_READ_DECL(m_threads, METRIC_GAUGE,
+        "ch_threads", "Threads in the registry.", read_threads);
+
+#if CH_DBG_STATISTICS
+static uint32_t read_crit_thd(unsigned i)
+{
+    (void)i;
+    return ch.kernel_stats.m_crit_thd.worst;
+}
+
+static uint32_t read_crit_isr(unsigned i)
+{
+    (void)i;
+    return ch.kernel_stats.m_crit_isr.worst;
+}
+
+static METRIC_READ_DECL(m_crit_thd, METRIC_GAUGE,
+        "ch_crit_thd_worst_cycles", "Longest thread critical zone.",
+        read_crit_thd);
+static METRIC_READ_DECL(m_crit_isr, METRIC_GAUGE,
+        "ch_crit_isr_worst_cycles", "Longest ISR critical zone.",
+        read_crit_isr);
+#endif
+
+/*===========================================================================*/
+/* Memory.                                                                   */
+/*===========================================================================*/
+
+static uint32_t read_core_free(unsigned i)
+{
+    (void)i;
+    return (uint32_t)chCoreGetStatusX();
+}
+
+static uint32_t read_heap_free(unsigned i)
+{
+    size_t size;
+
+    (void)i;
+    (void)chHeapStatus(NULL, &size);
+    return (uint32_t)size;
+}
+
+static uint32_t read_heap_frags(unsigned i)
+{
+    size_t size;
+
+    (void)i;
+    return (uint32_t)chHeapStatus(NULL, &size);
+}
+
+static METRIC_READ_DECL(m_core_free, METRIC_GAUGE,
+        "ch_core_free_bytes", "Unallocated core memory.", read_core_free);
+static METRIC_READ_DECL(m_heap_free, METRIC_GAUGE,
+        "ch_heap_free_bytes", "Free heap memory.", read_heap_free);
+static METRIC_READ_DECL(m_heap_frags, METRIC_GAUGE,
+        "ch_heap_fragments", "Free heap fragments.", read_heap_frags);
+
+/*===========================================================================*/
+/* lwIP.                                                                     */
+/*===========================================================================*/
+
+#if LWIP_STATS
+static const struct stats_proto * const protos[] = {
+#if LINK_STATS
+    &lwip_stats.link,
+#endif
+#if ETHARP_STATS
+    &lwip_stats.etharp,
+#endif
+#if IP_STATS
+    &lwip_stats.ip,
+#endif
+#if ICMP_STATS
+    &lwip_stats.icmp,
+#endif
+#if UDP_STATS
+    &lwip_stats.udp,
+#endif
+#if TCP_STATS
+    &lwip_stats.tcp,
+#endif
+};
+
+static const char * const proto_names[] = {
+#if LINK_STATS
+    "link",
+#endif
+#if ETHARP_STATS
+    "etharp",
+#endif
+#if IP_STATS
+    "ip",
+#endif
+#if ICMP_STATS
+    "icmp",
+#endif
+#if UDP_STATS
+    "udp",
+#endif
+#if TCP_STATS
+    "tcp",
+#endif
+};
+
+static uint32_t read_xmit(unsigned i)
+{
+    return protos[i]->xmit;
+}
+
+static uint32_t read_recv(unsigned i)
+{
+    return protos[i]->recv;
+}
+
+static uint32_t read_drop(unsigned i)
+{
+    return protos[i]->drop;
+}
+
+static uint32_t read_errors(unsigned i)
+{
+    const struct stats_proto *sp = protos[i];
+
+    return sp->chkerr + sp->lenerr + sp->memerr + sp->rterr +
+           sp->proterr + sp->opterr + sp->err;
+}
+
+static METRIC_FAMILY_DECL(m_lwip_xmit, METRIC_COUNTER,
+        "lwip_xmit_total", "Transmitted packets.", read_xmit,
+        "proto", proto_names);
+static METRIC_FAMILY_DECL(m_lwip_recv, METRIC_COUNTER,
+        "lwip_recv_total", "Received packets.", read_recv,
+        "proto", proto_names);
+static METRIC_FAMILY_DECL(m_lwip_drop, METRIC_COUNTER,
+        "lwip_drop_total", "Dropped packets.", read_drop,
+        "proto", proto_names);
+static METRIC_FAMILY_DECL(m_lwip_errors, METRIC_COUNTER,
+        "lwip_errors_total", "Checksum, length, memory, routing, protocol "
+        "and option errors.", read_errors, "proto", proto_names);
+
+#if MEM_STATS
+static uint32_t read_mem_used(unsigned i)
+{
+    (void)i;
+    return lwip_stats.mem.used;
+}
+
+static uint32_t read_mem_max(unsigned i)
+{
+    (void)i;
+    return lwip_stats.mem.max;
+}
+
+static uint32_t read_mem_err(unsigned i)
+{
+    (void)i;
+    return lwip_stats.mem.err;
+}
+
+static METRIC_READ_DECL(m_lwip_mem_used, METRIC_GAUGE,
+        "lwip_mem_used_bytes", "lwIP heap in use.", read_mem_used);
+static METRIC_READ_DECL(m_lwip_mem_max, METRIC_GAUGE,
+        "lwip_mem_max_bytes", "lwIP heap high-water mark.", read_mem_max);
+static METRIC_READ_DECL(m_lwip_mem_err, METRIC_COUNTER,
+        "lwip_mem_errors_total", "lwIP heap allocation failures.",
+        read_mem_err);
+#endif
+
+#if MEMP_STATS
+static const char * const memp_names[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/memp_std.h"
+};
+
+static uint32_t read_memp_used(unsigned i)
+{
+    return lwip_stats.memp[i].used;
+}
+
+static uint32_t read_memp_max(unsigned i)
+{
+    return lwip_stats.memp[i].max;
+}
+
+static uint32_t read_memp_err(unsigned i)
+{
+    return lwip_stats.memp[i].err;
+}
+
+static METRIC_FAMILY_DECL(m_lwip_memp_used, METRIC_GAUGE,
+        "lwip_memp_used", "lwIP pool elements in use.", read_memp_used,
+        "pool", memp_names);
+static METRIC_FAMILY_DECL(m_lwip_memp_max, METRIC_GAUGE,
+        "lwip_memp_max", "lwIP pool high-water mark.", read_memp_max,
+        "pool", memp_names);
+static METRIC_FAMILY_DECL(m_lwip_memp_err, METRIC_COUNTER,
+        "lwip_memp_errors_total", "lwIP pool allocation failures.",
+        read_memp_err, "pool", memp_names);
+#endif
+#endif /* LWIP_STATS */
+
+/*===========================================================================*/
+/* SDC and FatFs I/O.                                                        */
+/*===========================================================================*/
+
+#define ARRAY_LEN(a)    (sizeof(a) / sizeof((a)[0]))
+
+static const uint32_t io_bounds_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000
+};
+
+static METRIC_COUNTER_DECL(m_sdc_read, "sdc_read_sectors_total",
+        "Sectors read by FatFs.");
+static METRIC_COUNTER_DECL(m_sdc_write, "sdc_write_sectors_total",
+        "Sectors written by FatFs.");
+static METRIC_COUNTER_DECL(m_sdc_errors, "sdc_errors_total",
+        "Failed SDC transfers.");
+static volatile uint32_t read_buckets[ARRAY_LEN(io_bounds_us) + 1];
+static volatile uint32_t write_buckets[ARRAY_LEN(io_bounds_us) + 1];
+static METRIC_HISTOGRAM_DECL(m_sdc_read_us, "sdc_read_latency_us",
+        "SDC read transfer time.", io_bounds_us, read_buckets);
+static METRIC_HISTOGRAM_DECL(m_sdc_write_us, "sdc_write_latency_us",
+        "SDC write transfer time.", io_bounds_us, write_buckets);
+
+/* Invoked by disk_read() and disk_write(), see ffconf.h. */
+void _metrics_diskio(int wr, unsigned count, uint32_t cycles, int res)
+{
+    uint32_t us = (uint32_t)(((uint64_t)cycles * 1000000U) / CYCLES_CLOCK_HZ);
+
+    if (res != 0) {
+        metricInc(&m_sdc_errors);
+        return;
+    }
+    if (wr) {
+        metricAdd(&m_sdc_write, count);
+        metricObserve(&m_sdc_write_us, us);
+    }
+    else {
+        metricAdd(&m_sdc_read, count);
+        metricObserve(&m_sdc_read_us, us);
+    }
+}
+
+/**
+ * Registers the built-in metrics, to be invoked once after the kernel
+ * initialization.
+ **/
+void sysmetricsInit(void)
+{
+    metricsRegister(&m_switches);
+    metricsRegister(&m_irqs);
+    metricsRegister(&m_cpu_ms);
+    metricsRegister(&m_irq_ms);
+    metricsRegister(&m_idle_ms);
+    metricsRegister(&m_threads);
+#if CH_DBG_STATISTICS
+    metricsRegister(&m_crit_thd);
+    metricsRegister(&m_crit_isr);
+#endif
+    metricsRegister(&m_core_free);
+    metricsRegister(&m_heap_free);
+    metricsRegister(&m_heap_frags);
+#if LWIP_STATS
+    metricsRegister(&m_lwip_xmit);
+    metricsRegister(&m_lwip_recv);
+    metricsRegister(&m_lwip_drop);
+    metricsRegister(&m_lwip_errors);
+#if MEM_STATS
+    metricsRegister(&m_lwip_mem_used);
+    metricsRegister(&m_lwip_mem_max);
+    metricsRegister(&m_lwip_mem_err);
+#endif
+#if MEMP_STATS
+    metricsRegister(&m_lwip_memp_used);
+    metricsRegister(&m_lwip_memp_max);
+    metricsRegister(&m_lwip_memp_err);
+#endif
+#endif
+    metricsRegister(&m_sdc_read);
+    metricsRegister(&m_sdc_write);
+    metricsRegister(&m_sdc_errors);
+    metricsRegister(&m_sdc_read_us);
+    metricsRegister(&m_sdc_write_us);
+}
@@ -0,0 +1,446 @@
+#include "ch.h"
+#include "chprintf.h"
+#include "telemetry.h"
+#include "ringbuffer.h"
+#include "metrics.h"
+#include "globalconfig.h"
+#include "ccm.h"
+#include "web/websocket.h"
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    ip_addr_t addr;
+    uint16_t port;
+} telem_dest_t;
+
+/* A datagram buffer, the pbuf comes first so that the free callback
+   gets the buffer back. The destinations are copied in by the sender,
+   the lwIP thread never looks at the settings. */
+typedef struct {
+    struct pbuf_custom pc;
+    unsigned ndests;
+    telem_dest_t dests[TELEM_MAX_DESTS];
+    uint16_t len;
+    uint32_t data[(TELEM_DATAGRAM_SIZE + 3) / 4];
+} telem_buffer_t;
+
+static lockfree::MpscRing<telemsample_t, TELEM_RING_SIZE> ring;
+static telem_buffer_t buffers[TELEM_BUFFERS];
+static MEMORYPOOL_DECL(bufpool, sizeof(telem_buffer_t), NULL);
+
+/* Settings, written by the shell and the configuration loader. */
+static MUTEX_DECL(setmtx);
+static telem_dest_t dests[TELEM_MAX_DESTS];
+static unsigned ndests;
+static uint32_t rate;                   /* Bytes per second, 0 no limit.  */
+static systime_t period = MS2ST(10);
+static volatile bool running;
+
+/* lwIP thread only. */
+static struct udp_pcb *pcb;
+
+static volatile uint32_t genhz;
+static thread_t *genthd;
+
+static CCM_THD_WORKING_AREA(wa_telem, TELEM_THREAD_STACK_SIZE);
+static CCM_THD_WORKING_AREA(wa_telemgen, TELEM_THREAD_STACK_SIZE);
+
+static uint32_t read_ring(unsigned i)
+{
+    (void)i;
+    return (uint32_t)ring.size();
+}
+
+static METRIC_COUNTER_DECL(m_samples,
+        "telem_samples_total", "Telemetry samples pushed.");
+static METRIC_COUNTER_DECL(m_dropped,
+        "telem_dropped_total", "Telemetry samples dropped, ring full.");
+static METRIC_COUNTER_DECL(m_datagrams,
+        "telem_datagrams_total", "Telemetry datagrams sent.");
+static METRIC_COUNTER_DECL(m_bytes,
+        "telem_bytes_total", "Telemetry payload bytes sent.");
+static METRIC_COUNTER_DECL(m_errors,
+        "telem_errors_total", "Telemetry send failures.");
+static METRIC_COUNTER_DECL(m_throttled,
+        "telem_throttled_total", "Telemetry periods cut by the rate limit.");
+static METRIC_COUNTER_DECL(m_nobuf,
+        "telem_nobuf_total", "Telemetry periods cut by the buffer pool.");
+static METRIC_READ_DECL(m_ring, METRIC_GAUGE,
+        "telem_ring_samples", "Telemetry samples waiting.", read_ring);
+
+/*===========================================================================*/
+/* lwIP thread.                                                              */
+/*===========================================================================*/
+
+static void free_buffer(struct pbuf *p)
+{
+    chPoolFree(&bufpool, (telem_buffer_t *)(void *)p);
+}
+
+static void send_datagram(void *arg)
+{
+    telem_buffer_t *bp = (telem_buffer_t *)arg;
+    struct pbuf *p;
+    unsigned i;
+
+    if (pcb == NULL)
+        pcb = udp_new();
+    bp->pc.custom_free_function = free_buffer;
+    p = pbuf_alloced_custom(PBUF_RAW, bp->len, PBUF_REF, &bp->pc, bp->data,
+                            sizeof(bp->data));
+    if ((pcb == NULL) || (p == NULL)) {
+        metricInc(&m_errors);
+        chPoolFree(&bufpool, bp);
+        return;
+    }
+    /* udp_sendto() chains its own header pbuf in front, p is left as
+       it was and can go to the next destination. */
+    for (i = 0; i < bp->ndests; i++) {
+        if (udp_sendto(pcb, p, &bp->dests[i].addr, bp->dests[i].port) == ERR_OK) {
+            metricInc(&m_datagrams);
+            metricAdd(&m_bytes, bp->len);
+        }
+        else
+            metricInc(&m_errors);
+    }
+    pbuf_free(p);
+}
+
+/*===========================================================================*/
+/* Sender thread.                                                            */
+/*===========================================================================*/
+
+/**
+ * Sends n samples from the ring, returns false when they must wait.
+ **/
+static bool send_samples(size_t n, uint32_t seq, int32_t *tokens)
+{
+    telem_buffer_t *bp;
+    telemhdr_t *hdr;
+    size_t len = sizeof(telemhdr_t) + n * sizeof(telemsample_t);
+
+    if ((tokens != NULL) && (*tokens < (int32_t)len)) {
+        metricInc(&m_throttled);
+        return false;
+    }
+    bp = (telem_buffer_t *)chPoolAlloc(&bufpool);
+    if (bp == NULL) {
+        metricInc(&m_nobuf);
+        return false;
+    }
+    hdr = (telemhdr_t *)bp->data;
+    n = ring.popN((telemsample_t *)(hdr + 1), n);
+    hdr->magic = TELEM_MAGIC;
+    hdr->seq = seq;
+    hdr->dropped = m_dropped.value;
+    hdr->count = (uint16_t)n;
+    hdr->size = sizeof(telemsample_t);
+    bp->len = (uint16_t)(sizeof(telemhdr_t) + n * sizeof(telemsample_t));
+
+    /* The same datagram for the /ws/telemetry clients, copied once. */
+    wsBroadcast(WS_TOPIC_TELEMETRY, WS_OPCODE_BINARY, bp->data, bp->len, 0);
+
+    chMtxLock(&setmtx);
+    bp->ndests = ndests;
+    memcpy(bp->dests, dests, sizeof(dests));
+    chMtxUnlock(&setmtx);
+
+    if (tcpip_callback(send_datagram, bp) != ERR_OK) {
+        metricInc(&m_errors);
+        chPoolFree(&bufpool, bp);
+        return false;
+    }
+    if (tokens != NULL)
+        *tokens -= (int32_t)bp->len;
+    return true;
+}
+
+static THD_FUNCTION(telem_thread, arg)
+{
+    systime_t last = chVTGetSystemTime(), now, per;
+    uint32_t seq = 0, bps;
+    int32_t tokens = 0, burst;
+    bool waited = false;
+    size_t n;
+
+    (void)arg;
+    chRegSetThreadName("telemetry");
+
+    while (true) {
+        chMtxLock(&setmtx);
+        per = period;
+        bps = rate;
+        chMtxUnlock(&setmtx);
+        chThdSleep(per);
+        now = chVTGetSystemTime();
+
+        /* The bucket holds two periods, at least one full datagram. */
+        if (bps > 0) {
+            burst = (int32_t)((uint64_t)bps * per * 2 / CH_CFG_ST_FREQUENCY);
+            if (burst < TELEM_DATAGRAM_SIZE)
+                burst = TELEM_DATAGRAM_SIZE;
+            tokens += (int32_t)((uint64_t)bps * (systime_t)(now - last) /
+                                CH_CFG_ST_FREQUENCY);
+            if (tokens > burst)
+                tokens = burst;
+        }
+        last = now;
+        if (!running)
+            continue;
+
+        while ((n = ring.size()) >= TELEM_SAMPLES_PER_DATAGRAM) {
+            if (!send_samples(TELEM_SAMPLES_PER_DATAGRAM, seq,
+                              bps > 0 ? &tokens : NULL))
+                break;
+            seq++;
+            waited = false;
+        }
+        if ((n > 0) && (n < TELEM_SAMPLES_PER_DATAGRAM)) {
+            if (waited && send_samples(n, seq, bps > 0 ? &tokens : NULL)) {
+                seq++;
+                waited = false;
+            }
+            else
+                waited = true;
+        }
+        else
+            waited = false;
+    }
+}
+
+/**
+ * Test source, pushes genhz samples per second on channel 0 with the
+ * sample number, the rate and the tick in the values.
+ **/
+static THD_FUNCTION(telemgen_thread, arg)
+{
+    systime_t last = chVTGetSystemTime(), now;
+    uint64_t due = 0;
+    uint32_t n = 0, hz;
+
+    (void)arg;
+    chRegSetThreadName("telemgen");
+
+    while (true) {
+        chThdSleep(1);
+        now = chVTGetSystemTime();
+        hz = genhz;
+        due += (uint64_t)hz * (systime_t)(now - last);
+        last = now;
+        if (hz == 0) {
+            due = 0;
+            continue;
+        }
+        for (; due >= CH_CFG_ST_FREQUENCY; due -= CH_CFG_ST_FREQUENCY)
+            (void)telemPush(0, 0, (int32_t)n++, (int32_t)hz, (int32_t)now);
+    }
+}
+
+/*===========================================================================*/
+/* Exported functions.                                                       */
+/*===========================================================================*/
+
+/**
+ * Starts the sender thread and registers the metrics, then applies the
+ * configuration. To be called once after lwipInit().
+ **/
+void telemInit(void)
+{
+    size_t i;
+
+    for (i = 0; i < TELEM_BUFFERS; i++)
+        chPoolFree(&bufpool, &buffers[i]);
+    metricsRegister(&m_samples);
+    metricsRegister(&m_dropped);
+    metricsRegister(&m_datagrams);
+    metricsRegister(&m_bytes);
+    metricsRegister(&m_errors);
+    metricsRegister(&m_throttled);
+    metricsRegister(&m_nobuf);
+    metricsRegister(&m_ring);
+    chThdCreateStatic(wa_telem, sizeof(wa_telem), TELEM_THREAD_PRIORITY,
+                      telem_thread, NULL);
+    telemConfigure();
+}
+
+/**
+ * Applies the [telemetry] keys of the configuration: dest, rate, period
+ * and enable.
+ **/
+void telemConfigure(void)
+{
+    int32_t v;
+
+    if (telemSetDests(configStr(CONFIG_KEY("telemetry", "dest")).ptr) < 0)
+        telemSetDests("");
+    v = configInt(CONFIG_KEY("telemetry", "rate"));
+    telemSetRate(v > 0 ? (uint32_t)v : 0);
+    v = configInt(CONFIG_KEY("telemetry", "period"));
+    telemSetPeriod(v > 0 ? (uint32_t)v : 10);
+    if (configBool(CONFIG_KEY("telemetry", "enable")))
+        telemStart();
+    else
+        telemStop();
+}
+
+/**
+ * Replaces the destinations by a list of "address[:port]" separated by
+ * spaces or commas. Returns the number of destinations, or -1 if the
+ * list does not parse, the destinations are then unchanged.
+ **/
+int telemSetDests(const char *list)
+{
+    telem_dest_t tmp[TELEM_MAX_DESTS];
+    char text[24];
+    const char *p = list, *colon;
+    unsigned n = 0;
+    size_t len;
+    long port;
+
+    while (true) {
+        p += strspn(p, " ,");
+        if (*p == '\0')
+            break;
+        len = strcspn(p, " ,");
+        if ((n == TELEM_MAX_DESTS) || (len >= sizeof(text)))
+            return -1;
+        memcpy(text, p, len);
+        text[len] = '\0';
+        p += len;
+        port = TELEM_DEFAULT_PORT;
+        colon = strchr(text, ':');
+        if (colon != NULL) {
+            port = strtol(colon + 1, NULL, 10);
+            text[colon - text] = '\0';
+        }
+        if ((port <= 0) || (port > 65535) || !ipaddr_aton(text, &tmp[n].addr))
+            return -1;
+        tmp[n++].port = (uint16_t)port;
+    }
+
+    chMtxLock(&setmtx);
+    memcpy(dests, tmp, n * sizeof(tmp[0]));
+    ndests = n;
+    chMtxUnlock(&setmtx);
+    return (int)n;
+}
+
+/**
+ * Rate limit in kB/s, 0 for none.
+ **/
+void telemSetRate(uint32_t kbytes)
+{
+    chMtxLock(&setmtx);
+    rate = kbytes * 1000U;
+    chMtxUnlock(&setmtx);
+}
+
+/**
+ * Wake up period of the sender.
+ **/
+void telemSetPeriod(uint32_t ms)
+{
+    systime_t t = MS2ST(ms);
+
+    chMtxLock(&setmtx);
+    period = t > 0 ? t : 1;
+    chMtxUnlock(&setmtx);
+}
+
+/**
+ * Starts or stops the streaming, telemPush() refuses the samples while
+ * the streamer is stopped.
+ **/
+void telemStart(void)
+{
+    running = true;
+}
+
+void telemStop(void)
+{
+    running = false;
+}
+
+bool telemRunning(void)
+{
+    return running;
+}
+
+/**
+ * Appends a sample, from any thread or interrupt handler. Returns false
+ * if the streamer is stopped or the ring is full, the latter counted as
+ * a drop.
+ **/
+bool telemPush(unsigned channel, unsigned flags, int32_t v0, int32_t v1,
+               int32_t v2)
+{
+    telemsample_t s;
+
+    if (!running)
+        return false;
+    s.time = (uint32_t)chSysGetRealtimeCounterX();
+    s.channel = (uint16_t)channel;
+    s.flags = (uint16_t)flags;
+    s.value[0] = v0;
+    s.value[1] = v1;
+    s.value[2] = v2;
+    if (!ring.push(s)) {
+        metricInc(&m_dropped);
+        return false;
+    }
+    metricInc(&m_samples);
+    return true;
+}
+
+void telemGetStats(telemstats_t *sp)
+{
+    sp->samples = m_samples.value;
+    sp->dropped = m_dropped.value;
+    sp->datagrams = m_datagrams.value;
+    sp->bytes = m_bytes.value;
+    sp->errors = m_errors.value;
+    sp->throttled = m_throttled.value;
+    sp->nobuf = m_nobuf.value;
+}
+
+/**
+ * Writes the destinations as telemSetDests() takes them, returns the
+ * length.
+ **/
+size_t telemFormatDests(char *buf, size_t size)
+{
+    char addr[16];
+    size_t len = 0;
+    unsigned i;
+
+    if (size == 0)
+        return 0;
+    buf[0] = '\0';
+    chMtxLock(&setmtx);
+    for (i = 0; (i < ndests) && (len < size); i++) {
+        ipaddr_ntoa_r(&dests[i].addr, addr, sizeof(addr));
+        len += chsnprintf(buf + len, size - len, "%s%s:%u", i > 0 ? " " : "",
+                          addr, dests[i].port);
+    }
+    chMtxUnlock(&setmtx);
+    return len < size ? len : size - 1;
+}
+
+/**
+ * Runs the test source at hz samples per second, 0 stops it.
+ **/
+void telemGenerate(uint32_t hz)
+{
+    genhz = hz;
+    if ((hz > 0) && (genthd == NULL))
+        genthd = chThdCreateStatic(wa_telemgen, sizeof(wa_telemgen),
+                                   TELEM_THREAD_PRIORITY + 1, telemgen_thread,
+                                   NULL);
+}
@@ -0,0 +1,139 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+/**
+ * UDP telemetry streamer.
+ *
+ * Producers, threads or interrupt handlers, append fixed format samples
+ * with telemPush() to a lock-free MPSC ring (ringbuffer.h), a full ring
+ * drops the sample and counts it. The sender thread wakes up every
+ * period, packs the samples into datagrams of up to TELEM_DATAGRAM_SIZE
+ * bytes, a telemhdr_t and the samples, in buffers of a small pool and
+ * hands them to the lwIP thread. There a custom PBUF_REF pbuf pointing
+ * to the buffer is sent with the raw UDP API to every destination, lwIP
+ * only allocates the headers, and the buffer returns to the pool when
+ * the pbuf is freed.
+ *
+ * Full datagrams are sent at the first wake up after the samples are
+ * there, the rest once it has waited a whole period, so a sample waits
+ * at most two periods and the datagrams stay full at high rates. The
+ * rate limit is a token bucket on the datagram bytes, the samples wait
+ * in the ring while it is empty.
+ *
+ * The datagrams carry a sequence number for the loss detection and the
+ * count of the samples dropped on the board, all little endian. See
+ * tools/telemrecv.cpp for a receiver that measures the throughput and
+ * the losses. The settings come from the [telemetry] section of the
+ * configuration (appconfig.cpp), the counters are exported as metrics.
+ *
+ * This header is shared with the host tool so it must stay plain C and
+ * must not depend on the kernel types.
+ **/
+
+/**
+ * Samples in the ring, must be a power of two.
+ **/
+#if !defined(TELEM_RING_SIZE)
+#define TELEM_RING_SIZE         512
+#endif
+
+/**
+ * Largest UDP payload, 1472 fits the 1500 bytes Ethernet MTU.
+ **/
+#if !defined(TELEM_DATAGRAM_SIZE)
+#define TELEM_DATAGRAM_SIZE     1472
+#endif
+
+/**
+ * Datagram buffers, also the number of datagrams in flight.
+ **/
+#if !defined(TELEM_BUFFERS)
+#define TELEM_BUFFERS           4
+#endif
+
+/**
+ * Maximum number of destinations.
+ **/
+#if !defined(TELEM_MAX_DESTS)
+#define TELEM_MAX_DESTS         4
+#endif
+
+/**
+ * Stack of the sender thread and of the test generator.
+ **/
+#if !defined(TELEM_THREAD_STACK_SIZE)
+#define TELEM_THREAD_STACK_SIZE 512
+#endif
+
+#if !defined(TELEM_THREAD_PRIORITY)
+#define TELEM_THREAD_PRIORITY   (NORMALPRIO + 1)
+#endif
+
+#define TELEM_MAGIC             0x314D4C54U     /* "TLM1"               */
+#define TELEM_DEFAULT_PORT      5005
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Datagram header, 16 bytes.
+ **/
+typedef struct {
+  uint32_t magic;               /* TELEM_MAGIC.                         */
+  uint32_t seq;                 /* Datagram number, from 0 at start.    */
+  uint32_t dropped;             /* Samples dropped on the board.        */
+  uint16_t count;               /* Samples in the datagram.             */
+  uint16_t size;                /* sizeof(telemsample_t).               */
+} telemhdr_t;
+
+/**
+ * One sample, 20 bytes, e.g. the three axes of an accelerometer, ADC
+ * conversions or counters.
+ **/
+typedef struct {
+  uint32_t time;                /* Realtime counter, see cycles.h.      */
+  uint16_t channel;             /* Source, defined by the producer.     */
+  uint16_t flags;               /* Defined by the producer.             */
+  int32_t value[3];
+} telemsample_t;
+
+#define TELEM_SAMPLES_PER_DATAGRAM                                          \
+  ((TELEM_DATAGRAM_SIZE - sizeof(telemhdr_t)) / sizeof(telemsample_t))
+
+/**
+ * Counters, also exported as the telem_* metrics.
+ **/
+typedef struct {
+  uint32_t samples;             /* Pushed into the ring.                */
+  uint32_t dropped;             /* Ring full.                           */
+  uint32_t datagrams;           /* Sent, once per destination.          */
+  uint32_t bytes;               /* UDP payload bytes sent.              */
+  uint32_t errors;              /* Send or lwIP message failures.       */
+  uint32_t throttled;           /* Periods cut short by the rate limit. */
+  uint32_t nobuf;               /* Periods cut short by the pool.       */
+} telemstats_t;
+
+void telemInit(void);
+void telemConfigure(void);
+int telemSetDests(const char *list);
+void telemSetRate(uint32_t kbytes);
+void telemSetPeriod(uint32_t ms);
+void telemStart(void);
+void telemStop(void);
+bool telemRunning(void);
+bool telemPush(unsigned channel, unsigned flags, int32_t v0, int32_t v1,
+               int32_t v2);
+void telemGetStats(telemstats_t *sp);
+size_t telemFormatDests(char *buf, size_t size);
+void telemGenerate(uint32_t hz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
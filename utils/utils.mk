@@ -1,9 +1,26 @@
 UTILSSRC = $(UTILS)/direntx.cpp \
 	$(UTILS)/shellutils.cpp \
 	$(UTILS)/iniutils.cpp \
+	$(UTILS)/iniparser.cpp \
 	$(UTILS)/dictionary.cpp \
-	$(UTILS)/globalconfig.cpp
+	$(UTILS)/globalconfig.cpp \
+	$(UTILS)/cfgimage.cpp \
+	$(UTILS)/cpuload.cpp \
+	$(UTILS)/evtrace.cpp \
+	$(UTILS)/pcprof.cpp \
+	$(UTILS)/bench.cpp \
+	$(UTILS)/metrics.cpp \
+	$(UTILS)/sysmetrics.cpp \
+	$(UTILS)/allocprof.cpp \
+	$(UTILS)/stackwm.cpp \
+	$(UTILS)/ccm.cpp \
+	$(UTILS)/chksum.cpp \
+	$(UTILS)/telemetry.cpp \
+	$(UTILS)/sha1.cpp
 
 
 UTILSINC = $(UTILS)/
 
+# Malloc wrappers of the allocation profiler, see allocprof.h.
+UTILSLDFLAGS = -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+
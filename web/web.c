@@ -33,17 +33,176 @@
 #include "lwip/api.h"
 
 #include "web.h"
+#include "websocket.h"
+#include "webassets.h"
+#include "evtrace.h"
+#include "pcprof.h"
+#include "allocprof.h"
+#include "metrics.h"
+#include "tmscope.h"
+#include "ccm.h"
+#include "chprintf.h"
+#include "ff.h"
+
+#include <string.h>
 
 #if LWIP_NETCONN
 
 static const char http_html_hdr[] = "HTTP/1.1 200 OK\r\nContent-type: text/html\r\n\r\n";
+static const char http_bin_hdr[] = "HTTP/1.1 200 OK\r\nContent-type: application/octet-stream\r\n\r\n";
+static const char http_metrics_hdr[] = "HTTP/1.1 200 OK\r\nContent-type: text/plain; version=0.0.4\r\n\r\n";
 static const char http_index_html[] = "<html><head><title>Congrats!</title></head><body><h1>Welcome to our lwIP HTTP server!</h1><p>This is a small test page.</body></html>";
+static const char http_file_hdr[] = "HTTP/1.1 200 OK\r\nContent-type: %s\r\nContent-Length: %u\r\n%sVary: Accept-Encoding\r\n\r\n";
+static const char http_gzip_hdr[] = "Content-Encoding: gzip\r\n";
+static const char http_404[] = "HTTP/1.1 404 Not Found\r\nContent-type: text/plain\r\n\r\nNot found\r\n";
+static const char http_406[] = "HTTP/1.1 406 Not Acceptable\r\nContent-type: text/plain\r\nVary: Accept-Encoding\r\n\r\nOnly gzip encoded\r\n";
+
+/* SD card mounted, see shell/fs.h.*/
+extern bool fs_ready;
+
+/* Path of the static file, WEB_ROOT, the URL path and room for ".gz".*/
+static char http_path[sizeof(WEB_ROOT) + WEB_PATH_SIZE + 3];
+static char http_hdr[160];
+static FIL http_file;
+static uint8_t http_file_buf[WEB_FILE_BUFFER_SIZE];
+
+/* Static files served, by source.*/
+static const char *const http_asset_sources[] = {
+  "rom_gzip", "rom", "sd_gzip", "sd"
+};
+static volatile uint32_t http_asset_hits[4];
+
+static uint32_t read_asset_hits(unsigned i) {
 
-static void http_server_serve(struct netconn *conn) {
+  return http_asset_hits[i];
+}
+
+static METRIC_FAMILY_DECL(m_assets, METRIC_COUNTER,
+    "http_assets_total", "Static files served.", read_asset_hits,
+    "source", http_asset_sources);
+static METRIC_COUNTER_DECL(m_asset_misses,
+    "http_asset_misses_total", "Static files not found or not acceptable.");
+static METRIC_COUNTER_DECL(m_asset_bytes,
+    "http_asset_bytes_total", "Static file bytes sent, as encoded.");
+
+/* evtraceSerialize(), pcprofSerialize(), allocprofSerialize() and
+   metricsExport() callback, the data is only stable while it runs.*/
+static int http_trace_write(void *ctx, const void *buf, size_t n) {
+
+  return netconn_write((struct netconn *)ctx, buf, n, NETCONN_COPY) != ERR_OK;
+}
+
+static void http_file_header(struct netconn *conn, const char *path,
+                             size_t len, uint32_t size, bool gzip) {
+  int n;
+
+  n = chsnprintf(http_hdr, sizeof(http_hdr), http_file_hdr,
+                 webContentType(path, len), (unsigned)size,
+                 gzip ? http_gzip_hdr : "");
+  netconn_write(conn, http_hdr, (size_t)n, NETCONN_COPY | NETCONN_MORE);
+}
+
+/* Sends an open file of the SD card.*/
+static void http_send_file(struct netconn *conn, FIL *fp) {
+  UINT n;
+
+  while (f_read(fp, http_file_buf, sizeof(http_file_buf), &n) == FR_OK &&
+         n > 0) {
+    if (netconn_write(conn, http_file_buf, n, NETCONN_COPY) != ERR_OK)
+      break;
+    metricAdd(&m_asset_bytes, n);
+  }
+}
+
+/*
+ * Serves a static file, from the asset bundle or else from WEB_ROOT on
+ * the SD card. The compressed variant is sent with Content-Encoding
+ * gzip when the request accepts it, "/" and the paths ending with a
+ * slash stand for their index.html.
+ */
+static void http_serve_file(struct netconn *conn, const char *req, size_t len) {
+  const char *path = req + 4;
+  const webasset_t *ap;
+  char *name = http_path + sizeof(WEB_ROOT) - 1;
+  size_t n = 0;
+  bool gzip;
+
+  while (4 + n < len && path[n] != ' ' && path[n] != '?' &&
+         path[n] != '\r' && path[n] != '\n')
+    n++;
+  if (n >= WEB_PATH_SIZE - 10 || memchr(path, '\0', n) != NULL) {
+    metricInc(&m_asset_misses);
+    netconn_write(conn, http_404, sizeof(http_404)-1, NETCONN_NOCOPY);
+    return;
+  }
+  memcpy(http_path, WEB_ROOT, sizeof(WEB_ROOT) - 1);
+  memcpy(name, path, n);
+  if (name[n - 1] == '/') {
+    memcpy(name + n, "index.html", 10);
+    n += 10;
+  }
+  name[n] = '\0';
+  gzip = webAcceptsGzip(req, len);
+
+  /* The bundle first, it is sent from flash without copies.*/
+  ap = webAssetFind(name, n, gzip);
+  if ((ap != NULL) && (gzip || (ap->flags & WEBASSET_GZIP) == 0U)) {
+    http_file_header(conn, name, n, ap->size, (ap->flags & WEBASSET_GZIP) != 0U);
+    if (netconn_write(conn, ap->data, ap->size, NETCONN_NOCOPY) == ERR_OK)
+      metricAdd(&m_asset_bytes, ap->size);
+    http_asset_hits[(ap->flags & WEBASSET_GZIP) ? 0 : 1]++;
+    return;
+  }
+
+  /* Then the SD card, FatFs does not resolve "..", the card is only
+     read below WEB_ROOT.*/
+  if (fs_ready && (strstr(name, "..") == NULL)) {
+    if (gzip) {
+      memcpy(name + n, ".gz", 4);
+      if (f_open(&http_file, http_path, FA_READ) == FR_OK) {
+        http_file_header(conn, name, n, f_size(&http_file), true);
+        http_send_file(conn, &http_file);
+        f_close(&http_file);
+        http_asset_hits[2]++;
+        return;
+      }
+      name[n] = '\0';
+    }
+    if (f_open(&http_file, http_path, FA_READ) == FR_OK) {
+      http_file_header(conn, name, n, f_size(&http_file), false);
+      http_send_file(conn, &http_file);
+      f_close(&http_file);
+      http_asset_hits[3]++;
+      return;
+    }
+  }
+
+  metricInc(&m_asset_misses);
+  if (ap != NULL) {
+    /* Only the compressed variant is in the bundle.*/
+    netconn_write(conn, http_406, sizeof(http_406)-1, NETCONN_NOCOPY);
+  }
+  else if (strcmp(name, "/index.html") == 0) {
+    /* Send the HTML header
+           * subtract 1 from the size, since we dont send the \0 in the string
+           * NETCONN_NOCOPY: our data is const static, so no need to copy it
+     */
+    netconn_write(conn, http_html_hdr, sizeof(http_html_hdr)-1, NETCONN_NOCOPY);
+
+    /* Send our HTML page */
+    netconn_write(conn, http_index_html, sizeof(http_index_html)-1, NETCONN_NOCOPY);
+  }
+  else
+    netconn_write(conn, http_404, sizeof(http_404)-1, NETCONN_NOCOPY);
+}
+
+/* Returns true if the connection was handed over to websocket.c.*/
+static bool http_server_serve(struct netconn *conn) {
   struct netbuf *inbuf;
   char *buf;
   u16_t buflen;
   err_t err;
+  TM_SCOPE("http_request");
 
   /* Read the data from the port, blocking if nothing yet there.
    We assume the request (the part we care about) is in one netbuf */
@@ -61,14 +220,36 @@ static void http_server_serve(struct netconn *conn) {
         buf[3]==' ' &&
         buf[4]=='/' ) {
 
-      /* Send the HTML header
-             * subtract 1 from the size, since we dont send the \0 in the string
-             * NETCONN_NOCOPY: our data is const static, so no need to copy it
-       */
-      netconn_write(conn, http_html_hdr, sizeof(http_html_hdr)-1, NETCONN_NOCOPY);
-
-      /* Send our HTML page */
-      netconn_write(conn, http_index_html, sizeof(http_index_html)-1, NETCONN_NOCOPY);
+      /* WebSocket endpoints, see websocket.h.*/
+      if (buflen >= 8 && strncmp(buf + 4, "/ws/", 4) == 0) {
+        if (wsUpgrade(conn, inbuf)) {
+          netbuf_delete(inbuf);
+          return true;
+        }
+      }
+      /* Binary kernel event trace, see tools/evtrace2json.py.*/
+      else if (buflen >= 14 && strncmp(buf + 4, "/trace.bin", 10) == 0) {
+        netconn_write(conn, http_bin_hdr, sizeof(http_bin_hdr)-1, NETCONN_NOCOPY);
+        evtraceSerialize(http_trace_write, conn);
+      }
+      /* PC samples of the profiler, see tools/pcprof.py.*/
+      else if (buflen >= 13 && strncmp(buf + 4, "/prof.bin", 9) == 0) {
+        netconn_write(conn, http_bin_hdr, sizeof(http_bin_hdr)-1, NETCONN_NOCOPY);
+        pcprofSerialize(http_trace_write, conn);
+      }
+      /* Allocation profiler tables, see tools/allocprof.py.*/
+      else if (buflen >= 14 && strncmp(buf + 4, "/alloc.bin", 10) == 0) {
+        netconn_write(conn, http_bin_hdr, sizeof(http_bin_hdr)-1, NETCONN_NOCOPY);
+        allocprofSerialize(http_trace_write, conn);
+      }
+      /* Metrics in the Prometheus text format.*/
+      else if (buflen >= 12 && strncmp(buf + 4, "/metrics", 8) == 0) {
+        netconn_write(conn, http_metrics_hdr, sizeof(http_metrics_hdr)-1, NETCONN_NOCOPY);
+        metricsExport(http_trace_write, conn, NULL, METRICS_EXPORT_PROMETHEUS);
+      }
+      /* Static files, see webassets.h.*/
+      else
+        http_serve_file(conn, buf, buflen);
     }
   }
   /* Close the connection (server closes in HTTP) */
@@ -77,12 +258,13 @@ static void http_server_serve(struct netconn *conn) {
   /* Delete the buffer (netconn_recv gives us ownership,
    so we have to make sure to deallocate the buffer) */
   netbuf_delete(inbuf);
+  return false;
 }
 
 /**
  * Stack area for the http thread.
  */
-THD_WORKING_AREA(wa_http_server, WEB_THREAD_STACK_SIZE);
+CCM_THD_WORKING_AREA(wa_http_server, WEB_THREAD_STACK_SIZE);
 
 /**
  * HTTP server thread.
@@ -94,8 +276,14 @@ THD_FUNCTION(http_server, p) {
   (void)p;
   chRegSetThreadName("http");
 
+  /* WebSocket thread, the accepted connections report their events to it.*/
+  wsInit();
+  metricsRegister(&m_assets);
+  metricsRegister(&m_asset_misses);
+  metricsRegister(&m_asset_bytes);
+
   /* Create a new TCP connection handle */
-  conn = netconn_new(NETCONN_TCP);
+  conn = netconn_new_with_callback(NETCONN_TCP, wsNetconnEvent);
   LWIP_ERROR("http_server: invalid conn", (conn != NULL), chThdExit(MSG_RESET););
 
   /* Bind to port 80 (HTTP) with default IP address */
@@ -111,8 +299,8 @@ THD_FUNCTION(http_server, p) {
     err = netconn_accept(conn, &newconn);
     if (err != ERR_OK)
       continue;
-    http_server_serve(newconn);
-    netconn_delete(newconn);
+    if (!http_server_serve(newconn))
+      netconn_delete(newconn);
   }
 }
 
@@ -36,6 +36,29 @@
 #define WEB_THREAD_PRIORITY     (LOWPRIO + 2)
 #endif
 
+/**
+ * @brief   Directory of the SD card with the static files.
+ * @details A path that is not in the asset bundle (webassets.h) is looked
+ *          up there, as path.gz first if the client accepts gzip.
+ */
+#ifndef WEB_ROOT
+#define WEB_ROOT                "/www"
+#endif
+
+/**
+ * @brief   Longest URL path of a static file.
+ */
+#ifndef WEB_PATH_SIZE
+#define WEB_PATH_SIZE           96
+#endif
+
+/**
+ * @brief   Read size of the static files of the SD card.
+ */
+#ifndef WEB_FILE_BUFFER_SIZE
+#define WEB_FILE_BUFFER_SIZE    1024
+#endif
+
 extern THD_WORKING_AREA(wa_http_server, WEB_THREAD_STACK_SIZE);
 
 #ifdef __cplusplus
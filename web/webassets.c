@@ -0,0 +1,198 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006-2013 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file webassets.c
+ * @brief Static assets of the HTTP server.
+ * @addtogroup WEB_THREAD
+ * @{
+ */
+
+#include "webassets.h"
+
+#include <string.h>
+
+static int lower(int c) {
+
+  return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/* Compares the bytes of a with the terminated string b.*/
+static int compare(const char *a, size_t len, const char *b) {
+  size_t i;
+
+  for (i = 0; i < len && b[i] != '\0'; i++) {
+    if (a[i] != b[i])
+      return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+  }
+  if (i < len)
+    return 1;
+  return b[i] != '\0' ? -1 : 0;
+}
+
+static bool iequal(const char *a, size_t len, const char *b) {
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    if (b[i] == '\0' || lower(a[i]) != b[i])
+      return false;
+  }
+  return b[i] == '\0';
+}
+
+static bool is_space(char c) {
+
+  return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief   Looks up an asset of the bundle.
+ *
+ * @param[in] path      URL path, not terminated
+ * @param[in] len       length of the path
+ * @param[in] gzip      the client accepts the compressed variant
+ * @return              The compressed variant if there is one and @p gzip
+ *                      is set, else the uncompressed one, else the
+ *                      compressed one, the caller must check its flags.
+ * @retval NULL         if the path is not in the bundle.
+ */
+const webasset_t *webAssetFind(const char *path, size_t len, bool gzip) {
+  unsigned lo = 0, hi = web_assets_count, mid;
+  const webasset_t *ap;
+
+  /* Leftmost entry of the path, the compressed variant is listed first.*/
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (compare(path, len, web_assets[mid].path) > 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo >= web_assets_count || compare(path, len, web_assets[lo].path) != 0)
+    return NULL;
+  ap = &web_assets[lo];
+  if (!gzip && (ap->flags & WEBASSET_GZIP) && lo + 1 < web_assets_count &&
+      compare(path, len, ap[1].path) == 0)
+    ap++;
+  return ap;
+}
+
+/**
+ * @brief   Checks the Accept-Encoding header of a request for gzip.
+ * @details The request is scanned up to the end of its header or of the
+ *          buffer. The client accepts gzip if it lists gzip, x-gzip or *
+ *          with a non zero quality value, an explicit gzip;q=0 wins over
+ *          *. Without the header the identity encoding only is assumed.
+ *
+ * @param[in] req       the request, not terminated
+ * @param[in] len       length of the request
+ */
+bool webAcceptsGzip(const char *req, size_t len) {
+  static const char name[] = "accept-encoding:";
+  const char *p = req, *end = req + len, *eol, *lend, *tok;
+  size_t n;
+  bool star = false, listed = false, ok = false, zero;
+
+  while (p < end) {
+    eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (eol == NULL)
+      eol = end;
+    n = (size_t)(eol - p);
+    if (n > 0 && p[n - 1] == '\r')
+      n--;
+    if (n == 0 && p != req)
+      break;                            /* End of the header.           */
+    if (n >= sizeof(name) - 1 && iequal(p, sizeof(name) - 1, name)) {
+      lend = p + n;
+      p += sizeof(name) - 1;
+      while (p < lend) {
+        /* One coding, "token [ ; q=value ]".*/
+        while (p < lend && (is_space(*p) || *p == ','))
+          p++;
+        tok = p;
+        while (p < lend && *p != ',' && *p != ';' && !is_space(*p))
+          p++;
+        n = (size_t)(p - tok);
+        zero = false;
+        while (p < lend && *p != ',') {
+          if ((*p == 'q' || *p == 'Q') && p + 1 < lend && p[1] == '=') {
+            /* Zero is "0", "0." or "0.000", anything else is not.*/
+            p += 2;
+            zero = p < lend && *p == '0';
+            if (zero) {
+              p++;
+              if (p < lend && *p == '.')
+                p++;
+              while (p < lend && *p == '0')
+                p++;
+              zero = p == lend || *p == ',' || *p == ';' || is_space(*p);
+            }
+            continue;
+          }
+          p++;
+        }
+        if (n == 1 && *tok == '*')
+          star = !zero;
+        else if (iequal(tok, n, "gzip") || iequal(tok, n, "x-gzip")) {
+          listed = true;
+          ok = !zero;
+        }
+      }
+    }
+    p = eol + 1;
+  }
+  return listed ? ok : star;
+}
+
+/**
+ * @brief   Content type of a path, from its extension.
+ *
+ * @param[in] path      the path, not terminated, without the .gz suffix
+ * @param[in] len       length of the path
+ */
+const char *webContentType(const char *path, size_t len) {
+  static const char *const types[][2] = {
+    {"html",    "text/html; charset=utf-8"},
+    {"htm",     "text/html; charset=utf-8"},
+    {"css",     "text/css"},
+    {"js",      "application/javascript"},
+    {"json",    "application/json"},
+    {"svg",     "image/svg+xml"},
+    {"png",     "image/png"},
+    {"jpg",     "image/jpeg"},
+    {"gif",     "image/gif"},
+    {"ico",     "image/x-icon"},
+    {"txt",     "text/plain; charset=utf-8"},
+    {"wasm",    "application/wasm"},
+  };
+  size_t i, n;
+
+  for (n = 0; n < len; n++) {
+    if (path[len - n - 1] == '.')
+      break;
+    if (path[len - n - 1] == '/')
+      return "application/octet-stream";
+  }
+  if (n < len) {
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+      if (iequal(path + len - n, n, types[i][0]))
+        return types[i][1];
+    }
+  }
+  return "application/octet-stream";
+}
+
+/** @} */
@@ -0,0 +1,70 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006-2013 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file webassets.h
+ * @brief Static assets of the HTTP server.
+ * @details The files of the www directory are compressed by
+ *          tools/mkassets.py at build time into a table in flash, the
+ *          bundle. A file is stored gzip compressed when that saves
+ *          space, and also uncompressed if mkassets.py is given -p.
+ *
+ *          The helpers below have no dependency on lwIP or FatFs, web.c
+ *          uses them for the bundle and for the files of the SD card.
+ * @addtogroup WEB_THREAD
+ * @{
+ */
+
+#ifndef _WEBASSETS_H_
+#define _WEBASSETS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief   Asset flag, the data is gzip compressed.
+ */
+#define WEBASSET_GZIP           1U
+
+/**
+ * @brief   Asset of the bundle.
+ */
+typedef struct {
+  const char            *path;          /**< @brief Absolute URL path.    */
+  const uint8_t         *data;
+  uint32_t              size;
+  uint32_t              flags;
+} webasset_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  /* The bundle, sorted by path with the compressed variant first, it is
+     defined by the file generated by tools/mkassets.py.*/
+  extern const webasset_t web_assets[];
+  extern const unsigned web_assets_count;
+
+  const webasset_t *webAssetFind(const char *path, size_t len, bool gzip);
+  bool webAcceptsGzip(const char *req, size_t len);
+  const char *webContentType(const char *path, size_t len);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _WEBASSETS_H_ */
+
+/** @} */
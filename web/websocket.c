@@ -0,0 +1,869 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006-2013 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file websocket.c
+ * @brief WebSocket (RFC 6455) push endpoints code.
+ * @addtogroup WEB_THREAD
+ * @{
+ */
+
+#include "ch.h"
+#include "chprintf.h"
+
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+#include "lwip/api.h"
+
+#include "websocket.h"
+#include "metrics.h"
+#include "sha1.h"
+#include "ccm.h"
+
+#include <string.h>
+#include <strings.h>
+
+#if LWIP_NETCONN
+
+#define WS_GUID                 "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/* Largest upgrade request, headers included.*/
+#define WS_REQUEST_SIZE         1024
+
+/* Largest header of a server frame, which is not masked.*/
+#define WS_HEADER_MAX           10
+
+/* Largest control frame payload.*/
+#define WS_CONTROL_MAX          125
+
+/* Room for the handshake response or one control frame.*/
+#define WS_RAW_SIZE             160
+
+#define WS_OPCODE_CONTINUATION  0x0U
+#define WS_OPCODE_CLOSE         0x8U
+#define WS_OPCODE_PING          0x9U
+#define WS_OPCODE_PONG          0xAU
+
+#define WS_CLOSE_NORMAL         1000U
+#define WS_CLOSE_PROTOCOL       1002U
+
+/* Client i is signaled with EVENT_MASK(i).*/
+#define EVT_BROADCAST           EVENT_MASK(WS_MAX_CLIENTS)
+
+/**
+ * @brief   Broadcast frame, the encoded frame ends the payload area.
+ */
+struct wsframe {
+  uint32_t              refs;
+  unsigned              topic;
+  size_t                size;           /* Payload capacity.            */
+  size_t                n;              /* Payload written.             */
+  uint8_t               *data;          /* Encoded frame.               */
+  size_t                len;
+  uint8_t               buf[];          /* Header room and payload.     */
+};
+
+/**
+ * @brief   A client connection.
+ * @details The connection and the receive events count are read by the
+ *          netconn callback in the lwIP thread and are only changed in a
+ *          critical zone. The queue is protected by @p ws_mtx, all the
+ *          rest belongs to the WebSocket thread once the slot is taken.
+ */
+typedef struct {
+  struct netconn        *conn;          /* NULL if the slot is free.    */
+  int                   rxevents;       /* Buffers to read.             */
+  unsigned              topics;
+  wsframe_t             *queue[WS_QUEUE_SIZE];
+  unsigned              qhead;
+  unsigned              qcount;
+  /* Send side.*/
+  wsframe_t             *cur;           /* Frame being sent.            */
+  size_t                off;
+  uint8_t               raw[WS_RAW_SIZE]; /* Sent between the frames.   */
+  size_t                rawlen;
+  size_t                rawoff;
+  unsigned              close;          /* Close status to send.        */
+  bool                  closing;        /* No more frames to send.      */
+  bool                  closesent;
+  /* Receive side.*/
+  uint8_t               hdr[14];
+  unsigned              hlen;
+  unsigned              hneed;
+  uint64_t              remain;         /* Payload bytes to come.       */
+  uint8_t               ctl[WS_CONTROL_MAX];
+  unsigned              ctllen;
+  unsigned              mpos;
+  systime_t             lastrx;
+  systime_t             pingtime;
+  bool                  pinged;
+} ws_client_t;
+
+static const struct {
+  const char            *path;
+  unsigned              topic;
+} ws_paths[] = {
+  {"/ws/metrics",       WS_TOPIC_METRICS},
+  {"/ws/telemetry",     WS_TOPIC_TELEMETRY},
+};
+
+static const char http_400[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+static const char http_404[] = "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n";
+static const char http_426[] = "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\nConnection: close\r\n\r\n";
+static const char http_503[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+
+static ws_client_t ws_clients[WS_MAX_CLIENTS];
+static MUTEX_DECL(ws_mtx);
+static volatile unsigned ws_topics;     /* Topics with subscribers.     */
+static thread_t *ws_thd;
+
+/* HTTP thread only.*/
+static char ws_request[WS_REQUEST_SIZE];
+
+static CCM_THD_WORKING_AREA(wa_websocket, WS_THREAD_STACK_SIZE);
+
+static uint32_t read_clients(unsigned i) {
+  uint32_t n = 0;
+
+  (void)i;
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (ws_clients[i].conn != NULL)
+      n++;
+  }
+  return n;
+}
+
+static METRIC_READ_DECL(m_clients, METRIC_GAUGE,
+    "ws_clients", "Connected WebSocket clients.", read_clients);
+static METRIC_COUNTER_DECL(m_frames,
+    "ws_frames_total", "Frames broadcast to at least one client.");
+static METRIC_COUNTER_DECL(m_bytes,
+    "ws_sent_bytes_total", "Frame bytes sent, all clients.");
+static METRIC_COUNTER_DECL(m_dropped,
+    "ws_dropped_total", "Frames dropped from the queue of a slow client.");
+static METRIC_COUNTER_DECL(m_coalesced,
+    "ws_coalesced_total", "Queued frames replaced by a newer one.");
+static METRIC_COUNTER_DECL(m_errors,
+    "ws_errors_total", "Refused upgrades, protocol errors and frame allocation failures.");
+
+static void frame_ref(wsframe_t *fp) {
+
+  __atomic_fetch_add(&fp->refs, 1U, __ATOMIC_RELAXED);
+}
+
+static void frame_release(wsframe_t *fp) {
+
+  if (__atomic_sub_fetch(&fp->refs, 1U, __ATOMIC_ACQ_REL) == 0U)
+    chHeapFree(fp);
+}
+
+/**
+ * @brief   Puts the header in front of the payload.
+ */
+static void frame_encode(wsframe_t *fp, unsigned opcode) {
+  size_t n = fp->n;
+  unsigned hlen, i;
+  uint8_t *p;
+
+  hlen = n < 126U ? 2U : n <= 0xFFFFU ? 4U : 10U;
+  p = fp->buf + WS_HEADER_MAX - hlen;
+  p[0] = (uint8_t)(0x80U | opcode);
+  if (hlen == 2U)
+    p[1] = (uint8_t)n;
+  else if (hlen == 4U) {
+    p[1] = 126U;
+    p[2] = (uint8_t)(n >> 8);
+    p[3] = (uint8_t)n;
+  }
+  else {
+    p[1] = 127U;
+    for (i = 0; i < 8U; i++)
+      p[2 + i] = (uint8_t)((uint64_t)n >> (56U - 8U * i));
+  }
+  fp->data = p;
+  fp->len = hlen + n;
+}
+
+/**
+ * @brief   Queues a frame to a client, @p ws_mtx held.
+ */
+static void enqueue(ws_client_t *c, wsframe_t *fp, unsigned flags) {
+  unsigned i, k;
+
+  if ((flags & WS_LATEST) != 0U) {
+    for (i = 0; i < c->qcount; i++) {
+      k = (c->qhead + i) % WS_QUEUE_SIZE;
+      if (c->queue[k]->topic == fp->topic) {
+        frame_release(c->queue[k]);
+        frame_ref(fp);
+        c->queue[k] = fp;
+        metricInc(&m_coalesced);
+        return;
+      }
+    }
+  }
+  /* Full, the oldest frame goes, the one being sent is not queued.*/
+  if (c->qcount == WS_QUEUE_SIZE) {
+    frame_release(c->queue[c->qhead]);
+    c->qhead = (c->qhead + 1U) % WS_QUEUE_SIZE;
+    c->qcount--;
+    metricInc(&m_dropped);
+  }
+  frame_ref(fp);
+  c->queue[(c->qhead + c->qcount) % WS_QUEUE_SIZE] = fp;
+  c->qcount++;
+}
+
+static wsframe_t *dequeue(ws_client_t *c) {
+  wsframe_t *fp = NULL;
+
+  chMtxLock(&ws_mtx);
+  if (c->qcount > 0U) {
+    fp = c->queue[c->qhead];
+    c->qhead = (c->qhead + 1U) % WS_QUEUE_SIZE;
+    c->qcount--;
+  }
+  chMtxUnlock(&ws_mtx);
+  return fp;
+}
+
+/**
+ * @brief   Recomputes the topics with subscribers, @p ws_mtx held.
+ */
+static void update_topics(void) {
+  unsigned i, topics = 0;
+
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (ws_clients[i].conn != NULL)
+      topics |= ws_clients[i].topics;
+  }
+  ws_topics = topics;
+}
+
+/**
+ * @brief   Closes the connection and frees the slot.
+ */
+static void drop(ws_client_t *c) {
+  struct netconn *conn = c->conn;
+
+  chMtxLock(&ws_mtx);
+  while (c->qcount > 0U) {
+    frame_release(c->queue[c->qhead]);
+    c->qhead = (c->qhead + 1U) % WS_QUEUE_SIZE;
+    c->qcount--;
+  }
+  chSysLock();
+  c->conn = NULL;
+  chSysUnlock();
+  update_topics();
+  chMtxUnlock(&ws_mtx);
+
+  if (c->cur != NULL) {
+    frame_release(c->cur);
+    c->cur = NULL;
+  }
+  netconn_close(conn);
+  netconn_delete(conn);
+}
+
+/**
+ * @brief   Prepares a control frame, a pending one is not overwritten.
+ *
+ * @return              @p false if a frame was pending, nothing is queued.
+ */
+static bool send_control(ws_client_t *c, unsigned opcode, const uint8_t *p,
+                         size_t n) {
+
+  if (c->rawlen > 0U)
+    return false;
+  c->raw[0] = (uint8_t)(0x80U | opcode);
+  c->raw[1] = (uint8_t)n;
+  memcpy(c->raw + 2, p, n);
+  c->rawlen = 2U + n;
+  c->rawoff = 0;
+  return true;
+}
+
+/**
+ * @brief   Sends a close frame after the current frame and then drops
+ *          the client.
+ */
+static void start_close(ws_client_t *c, unsigned status) {
+
+  if (!c->closing) {
+    c->closing = true;
+    c->close = status;
+  }
+}
+
+/**
+ * @brief   Writes without blocking, @p false on a connection error.
+ */
+static bool write_some(ws_client_t *c, const uint8_t *p, size_t n,
+                       size_t *written) {
+  err_t err;
+
+  *written = 0;
+  err = netconn_write_partly(c->conn, p, n, NETCONN_COPY | NETCONN_DONTBLOCK,
+                             written);
+  if ((err == ERR_WOULDBLOCK) || (err == ERR_MEM))
+    *written = 0;
+  else if (err != ERR_OK)
+    return false;
+  return true;
+}
+
+/**
+ * @brief   Sends as much as the connection takes.
+ * @details A control frame only goes between two data frames. The
+ *          netconn signals when there is room again.
+ *
+ * @return              @p false if the client must be dropped.
+ */
+static bool send_pending(ws_client_t *c) {
+  uint8_t close[4];
+  size_t n;
+
+  while (true) {
+    if (c->cur == NULL) {
+      if (c->rawoff < c->rawlen) {
+        if (!write_some(c, c->raw + c->rawoff, c->rawlen - c->rawoff, &n))
+          return false;
+        c->rawoff += n;
+        if (c->rawoff < c->rawlen)
+          return true;
+        c->rawlen = 0;
+        c->rawoff = 0;
+        if (c->closesent)
+          return false;
+        continue;
+      }
+      if (c->close != 0U) {
+        close[0] = (uint8_t)(c->close >> 8);
+        close[1] = (uint8_t)c->close;
+        c->close = 0;
+        c->closesent = true;
+        send_control(c, WS_OPCODE_CLOSE, close, 2);
+        continue;
+      }
+      if (c->closing)
+        return true;
+      c->cur = dequeue(c);
+      c->off = 0;
+      if (c->cur == NULL)
+        return true;
+    }
+    if (!write_some(c, c->cur->data + c->off, c->cur->len - c->off, &n))
+      return false;
+    c->off += n;
+    metricAdd(&m_bytes, (uint32_t)n);
+    if (c->off < c->cur->len)
+      return true;
+    frame_release(c->cur);
+    c->cur = NULL;
+  }
+}
+
+/**
+ * @brief   Validates a complete frame header.
+ */
+static bool header_done(ws_client_t *c) {
+  unsigned opcode = c->hdr[0] & 0x0FU, len = c->hdr[1] & 0x7FU, i;
+
+  /* No extension is negotiated and the clients must mask.*/
+  if (((c->hdr[0] & 0x70U) != 0U) || ((c->hdr[1] & 0x80U) == 0U))
+    return false;
+  if (len == 126U)
+    c->remain = ((uint64_t)c->hdr[2] << 8) | c->hdr[3];
+  else if (len == 127U) {
+    c->remain = 0;
+    for (i = 2; i < 10U; i++)
+      c->remain = (c->remain << 8) | c->hdr[i];
+    if ((c->remain >> 63) != 0U)
+      return false;
+  }
+  else
+    c->remain = len;
+  if (opcode >= WS_OPCODE_CLOSE) {
+    if ((opcode > WS_OPCODE_PONG) || ((c->hdr[0] & 0x80U) == 0U) ||
+        (c->remain > WS_CONTROL_MAX))
+      return false;
+  }
+  else if (opcode > WS_OPCODE_BINARY)
+    return false;
+  c->ctllen = 0;
+  c->mpos = 0;
+  return true;
+}
+
+/**
+ * @brief   Handles a complete frame, the data messages are discarded.
+ */
+static void frame_done(ws_client_t *c) {
+  unsigned status;
+
+  switch (c->hdr[0] & 0x0FU) {
+  case WS_OPCODE_PING:
+    send_control(c, WS_OPCODE_PONG, c->ctl, c->ctllen);
+    break;
+  case WS_OPCODE_CLOSE:
+    status = c->ctllen >= 2U ? ((unsigned)c->ctl[0] << 8) | c->ctl[1]
+                             : WS_CLOSE_NORMAL;
+    start_close(c, status);
+    break;
+  default:
+    break;
+  }
+  c->hlen = 0;
+  c->hneed = 2;
+}
+
+/**
+ * @brief   Parses the bytes received from a client.
+ */
+static void receive(ws_client_t *c, const uint8_t *p, size_t n) {
+  const uint8_t *mask;
+  size_t take, i;
+
+  while ((n > 0U) && !c->closing) {
+    if (c->hlen < c->hneed) {
+      c->hdr[c->hlen++] = *p++;
+      n--;
+      /* Extended length and masking key.*/
+      if (c->hlen == 2U)
+        c->hneed = 2U + ((c->hdr[1] & 0x7FU) == 126U ? 2U :
+                         (c->hdr[1] & 0x7FU) == 127U ? 8U : 0U) + 4U;
+      if (c->hlen == c->hneed) {
+        if (!header_done(c)) {
+          metricInc(&m_errors);
+          start_close(c, WS_CLOSE_PROTOCOL);
+          return;
+        }
+        if (c->remain == 0U)
+          frame_done(c);
+      }
+      continue;
+    }
+    take = c->remain < n ? (size_t)c->remain : n;
+    if ((c->hdr[0] & 0x0FU) >= WS_OPCODE_CLOSE) {
+      mask = c->hdr + c->hneed - 4U;
+      for (i = 0; i < take; i++)
+        c->ctl[c->ctllen++] = p[i] ^ mask[c->mpos++ & 3U];
+    }
+    p += take;
+    n -= take;
+    c->remain -= take;
+    if (c->remain == 0U)
+      frame_done(c);
+  }
+}
+
+/**
+ * @brief   Pings an idle client, drops one that does not answer.
+ *
+ * @return              @p false if the client must be dropped.
+ */
+static bool keepalive(ws_client_t *c) {
+
+  if (c->pinged)
+    return chVTTimeElapsedSinceX(c->pingtime) < MS2ST(WS_PING_INTERVAL);
+  /* Retried on the next call while another control frame is pending.*/
+  if (chVTTimeElapsedSinceX(c->lastrx) >= MS2ST(WS_PING_INTERVAL) &&
+      send_control(c, WS_OPCODE_PING, NULL, 0)) {
+    c->pinged = true;
+    c->pingtime = chVTGetSystemTime();
+  }
+  return true;
+}
+
+static void serve(ws_client_t *c) {
+  struct netbuf *nb;
+  void *data;
+  u16_t len;
+  int pending;
+
+  /* Only the announced buffers, netconn_recv() must not block.*/
+  while (true) {
+    chSysLock();
+    pending = c->rxevents;
+    chSysUnlock();
+    if (pending <= 0)
+      break;
+    if (netconn_recv(c->conn, &nb) != ERR_OK) {
+      drop(c);
+      return;
+    }
+    c->lastrx = chVTGetSystemTime();
+    c->pinged = false;
+    do {
+      netbuf_data(nb, &data, &len);
+      receive(c, (const uint8_t *)data, len);
+    } while (netbuf_next(nb) >= 0);
+    netbuf_delete(nb);
+  }
+  if (!c->closing && !keepalive(c)) {
+    drop(c);
+    return;
+  }
+  if (!send_pending(c))
+    drop(c);
+}
+
+static void publish_metrics(void) {
+  wsframe_t *fp;
+
+  if ((ws_topics & WS_TOPIC_METRICS) == 0U)
+    return;
+  fp = wsFrameAlloc(WS_METRICS_SIZE);
+  if (fp == NULL)
+    return;
+  if (metricsExport(wsFrameWrite, fp, NULL, 0) != 0) {
+    metricInc(&m_errors);
+    frame_release(fp);
+    return;
+  }
+  wsBroadcastFrame(fp, WS_TOPIC_METRICS, WS_OPCODE_TEXT, WS_LATEST);
+}
+
+/**
+ * @brief   WebSocket thread, serves all the clients.
+ */
+static THD_FUNCTION(websocket, p) {
+  systime_t published, elapsed;
+  unsigned i;
+
+  (void)p;
+  chRegSetThreadName("websocket");
+
+  published = chVTGetSystemTime();
+  while (true) {
+    /* Also a periodic retry of the writes that failed for memory.*/
+    elapsed = chVTTimeElapsedSinceX(published);
+    if (elapsed < MS2ST(WS_METRICS_PERIOD))
+      chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(WS_METRICS_PERIOD) - elapsed);
+    if (chVTTimeElapsedSinceX(published) >= MS2ST(WS_METRICS_PERIOD)) {
+      published = chVTGetSystemTime();
+      publish_metrics();
+    }
+    for (i = 0; i < WS_MAX_CLIENTS; i++) {
+      if (ws_clients[i].conn != NULL)
+        serve(&ws_clients[i]);
+    }
+  }
+}
+
+/**
+ * @brief   Returns @p true if the comma separated list contains the token.
+ */
+static bool has_token(const char *list, const char *token) {
+  size_t n = strlen(token);
+
+  while (*list != '\0') {
+    while ((*list == ' ') || (*list == ','))
+      list++;
+    if ((strncasecmp(list, token, n) == 0) &&
+        ((list[n] == '\0') || (list[n] == ',') || (list[n] == ' ')))
+      return true;
+    while ((*list != '\0') && (*list != ','))
+      list++;
+  }
+  return false;
+}
+
+/**
+ * @brief   Reads the whole upgrade request, terminated.
+ */
+static size_t read_request(struct netconn *conn, struct netbuf *inbuf) {
+  struct netbuf *nb;
+  size_t n;
+
+  n = netbuf_copy(inbuf, ws_request, sizeof(ws_request) - 1U);
+  ws_request[n] = '\0';
+  while (strstr(ws_request, "\r\n\r\n") == NULL) {
+    if ((n >= sizeof(ws_request) - 1U) || (netconn_recv(conn, &nb) != ERR_OK))
+      return 0;
+    n += netbuf_copy(nb, ws_request + n, sizeof(ws_request) - 1U - n);
+    ws_request[n] = '\0';
+    netbuf_delete(nb);
+  }
+  return n;
+}
+
+/*===========================================================================*/
+/* Exported functions.                                                       */
+/*===========================================================================*/
+
+/**
+ * @brief   Starts the WebSocket thread.
+ */
+void wsInit(void) {
+  unsigned i;
+
+  for (i = 0; i < WS_MAX_CLIENTS; i++)
+    ws_clients[i].conn = NULL;
+  metricsRegister(&m_clients);
+  metricsRegister(&m_frames);
+  metricsRegister(&m_bytes);
+  metricsRegister(&m_dropped);
+  metricsRegister(&m_coalesced);
+  metricsRegister(&m_errors);
+  ws_thd = chThdCreateStatic(wa_websocket, sizeof(wa_websocket),
+                             WS_THREAD_PRIORITY, websocket, NULL);
+}
+
+/**
+ * @brief   Returns the number of clients subscribed to any of the topics.
+ */
+unsigned wsSubscribers(unsigned topic) {
+  unsigned i, n = 0;
+
+  chMtxLock(&ws_mtx);
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if ((ws_clients[i].conn != NULL) && ((ws_clients[i].topics & topic) != 0U))
+      n++;
+  }
+  chMtxUnlock(&ws_mtx);
+  return n;
+}
+
+/**
+ * @brief   Allocates a frame for a payload of up to @p size bytes.
+ * @details The payload is appended with @p wsFrameWrite(), which is also
+ *          a @p metrics_write_t, then the frame is passed to
+ *          @p wsBroadcastFrame().
+ *
+ * @return              The frame, @p NULL if the heap is exhausted.
+ */
+wsframe_t *wsFrameAlloc(size_t size) {
+  wsframe_t *fp;
+
+  fp = chHeapAlloc(NULL, sizeof(wsframe_t) + WS_HEADER_MAX + size);
+  if (fp == NULL) {
+    metricInc(&m_errors);
+    return NULL;
+  }
+  fp->refs = 1;
+  fp->size = size;
+  fp->n = 0;
+  return fp;
+}
+
+/**
+ * @brief   Appends to the payload of a frame.
+ *
+ * @return              Zero, non zero if the payload would not fit.
+ */
+int wsFrameWrite(void *frame, const void *buf, size_t n) {
+  wsframe_t *fp = frame;
+
+  if (n > fp->size - fp->n)
+    return 1;
+  memcpy(fp->buf + WS_HEADER_MAX + fp->n, buf, n);
+  fp->n += n;
+  return 0;
+}
+
+/**
+ * @brief   Encodes a frame and queues it to the subscribers of a topic.
+ * @details The frame is encoded once and shared by the queues, the
+ *          reference of the caller is consumed.
+ *
+ * @param[in] fp        frame from @p wsFrameAlloc()
+ * @param[in] topic     one @p WS_TOPIC_ bit
+ * @param[in] opcode    @p WS_OPCODE_TEXT or @p WS_OPCODE_BINARY
+ * @param[in] flags     @p WS_LATEST or zero
+ * @return              The number of clients the frame is queued to.
+ */
+unsigned wsBroadcastFrame(wsframe_t *fp, unsigned topic, unsigned opcode,
+                          unsigned flags) {
+  unsigned i, n = 0;
+
+  frame_encode(fp, opcode);
+  fp->topic = topic;
+  chMtxLock(&ws_mtx);
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if ((ws_clients[i].conn != NULL) && ((ws_clients[i].topics & topic) != 0U)) {
+      enqueue(&ws_clients[i], fp, flags);
+      n++;
+    }
+  }
+  chMtxUnlock(&ws_mtx);
+  frame_release(fp);
+  if (n > 0U) {
+    metricInc(&m_frames);
+    chEvtSignal(ws_thd, EVT_BROADCAST);
+  }
+  return n;
+}
+
+/**
+ * @brief   Broadcasts a copy of @p n bytes to the subscribers of a topic.
+ * @note    Nothing is allocated when the topic has no subscribers.
+ *
+ * @return              The number of clients the frame is queued to.
+ */
+unsigned wsBroadcast(unsigned topic, unsigned opcode, const void *data,
+                     size_t n, unsigned flags) {
+  wsframe_t *fp;
+
+  if ((ws_topics & topic) == 0U)
+    return 0;
+  fp = wsFrameAlloc(n);
+  if (fp == NULL)
+    return 0;
+  wsFrameWrite(fp, data, n);
+  return wsBroadcastFrame(fp, topic, opcode, flags);
+}
+
+/**
+ * @brief   Upgrades an HTTP connection, called by the HTTP thread for a
+ *          GET of a /ws/ path.
+ * @details On success the connection belongs to the WebSocket thread,
+ *          which sends the handshake response. Otherwise an error
+ *          response has been sent and the caller closes the connection.
+ *
+ * @param[in] conn      the connection
+ * @param[in] inbuf     the first buffer of the request
+ * @return              @p true if the connection was taken over.
+ */
+bool wsUpgrade(struct netconn *conn, struct netbuf *inbuf) {
+  const char *resp = http_400, *key = NULL, *line, *end, *value;
+  bool upgrade = false, connection = false, version = false;
+  char *eol, accept[BASE64_ENCODED_SIZE(SHA1_DIGEST_SIZE) + 1];
+  uint8_t digest[SHA1_DIGEST_SIZE];
+  unsigned topic = 0, i;
+  ws_client_t *c = NULL;
+  size_t keylen = 0, n;
+  sha1_t sha;
+
+  if (read_request(conn, inbuf) == 0)
+    goto refuse;
+
+  /* "GET /ws/... HTTP/1.1", the query is ignored.*/
+  line = ws_request + 4;
+  end = line + strcspn(line, " ?\r\n");
+  for (i = 0; i < sizeof(ws_paths) / sizeof(ws_paths[0]); i++) {
+    n = strlen(ws_paths[i].path);
+    if (((size_t)(end - line) == n) && (strncmp(line, ws_paths[i].path, n) == 0))
+      topic = ws_paths[i].topic;
+  }
+  if (topic == 0U) {
+    resp = http_404;
+    goto refuse;
+  }
+
+  /* Headers, each line is terminated in place.*/
+  line = strstr(ws_request, "\r\n") + 2;
+  while (((eol = strstr(line, "\r\n")) != NULL) && (eol != line)) {
+    *eol = '\0';
+    value = strchr(line, ':');
+    if (value != NULL) {
+      n = (size_t)(value - line);
+      for (value++; *value == ' '; value++)
+        ;
+      if ((n == 7U) && (strncasecmp(line, "Upgrade", n) == 0))
+        upgrade = has_token(value, "websocket");
+      else if ((n == 10U) && (strncasecmp(line, "Connection", n) == 0))
+        connection = has_token(value, "Upgrade");
+      else if ((n == 17U) && (strncasecmp(line, "Sec-WebSocket-Key", n) == 0)) {
+        key = value;
+        keylen = strcspn(value, " ");
+      }
+      else if ((n == 21U) && (strncasecmp(line, "Sec-WebSocket-Version", n) == 0))
+        version = strcmp(value, "13") == 0;
+    }
+    line = eol + 2;
+  }
+  /* A nonce of 16 bytes in base64.*/
+  if (!upgrade || !connection || (key == NULL) || (keylen != 24U))
+    goto refuse;
+  if (!version) {
+    resp = http_426;
+    goto refuse;
+  }
+
+  sha1Init(&sha);
+  sha1Update(&sha, key, keylen);
+  sha1Update(&sha, WS_GUID, sizeof(WS_GUID) - 1U);
+  sha1Final(&sha, digest);
+  base64Encode(accept, sizeof(accept), digest, sizeof(digest));
+
+  chMtxLock(&ws_mtx);
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (ws_clients[i].conn == NULL) {
+      c = &ws_clients[i];
+      break;
+    }
+  }
+  if (c == NULL) {
+    chMtxUnlock(&ws_mtx);
+    resp = http_503;
+    goto refuse;
+  }
+  memset(c, 0, sizeof(*c));
+  c->topics = topic;
+  c->hneed = 2;
+  c->lastrx = chVTGetSystemTime();
+  c->rawlen = (size_t)chsnprintf((char *)c->raw, sizeof(c->raw),
+                                 "HTTP/1.1 101 Switching Protocols\r\n"
+                                 "Upgrade: websocket\r\n"
+                                 "Connection: Upgrade\r\n"
+                                 "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+  /* Nothing is received before the response, no event is missed.*/
+  chSysLock();
+  c->conn = conn;
+  chSysUnlock();
+  update_topics();
+  chMtxUnlock(&ws_mtx);
+  chEvtSignal(ws_thd, EVENT_MASK(i));
+  return true;
+
+refuse:
+  metricInc(&m_errors);
+  netconn_write(conn, resp, strlen(resp), NETCONN_NOCOPY);
+  return false;
+}
+
+/**
+ * @brief   Callback of the netconns of the HTTP server.
+ * @details Invoked by lwIP for every connection accepted by the server,
+ *          only those of the WebSocket clients are looked at.
+ */
+void wsNetconnEvent(struct netconn *conn, enum netconn_evt evt, u16_t len) {
+  unsigned i;
+
+  (void)len;
+  chSysLock();
+  for (i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (ws_clients[i].conn == conn) {
+      if (evt == NETCONN_EVT_RCVPLUS)
+        ws_clients[i].rxevents++;
+      else if (evt == NETCONN_EVT_RCVMINUS)
+        ws_clients[i].rxevents--;
+      if ((evt == NETCONN_EVT_RCVPLUS) || (evt == NETCONN_EVT_SENDPLUS) ||
+          (evt == NETCONN_EVT_ERROR)) {
+        chEvtSignalI(ws_thd, EVENT_MASK(i));
+        chSchRescheduleS();
+      }
+      break;
+    }
+  }
+  chSysUnlock();
+}
+
+#endif /* LWIP_NETCONN */
+
+/** @} */
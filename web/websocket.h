@@ -0,0 +1,141 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006-2013 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file websocket.h
+ * @brief WebSocket (RFC 6455) push endpoints of the HTTP server.
+ * @details A GET of one of the topic paths below with the upgrade headers
+ *          is handed over by web.c to this module, which keeps the
+ *          connection and pushes the frames broadcast to the topic until
+ *          the client goes away. A single thread serves all the clients
+ *          without blocking on any of them, it is woken up by the netconn
+ *          events of the connections and by the broadcasts.
+ *
+ *          A broadcast frame is encoded once, in a reference counted heap
+ *          buffer, and the same buffer is queued to every subscriber.
+ *          Each client has a bounded queue, when it is full the oldest
+ *          frame not yet started is dropped. A frame broadcast with
+ *          @p WS_LATEST replaces instead the queued frame of the same topic,
+ *          so a slow client of periodic snapshots only gets the newest one.
+ *
+ *          The server answers the pings and the close of the clients,
+ *          pings an idle client every @p WS_PING_INTERVAL and drops it
+ *          when it does not answer within another interval. The messages
+ *          of the clients are read and discarded.
+ * @addtogroup WEB_THREAD
+ * @{
+ */
+
+#ifndef _WEBSOCKET_H_
+#define _WEBSOCKET_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief   Maximum number of WebSocket clients.
+ * @note    Each takes a netconn and a TCP PCB, see lwipopts.h.
+ */
+#ifndef WS_MAX_CLIENTS
+#define WS_MAX_CLIENTS          3
+#endif
+
+/**
+ * @brief   Frames queued per client.
+ */
+#ifndef WS_QUEUE_SIZE
+#define WS_QUEUE_SIZE           8
+#endif
+
+/**
+ * @brief   Idle time in milliseconds before pinging a client.
+ */
+#ifndef WS_PING_INTERVAL
+#define WS_PING_INTERVAL        20000
+#endif
+
+/**
+ * @brief   Period in milliseconds of the /ws/metrics snapshots.
+ */
+#ifndef WS_METRICS_PERIOD
+#define WS_METRICS_PERIOD       1000
+#endif
+
+/**
+ * @brief   Largest /ws/metrics snapshot.
+ */
+#ifndef WS_METRICS_SIZE
+#define WS_METRICS_SIZE         8192
+#endif
+
+#ifndef WS_THREAD_STACK_SIZE
+#define WS_THREAD_STACK_SIZE    1024
+#endif
+
+#ifndef WS_THREAD_PRIORITY
+#define WS_THREAD_PRIORITY      (LOWPRIO + 3)
+#endif
+
+/**
+ * @name    Topics, one bit each.
+ * @{
+ */
+/** /ws/metrics: the metrics as the "stats" command lists them, text. */
+#define WS_TOPIC_METRICS        (1U << 0)
+/** /ws/telemetry: the telemetry datagrams of telemetry.h, binary. */
+#define WS_TOPIC_TELEMETRY      (1U << 1)
+/** @} */
+
+/**
+ * @name    Opcodes.
+ * @{
+ */
+#define WS_OPCODE_TEXT          0x1U
+#define WS_OPCODE_BINARY        0x2U
+/** @} */
+
+/**
+ * @brief   Broadcast flag, the frame supersedes the queued one of the topic.
+ */
+#define WS_LATEST               1U
+
+/**
+ * @brief   Type of a broadcast frame.
+ */
+typedef struct wsframe wsframe_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void wsInit(void);
+  unsigned wsSubscribers(unsigned topic);
+  wsframe_t *wsFrameAlloc(size_t size);
+  int wsFrameWrite(void *frame, const void *buf, size_t n);
+  unsigned wsBroadcastFrame(wsframe_t *fp, unsigned topic, unsigned opcode,
+                            unsigned flags);
+  unsigned wsBroadcast(unsigned topic, unsigned opcode, const void *data,
+                       size_t n, unsigned flags);
+#if defined(__LWIP_API_H__)
+  bool wsUpgrade(struct netconn *conn, struct netbuf *inbuf);
+  void wsNetconnEvent(struct netconn *conn, enum netconn_evt evt, u16_t len);
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _WEBSOCKET_H_ */
+
+/** @} */
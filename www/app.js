@@ -0,0 +1,62 @@
+// Live view of the metrics pushed every second on /ws/metrics, one
+// "name value" line each, see web/websocket.h.
+(function () {
+  'use strict';
+
+  var table = document.getElementById('metrics');
+  var status = document.getElementById('status');
+  var filter = document.getElementById('filter');
+  var rows = {};
+
+  function row(name) {
+    var tr = rows[name];
+    if (!tr) {
+      tr = document.createElement('tr');
+      tr.appendChild(document.createElement('td')).textContent = name;
+      tr.appendChild(document.createElement('td'));
+      table.appendChild(tr);
+      rows[name] = tr;
+    }
+    return tr;
+  }
+
+  function apply() {
+    var f = filter.value;
+    Object.keys(rows).forEach(function (name) {
+      rows[name].hidden = f !== '' && name.indexOf(f) < 0;
+    });
+  }
+
+  function update(text) {
+    text.split('\n').forEach(function (line) {
+      line = line.trim();
+      var sp = line.lastIndexOf(' ');
+      if (sp <= 0)
+        return;
+      var tr = row(line.slice(0, sp));
+      var value = line.slice(sp + 1);
+      tr.className = tr.lastChild.textContent !== value ? 'changed' : '';
+      tr.lastChild.textContent = value;
+    });
+    apply();
+  }
+
+  function connect() {
+    var ws = new WebSocket('ws://' + location.host + '/ws/metrics');
+    ws.onopen = function () {
+      status.textContent = 'live';
+      status.className = 'live';
+    };
+    ws.onmessage = function (ev) {
+      update(ev.data);
+    };
+    ws.onclose = function () {
+      status.textContent = 'disconnected';
+      status.className = '';
+      setTimeout(connect, 2000);
+    };
+  }
+
+  filter.oninput = apply;
+  connect();
+}());